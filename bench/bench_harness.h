@@ -0,0 +1,147 @@
+#pragma once
+// Minimal self-contained microbenchmark harness for obx8_bench.
+//
+// Each benchmark runs its body in batches until a time budget is used, repeats
+// that several times and reports the median nanoseconds per operation. Results
+// can be written as JSON and compared against a stored baseline.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+struct BenchResult {
+    std::string name;
+    double ns_per_op;
+    uint64_t iterations;
+};
+
+// Keeps the optimizer from discarding benchmark results
+template <typename T>
+inline void benchDoNotOptimize(const T& value) {
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+class BenchRunner {
+public:
+    BenchRunner() : filter_(""), repetitions_(5), min_batch_ms_(50.0) {}
+    
+    void setFilter(const std::string& filter) { filter_ = filter; }
+    void setRepetitions(int repetitions) { repetitions_ = std::max(1, repetitions); }
+    void setMinBatchMs(double min_batch_ms) { min_batch_ms_ = min_batch_ms; }
+    
+    // body(n) must perform n operations
+    void run(const std::string& name, const std::function<void(uint64_t)>& body) {
+        if (!filter_.empty() && name.find(filter_) == std::string::npos) {
+            return;
+        }
+        
+        // Grow the batch until it takes long enough to time reliably
+        uint64_t batch = 1;
+        double elapsed_ms = 0.0;
+        while (true) {
+            elapsed_ms = timeBatchMs(body, batch);
+            if (elapsed_ms >= min_batch_ms_ || batch >= (1ULL << 32)) {
+                break;
+            }
+            double scale = elapsed_ms > 0.0 ? (min_batch_ms_ * 1.2) / elapsed_ms : 10.0;
+            batch = static_cast<uint64_t>(batch * std::min(10.0, std::max(2.0, scale)));
+        }
+        
+        std::vector<double> samples;
+        samples.push_back(elapsed_ms * 1e6 / batch);
+        for (int i = 1; i < repetitions_; ++i) {
+            samples.push_back(timeBatchMs(body, batch) * 1e6 / batch);
+        }
+        std::sort(samples.begin(), samples.end());
+        
+        BenchResult result{name, samples[samples.size() / 2], batch * repetitions_};
+        std::printf("%-40s %14.1f ns/op %12llu iterations\n", result.name.c_str(), result.ns_per_op,
+                    static_cast<unsigned long long>(result.iterations));
+        std::fflush(stdout);
+        results_.push_back(result);
+    }
+    
+    const std::vector<BenchResult>& getResults() const { return results_; }
+    
+    bool writeJson(const std::string& path) const {
+        std::ofstream out(path);
+        if (!out) {
+            return false;
+        }
+        
+        out << "{\n  \"benchmarks\": [\n";
+        for (size_t i = 0; i < results_.size(); ++i) {
+            out << "    {\"name\": \"" << results_[i].name << "\", \"ns_per_op\": " << results_[i].ns_per_op
+                << ", \"iterations\": " << results_[i].iterations << "}" << (i + 1 < results_.size() ? "," : "") << "\n";
+        }
+        out << "  ]\n}\n";
+        return static_cast<bool>(out);
+    }
+    
+    // Reads the JSON written by writeJson() - name -> ns_per_op
+    static bool readJson(const std::string& path, std::map<std::string, double>& baseline) {
+        std::ifstream in(path);
+        if (!in) {
+            return false;
+        }
+        
+        std::stringstream buffer;
+        buffer << in.rdbuf();
+        std::string text = buffer.str();
+        
+        size_t pos = 0;
+        while ((pos = text.find("\"name\": \"", pos)) != std::string::npos) {
+            pos += 9;
+            size_t name_end = text.find('"', pos);
+            size_t value_pos = text.find("\"ns_per_op\": ", name_end);
+            if (name_end == std::string::npos || value_pos == std::string::npos) {
+                return false;
+            }
+            baseline[text.substr(pos, name_end - pos)] = std::strtod(text.c_str() + value_pos + 13, nullptr);
+            pos = value_pos;
+        }
+        return true;
+    }
+    
+    // Returns the number of benchmarks slower than baseline * (1 + tolerance)
+    int compareToBaseline(const std::map<std::string, double>& baseline, double tolerance) const {
+        int regressions = 0;
+        std::printf("\n%-40s %12s %12s %9s\n", "benchmark", "baseline", "current", "change");
+        for (const auto& result : results_) {
+            auto it = baseline.find(result.name);
+            if (it == baseline.end() || it->second <= 0.0) {
+                std::printf("%-40s %12s %12.1f %9s\n", result.name.c_str(), "-", result.ns_per_op, "new");
+                continue;
+            }
+            
+            double change = (result.ns_per_op - it->second) / it->second;
+            bool regressed = change > tolerance;
+            std::printf("%-40s %12.1f %12.1f %+8.1f%%%s\n", result.name.c_str(), it->second, result.ns_per_op,
+                        change * 100.0, regressed ? "  REGRESSION" : "");
+            if (regressed) {
+                ++regressions;
+            }
+        }
+        return regressions;
+    }
+    
+private:
+    std::string filter_;
+    int repetitions_;
+    double min_batch_ms_;
+    std::vector<BenchResult> results_;
+    
+    static double timeBatchMs(const std::function<void(uint64_t)>& body, uint64_t batch) {
+        auto start = std::chrono::steady_clock::now();
+        body(batch);
+        auto elapsed = std::chrono::steady_clock::now() - start;
+        return std::chrono::duration<double, std::milli>(elapsed).count();
+    }
+};
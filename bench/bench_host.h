@@ -0,0 +1,170 @@
+#pragma once
+// Stand-ins for the host side of the CLAP API used by the benchmarks: a host
+// with no-op callbacks, in-memory event lists and in-memory state streams.
+
+#include <clap/clap.h>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+inline const void* bench_host_get_extension(const clap_host_t *host, const char *extension_id) {
+    return nullptr;
+}
+
+inline void bench_host_request_restart(const clap_host_t *host) {
+}
+
+inline void bench_host_request_process(const clap_host_t *host) {
+}
+
+inline void bench_host_request_callback(const clap_host_t *host) {
+}
+
+static const clap_host_t bench_host = {
+    .clap_version = CLAP_VERSION_INIT,
+    .host_data = nullptr,
+    .name = "obx8_bench",
+    .vendor = "SPOBX8",
+    .url = "",
+    .version = "1.0.0",
+    .get_extension = bench_host_get_extension,
+    .request_restart = bench_host_request_restart,
+    .request_process = bench_host_request_process,
+    .request_callback = bench_host_request_callback
+};
+
+// Host input event list backed by a flat byte buffer
+class BenchInputEvents {
+public:
+    BenchInputEvents() {
+        list_.ctx = this;
+        list_.size = [](const clap_input_events_t *list) -> uint32_t {
+            return static_cast<uint32_t>(static_cast<const BenchInputEvents*>(list->ctx)->offsets_.size());
+        };
+        list_.get = [](const clap_input_events_t *list, uint32_t index) -> const clap_event_header_t* {
+            const BenchInputEvents *events = static_cast<const BenchInputEvents*>(list->ctx);
+            return reinterpret_cast<const clap_event_header_t*>(events->storage_.data() + events->offsets_[index]);
+        };
+    }
+    
+    void clear() {
+        storage_.clear();
+        offsets_.clear();
+    }
+    
+    void addParamValue(uint32_t time, clap_id param_id, double value) {
+        clap_event_param_value_t event = {};
+        event.header = {sizeof(event), time, CLAP_CORE_EVENT_SPACE_ID, CLAP_EVENT_PARAM_VALUE, 0};
+        event.param_id = param_id;
+        event.note_id = -1;
+        event.port_index = -1;
+        event.channel = -1;
+        event.key = -1;
+        event.value = value;
+        append(&event.header);
+    }
+    
+    void addParamMod(uint32_t time, clap_id param_id, double amount) {
+        clap_event_param_mod_t event = {};
+        event.header = {sizeof(event), time, CLAP_CORE_EVENT_SPACE_ID, CLAP_EVENT_PARAM_MOD, 0};
+        event.param_id = param_id;
+        event.note_id = -1;
+        event.port_index = -1;
+        event.channel = -1;
+        event.key = -1;
+        event.amount = amount;
+        append(&event.header);
+    }
+    
+    void addMidi(uint32_t time, uint8_t status, uint8_t data1, uint8_t data2) {
+        clap_event_midi_t event = {};
+        event.header = {sizeof(event), time, CLAP_CORE_EVENT_SPACE_ID, CLAP_EVENT_MIDI, 0};
+        event.port_index = 0;
+        event.data[0] = status;
+        event.data[1] = data1;
+        event.data[2] = data2;
+        append(&event.header);
+    }
+    
+    const clap_input_events_t* get() const { return &list_; }
+    
+private:
+    clap_input_events_t list_;
+    std::vector<uint8_t> storage_;
+    std::vector<size_t> offsets_;
+    
+    void append(const clap_event_header_t *header) {
+        // Keep every event 8-byte aligned inside the buffer
+        size_t offset = (storage_.size() + 7) & ~size_t(7);
+        storage_.resize(offset + header->size);
+        std::memcpy(storage_.data() + offset, header, header->size);
+        offsets_.push_back(offset);
+    }
+};
+
+// Host output event list that keeps the last block's events
+class BenchOutputEvents {
+public:
+    BenchOutputEvents() {
+        list_.ctx = this;
+        list_.try_push = [](const clap_output_events_t *list, const clap_event_header_t *event) -> bool {
+            BenchOutputEvents *events = static_cast<BenchOutputEvents*>(list->ctx);
+            const uint8_t *bytes = reinterpret_cast<const uint8_t*>(event);
+            events->storage_.insert(events->storage_.end(), bytes, bytes + event->size);
+            ++events->count_;
+            return true;
+        };
+    }
+    
+    void clear() {
+        storage_.clear();
+        count_ = 0;
+    }
+    
+    uint32_t count() const { return count_; }
+    const clap_output_events_t* get() const { return &list_; }
+    
+private:
+    clap_output_events_t list_;
+    std::vector<uint8_t> storage_;
+    uint32_t count_ = 0;
+};
+
+// In-memory clap_ostream_t / clap_istream_t
+class BenchStream {
+public:
+    BenchStream() : read_pos_(0) {
+        ostream_.ctx = this;
+        ostream_.write = [](const clap_ostream_t *stream, const void *buffer, uint64_t size) -> int64_t {
+            BenchStream *self = static_cast<BenchStream*>(stream->ctx);
+            const uint8_t *bytes = static_cast<const uint8_t*>(buffer);
+            self->data_.insert(self->data_.end(), bytes, bytes + size);
+            return static_cast<int64_t>(size);
+        };
+        istream_.ctx = this;
+        istream_.read = [](const clap_istream_t *stream, void *buffer, uint64_t size) -> int64_t {
+            BenchStream *self = static_cast<BenchStream*>(stream->ctx);
+            uint64_t available = self->data_.size() - self->read_pos_;
+            uint64_t count = size < available ? size : available;
+            std::memcpy(buffer, self->data_.data() + self->read_pos_, count);
+            self->read_pos_ += count;
+            return static_cast<int64_t>(count);
+        };
+    }
+    
+    void clear() {
+        data_.clear();
+        read_pos_ = 0;
+    }
+    
+    void rewind() { read_pos_ = 0; }
+    
+    const clap_ostream_t* output() const { return &ostream_; }
+    const clap_istream_t* input() const { return &istream_; }
+    
+private:
+    clap_ostream_t ostream_;
+    clap_istream_t istream_;
+    std::vector<uint8_t> data_;
+    uint64_t read_pos_;
+};
@@ -0,0 +1,232 @@
+// MIDI clock jitter benchmark - plays the host transport into a plugin instance
+// talking to the loopback device and measures when the clock ticks come back.
+//
+// Usage: obx8_clock_jitter_bench [--buffer FRAMES] [--rate HZ] [--tempo BPM]
+//                                [--seconds S] [--call-jitter FRACTION] [--max-p99-ms MS]
+//
+// A simulated host calls process() once per buffer, each call late by a random
+// fraction (up to --call-jitter) of the buffer period, the way a real audio
+// callback wanders. The loopback device delivers every send at its scheduled
+// timestamp and the arrival times are taken from a traffic capture. The report
+// compares the deviation of tick-to-tick intervals from the ideal interval with
+// what the same run would give if each tick went out when its block was processed.
+// The exit status is 1 when a tick is missing or extra, and with --max-p99-ms
+// when the measured p99 deviation exceeds it.
+
+#include "bench_host.h"
+#include "../src/obx8_plugin.h"
+#include "../src/midi_capture.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+static uint64_t steadyNowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Absolute deviation of consecutive intervals from the ideal one, in ms
+static std::vector<double> intervalDeviations(const std::vector<uint64_t>& times_ns, double ideal_ms) {
+    std::vector<double> deviations;
+    for (size_t i = 1; i < times_ns.size(); ++i) {
+        double interval_ms = (times_ns[i] - times_ns[i - 1]) / 1e6;
+        deviations.push_back(std::abs(interval_ms - ideal_ms));
+    }
+    std::sort(deviations.begin(), deviations.end());
+    return deviations;
+}
+
+static double percentile(const std::vector<double>& sorted, double fraction) {
+    if (sorted.empty()) {
+        return 0.0;
+    }
+    size_t index = std::min(sorted.size() - 1, static_cast<size_t>(sorted.size() * fraction));
+    return sorted[index];
+}
+
+static void printHistogram(const char* label, const std::vector<double>& deviations) {
+    static const double bounds_ms[] = {0.05, 0.1, 0.25, 0.5, 1.0, 2.0, 5.0, 10.0};
+    static const size_t bound_count = sizeof(bounds_ms) / sizeof(bounds_ms[0]);
+    
+    std::printf("%s: %zu intervals, median %.3f ms, p99 %.3f ms, max %.3f ms\n", label, deviations.size(),
+                percentile(deviations, 0.5), percentile(deviations, 0.99),
+                deviations.empty() ? 0.0 : deviations.back());
+    
+    size_t previous = 0;
+    for (size_t b = 0; b <= bound_count; ++b) {
+        size_t upto = b < bound_count
+            ? std::upper_bound(deviations.begin(), deviations.end(), bounds_ms[b]) - deviations.begin()
+            : deviations.size();
+        size_t count = upto - previous;
+        previous = upto;
+        
+        char range[32];
+        if (b < bound_count) {
+            std::snprintf(range, sizeof(range), "<= %.2f ms", bounds_ms[b]);
+        } else {
+            std::snprintf(range, sizeof(range), " > %.2f ms", bounds_ms[bound_count - 1]);
+        }
+        
+        double share = deviations.empty() ? 0.0 : 100.0 * count / deviations.size();
+        std::printf("  %-12s %6zu  %5.1f%%  %s\n", range, count, share,
+                    std::string(static_cast<size_t>(share / 2.0 + 0.5), '#').c_str());
+    }
+}
+
+int main(int argc, char **argv) {
+    uint32_t buffer_frames = 1024;
+    double sample_rate = 48000.0;
+    double tempo = 120.0;
+    double seconds = 10.0;
+    double call_jitter = 0.5;
+    double max_p99_ms = 0.0;
+    
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (i + 1 >= argc) {
+            std::fprintf(stderr, "Missing value for %s\n", arg.c_str());
+            return 2;
+        }
+        double value = std::atof(argv[++i]);
+        if (arg == "--buffer") {
+            buffer_frames = static_cast<uint32_t>(std::max(16.0, value));
+        } else if (arg == "--rate") {
+            sample_rate = value;
+        } else if (arg == "--tempo") {
+            tempo = value;
+        } else if (arg == "--seconds") {
+            seconds = value;
+        } else if (arg == "--call-jitter") {
+            call_jitter = std::max(0.0, std::min(1.0, value));
+        } else if (arg == "--max-p99-ms") {
+            max_p99_ms = value;
+        } else {
+            std::fprintf(stderr, "Unknown argument: %s\n", arg.c_str());
+            return 2;
+        }
+    }
+    if (sample_rate <= 0.0 || tempo <= 0.0 || seconds <= 0.0) {
+        std::fprintf(stderr, "Rate, tempo and duration must be positive\n");
+        return 2;
+    }
+    
+    const std::string capture_path = "obx8_clock_jitter.cap";
+    OBX8Plugin plugin(&bench_host);
+    plugin.init();
+    plugin.activate(sample_rate, buffer_frames, buffer_frames);
+    plugin.start_processing();
+    for (int i = 0; i < 500 && !plugin.isMidiReady(); ++i) {
+        plugin.on_main_thread();
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    plugin.selectMidiDevice(MidiDeviceManager::LOOPBACK_DEVICE_NAME);
+    if (!plugin.startCapture(capture_path)) {
+        std::fprintf(stderr, "Failed to open %s\n", capture_path.c_str());
+        return 2;
+    }
+    
+    double period_ns = buffer_frames * 1e9 / sample_rate;
+    double beats_per_frame = tempo / 60.0 / sample_rate;
+    uint64_t block_count = static_cast<uint64_t>(seconds * sample_rate / buffer_frames);
+    std::mt19937 random(12345);
+    std::uniform_real_distribution<double> lateness(0.0, call_jitter * period_ns);
+    
+    BenchInputEvents in_events;
+    BenchOutputEvents out_events;
+    std::vector<uint64_t> call_times_ns;
+    std::vector<uint64_t> quantized_ticks_ns;
+    int64_t next_tick = 0;
+    
+    uint64_t start_ns = steadyNowNs() + 50000000;
+    for (uint64_t block = 0; block < block_count; ++block) {
+        uint64_t call_ns = start_ns + static_cast<uint64_t>(block * period_ns + lateness(random));
+        std::this_thread::sleep_until(std::chrono::steady_clock::time_point(std::chrono::nanoseconds(call_ns)));
+        
+        double beats = block * buffer_frames * beats_per_frame;
+        clap_event_transport_t transport = {};
+        transport.header = {sizeof(transport), 0, CLAP_CORE_EVENT_SPACE_ID, CLAP_EVENT_TRANSPORT, 0};
+        transport.flags = CLAP_TRANSPORT_HAS_TEMPO | CLAP_TRANSPORT_HAS_BEATS_TIMELINE | CLAP_TRANSPORT_IS_PLAYING;
+        transport.tempo = tempo;
+        transport.song_pos_beats = static_cast<clap_beattime>(std::llround(beats * CLAP_BEATTIME_FACTOR));
+        
+        in_events.clear();
+        out_events.clear();
+        if (block == 0) {
+            in_events.addParamValue(0, MIDI_CLOCK_OUTPUT, 1.0);
+        }
+        
+        clap_process_t process = {};
+        process.steady_time = static_cast<int64_t>(block * buffer_frames);
+        process.frames_count = buffer_frames;
+        process.transport = &transport;
+        process.in_events = in_events.get();
+        process.out_events = out_events.get();
+        
+        uint64_t actual_call_ns = steadyNowNs();
+        plugin.process(&process);
+        call_times_ns.push_back(actual_call_ns);
+        
+        // Reference: every tick of this block sent when the block was processed
+        double block_end_ticks = (beats + buffer_frames * beats_per_frame) * MidiClockGenerator::PPQN;
+        while (next_tick < block_end_ticks) {
+            quantized_ticks_ns.push_back(actual_call_ns);
+            ++next_tick;
+        }
+    }
+    
+    // Let scheduled sends still pending in the loopback arrive
+    std::this_thread::sleep_for(std::chrono::nanoseconds(static_cast<uint64_t>(3 * period_ns)) +
+                                std::chrono::milliseconds(50));
+    plugin.stop_processing();
+    plugin.deactivate();
+    plugin.stopCapture();
+    plugin.destroy();
+    
+    std::vector<uint64_t> received_ticks_ns;
+    CaptureReader reader;
+    if (!reader.open(capture_path)) {
+        std::fprintf(stderr, "Failed to read %s\n", capture_path.c_str());
+        return 2;
+    }
+    CaptureRecord record;
+    while (reader.next(record)) {
+        if (record.type != CAPTURE_DEVICE_MIDI_IN) {
+            continue;
+        }
+        for (uint8_t byte : record.payload) {
+            if (byte == MidiClockGenerator::MIDI_CLOCK) {
+                received_ticks_ns.push_back(record.time_ns);
+            }
+        }
+    }
+    reader.close();
+    std::remove(capture_path.c_str());
+    
+    double ideal_ms = 60000.0 / tempo / MidiClockGenerator::PPQN;
+    std::printf("%.0f Hz, %u-frame buffer (%.2f ms), %.1f BPM (tick every %.3f ms), call jitter up to %.0f%% of a buffer\n",
+                sample_rate, buffer_frames, period_ns / 1e6, tempo, ideal_ms, call_jitter * 100.0);
+    std::printf("%zu ticks expected, %zu received\n\n", quantized_ticks_ns.size(), received_ticks_ns.size());
+    
+    std::vector<double> scheduled = intervalDeviations(received_ticks_ns, ideal_ms);
+    std::vector<double> quantized = intervalDeviations(quantized_ticks_ns, ideal_ms);
+    printHistogram("scheduled clock (measured on loopback)", scheduled);
+    std::printf("\n");
+    printHistogram("block-quantized clock (reference)", quantized);
+    
+    if (received_ticks_ns.size() != quantized_ticks_ns.size()) {
+        std::printf("\ntick count wrong: %zu expected, %zu received\n", quantized_ticks_ns.size(),
+                    received_ticks_ns.size());
+        return 1;
+    }
+    if (max_p99_ms > 0.0 && percentile(scheduled, 0.99) > max_p99_ms) {
+        std::printf("\np99 deviation above %.3f ms\n", max_p99_ms);
+        return 1;
+    }
+    return 0;
+}
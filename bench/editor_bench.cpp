@@ -0,0 +1,182 @@
+// Editor benchmark - what open SPOBX8Edit editors cost on the main thread, drawn
+// headless (no window system needed).
+//
+// Usage: obx8_editor_bench [--editors N] [--seconds S] [--moves-per-second M]
+//                          [--ppm FILE]
+//
+// N instances each open an editor with the headless window API. For S seconds of
+// frames at the editor's frame cap, the first instance gets M hardware knob
+// moves per second through its MIDI input and process(); every editor is then
+// updated once per frame. Reported: update() cost for the editor whose values
+// change and for the idle ones, and how many controls a frame redraws. A drag
+// across a control then checks that editor edits reach the parameter
+// and come back to the host as a gesture.
+// --ppm writes the first editor's canvas as a binary PPM image.
+
+#include "bench_host.h"
+#include "../src/obx8_plugin.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <vector>
+
+static bool writePPM(const EditorCanvas& canvas, const std::string& path) {
+    FILE *file = std::fopen(path.c_str(), "wb");
+    if (!file) {
+        return false;
+    }
+    std::fprintf(file, "P6\n%d %d\n255\n", canvas.width(), canvas.height());
+    std::vector<uint8_t> row(static_cast<size_t>(canvas.width()) * 3);
+    for (int y = 0; y < canvas.height(); ++y) {
+        for (int x = 0; x < canvas.width(); ++x) {
+            uint32_t pixel = canvas.pixel(x, y);
+            row[x * 3] = static_cast<uint8_t>(pixel >> 16);
+            row[x * 3 + 1] = static_cast<uint8_t>(pixel >> 8);
+            row[x * 3 + 2] = static_cast<uint8_t>(pixel);
+        }
+        std::fwrite(row.data(), 1, row.size(), file);
+    }
+    return std::fclose(file) == 0;
+}
+
+static void runBlock(OBX8Plugin& plugin, const BenchInputEvents& in, BenchOutputEvents& out, int64_t steady_time) {
+    clap_process_t process = {};
+    process.frames_count = 256;
+    process.steady_time = steady_time;
+    process.in_events = in.get();
+    process.out_events = out.get();
+    plugin.process(&process);
+}
+
+int main(int argc, char **argv) {
+    size_t editor_count = 16;
+    double seconds = 10.0;
+    double moves_per_second = 200.0;
+    std::string ppm_path;
+    
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (i + 1 >= argc) {
+            std::fprintf(stderr, "Missing value for %s\n", arg.c_str());
+            return 2;
+        }
+        std::string value = argv[++i];
+        if (arg == "--editors") {
+            editor_count = static_cast<size_t>(std::max(1, std::atoi(value.c_str())));
+        } else if (arg == "--seconds") {
+            seconds = std::atof(value.c_str());
+        } else if (arg == "--moves-per-second") {
+            moves_per_second = std::atof(value.c_str());
+        } else if (arg == "--ppm") {
+            ppm_path = value;
+        } else {
+            std::fprintf(stderr, "Unknown argument: %s\n", arg.c_str());
+            return 2;
+        }
+    }
+    
+    std::vector<std::unique_ptr<OBX8Plugin>> plugins;
+    for (size_t i = 0; i < editor_count; ++i) {
+        std::unique_ptr<OBX8Plugin> plugin(new OBX8Plugin(&bench_host));
+        plugin->init();
+        // Blocks run back to back; a realtime host mode keeps freewheel detection out of the numbers
+        plugin->render_set(CLAP_RENDER_REALTIME);
+        plugin->activate(48000.0, 256, 256);
+        plugin->start_processing();
+        if (!plugin->gui_create(EditorView::HEADLESS_API, false) || !plugin->gui_show()) {
+            std::fprintf(stderr, "Headless editor unavailable\n");
+            return 1;
+        }
+        plugins.push_back(std::move(plugin));
+    }
+    
+    BenchInputEvents no_events;
+    BenchOutputEvents out_events;
+    const uint64_t frame_ns = static_cast<uint64_t>(1e9 / EditorView::DEFAULT_MAX_FRAME_RATE);
+    uint64_t frame_count = static_cast<uint64_t>(seconds * EditorView::DEFAULT_MAX_FRAME_RATE);
+    double moves_per_frame = moves_per_second / EditorView::DEFAULT_MAX_FRAME_RATE;
+    
+    double active_ns = 0.0;
+    double idle_ns = 0.0;
+    uint64_t active_controls = 0;
+    uint64_t idle_controls = 0;
+    double move_budget = 0.0;
+    uint8_t knob = 0;
+    
+    for (uint64_t frame = 0; frame < frame_count; ++frame) {
+        // Hardware moves for this frame go through the audio path into the store
+        for (move_budget += moves_per_frame; move_budget >= 1.0; move_budget -= 1.0) {
+            knob = static_cast<uint8_t>((knob + 1) & 0x7F);
+            const uint8_t controller[] = {0xB0, 18, knob};
+            plugins[0]->receiveMidiData(controller, sizeof(controller));
+        }
+        runBlock(*plugins[0], no_events, out_events, static_cast<int64_t>(frame * 256));
+        out_events.clear();
+        
+        uint64_t now_ns = (frame + 1) * frame_ns;
+        for (size_t i = 0; i < plugins.size(); ++i) {
+            EditorView& editor = *plugins[i]->getEditorView();
+            uint64_t controls_before = editor.getControlsDrawn();
+            auto start = std::chrono::steady_clock::now();
+            editor.update(now_ns);
+            double elapsed = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+            // The first frame draws everything; leave it out
+            if (frame == 0) {
+                continue;
+            }
+            if (i == 0) {
+                active_ns += elapsed;
+                active_controls += editor.getControlsDrawn() - controls_before;
+            } else {
+                idle_ns += elapsed;
+                idle_controls += editor.getControlsDrawn() - controls_before;
+            }
+        }
+    }
+    
+    uint64_t measured = frame_count > 1 ? frame_count - 1 : 1;
+    size_t idle_count = std::max<size_t>(1, plugins.size() - 1);
+    std::printf("%zu editors, %.0f s at %.0f fps, %.0f hardware moves/s on the first\n", editor_count, seconds,
+                EditorView::DEFAULT_MAX_FRAME_RATE, moves_per_second);
+    std::printf("%-8s %16s %18s\n", "editor", "ns/update", "controls/frame");
+    std::printf("%-8s %16.1f %18.2f\n", "active", active_ns / measured, double(active_controls) / measured);
+    if (plugins.size() > 1) {
+        std::printf("%-8s %16.1f %18.2f\n", "idle", idle_ns / (measured * idle_count),
+                    double(idle_controls) / (measured * idle_count));
+    }
+    
+    // Drag the filter frequency bar from its left end to its right end
+    OBX8Plugin& plugin = *plugins[0];
+    EditorView& editor = *plugin.getEditorView();
+    EditorRect bar = editor.getControlBar(FILTER_FREQUENCY);
+    int bar_y = bar.y + bar.height / 2;
+    editor.mouseDown(bar.x, bar_y);
+    for (int x = bar.x; x < bar.x + bar.width; x += 2) {
+        editor.mouseDrag(x, bar_y);
+    }
+    editor.mouseDrag(bar.x + bar.width - 1, bar_y);
+    editor.mouseUp();
+    runBlock(plugin, no_events, out_events, static_cast<int64_t>(frame_count * 256));
+    
+    double value = 0.0;
+    plugin.params_get_value(FILTER_FREQUENCY, &value);
+    std::printf("drag: %u host events, filter frequency at %.3f, %llu edits dropped\n", out_events.count(), value,
+                static_cast<unsigned long long>(editor.getEditsDropped()));
+    
+    editor.update((frame_count + 1) * frame_ns);
+    if (!ppm_path.empty() && !writePPM(editor.canvas(), ppm_path)) {
+        std::fprintf(stderr, "Could not write %s\n", ppm_path.c_str());
+        return 1;
+    }
+    
+    for (auto& instance : plugins) {
+        instance->gui_destroy();
+        instance->stop_processing();
+        instance->deactivate();
+        instance->destroy();
+    }
+    return 0;
+}
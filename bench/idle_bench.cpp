@@ -0,0 +1,200 @@
+// Idle benchmark - what a project full of SPOBX8Edit instances costs while none
+// of them has anything to do, the usual state for most of a song.
+//
+// Usage: obx8_idle_bench [--instances N] [--seconds S] [--buffer FRAMES] [--rate HZ]
+//                        [--input-every BLOCKS] [--max-sleeping-percent P]
+//
+// Each instance gets empty blocks for S seconds of audio, run back to back on one
+// thread, in three passes:
+//   busy      - MIDI clock output is on with the transport stopped, which keeps
+//               every block on the full process() path (the cost before idle
+//               detection)
+//   early-out - a host that ignores CLAP_PROCESS_SLEEP and keeps calling
+//   sleeping  - a host that honours it and skips an instance until it asks to
+//               process again
+// Every --input-every blocks a hardware controller message reaches one instance,
+// which has to wake it. CPU is reported as a share of one core in real time.
+// With --max-sleeping-percent the exit status is 1 when the sleeping pass exceeds it.
+
+#include "bench_host.h"
+#include "../src/obx8_plugin.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <vector>
+
+enum IdlePass {
+    PASS_BUSY,
+    PASS_EARLY_OUT,
+    PASS_SLEEPING
+};
+
+// One host per instance so request_process() can tell which one asked
+struct IdleInstance {
+    clap_host_t host;
+    bool process_requested;
+    bool sleeping;
+    std::unique_ptr<OBX8Plugin> plugin;
+};
+
+static void idleHostRequestProcess(const clap_host_t *host) {
+    static_cast<IdleInstance*>(host->host_data)->process_requested = true;
+}
+
+struct PassResult {
+    double cpu_ms;
+    uint64_t process_calls;
+    uint64_t sleep_results;
+    uint64_t wakeups;
+};
+
+static PassResult runPass(IdlePass pass, std::vector<std::unique_ptr<IdleInstance>>& instances,
+                          uint64_t block_count, uint32_t buffer_frames, uint64_t input_every) {
+    BenchInputEvents empty_events;
+    BenchInputEvents clock_on;
+    clock_on.addParamValue(0, MIDI_CLOCK_OUTPUT, 1.0);
+    BenchInputEvents clock_off;
+    clock_off.addParamValue(0, MIDI_CLOCK_OUTPUT, 0.0);
+    BenchOutputEvents out_events;
+    
+    clap_process_t process = {};
+    process.frames_count = buffer_frames;
+    process.out_events = out_events.get();
+    
+    // Settle every instance into the pass's state outside the timed loop
+    for (auto& instance : instances) {
+        process.in_events = pass == PASS_BUSY ? clock_on.get() : clock_off.get();
+        instance->plugin->process(&process);
+        instance->sleeping = false;
+        instance->process_requested = false;
+    }
+    out_events.clear();
+    
+    PassResult result = {0.0, 0, 0, 0};
+    const uint8_t controller[] = {0xB0, 74, 64};
+    process.in_events = empty_events.get();
+    
+    auto start = std::chrono::steady_clock::now();
+    for (uint64_t block = 0; block < block_count; ++block) {
+        process.steady_time = static_cast<int64_t>(block * buffer_frames);
+        
+        if (input_every > 0 && block % input_every == 0) {
+            IdleInstance& target = *instances[(block / input_every) % instances.size()];
+            target.plugin->receiveMidiData(controller, sizeof(controller));
+        }
+        
+        for (auto& instance : instances) {
+            if (instance->sleeping) {
+                if (!instance->process_requested) {
+                    continue;
+                }
+                instance->sleeping = false;
+                ++result.wakeups;
+            }
+            instance->process_requested = false;
+            
+            clap_process_status status = instance->plugin->process(&process);
+            ++result.process_calls;
+            if (status == CLAP_PROCESS_SLEEP) {
+                ++result.sleep_results;
+                instance->sleeping = pass == PASS_SLEEPING;
+            }
+        }
+        out_events.clear();
+    }
+    result.cpu_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    return result;
+}
+
+int main(int argc, char **argv) {
+    size_t instance_count = 64;
+    double seconds = 60.0;
+    uint32_t buffer_frames = 256;
+    double sample_rate = 48000.0;
+    uint64_t input_every = 1000;
+    double max_sleeping_percent = 0.0;
+    
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (i + 1 >= argc) {
+            std::fprintf(stderr, "Missing value for %s\n", arg.c_str());
+            return 2;
+        }
+        double value = std::atof(argv[++i]);
+        if (arg == "--instances") {
+            instance_count = static_cast<size_t>(std::max(1.0, value));
+        } else if (arg == "--seconds") {
+            seconds = value;
+        } else if (arg == "--buffer") {
+            buffer_frames = static_cast<uint32_t>(std::max(16.0, value));
+        } else if (arg == "--rate") {
+            sample_rate = value;
+        } else if (arg == "--input-every") {
+            input_every = static_cast<uint64_t>(std::max(0.0, value));
+        } else if (arg == "--max-sleeping-percent") {
+            max_sleeping_percent = value;
+        } else {
+            std::fprintf(stderr, "Unknown argument: %s\n", arg.c_str());
+            return 2;
+        }
+    }
+    if (sample_rate <= 0.0 || seconds <= 0.0) {
+        std::fprintf(stderr, "Rate and duration must be positive\n");
+        return 2;
+    }
+    
+    std::vector<std::unique_ptr<IdleInstance>> instances;
+    for (size_t i = 0; i < instance_count; ++i) {
+        std::unique_ptr<IdleInstance> instance(new IdleInstance());
+        instance->host = bench_host;
+        instance->host.host_data = instance.get();
+        instance->host.request_process = idleHostRequestProcess;
+        instance->process_requested = false;
+        instance->sleeping = false;
+        instance->plugin.reset(new OBX8Plugin(&instance->host));
+        instance->plugin->init();
+        // Blocks run back to back; a realtime host mode keeps freewheel detection out of the numbers
+        instance->plugin->render_set(CLAP_RENDER_REALTIME);
+        instance->plugin->activate(sample_rate, buffer_frames, buffer_frames);
+        instance->plugin->start_processing();
+        instances.push_back(std::move(instance));
+    }
+    
+    uint64_t block_count = static_cast<uint64_t>(seconds * sample_rate / buffer_frames);
+    double real_time_ms = seconds * 1000.0;
+    std::printf("%zu instances, %.0f s of %u-frame blocks at %.0f Hz, hardware input every %llu blocks\n",
+                instance_count, seconds, buffer_frames, sample_rate, static_cast<unsigned long long>(input_every));
+    std::printf("%-10s %12s %10s %14s %12s %10s %8s\n", "pass", "cpu ms", "% core", "ns/inst-block",
+                "calls", "sleeps", "wakeups");
+    
+    static const char* const pass_names[] = {"busy", "early-out", "sleeping"};
+    double sleeping_percent = 0.0;
+    for (int pass = PASS_BUSY; pass <= PASS_SLEEPING; ++pass) {
+        PassResult result = runPass(static_cast<IdlePass>(pass), instances, block_count, buffer_frames, input_every);
+        double percent = 100.0 * result.cpu_ms / real_time_ms;
+        std::printf("%-10s %12.2f %10.4f %14.1f %12llu %10llu %8llu\n", pass_names[pass], result.cpu_ms, percent,
+                    result.cpu_ms * 1e6 / (double(block_count) * instance_count),
+                    static_cast<unsigned long long>(result.process_calls),
+                    static_cast<unsigned long long>(result.sleep_results),
+                    static_cast<unsigned long long>(result.wakeups));
+        if (pass == PASS_SLEEPING) {
+            sleeping_percent = percent;
+        }
+    }
+    
+    for (auto& instance : instances) {
+        instance->plugin->stop_processing();
+        instance->plugin->deactivate();
+        instance->plugin->destroy();
+    }
+    
+    if (max_sleeping_percent > 0.0 && sleeping_percent > max_sleeping_percent) {
+        std::fprintf(stderr, "Sleeping instances used %.4f%% of a core (limit %.4f%%)\n",
+                     sleeping_percent, max_sleeping_percent);
+        return 1;
+    }
+    return 0;
+}
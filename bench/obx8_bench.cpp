@@ -0,0 +1,367 @@
+// SPOBX8Edit microbenchmark suite.
+//
+// Usage: obx8_bench [--filter NAME] [--repetitions N] [--min-batch-ms MS]
+//                   [--json OUT.json] [--baseline BASELINE.json] [--tolerance 0.25]
+//
+// With --baseline the exit status is non-zero when any benchmark is slower than
+// its baseline by more than the tolerance, so a slower commit fails the check.
+
+#include "bench_harness.h"
+#include "bench_host.h"
+#include "../src/obx8_plugin.h"
+#include "../src/obx8_parameters.h"
+#include "../src/midi_handler.h"
+#include "../src/ump_midi1_encoder.h"
+#include "../src/gesture_recorder.h"
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+
+static void benchMidiHandler(BenchRunner& runner) {
+    runner.run("midi_handler/parse_nrpn", [](uint64_t n) {
+        MidiHandler handler;
+        uint64_t received = 0;
+        handler.setNRPNCallback([&received](uint16_t parameter, uint16_t value) {
+            received += value;
+        });
+        
+        for (uint64_t i = 0; i < n; ++i) {
+            uint8_t param = static_cast<uint8_t>(i & 0x3F);
+            handler.processMidiMessage(MidiMessage{0xB0, 99, 0, 0});
+            handler.processMidiMessage(MidiMessage{0xB0, 98, param, 0});
+            handler.processMidiMessage(MidiMessage{0xB0, 6, 0, 0});
+            handler.processMidiMessage(MidiMessage{0xB0, 38, static_cast<uint8_t>(i & 0x7F), 0});
+        }
+        benchDoNotOptimize(received);
+    });
+    
+    // Address sent once, then only the data bytes that change
+    runner.run("midi_handler/parse_nrpn_abbreviated", [](uint64_t n) {
+        MidiHandler handler;
+        uint64_t received = 0;
+        handler.setNRPNCallback([&received](uint16_t parameter, uint16_t value) {
+            received += value;
+        });
+        handler.processMidiMessage(MidiMessage{0xB0, 99, 0, 0});
+        handler.processMidiMessage(MidiMessage{0xB0, 98, 22, 0});
+        
+        for (uint64_t i = 0; i < n; ++i) {
+            handler.processMidiMessage(MidiMessage{0xB0, 38, static_cast<uint8_t>(i & 0x7F), 0});
+        }
+        benchDoNotOptimize(received);
+    });
+    
+    runner.run("midi_handler/parse_cc", [](uint64_t n) {
+        MidiHandler handler;
+        uint64_t received = 0;
+        handler.setCCCallback([&received](uint8_t cc, uint8_t value) {
+            received += value;
+        });
+        
+        for (uint64_t i = 0; i < n; ++i) {
+            handler.processMidiMessage(MidiMessage{0xB0, 74, static_cast<uint8_t>(i & 0x7F), 0});
+        }
+        benchDoNotOptimize(received);
+    });
+    
+    runner.run("midi_handler/send_nrpn", [](uint64_t n) {
+        MidiHandler handler;
+        UmpMidi1Encoder encoder;
+        std::vector<UmpPacket> packets;
+        packets.reserve(16);
+        uint8_t bytes[UmpMidi1Encoder::MAX_BYTES];
+        size_t length = 0;
+        
+        for (uint64_t i = 0; i < n; ++i) {
+            handler.sendNRPN(static_cast<uint16_t>(i & 0x7F), static_cast<uint16_t>(i & 0xFF));
+            handler.getOutgoingPackets(packets);
+            for (const UmpPacket& packet : packets) {
+                length += encoder.encodeBytes(packet, bytes);
+            }
+        }
+        benchDoNotOptimize(length);
+    });
+}
+
+static void benchParameterManager(BenchRunner& runner) {
+    OBX8ParameterManager manager;
+    const auto& params = manager.getParameters();
+    
+    runner.run("parameters/lookup_by_id", [&](uint64_t n) {
+        const OBX8Parameter* found = nullptr;
+        for (uint64_t i = 0; i < n; ++i) {
+            found = manager.getParameterById(params[i % params.size()].id);
+            benchDoNotOptimize(found);
+        }
+    });
+    
+    runner.run("parameters/lookup_by_nrpn", [&](uint64_t n) {
+        const OBX8Parameter* found = nullptr;
+        for (uint64_t i = 0; i < n; ++i) {
+            const OBX8Parameter& param = params[i % params.size()];
+            found = manager.getParameterByNRPN(param.nrpn_msb, param.nrpn_lsb);
+            benchDoNotOptimize(found);
+        }
+    });
+    
+    runner.run("parameters/lookup_by_cc", [&](uint64_t n) {
+        const OBX8Parameter* found = nullptr;
+        for (uint64_t i = 0; i < n; ++i) {
+            found = manager.getParameterByCC(static_cast<uint8_t>(16 + (i % 32)));
+            benchDoNotOptimize(found);
+        }
+    });
+    
+    runner.run("convert/normalize_denormalize", [&](uint64_t n) {
+        double total = 0.0;
+        for (uint64_t i = 0; i < n; ++i) {
+            const OBX8Parameter* param = &params[i % params.size()];
+            double normalized = OBX8ParameterManager::normalizeParameterValue(param, param->default_value);
+            total += OBX8ParameterManager::denormalizeParameterValue(param, normalized);
+        }
+        benchDoNotOptimize(total);
+    });
+    
+    runner.run("convert/to_nrpn_value", [&](uint64_t n) {
+        uint64_t total = 0;
+        for (uint64_t i = 0; i < n; ++i) {
+            const OBX8Parameter* param = &params[i % params.size()];
+            total += OBX8ParameterManager::parameterToNRPNValue(param, (i % 101) / 100.0);
+        }
+        benchDoNotOptimize(total);
+    });
+    
+    runner.run("convert/from_nrpn_value", [&](uint64_t n) {
+        double total = 0.0;
+        for (uint64_t i = 0; i < n; ++i) {
+            const OBX8Parameter* param = &params[i % params.size()];
+            total += OBX8ParameterManager::nrpnToParameterValue(param, static_cast<uint16_t>(i & 0x7F));
+        }
+        benchDoNotOptimize(total);
+    });
+}
+
+static void benchDeviceProfile(BenchRunner& runner) {
+    std::vector<uint32_t> reserved_ids = OBX8ParameterManager::reservedParameterIds();
+    
+    runner.run("profile/compile", [&](uint64_t n) {
+        std::string error;
+        for (uint64_t i = 0; i < n; ++i) {
+            auto profile = DeviceProfile::load(DEFAULT_DEVICE_PROFILE, reserved_ids, "", error);
+            benchDoNotOptimize(profile.get());
+        }
+    });
+    
+    // The cache is written by the first load, every timed load maps it
+    std::string cache_dir = "obx8_bench_profile_cache";
+    std::string error;
+    DeviceProfile::load(DEFAULT_DEVICE_PROFILE, reserved_ids, cache_dir, error);
+    runner.run("profile/load_cached", [&](uint64_t n) {
+        std::string error;
+        for (uint64_t i = 0; i < n; ++i) {
+            auto profile = DeviceProfile::load(DEFAULT_DEVICE_PROFILE, reserved_ids, cache_dir, error);
+            benchDoNotOptimize(profile.get());
+        }
+    });
+    char cache_name[40];
+    std::snprintf(cache_name, sizeof(cache_name), "/profile-%016llx.bin",
+                  static_cast<unsigned long long>(DeviceProfile::hashSource(DEFAULT_DEVICE_PROFILE, reserved_ids)));
+    std::remove((cache_dir + cache_name).c_str());
+    std::remove(cache_dir.c_str());
+}
+
+static void benchGestureRecorder(BenchRunner& runner) {
+    // A knob swept up and down, one value per millisecond, thinned as it arrives
+    runner.run("gesture/add_value", [](uint64_t n) {
+        GestureRecorder recorder(PARAM_COUNT, 256);
+        size_t points = 0;
+        for (uint64_t i = 0; i < n; ++i) {
+            int32_t phase = static_cast<int32_t>(i % 254);
+            recorder.addValue(FILTER_FREQUENCY, phase < 127 ? phase : 254 - phase, 1000000 * (i + 1));
+            if ((i & 0xFF) == 0xFF) {
+                size_t count;
+                recorder.takeEvents(count);
+                points += count;
+            }
+        }
+        benchDoNotOptimize(points);
+    });
+}
+
+static std::unique_ptr<OBX8Plugin> createActivePlugin() {
+    std::unique_ptr<OBX8Plugin> plugin(new OBX8Plugin(&bench_host));
+    plugin->init();
+    // The loop below runs far faster than real time; without a render mode the
+    // plugin would take it for a freewheeling bounce and pace every send
+    plugin->render_set(CLAP_RENDER_REALTIME);
+    plugin->activate(48000.0, 32, 512);
+    plugin->start_processing();
+    plugin->on_main_thread();
+    plugin->selectMidiDevice(MidiDeviceManager::LOOPBACK_DEVICE_NAME);
+    return plugin;
+}
+
+static void destroyPlugin(std::unique_ptr<OBX8Plugin>& plugin) {
+    plugin->stop_processing();
+    plugin->deactivate();
+    plugin->destroy();
+    plugin.reset();
+}
+
+static void benchPlugin(BenchRunner& runner) {
+    runner.run("plugin/create_init_destroy", [](uint64_t n) {
+        for (uint64_t i = 0; i < n; ++i) {
+            OBX8Plugin plugin(&bench_host);
+            plugin.init();
+            plugin.destroy();
+        }
+    });
+    
+    runner.run("state/save_load_roundtrip", [](uint64_t n) {
+        std::unique_ptr<OBX8Plugin> plugin(new OBX8Plugin(&bench_host));
+        plugin->init();
+        BenchStream stream;
+        bool ok = true;
+        for (uint64_t i = 0; i < n; ++i) {
+            stream.clear();
+            ok &= plugin->state_save(stream.output());
+            ok &= plugin->state_load(stream.input());
+        }
+        benchDoNotOptimize(ok);
+        plugin->destroy();
+    });
+    
+    runner.run("process/empty_block", [](uint64_t n) {
+        std::unique_ptr<OBX8Plugin> plugin = createActivePlugin();
+        BenchInputEvents in_events;
+        BenchOutputEvents out_events;
+        clap_process_t process = {};
+        process.frames_count = 256;
+        process.in_events = in_events.get();
+        process.out_events = out_events.get();
+        
+        for (uint64_t i = 0; i < n; ++i) {
+            process.steady_time = static_cast<int64_t>(i * 256);
+            plugin->process(&process);
+        }
+        destroyPlugin(plugin);
+    });
+    
+    runner.run("process/8_param_events", [](uint64_t n) {
+        std::unique_ptr<OBX8Plugin> plugin = createActivePlugin();
+        BenchInputEvents in_events;
+        BenchOutputEvents out_events;
+        clap_process_t process = {};
+        process.frames_count = 256;
+        process.in_events = in_events.get();
+        process.out_events = out_events.get();
+        
+        for (uint64_t i = 0; i < n; ++i) {
+            in_events.clear();
+            out_events.clear();
+            for (uint32_t e = 0; e < 8; ++e) {
+                in_events.addParamValue(e * 32, OSC1_PULSE_WIDTH + e, ((i + e) % 100) / 100.0);
+            }
+            process.steady_time = static_cast<int64_t>(i * 256);
+            plugin->process(&process);
+        }
+        destroyPlugin(plugin);
+    });
+    
+    runner.run("process/8_mod_events", [](uint64_t n) {
+        std::unique_ptr<OBX8Plugin> plugin = createActivePlugin();
+        BenchInputEvents in_events;
+        BenchOutputEvents out_events;
+        clap_process_t process = {};
+        process.frames_count = 256;
+        process.in_events = in_events.get();
+        process.out_events = out_events.get();
+        
+        for (uint64_t i = 0; i < n; ++i) {
+            in_events.clear();
+            out_events.clear();
+            for (uint32_t e = 0; e < 8; ++e) {
+                in_events.addParamMod(e * 32, FILTER_FREQUENCY, ((i * 8 + e) % 50) / 10.0);
+            }
+            process.steady_time = static_cast<int64_t>(i * 256);
+            plugin->process(&process);
+        }
+        destroyPlugin(plugin);
+    });
+    
+    runner.run("process/16_host_midi_events", [](uint64_t n) {
+        std::unique_ptr<OBX8Plugin> plugin = createActivePlugin();
+        BenchInputEvents in_events;
+        BenchOutputEvents out_events;
+        clap_process_t process = {};
+        process.frames_count = 256;
+        process.in_events = in_events.get();
+        process.out_events = out_events.get();
+        
+        for (uint64_t i = 0; i < n; ++i) {
+            in_events.clear();
+            out_events.clear();
+            for (uint32_t e = 0; e < 16; ++e) {
+                in_events.addMidi(e * 16, 0xB0, 74, static_cast<uint8_t>((i + e) & 0x7F));
+            }
+            process.steady_time = static_cast<int64_t>(i * 256);
+            plugin->process(&process);
+        }
+        destroyPlugin(plugin);
+    });
+}
+
+int main(int argc, char **argv) {
+    BenchRunner runner;
+    std::string json_path;
+    std::string baseline_path;
+    double tolerance = 0.25;
+    
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if (arg == "--filter" && has_value) {
+            runner.setFilter(argv[++i]);
+        } else if (arg == "--repetitions" && has_value) {
+            runner.setRepetitions(std::atoi(argv[++i]));
+        } else if (arg == "--min-batch-ms" && has_value) {
+            runner.setMinBatchMs(std::atof(argv[++i]));
+        } else if (arg == "--json" && has_value) {
+            json_path = argv[++i];
+        } else if (arg == "--baseline" && has_value) {
+            baseline_path = argv[++i];
+        } else if (arg == "--tolerance" && has_value) {
+            tolerance = std::atof(argv[++i]);
+        } else {
+            std::fprintf(stderr, "Unknown or incomplete argument: %s\n", arg.c_str());
+            return 2;
+        }
+    }
+    
+    benchMidiHandler(runner);
+    benchParameterManager(runner);
+    benchDeviceProfile(runner);
+    benchGestureRecorder(runner);
+    benchPlugin(runner);
+    
+    if (!json_path.empty() && !runner.writeJson(json_path)) {
+        std::fprintf(stderr, "Failed to write %s\n", json_path.c_str());
+        return 2;
+    }
+    
+    if (!baseline_path.empty()) {
+        std::map<std::string, double> baseline;
+        if (!BenchRunner::readJson(baseline_path, baseline)) {
+            std::fprintf(stderr, "Failed to read baseline %s\n", baseline_path.c_str());
+            return 2;
+        }
+        
+        int regressions = runner.compareToBaseline(baseline, tolerance);
+        if (regressions > 0) {
+            std::printf("\n%d benchmark(s) regressed by more than %.0f%%\n", regressions, tolerance * 100.0);
+            return 1;
+        }
+    }
+    
+    return 0;
+}
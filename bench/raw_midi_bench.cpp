@@ -0,0 +1,298 @@
+// Raw MIDI transport check - runs the Linux transport end to end over pipes, a
+// FIFO and a pseudo-terminal, so it needs no MIDI hardware.
+//
+// Usage: obx8_raw_midi_bench [--max-late-ms MS]
+//
+//   pipes       - inbound bytes arrive with their arrival time; batches sent for
+//                 later go out in due-time order, never early and no more than
+//                 --max-late-ms late, and a send with timestamp 0 goes out at once
+//                 instead of waiting behind them
+//   short write - a batch larger than a shrunk pipe goes out in part, stalls,
+//                 and is finished from EPOLLOUT once the reader drains the pipe
+//   fifo        - opened by path; writes into it reach the receive callback and
+//                 sends come back through it
+//   pty         - bytes both ways through a raw-mode pseudo-terminal
+//
+// The exit status is 1 when any check fails.
+
+#include "../src/raw_midi_transport.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fcntl.h>
+#include <mutex>
+#include <poll.h>
+#include <string>
+#include <sys/stat.h>
+#include <termios.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+static uint64_t steadyNowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static int failures = 0;
+
+static void check(bool ok, const char* what) {
+    std::printf("  %-58s %s\n", what, ok ? "ok" : "FAILED");
+    if (!ok) {
+        ++failures;
+    }
+}
+
+// What the transport's receive callback saw
+struct Received {
+    std::mutex mutex;
+    std::vector<uint8_t> bytes;
+    std::vector<uint64_t> arrival_ns;   // one per byte
+    
+    void attach(RawMidiTransport& transport) {
+        transport.setReceiveCallback([this](const uint8_t* data, size_t length, uint64_t time_ns) {
+            std::lock_guard<std::mutex> lock(mutex);
+            bytes.insert(bytes.end(), data, data + length);
+            arrival_ns.insert(arrival_ns.end(), length, time_ns);
+        });
+    }
+    
+    bool waitFor(size_t count, int timeout_ms) {
+        for (int waited = 0; waited <= timeout_ms; ++waited) {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (bytes.size() >= count) {
+                    return true;
+                }
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        return false;
+    }
+};
+
+// Reads count bytes from fd, noting when each arrived
+static bool readBytes(int fd, size_t count, int timeout_ms, std::vector<uint8_t>& bytes,
+                      std::vector<uint64_t>* times_ns = nullptr) {
+    uint64_t deadline_ns = steadyNowNs() + static_cast<uint64_t>(timeout_ms) * 1000000;
+    while (bytes.size() < count) {
+        uint64_t now_ns = steadyNowNs();
+        if (now_ns >= deadline_ns) {
+            return false;
+        }
+        pollfd ready = {fd, POLLIN, 0};
+        if (poll(&ready, 1, static_cast<int>((deadline_ns - now_ns) / 1000000) + 1) <= 0) {
+            continue;
+        }
+        uint8_t buffer[4096];
+        ssize_t length = read(fd, buffer, sizeof(buffer));
+        if (length <= 0) {
+            continue;
+        }
+        uint64_t time_ns = steadyNowNs();
+        bytes.insert(bytes.end(), buffer, buffer + length);
+        if (times_ns) {
+            times_ns->insert(times_ns->end(), static_cast<size_t>(length), time_ns);
+        }
+    }
+    return true;
+}
+
+static void checkPipes(double max_late_ms) {
+    std::printf("pipes\n");
+    int to_transport[2];
+    int from_transport[2];
+    if (pipe(to_transport) != 0 || pipe(from_transport) != 0) {
+        check(false, "create pipes");
+        return;
+    }
+    
+    RawMidiTransport transport;
+    Received received;
+    received.attach(transport);
+    check(transport.openFileDescriptors(to_transport[0], from_transport[1]), "open descriptors");
+    
+    // Inbound, stamped between the write and the callback
+    const uint8_t cc[3] = {0xB0, 7, 100};
+    uint64_t written_ns = steadyNowNs();
+    ssize_t result = write(to_transport[1], cc, sizeof(cc));
+    (void)result;
+    bool arrived = received.waitFor(3, 1000);
+    uint64_t seen_ns = steadyNowNs();
+    check(arrived && received.bytes == std::vector<uint8_t>(cc, cc + 3), "inbound bytes reach the callback");
+    check(arrived && received.arrival_ns[0] >= written_ns && received.arrival_ns[0] <= seen_ns,
+          "inbound arrival time on the steady clock");
+    
+    // Two batches for later, then one for now
+    const uint64_t max_late_ns = static_cast<uint64_t>(max_late_ms * 1e6);
+    const uint8_t note_on[3] = {0x90, 60, 100};
+    const uint8_t note_off[3] = {0x80, 60, 0};
+    uint64_t base_ns = steadyNowNs();
+    uint64_t note_on_due_ns = base_ns + 40000000;
+    uint64_t note_off_due_ns = base_ns + 80000000;
+    bool queued = transport.send(note_on, 3, note_on_due_ns);
+    queued &= transport.send(note_off, 3, note_off_due_ns);
+    queued &= transport.send(cc, 3, 0);
+    check(queued, "sends queued");
+    
+    std::vector<uint8_t> out;
+    std::vector<uint64_t> out_ns;
+    bool complete = readBytes(from_transport[0], 9, 1000, out, &out_ns);
+    check(complete && out[0] == 0xB0 && out[3] == 0x90 && out[6] == 0x80, "due-time order: now, +40 ms, +80 ms");
+    if (complete) {
+        std::printf("  immediate %.3f ms, +40 ms batch at %.3f ms, +80 ms batch at %.3f ms\n",
+                    (out_ns[0] - base_ns) / 1e6, (out_ns[3] - base_ns) / 1e6, (out_ns[6] - base_ns) / 1e6);
+    }
+    check(complete && out_ns[0] - base_ns <= max_late_ns, "timestamp 0 doesn't wait behind later batches");
+    check(complete && out_ns[3] >= note_on_due_ns && out_ns[6] >= note_off_due_ns, "no batch goes out early");
+    check(complete && out_ns[3] - note_on_due_ns <= max_late_ns && out_ns[6] - note_off_due_ns <= max_late_ns,
+          "no batch goes out late");
+    
+    transport.close();
+    ::close(to_transport[1]);
+    ::close(from_transport[0]);
+}
+
+static void checkShortWrite() {
+    std::printf("short write\n");
+    int to_transport[2];
+    int from_transport[2];
+    if (pipe(to_transport) != 0 || pipe(from_transport) != 0) {
+        check(false, "create pipes");
+        return;
+    }
+    // The smallest pipe the kernel allows, a page
+    int pipe_bytes = fcntl(from_transport[1], F_SETPIPE_SZ, 4096);
+    check(pipe_bytes > 0, "shrink the pipe");
+    
+    RawMidiTransport transport;
+    check(transport.openFileDescriptors(to_transport[0], from_transport[1]), "open descriptors");
+    
+    std::vector<uint8_t> batch(4 * 4096);
+    for (size_t i = 0; i < batch.size(); i += 3) {
+        batch[i] = 0xB0;
+        if (i + 2 < batch.size()) {
+            batch[i + 1] = static_cast<uint8_t>((i / 3) % 120);
+            batch[i + 2] = static_cast<uint8_t>(i % 128);
+        }
+    }
+    check(transport.send(batch.data(), batch.size(), 0), "batch queued");
+    
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    uint64_t stalled_at = transport.getBytesWritten();
+    std::printf("  %llu of %zu bytes written before the reader drains a %d-byte pipe\n",
+                static_cast<unsigned long long>(stalled_at), batch.size(), pipe_bytes);
+    check(stalled_at > 0 && stalled_at < batch.size(), "write stops short at a full pipe");
+    check(transport.getWriteStalls() >= 1, "stall counted");
+    
+    std::vector<uint8_t> out;
+    bool complete = readBytes(from_transport[0], batch.size(), 2000, out);
+    check(complete && out == batch, "EPOLLOUT continues the write to the last byte");
+    check(transport.getBytesWritten() == batch.size(), "byte count matches");
+    
+    transport.close();
+    ::close(to_transport[1]);
+    ::close(from_transport[0]);
+}
+
+static void checkFifo() {
+    std::printf("fifo\n");
+    char directory[] = "/tmp/obx8_raw_midi_XXXXXX";
+    if (!mkdtemp(directory)) {
+        check(false, "create a temporary directory");
+        return;
+    }
+    std::string path = std::string(directory) + "/midi";
+    if (mkfifo(path.c_str(), 0600) != 0) {
+        check(false, "create the FIFO");
+        rmdir(directory);
+        return;
+    }
+    
+    RawMidiTransport transport;
+    Received received;
+    received.attach(transport);
+    check(transport.open(path), "open by path");
+    
+    // The transport holds the read end, so a writer opens without blocking
+    const uint8_t program_change[2] = {0xC0, 5};
+    int writer = ::open(path.c_str(), O_WRONLY | O_NONBLOCK | O_CLOEXEC);
+    ssize_t result = writer >= 0 ? write(writer, program_change, sizeof(program_change)) : -1;
+    (void)result;
+    check(received.waitFor(2, 1000) && received.bytes[0] == 0xC0, "writes into the FIFO reach the callback");
+    
+    const uint8_t note_on[3] = {0x90, 64, 90};
+    check(transport.send(note_on, 3, 0) && received.waitFor(5, 1000) && received.bytes[2] == 0x90,
+          "sends come back through the FIFO");
+    
+    transport.close();
+    if (writer >= 0) {
+        ::close(writer);
+    }
+    unlink(path.c_str());
+    rmdir(directory);
+}
+
+static void checkPty() {
+    std::printf("pty\n");
+    int master = posix_openpt(O_RDWR | O_NOCTTY | O_CLOEXEC);
+    int terminal = -1;
+    if (master >= 0 && grantpt(master) == 0 && unlockpt(master) == 0) {
+        terminal = ::open(ptsname(master), O_RDWR | O_NOCTTY | O_CLOEXEC);
+    }
+    termios mode;
+    if (terminal < 0 || tcgetattr(terminal, &mode) != 0) {
+        check(false, "open a pseudo-terminal");
+        if (master >= 0) {
+            ::close(master);
+        }
+        return;
+    }
+    // MIDI bytes must pass without line discipline
+    cfmakeraw(&mode);
+    tcsetattr(terminal, TCSANOW, &mode);
+    
+    RawMidiTransport transport;
+    Received received;
+    received.attach(transport);
+    check(transport.openFileDescriptors(terminal, terminal), "open the terminal side");
+    
+    const uint8_t sysex[6] = {0xF0, 0x7E, 0x7F, 0x06, 0x01, 0xF7};
+    ssize_t result = write(master, sysex, sizeof(sysex));
+    (void)result;
+    check(received.waitFor(6, 1000) && received.bytes == std::vector<uint8_t>(sysex, sysex + 6),
+          "bytes in, unchanged");
+    
+    std::vector<uint8_t> out;
+    check(transport.send(sysex, sizeof(sysex), 0) && readBytes(master, 6, 1000, out) &&
+          out == std::vector<uint8_t>(sysex, sysex + 6), "bytes out, unchanged");
+    
+    transport.close();
+    ::close(master);
+}
+
+int main(int argc, char **argv) {
+    double max_late_ms = 20.0;
+    
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--max-late-ms" && i + 1 < argc) {
+            max_late_ms = std::atof(argv[++i]);
+        } else {
+            std::fprintf(stderr, "Unknown argument: %s\n", arg.c_str());
+            return 2;
+        }
+    }
+    
+    checkPipes(max_late_ms);
+    checkShortWrite();
+    checkFifo();
+    checkPty();
+    
+    if (failures != 0) {
+        std::printf("\n%d check(s) failed\n", failures);
+        return 1;
+    }
+    std::printf("\nall checks passed\n");
+    return 0;
+}
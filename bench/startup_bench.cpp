@@ -0,0 +1,78 @@
+// Startup benchmark - measures what a host pays per instance when scanning
+// plugins or loading a project with many SPOBX8Edit instances.
+//
+// Usage: obx8_startup_bench [instance_count]
+
+#include "bench_host.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+static double elapsedMs(std::chrono::steady_clock::time_point start) {
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    return std::chrono::duration<double, std::milli>(elapsed).count();
+}
+
+int main(int argc, char **argv) {
+    int instance_count = (argc > 1) ? std::atoi(argv[1]) : 100;
+    if (instance_count <= 0) {
+        instance_count = 100;
+    }
+    
+    clap_entry.init("");
+    const clap_plugin_factory_t *factory = static_cast<const clap_plugin_factory_t*>(
+        clap_entry.get_factory(CLAP_PLUGIN_FACTORY_ID));
+    if (!factory) {
+        std::fprintf(stderr, "No plugin factory\n");
+        return 1;
+    }
+    
+    const char *plugin_id = factory->get_plugin_descriptor(factory, 0)->id;
+    std::vector<const clap_plugin_t*> plugins;
+    plugins.reserve(instance_count);
+    
+    // Scan pass: what a host does when it validates the plugin
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < instance_count; ++i) {
+        const clap_plugin_t *plugin = factory->create_plugin(factory, &bench_host, plugin_id);
+        plugin->init(plugin);
+        plugin->destroy(plugin);
+    }
+    double scan_ms = elapsedMs(start);
+    
+    // Project load pass: all instances alive at once
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < instance_count; ++i) {
+        const clap_plugin_t *plugin = factory->create_plugin(factory, &bench_host, plugin_id);
+        plugin->init(plugin);
+        plugins.push_back(plugin);
+    }
+    double construct_ms = elapsedMs(start);
+    
+    start = std::chrono::steady_clock::now();
+    for (const clap_plugin_t *plugin : plugins) {
+        plugin->activate(plugin, 48000.0, 32, 1024);
+    }
+    double activate_ms = elapsedMs(start);
+    
+    start = std::chrono::steady_clock::now();
+    for (const clap_plugin_t *plugin : plugins) {
+        plugin->deactivate(plugin);
+        plugin->destroy(plugin);
+    }
+    double destroy_ms = elapsedMs(start);
+    
+    clap_entry.deinit();
+    
+    std::printf("instances:            %d\n", instance_count);
+    std::printf("scan (create/init/destroy): %10.3f ms total, %8.3f us/instance\n",
+                scan_ms, scan_ms * 1000.0 / instance_count);
+    std::printf("construct + init:     %10.3f ms total, %8.3f us/instance\n",
+                construct_ms, construct_ms * 1000.0 / instance_count);
+    std::printf("activate:             %10.3f ms total, %8.3f us/instance\n",
+                activate_ms, activate_ms * 1000.0 / instance_count);
+    std::printf("deactivate + destroy: %10.3f ms total, %8.3f us/instance\n",
+                destroy_ms, destroy_ms * 1000.0 / instance_count);
+    return 0;
+}
@@ -0,0 +1,75 @@
+# SPOBX8Edit device profile: Oberheim OB-X8
+#
+# One parameter per line:
+#   param ID NAME "Display Name" nrpn=MSB:LSB range=MIN:MAX [key=value...]
+# Keys:
+#   nrpn=MSB:LSB      NRPN address on the hardware (required, never 0:0)
+#   range=MIN:MAX     hardware value range (required); NRPN data is the value minus MIN
+#   default=V         default value (MIN when omitted)
+#   cc=N              CC the hardware also answers to (omit for none); CC data is the
+#                     value minus MIN, or the range scaled onto 0-127 when it is wider
+#   unit="..."        unit appended to displayed values
+#   steps="A|B|..."   names of the values of a switch or menu (makes it stepped)
+#   stepped           stepped without names
+#   relative=no       never send data increment/decrement (switches and menus never do)
+# "group" starts a section; parameters after it are shown under that module.
+#
+# IDs are the plugin parameter IDs the DAW stores automation and presets under:
+# never renumber an existing parameter, and give new ones the next free ID.
+# IDs 38-44 belong to plugin-side settings. Together with those, the IDs in a
+# profile must run from 0 without gaps.
+
+profile "Oberheim OB-X8"
+
+group "Oscillator 1"
+param 0 osc1_frequency "Osc 1 Frequency" nrpn=0:1 range=0:63 default=32 cc=16
+param 1 osc1_waveform "Osc 1 Waveform" nrpn=0:5 range=0:3 cc=17 steps="Triangle|Sawtooth|Pulse|Pulse+Saw"
+param 2 osc1_pulse_width "Osc 1 Pulse Width" nrpn=0:7 range=0:127 default=64 cc=18 unit="%"
+param 3 osc1_level "Osc 1 Level" nrpn=0:19 range=0:1 default=1 cc=19 steps="Off|On"
+
+group "Oscillator 2"
+param 4 osc2_frequency "Osc 2 Frequency" nrpn=0:2 range=0:63 default=32 cc=20
+param 5 osc2_waveform "Osc 2 Waveform" nrpn=0:6 range=0:3 cc=21 steps="Triangle|Sawtooth|Pulse|Pulse+Saw"
+param 6 osc2_pulse_width "Osc 2 Pulse Width" nrpn=0:8 range=0:127 default=64 cc=22 unit="%"
+param 7 osc2_detune "Osc 2 Detune" nrpn=0:3 range=0:63 default=32 cc=23
+param 8 osc_sync "Osc Sync" nrpn=0:13 range=0:1 cc=24 steps="Off|On"
+param 9 osc2_level "Osc 2 Level" nrpn=0:20 range=0:1 default=1 cc=25 steps="Off|On"
+param 10 noise_level "Noise Level" nrpn=0:21 range=0:1 cc=26 steps="Off|On"
+
+group "Filter"
+param 11 filter_frequency "Filter Frequency" nrpn=0:22 range=0:175 default=88 cc=26
+param 12 filter_resonance "Filter Resonance" nrpn=0:23 range=0:127 cc=27
+param 13 filter_tracking "Filter Tracking" nrpn=0:25 range=0:1 cc=28 steps="Off|On"
+param 14 filter_pole "Filter Type" nrpn=0:24 range=0:6 cc=29 steps="OB-X/SEM 2-Pole LP|SEM 2-Pole HP|SEM 2-Pole BP|SEM 2-Pole Notch|OB-Xa/8 2-Pole LP|OB-Xa/8 4-Pole LP|Modified 4-Pole LP"
+param 15 vintage "Vintage" nrpn=0:26 range=0:127 default=64 cc=30
+
+group "Envelopes"
+param 16 env1_attack "Filter Env Attack" nrpn=0:60 range=0:255 cc=30
+param 17 env1_decay "Filter Env Decay" nrpn=0:62 range=0:255 default=64 cc=31
+param 18 env1_sustain "Filter Env Sustain" nrpn=0:64 range=0:127 default=100 cc=32
+param 19 env1_release "Filter Env Release" nrpn=0:66 range=0:255 default=64 cc=33
+param 20 env2_attack "Volume Env Attack" nrpn=0:61 range=0:255 cc=34
+param 21 env2_decay "Volume Env Decay" nrpn=0:63 range=0:255 default=64 cc=35
+param 22 env2_sustain "Volume Env Sustain" nrpn=0:65 range=0:127 default=100 cc=36
+param 23 env2_release "Volume Env Release" nrpn=0:67 range=0:255 default=64 cc=37
+
+group "LFOs"
+param 24 lfo1_rate "LFO 1 Rate" nrpn=0:29 range=0:127 default=32 cc=38
+param 25 lfo1_shape "LFO 1 Shape" nrpn=0:30 range=0:5 cc=39 steps="Sine|Saw Up|Saw Down|Triangle|Square|Sample & Hold"
+param 26 lfo1_amount "LFO 1 Depth 1" nrpn=0:31 range=0:127 cc=40
+param 27 lfo2_rate "LFO 2 Rate" nrpn=0:54 range=0:127 default=32 cc=41
+param 28 lfo2_shape "LFO 2 Shape" nrpn=0:55 range=0:5 cc=42 steps="Triangle|Square|Saw Up|S&H|Saw Down|Noise"
+param 29 lfo2_amount "LFO 2 Depth" nrpn=0:58 range=0:127 cc=43
+param 30 filter_modulation "Filter Modulation" nrpn=0:59 range=0:127 cc=44
+
+group "Master"
+param 31 master_volume "Program Volume" nrpn=0:73 range=0:127 default=100 cc=7
+param 32 master_tune "Master Tune" nrpn=1:1 range=-50:50 default=0 cc=44 unit="cents"
+
+group "Performance"
+param 33 portamento_rate "Portamento Rate" nrpn=0:14 range=0:127
+param 34 program_volume "Program Volume" nrpn=0:73 range=0:127 default=100
+param 35 unison "Unison" nrpn=0:74 range=0:1 steps="Off|On"
+param 36 unison_voice_count "Unison Voice Count" nrpn=0:75 range=0:7 default=2 steps="2|3|4|5|6|7|8"
+param 37 envelope_type "Envelope Type" nrpn=0:96 range=0:2 steps="ADSR|Multi-Trigger|Free-Run"
+
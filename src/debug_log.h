@@ -0,0 +1,20 @@
+#pragma once
+#include <fstream>
+
+// Developer trace in /tmp/spobx8_debug.log. Every call site opens the file, which
+// is far too slow to leave on for parameter changes in a session, so it is only
+// written in builds configured with -DSPOBX8_DEBUG_LOG=ON. Otherwise the stream
+// starts out bad and writes to it return without formatting anything.
+#ifndef SPOBX8_DEBUG_LOG
+#define SPOBX8_DEBUG_LOG 0
+#endif
+
+inline std::ofstream openDebugLog() {
+#if SPOBX8_DEBUG_LOG
+    return std::ofstream("/tmp/spobx8_debug.log", std::ios::app);
+#else
+    std::ofstream disabled;
+    disabled.setstate(std::ios::badbit);
+    return disabled;
+#endif
+}
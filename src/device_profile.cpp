@@ -0,0 +1,652 @@
+#include "device_profile.h"
+#include <cctype>
+#include <cerrno>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <set>
+#include <sstream>
+
+#ifdef _WIN32
+#include <direct.h>
+#include <process.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+static const char PROFILE_MAGIC[8] = {'O', 'B', 'X', '8', 'P', 'R', 'F', '\0'};
+
+const char* const DeviceProfile::PROFILE_ENV_VAR = "SPOBX8_PROFILE";
+const char* const DeviceProfile::CACHE_DIR_ENV_VAR = "SPOBX8_PROFILE_CACHE";
+
+bool DeviceProfile::isReservedController(long cc) {
+    return cc == 0 || cc == 32 || cc == 6 || cc == 38 || (cc >= 96 && cc <= 101) || cc == 1 || cc == 64;
+}
+
+// Splits a line into whitespace-separated tokens. Double quotes group text with
+// spaces and are dropped, backslash escapes the next character inside quotes,
+// and '#' outside quotes starts a comment.
+static bool tokenize(const std::string& line, std::vector<std::string>& tokens, std::string& error) {
+    tokens.clear();
+    std::string token;
+    bool in_token = false;
+    bool quoted = false;
+    
+    for (size_t i = 0; i < line.size(); ++i) {
+        char c = line[i];
+        if (quoted) {
+            if (c == '"') {
+                quoted = false;
+            } else if (c == '\\' && i + 1 < line.size()) {
+                token += line[++i];
+            } else {
+                token += c;
+            }
+            continue;
+        }
+        
+        if (c == '#') {
+            break;
+        }
+        if (c == '"') {
+            quoted = true;
+            in_token = true;
+        } else if (std::isspace(static_cast<unsigned char>(c))) {
+            if (in_token) {
+                tokens.push_back(token);
+                token.clear();
+                in_token = false;
+            }
+        } else {
+            token += c;
+            in_token = true;
+        }
+    }
+    
+    if (quoted) {
+        error = "unterminated quote";
+        return false;
+    }
+    if (in_token) {
+        tokens.push_back(token);
+    }
+    return true;
+}
+
+static bool parseNumber(const std::string& text, double& value) {
+    if (text.empty()) {
+        return false;
+    }
+    char* end = nullptr;
+    errno = 0;
+    value = std::strtod(text.c_str(), &end);
+    return *end == '\0' && errno == 0 && std::isfinite(value);
+}
+
+static bool parseInteger(const std::string& text, long min_value, long max_value, long& value) {
+    if (text.empty()) {
+        return false;
+    }
+    char* end = nullptr;
+    errno = 0;
+    value = std::strtol(text.c_str(), &end, 10);
+    return *end == '\0' && errno == 0 && value >= min_value && value <= max_value;
+}
+
+static bool splitPair(const std::string& text, std::string& first, std::string& second) {
+    size_t colon = text.find(':');
+    if (colon == std::string::npos) {
+        return false;
+    }
+    first = text.substr(0, colon);
+    second = text.substr(colon + 1);
+    return true;
+}
+
+static bool isValidName(const std::string& name) {
+    if (name.empty()) {
+        return false;
+    }
+    for (char c : name) {
+        if (!std::islower(static_cast<unsigned char>(c)) && !std::isdigit(static_cast<unsigned char>(c)) && c != '_') {
+            return false;
+        }
+    }
+    return true;
+}
+
+DeviceProfile::DeviceProfile()
+    : data_(nullptr)
+    , size_(0)
+    , mapping_(nullptr)
+    , compiled_(false)
+{
+}
+
+DeviceProfile::~DeviceProfile() {
+#ifndef _WIN32
+    if (mapping_) {
+        munmap(mapping_, size_);
+    }
+#endif
+}
+
+bool DeviceProfile::parse(const std::string& text, const std::vector<uint32_t>& reserved_ids,
+                          std::string& profile_name, std::vector<DeviceProfileParameter>& parameters,
+                          std::vector<std::string>& warnings, std::string& error) {
+    profile_name.clear();
+    parameters.clear();
+    warnings.clear();
+    
+    std::set<uint32_t> reserved(reserved_ids.begin(), reserved_ids.end());
+    std::set<uint32_t> ids;
+    std::set<std::string> names;
+    std::map<uint32_t, std::string> nrpn_owner;
+    std::map<long, std::string> cc_owner;
+    std::string group;
+    
+    std::istringstream stream(text);
+    std::string line;
+    std::vector<std::string> tokens;
+    int line_number = 0;
+    
+    auto fail = [&](const std::string& message) {
+        error = "line " + std::to_string(line_number) + ": " + message;
+        return false;
+    };
+    auto warn = [&](const std::string& message) {
+        warnings.push_back("line " + std::to_string(line_number) + ": " + message);
+    };
+    
+    while (std::getline(stream, line)) {
+        ++line_number;
+        if (!line.empty() && line.back() == '\r') {
+            line.pop_back();
+        }
+        
+        std::string token_error;
+        if (!tokenize(line, tokens, token_error)) {
+            return fail(token_error);
+        }
+        if (tokens.empty()) {
+            continue;
+        }
+        
+        const std::string& keyword = tokens[0];
+        if (keyword == "profile" || keyword == "group") {
+            if (tokens.size() != 2) {
+                return fail("expected: " + keyword + " \"Name\"");
+            }
+            (keyword == "profile" ? profile_name : group) = tokens[1];
+            continue;
+        }
+        if (keyword != "param") {
+            return fail("unknown keyword '" + keyword + "'");
+        }
+        if (tokens.size() < 4) {
+            return fail("expected: param ID NAME \"Display Name\" nrpn=MSB:LSB range=MIN:MAX ...");
+        }
+        
+        DeviceProfileParameter param = {};
+        long id = 0;
+        if (!parseInteger(tokens[1], 0, 65535, id)) {
+            return fail("bad parameter ID '" + tokens[1] + "'");
+        }
+        param.id = static_cast<uint32_t>(id);
+        if (reserved.count(param.id)) {
+            return fail("ID " + tokens[1] + " is reserved for a plugin setting");
+        }
+        if (!ids.insert(param.id).second) {
+            return fail("duplicate ID " + tokens[1]);
+        }
+        
+        param.name = tokens[2];
+        if (!isValidName(param.name)) {
+            return fail("parameter name '" + param.name + "' must be lowercase letters, digits and '_'");
+        }
+        if (!names.insert(param.name).second) {
+            return fail("duplicate parameter name '" + param.name + "'");
+        }
+        param.display_name = tokens[3];
+        if (param.display_name.empty()) {
+            return fail("empty display name");
+        }
+        param.group = group;
+        param.relative = true;
+        
+        bool has_nrpn = false;
+        bool has_range = false;
+        bool has_default = false;
+        bool has_steps = false;
+        
+        for (size_t i = 4; i < tokens.size(); ++i) {
+            const std::string& option = tokens[i];
+            size_t equals = option.find('=');
+            if (equals == std::string::npos) {
+                if (option != "stepped") {
+                    return fail("unknown flag '" + option + "'");
+                }
+                param.is_stepped = true;
+                continue;
+            }
+            
+            std::string key = option.substr(0, equals);
+            std::string value = option.substr(equals + 1);
+            std::string first;
+            std::string second;
+            
+            if (key == "nrpn") {
+                long msb = 0;
+                long lsb = 0;
+                if (!splitPair(value, first, second) || !parseInteger(first, 0, 127, msb) ||
+                    !parseInteger(second, 0, 127, lsb)) {
+                    return fail("nrpn must be MSB:LSB, each 0-127");
+                }
+                param.nrpn_msb = static_cast<uint16_t>(msb);
+                param.nrpn_lsb = static_cast<uint16_t>(lsb);
+                has_nrpn = true;
+            } else if (key == "range") {
+                if (!splitPair(value, first, second) || !parseNumber(first, param.min_value) ||
+                    !parseNumber(second, param.max_value)) {
+                    return fail("range must be MIN:MAX");
+                }
+                has_range = true;
+            } else if (key == "default") {
+                if (!parseNumber(value, param.default_value)) {
+                    return fail("bad default '" + value + "'");
+                }
+                has_default = true;
+            } else if (key == "cc") {
+                long cc = 0;
+                if (!parseInteger(value, 0, 127, cc)) {
+                    return fail("cc must be 0-127");
+                }
+                param.midi_cc = static_cast<uint8_t>(cc);
+            } else if (key == "unit") {
+                param.unit = value;
+            } else if (key == "steps") {
+                std::istringstream step_stream(value);
+                std::string step;
+                while (std::getline(step_stream, step, '|')) {
+                    param.step_names.push_back(step);
+                }
+                has_steps = true;
+            } else if (key == "relative") {
+                if (value != "yes" && value != "no") {
+                    return fail("relative must be yes or no");
+                }
+                param.relative = value == "yes";
+            } else {
+                return fail("unknown key '" + key + "'");
+            }
+        }
+        
+        if (!has_nrpn) {
+            return fail("missing nrpn=MSB:LSB");
+        }
+        if (param.nrpn_msb == 0 && param.nrpn_lsb == 0) {
+            return fail("NRPN 0:0 is reserved for plugin settings");
+        }
+        if (!has_range) {
+            return fail("missing range=MIN:MAX");
+        }
+        if (!(param.min_value < param.max_value)) {
+            return fail("range must have MIN < MAX");
+        }
+        if (!has_default) {
+            param.default_value = param.min_value;
+        }
+        if (param.default_value < param.min_value || param.default_value > param.max_value) {
+            return fail("default outside range");
+        }
+        if (has_steps) {
+            param.is_stepped = true;
+            if (param.step_names.size() < 2) {
+                return fail("steps needs at least two names");
+            }
+            if (param.step_names.size() > param.max_value - param.min_value + 1) {
+                return fail("more step names than values in range");
+            }
+            for (const auto& step : param.step_names) {
+                if (step.empty()) {
+                    return fail("empty step name");
+                }
+            }
+        }
+        
+        // Switches and menus are always written absolutely
+        if (param.is_stepped) {
+            param.relative = false;
+        }
+        
+        uint32_t nrpn_key = (param.nrpn_msb << 7) | param.nrpn_lsb;
+        auto nrpn_it = nrpn_owner.find(nrpn_key);
+        if (nrpn_it != nrpn_owner.end()) {
+            warn("NRPN " + std::to_string(param.nrpn_msb) + ":" + std::to_string(param.nrpn_lsb) +
+                 " is also used by " + nrpn_it->second + "; values from the hardware go to " + param.name);
+        }
+        nrpn_owner[nrpn_key] = param.name;
+        
+        if (param.midi_cc != 0) {
+            if (isReservedController(param.midi_cc)) {
+                warn("cc " + std::to_string(param.midi_cc) + " is also interpreted by the MIDI layer");
+            }
+            auto cc_it = cc_owner.find(param.midi_cc);
+            if (cc_it != cc_owner.end()) {
+                warn("cc " + std::to_string(param.midi_cc) + " is also used by " + cc_it->second +
+                     "; incoming values go to " + param.name);
+            }
+            cc_owner[param.midi_cc] = param.name;
+        }
+        
+        parameters.push_back(param);
+    }
+    
+    line_number = 0;
+    if (parameters.empty()) {
+        error = "no parameters";
+        return false;
+    }
+    
+    // Parameter IDs index the plugin's value arrays, so they have to be dense
+    uint32_t total = static_cast<uint32_t>(ids.size() + reserved.size());
+    for (uint32_t id = 0; id < total; ++id) {
+        if (!ids.count(id) && !reserved.count(id)) {
+            error = "IDs must run from 0 without gaps; " + std::to_string(id) + " is missing";
+            return false;
+        }
+    }
+    
+    if (profile_name.empty()) {
+        profile_name = "Unnamed";
+    }
+    return true;
+}
+
+std::vector<uint8_t> DeviceProfile::compile(const std::string& profile_name,
+                                            const std::vector<DeviceProfileParameter>& parameters,
+                                            uint64_t source_hash) {
+    // Reference 0 is the empty string; repeated strings (units, groups, step
+    // names) are stored once
+    std::string strings(1, '\0');
+    std::map<std::string, uint32_t> interned;
+    auto intern = [&](const std::string& text) -> uint32_t {
+        if (text.empty()) {
+            return 0;
+        }
+        auto it = interned.find(text);
+        if (it != interned.end()) {
+            return it->second;
+        }
+        uint32_t reference = static_cast<uint32_t>(strings.size());
+        strings += text;
+        strings += '\0';
+        interned[text] = reference;
+        return reference;
+    };
+    
+    std::vector<DeviceProfileRecord> records;
+    std::vector<uint32_t> steps;
+    for (const auto& param : parameters) {
+        DeviceProfileRecord record = {};
+        record.id = param.id;
+        record.name = intern(param.name);
+        record.display_name = intern(param.display_name);
+        record.unit = intern(param.unit);
+        record.group = intern(param.group);
+        record.first_step = static_cast<uint32_t>(steps.size());
+        record.step_count = static_cast<uint32_t>(param.step_names.size());
+        record.nrpn_msb = param.nrpn_msb;
+        record.nrpn_lsb = param.nrpn_lsb;
+        record.midi_cc = param.midi_cc;
+        record.flags = (param.is_stepped ? PROFILE_PARAM_STEPPED : 0) | (param.relative ? PROFILE_PARAM_RELATIVE : 0);
+        record.min_value = param.min_value;
+        record.max_value = param.max_value;
+        record.default_value = param.default_value;
+        for (const auto& step : param.step_names) {
+            steps.push_back(intern(step));
+        }
+        records.push_back(record);
+    }
+    
+    DeviceProfileHeader header = {};
+    std::memcpy(header.magic, PROFILE_MAGIC, sizeof(PROFILE_MAGIC));
+    header.format_version = FORMAT_VERSION;
+    header.parameter_count = static_cast<uint32_t>(records.size());
+    header.source_hash = source_hash;
+    header.name = intern(profile_name);
+    header.parameters_offset = static_cast<uint32_t>((sizeof(header) + 7) & ~size_t(7));
+    header.steps_offset = header.parameters_offset + static_cast<uint32_t>(records.size() * sizeof(DeviceProfileRecord));
+    header.step_count = static_cast<uint32_t>(steps.size());
+    header.strings_offset = header.steps_offset + static_cast<uint32_t>(steps.size() * sizeof(uint32_t));
+    header.strings_size = static_cast<uint32_t>(strings.size());
+    
+    std::vector<uint8_t> image(header.strings_offset + strings.size(), 0);
+    std::memcpy(image.data(), &header, sizeof(header));
+    if (!records.empty()) {
+        std::memcpy(image.data() + header.parameters_offset, records.data(), records.size() * sizeof(DeviceProfileRecord));
+    }
+    if (!steps.empty()) {
+        std::memcpy(image.data() + header.steps_offset, steps.data(), steps.size() * sizeof(uint32_t));
+    }
+    std::memcpy(image.data() + header.strings_offset, strings.data(), strings.size());
+    return image;
+}
+
+uint64_t DeviceProfile::hashSource(const std::string& text, const std::vector<uint32_t>& reserved_ids) {
+    // FNV-1a over everything the compiled image depends on
+    uint64_t hash = 14695981039346656037ULL;
+    auto mix = [&hash](const void* data, size_t length) {
+        const uint8_t* bytes = static_cast<const uint8_t*>(data);
+        for (size_t i = 0; i < length; ++i) {
+            hash = (hash ^ bytes[i]) * 1099511628211ULL;
+        }
+    };
+    uint32_t version = FORMAT_VERSION;
+    mix(&version, sizeof(version));
+    mix(text.data(), text.size());
+    for (uint32_t id : reserved_ids) {
+        mix(&id, sizeof(id));
+    }
+    return hash;
+}
+
+bool DeviceProfile::validateImage(const uint8_t* data, size_t size, uint64_t source_hash) {
+    if (size < sizeof(DeviceProfileHeader)) {
+        return false;
+    }
+    const DeviceProfileHeader& header = *reinterpret_cast<const DeviceProfileHeader*>(data);
+    if (std::memcmp(header.magic, PROFILE_MAGIC, sizeof(PROFILE_MAGIC)) != 0 ||
+        header.format_version != FORMAT_VERSION || header.source_hash != source_hash) {
+        return false;
+    }
+    
+    // Every table inside the file, every reference inside its table
+    uint64_t parameters_end = header.parameters_offset + uint64_t(header.parameter_count) * sizeof(DeviceProfileRecord);
+    uint64_t steps_end = header.steps_offset + uint64_t(header.step_count) * sizeof(uint32_t);
+    uint64_t strings_end = header.strings_offset + uint64_t(header.strings_size);
+    if (header.parameters_offset % alignof(DeviceProfileRecord) != 0 || header.steps_offset % alignof(uint32_t) != 0 ||
+        parameters_end > size || steps_end > size || strings_end > size || header.strings_size == 0 ||
+        data[header.strings_offset + header.strings_size - 1] != '\0' || header.name >= header.strings_size) {
+        return false;
+    }
+    
+    const DeviceProfileRecord* records = reinterpret_cast<const DeviceProfileRecord*>(data + header.parameters_offset);
+    for (uint32_t i = 0; i < header.parameter_count; ++i) {
+        const DeviceProfileRecord& record = records[i];
+        if (record.name >= header.strings_size || record.display_name >= header.strings_size ||
+            record.unit >= header.strings_size || record.group >= header.strings_size ||
+            uint64_t(record.first_step) + record.step_count > header.step_count) {
+            return false;
+        }
+    }
+    
+    const uint32_t* steps = reinterpret_cast<const uint32_t*>(data + header.steps_offset);
+    for (uint32_t i = 0; i < header.step_count; ++i) {
+        if (steps[i] >= header.strings_size) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool DeviceProfile::mapFile(const std::string& path, uint64_t source_hash) {
+#ifdef _WIN32
+    FILE* file = std::fopen(path.c_str(), "rb");
+    if (!file) {
+        return false;
+    }
+    std::vector<uint8_t> image;
+    uint8_t buffer[4096];
+    size_t count;
+    while ((count = std::fread(buffer, 1, sizeof(buffer), file)) > 0) {
+        image.insert(image.end(), buffer, buffer + count);
+    }
+    std::fclose(file);
+    if (!validateImage(image.data(), image.size(), source_hash)) {
+        return false;
+    }
+    owned_.swap(image);
+    data_ = owned_.data();
+    size_ = owned_.size();
+    return true;
+#else
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size <= 0) {
+        close(fd);
+        return false;
+    }
+    
+    size_t size = static_cast<size_t>(info.st_size);
+    void* mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED) {
+        return false;
+    }
+    if (!validateImage(static_cast<const uint8_t*>(mapping), size, source_hash)) {
+        munmap(mapping, size);
+        return false;
+    }
+    
+    mapping_ = mapping;
+    data_ = static_cast<const uint8_t*>(mapping);
+    size_ = size;
+    return true;
+#endif
+}
+
+static bool createDirectories(const std::string& path) {
+    for (size_t pos = path.find('/', 1); ; pos = path.find('/', pos + 1)) {
+        std::string prefix = path.substr(0, pos);
+#ifdef _WIN32
+        int result = _mkdir(prefix.c_str());
+#else
+        int result = mkdir(prefix.c_str(), 0755);
+#endif
+        if (result != 0 && errno != EEXIST) {
+            return false;
+        }
+        if (pos == std::string::npos) {
+            return true;
+        }
+    }
+}
+
+bool DeviceProfile::writeFile(const std::string& path, const std::vector<uint8_t>& image) {
+    // Written aside and renamed into place, so a concurrent load never maps half a file
+#ifdef _WIN32
+    std::string temp_path = path + ".tmp" + std::to_string(_getpid());
+#else
+    std::string temp_path = path + ".tmp" + std::to_string(getpid());
+#endif
+    FILE* file = std::fopen(temp_path.c_str(), "wb");
+    if (!file) {
+        return false;
+    }
+    bool written = std::fwrite(image.data(), 1, image.size(), file) == image.size();
+    written = std::fclose(file) == 0 && written;
+    if (!written || std::rename(temp_path.c_str(), path.c_str()) != 0) {
+        std::remove(temp_path.c_str());
+        return false;
+    }
+    return true;
+}
+
+std::unique_ptr<DeviceProfile> DeviceProfile::load(const std::string& text, const std::vector<uint32_t>& reserved_ids,
+                                                   const std::string& cache_dir, std::string& error) {
+    uint64_t source_hash = hashSource(text, reserved_ids);
+    std::unique_ptr<DeviceProfile> profile(new DeviceProfile());
+    
+    std::string cache_path;
+    if (!cache_dir.empty()) {
+        char name[40];
+        std::snprintf(name, sizeof(name), "/profile-%016llx.bin", static_cast<unsigned long long>(source_hash));
+        cache_path = cache_dir + name;
+        if (profile->mapFile(cache_path, source_hash)) {
+            return profile;
+        }
+    }
+    
+    std::string profile_name;
+    std::vector<DeviceProfileParameter> parameters;
+    if (!parse(text, reserved_ids, profile_name, parameters, profile->warnings_, error)) {
+        return nullptr;
+    }
+    
+    profile->owned_ = compile(profile_name, parameters, source_hash);
+    profile->data_ = profile->owned_.data();
+    profile->size_ = profile->owned_.size();
+    profile->compiled_ = true;
+    
+    // A cache that can't be written only costs the next load a parse
+    if (!cache_path.empty() && createDirectories(cache_dir)) {
+        writeFile(cache_path, profile->owned_);
+    }
+    return profile;
+}
+
+std::string DeviceProfile::defaultCacheDirectory() {
+    const char* override_dir = std::getenv(CACHE_DIR_ENV_VAR);
+    if (override_dir && *override_dir) {
+        return override_dir;
+    }
+
+#if defined(_WIN32)
+    const char* local_app_data = std::getenv("LOCALAPPDATA");
+    return local_app_data ? std::string(local_app_data) + "/SPOBX8Edit" : std::string();
+#else
+    const char* home = std::getenv("HOME");
+#if defined(__APPLE__)
+    return home ? std::string(home) + "/Library/Caches/SPOBX8Edit" : std::string();
+#else
+    const char* xdg_cache = std::getenv("XDG_CACHE_HOME");
+    if (xdg_cache && *xdg_cache) {
+        return std::string(xdg_cache) + "/spobx8edit";
+    }
+    return home ? std::string(home) + "/.cache/spobx8edit" : std::string();
+#endif
+#endif
+}
+
+const DeviceProfileRecord& DeviceProfile::parameter(size_t index) const {
+    const DeviceProfileRecord* records = reinterpret_cast<const DeviceProfileRecord*>(data_ + header().parameters_offset);
+    return records[index];
+}
+
+const char* DeviceProfile::string(uint32_t reference) const {
+    return reinterpret_cast<const char*>(data_ + header().strings_offset + reference);
+}
+
+const char* DeviceProfile::stepName(const DeviceProfileRecord& record, uint32_t step) const {
+    const uint32_t* steps = reinterpret_cast<const uint32_t*>(data_ + header().steps_offset);
+    return string(steps[record.first_step + step]);
+}
@@ -0,0 +1,139 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Hardware parameter maps described in a text profile (see profiles/obx8.profile
+// for the format). A profile is parsed and validated once, compiled into a flat
+// binary image and written to a cache file named after a hash of its text; later
+// loads memory-map that file and skip parsing, so load time does not grow with
+// the size of the profile. The default profile is compiled into the plugin.
+
+// Compiled image layout, native byte order. Offsets are from the start of the
+// image; string references are offsets into the string table, whose strings are
+// NUL-terminated.
+struct DeviceProfileHeader {
+    char magic[8];              // "OBX8PRF" + '\0'
+    uint32_t format_version;
+    uint32_t parameter_count;
+    uint64_t source_hash;       // hash of the profile text and reserved IDs
+    uint32_t parameters_offset; // DeviceProfileRecord[parameter_count]
+    uint32_t steps_offset;      // uint32_t string references, step names of all parameters
+    uint32_t step_count;
+    uint32_t strings_offset;
+    uint32_t strings_size;
+    uint32_t name;              // profile name
+};
+
+struct DeviceProfileRecord {
+    uint32_t id;
+    uint32_t name;
+    uint32_t display_name;
+    uint32_t unit;
+    uint32_t group;
+    uint32_t first_step;
+    uint32_t step_count;
+    uint16_t nrpn_msb;
+    uint16_t nrpn_lsb;
+    uint8_t midi_cc;
+    uint8_t flags;
+    uint16_t reserved;
+    double min_value;
+    double max_value;
+    double default_value;
+};
+
+enum DeviceProfileFlags : uint8_t {
+    PROFILE_PARAM_STEPPED = 1 << 0,
+    PROFILE_PARAM_RELATIVE = 1 << 1  // accepts data increment/decrement
+};
+
+// One parameter as written in the profile text
+struct DeviceProfileParameter {
+    uint32_t id;
+    std::string name;
+    std::string display_name;
+    std::string unit;
+    std::string group;
+    uint16_t nrpn_msb;
+    uint16_t nrpn_lsb;
+    uint8_t midi_cc;
+    double min_value;
+    double max_value;
+    double default_value;
+    bool is_stepped;
+    bool relative;
+    std::vector<std::string> step_names;
+};
+
+class DeviceProfile {
+public:
+    static const uint32_t FORMAT_VERSION = 1;
+    // Path of a text profile to use instead of the built-in one
+    static const char* const PROFILE_ENV_VAR;
+    // Directory for compiled profiles, overriding the per-user cache directory
+    static const char* const CACHE_DIR_ENV_VAR;
+    
+    ~DeviceProfile();
+    DeviceProfile(const DeviceProfile&) = delete;
+    DeviceProfile& operator=(const DeviceProfile&) = delete;
+    
+    // Loads profile text through the compiled cache in cache_dir (no caching when
+    // empty). reserved_ids are IDs the plugin uses itself; profile IDs must not
+    // use them and, together with them, must be dense from 0. Returns null with a
+    // message in error when the text does not validate.
+    static std::unique_ptr<DeviceProfile> load(const std::string& text, const std::vector<uint32_t>& reserved_ids,
+                                               const std::string& cache_dir, std::string& error);
+    
+    // Text to validated parameter definitions. Problems that older profiles are
+    // known to contain (duplicate NRPN/CC assignments, CCs the MIDI layer also
+    // uses) are reported in warnings rather than rejected.
+    static bool parse(const std::string& text, const std::vector<uint32_t>& reserved_ids,
+                      std::string& profile_name, std::vector<DeviceProfileParameter>& parameters,
+                      std::vector<std::string>& warnings, std::string& error);
+    
+    // Validated definitions to a binary image
+    static std::vector<uint8_t> compile(const std::string& profile_name,
+                                        const std::vector<DeviceProfileParameter>& parameters, uint64_t source_hash);
+    
+    static uint64_t hashSource(const std::string& text, const std::vector<uint32_t>& reserved_ids);
+    
+    // Per-user cache directory ($SPOBX8_PROFILE_CACHE, else the platform cache dir)
+    static std::string defaultCacheDirectory();
+    
+    // Controllers the MIDI layer interprets itself: bank select, data entry,
+    // data increment/decrement, NRPN/RPN select, and the forwarded mod wheel/sustain
+    static bool isReservedController(long cc);
+    
+    // Image access
+    const char* name() const { return string(header().name); }
+    size_t parameterCount() const { return header().parameter_count; }
+    const DeviceProfileRecord& parameter(size_t index) const;
+    const char* string(uint32_t reference) const;
+    const char* stepName(const DeviceProfileRecord& record, uint32_t step) const;
+    
+    // How this load was satisfied
+    bool isMapped() const { return mapping_ != nullptr; }
+    bool wasCompiled() const { return compiled_; }
+    const std::vector<std::string>& getWarnings() const { return warnings_; }
+
+private:
+    DeviceProfile();
+    
+    const uint8_t* data_;
+    size_t size_;
+    void* mapping_;
+    std::vector<uint8_t> owned_;
+    bool compiled_;
+    std::vector<std::string> warnings_;
+    
+    const DeviceProfileHeader& header() const { return *reinterpret_cast<const DeviceProfileHeader*>(data_); }
+    static bool validateImage(const uint8_t* data, size_t size, uint64_t source_hash);
+    bool mapFile(const std::string& path, uint64_t source_hash);
+    static bool writeFile(const std::string& path, const std::vector<uint8_t>& image);
+};
+
+// Built-in profile text (profiles/obx8.profile, embedded at build time)
+extern const char DEFAULT_DEVICE_PROFILE[];
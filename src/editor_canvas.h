@@ -0,0 +1,50 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+struct EditorRect {
+    int x;
+    int y;
+    int width;
+    int height;
+    
+    bool contains(int px, int py) const { return px >= x && py >= y && px < x + width && py < y + height; }
+    bool isEmpty() const { return width <= 0 || height <= 0; }
+};
+
+// Software framebuffer the editor draws into: 32-bit 0xAARRGGBB pixels, rows top
+// to bottom, which a native view blits as is (little-endian BGRA, alpha ignored).
+// Text uses a built-in 5x7 ASCII font, so drawing needs nothing from the platform.
+class EditorCanvas {
+public:
+    EditorCanvas(int width, int height);
+    
+    int width() const { return width_; }
+    int height() const { return height_; }
+    const uint32_t* pixels() const { return pixels_.data(); }
+    size_t bytesPerRow() const { return static_cast<size_t>(width_) * sizeof(uint32_t); }
+    
+    // Everything clips to the canvas
+    void fillRect(const EditorRect& rect, uint32_t color);
+    void frameRect(const EditorRect& rect, uint32_t color);
+    
+    // Draws text with its top-left corner at x, y, cut at max_width pixels. Bytes
+    // outside printable ASCII draw as '?'.
+    void drawText(int x, int y, const std::string& text, uint32_t color, int max_width = 1 << 30);
+    static int textWidth(const std::string& text) { return static_cast<int>(text.size()) * GLYPH_ADVANCE; }
+    
+    uint32_t pixel(int x, int y) const { return pixels_[static_cast<size_t>(y) * width_ + x]; }
+    
+    static const int GLYPH_WIDTH = 5;
+    static const int GLYPH_HEIGHT = 7;
+    static const int GLYPH_ADVANCE = 6;
+
+private:
+    int width_;
+    int height_;
+    std::vector<uint32_t> pixels_;
+    
+    void drawGlyph(int x, int y, char c, uint32_t color);
+};
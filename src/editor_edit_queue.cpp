@@ -0,0 +1,27 @@
+#include "editor_edit_queue.h"
+
+EditorEditQueue::EditorEditQueue()
+    : ring_head_(0)
+    , ring_tail_(0)
+{
+}
+
+bool EditorEditQueue::push(const EditorEdit& edit) {
+    size_t head = ring_head_.load(std::memory_order_relaxed);
+    if (head - ring_tail_.load(std::memory_order_acquire) >= RING_SIZE) {
+        return false;
+    }
+    ring_[head & (RING_SIZE - 1)] = edit;
+    ring_head_.store(head + 1, std::memory_order_release);
+    return true;
+}
+
+bool EditorEditQueue::pop(EditorEdit& edit) {
+    size_t tail = ring_tail_.load(std::memory_order_relaxed);
+    if (tail == ring_head_.load(std::memory_order_acquire)) {
+        return false;
+    }
+    edit = ring_[tail & (RING_SIZE - 1)];
+    ring_tail_.store(tail + 1, std::memory_order_release);
+    return true;
+}
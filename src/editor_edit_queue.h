@@ -0,0 +1,42 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+enum EditorEditType : uint8_t {
+    EDITOR_EDIT_BEGIN,   // the user grabbed a control
+    EDITOR_EDIT_VALUE,
+    EDITOR_EDIT_END      // and let go of it
+};
+
+struct EditorEdit {
+    uint32_t param_id;
+    EditorEditType type;
+    double value;        // normalized, EDITOR_EDIT_VALUE only
+};
+
+// Edits made in the editor on their way to the audio thread, which applies them
+// like host automation and reports them to the host as gestures. Single
+// producer (the main thread), single consumer (process() or a params flush);
+// neither side blocks or allocates.
+class EditorEditQueue {
+public:
+    EditorEditQueue();
+    
+    // Main thread. Returns false and drops the edit when the queue is full.
+    bool push(const EditorEdit& edit);
+    
+    // Consumer
+    bool pop(EditorEdit& edit);
+    bool empty() const {
+        return ring_head_.load(std::memory_order_acquire) == ring_tail_.load(std::memory_order_relaxed);
+    }
+    
+    static const size_t RING_SIZE = 256;  // power of two
+
+private:
+    std::array<EditorEdit, RING_SIZE> ring_;
+    std::atomic<size_t> ring_head_;  // next write, owned by the producer
+    std::atomic<size_t> ring_tail_;  // next read, owned by the consumer
+};
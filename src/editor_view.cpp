@@ -0,0 +1,243 @@
+#include "editor_view.h"
+#include <algorithm>
+#include <array>
+#include <cmath>
+
+const char* const EditorView::HEADLESS_API = "spobx8.headless";
+
+// Colours, 0xAARRGGBB
+static const uint32_t COLOR_BACKGROUND = 0xFF15171A;
+static const uint32_t COLOR_PANEL = 0xFF23262B;
+static const uint32_t COLOR_PANEL_TITLE = 0xFF30343A;
+static const uint32_t COLOR_TITLE_TEXT = 0xFFE8C547;
+static const uint32_t COLOR_LABEL = 0xFFC8CCD2;
+static const uint32_t COLOR_VALUE = 0xFFFFFFFF;
+static const uint32_t COLOR_BAR_FRAME = 0xFF4A4F57;
+static const uint32_t COLOR_BAR_FILL = 0xFF5B8DD6;
+static const uint32_t COLOR_BAR_DRAGGED = 0xFF8FB8F0;
+
+EditorView::EditorView(const OBX8ParameterManager& params, const ParameterStore& store,
+                       ParameterDisplayTable& display_table, EditorEditQueue& edits)
+    : store_(store)
+    , display_table_(display_table)
+    , edits_(edits)
+    , canvas_(layout(params, sections_, controls_))
+    , drawn_version_(0)
+    , full_redraw_(true)
+    , frame_interval_ns_(static_cast<uint64_t>(1e9 / DEFAULT_MAX_FRAME_RATE))
+    , last_frame_ns_(0)
+    , drag_control_(-1)
+    , drag_value_(0)
+    , redraw_control_(-1)
+    , frames_drawn_(0)
+    , controls_drawn_(0)
+    , edits_dropped_(0)
+{
+    dirty_.reserve(controls_.size() + 1);
+}
+
+EditorCanvas EditorView::layout(const OBX8ParameterManager& params, std::vector<Section>& sections,
+                                std::vector<Control>& controls) {
+    // Sections in profile order, each with its parameters in profile order
+    std::vector<std::vector<const OBX8Parameter*>> members;
+    for (const OBX8Parameter& param : params.getParameters()) {
+        std::string title = param.group.empty() ? "Other" : param.group;
+        size_t index = 0;
+        while (index < sections.size() && sections[index].title != title) {
+            ++index;
+        }
+        if (index == sections.size()) {
+            sections.push_back(Section{title, EditorRect{0, 0, 0, 0}});
+            members.emplace_back();
+        }
+        members[index].push_back(&param);
+    }
+    
+    // Each panel goes to the shortest column
+    std::array<int, COLUMNS> column_bottom;
+    column_bottom.fill(MARGIN);
+    for (size_t s = 0; s < sections.size(); ++s) {
+        int column = static_cast<int>(std::min_element(column_bottom.begin(), column_bottom.end()) - column_bottom.begin());
+        int height = PANEL_TITLE_HEIGHT + static_cast<int>(members[s].size()) * CONTROL_HEIGHT + CONTROL_PADDING;
+        EditorRect panel = {MARGIN + column * (PANEL_WIDTH + MARGIN), column_bottom[column], PANEL_WIDTH, height};
+        sections[s].rect = panel;
+        column_bottom[column] += height + MARGIN;
+        
+        int y = panel.y + PANEL_TITLE_HEIGHT + CONTROL_PADDING / 2;
+        for (const OBX8Parameter* param : members[s]) {
+            EditorRect rect = {panel.x + CONTROL_PADDING, y, PANEL_WIDTH - 2 * CONTROL_PADDING, CONTROL_HEIGHT};
+            EditorRect bar = {rect.x, rect.y + EditorCanvas::GLYPH_HEIGHT + 5, rect.width, 8};
+            controls.push_back(Control{param, rect, bar, 0});
+            y += CONTROL_HEIGHT;
+        }
+    }
+    
+    int width = MARGIN + COLUMNS * (PANEL_WIDTH + MARGIN);
+    int height = *std::max_element(column_bottom.begin(), column_bottom.end());
+    return EditorCanvas(width, height);
+}
+
+void EditorView::setMaxFrameRate(double frames_per_second) {
+    frame_interval_ns_ = frames_per_second > 0.0 ? static_cast<uint64_t>(1e9 / frames_per_second) : 0;
+}
+
+const std::vector<EditorRect>& EditorView::update(uint64_t now_ns) {
+    dirty_.clear();
+    if (last_frame_ns_ != 0 && now_ns - last_frame_ns_ < frame_interval_ns_) {
+        return dirty_;
+    }
+    
+    uint64_t version = store_.getVersion();
+    if (version == drawn_version_ && !full_redraw_ && redraw_control_ < 0) {
+        return dirty_;
+    }
+    
+    if (full_redraw_) {
+        canvas_.fillRect(EditorRect{0, 0, canvas_.width(), canvas_.height()}, COLOR_BACKGROUND);
+        for (const Section& section : sections_) {
+            drawSection(section);
+        }
+        for (Control& control : controls_) {
+            drawControl(control);
+        }
+        dirty_.push_back(EditorRect{0, 0, canvas_.width(), canvas_.height()});
+    } else {
+        for (size_t i = 0; i < controls_.size(); ++i) {
+            Control& control = controls_[i];
+            if (static_cast<int>(i) == redraw_control_ || store_.read(control.param->id).sequence != control.drawn_sequence) {
+                drawControl(control);
+                dirty_.push_back(control.rect);
+            }
+        }
+    }
+    
+    // A write landing during the pass is drawn next frame: its version is newer
+    drawn_version_ = version;
+    full_redraw_ = false;
+    redraw_control_ = -1;
+    last_frame_ns_ = now_ns;
+    ++frames_drawn_;
+    return dirty_;
+}
+
+void EditorView::drawSection(const Section& section) {
+    canvas_.fillRect(section.rect, COLOR_PANEL);
+    canvas_.fillRect(EditorRect{section.rect.x, section.rect.y, section.rect.width, PANEL_TITLE_HEIGHT},
+                     COLOR_PANEL_TITLE);
+    canvas_.drawText(section.rect.x + CONTROL_PADDING, section.rect.y + (PANEL_TITLE_HEIGHT - EditorCanvas::GLYPH_HEIGHT) / 2,
+                     section.title, COLOR_TITLE_TEXT, section.rect.width - 2 * CONTROL_PADDING);
+}
+
+void EditorView::drawControl(Control& control) {
+    const OBX8Parameter& param = *control.param;
+    ParameterEntry entry = store_.read(param.id);
+    control.drawn_sequence = entry.sequence;
+    
+    bool dragged = drag_control_ >= 0 && &controls_[drag_control_] == &control;
+    int hardware_value = dragged ? drag_value_ : toHardwareStep(param, entry.value);
+    double range = param.max_value - param.min_value;
+    double position = range > 0.0 ? (hardware_value - param.min_value) / range : 0.0;
+    
+    const std::string* text = display_table_.getText(param, hardware_value);
+    std::string value_text = text ? *text : std::to_string(hardware_value);
+    int value_width = std::min(EditorCanvas::textWidth(value_text), control.rect.width / 2);
+    
+    canvas_.fillRect(control.rect, COLOR_PANEL);
+    canvas_.drawText(control.rect.x, control.rect.y + 2, param.display_name, COLOR_LABEL,
+                     control.rect.width - value_width - EditorCanvas::GLYPH_ADVANCE);
+    canvas_.drawText(control.rect.x + control.rect.width - value_width, control.rect.y + 2, value_text,
+                     COLOR_VALUE, value_width);
+    
+    canvas_.frameRect(control.bar, COLOR_BAR_FRAME);
+    int fill = static_cast<int>(position * (control.bar.width - 2) + 0.5);
+    canvas_.fillRect(EditorRect{control.bar.x + 1, control.bar.y + 1, fill, control.bar.height - 2},
+                     dragged ? COLOR_BAR_DRAGGED : COLOR_BAR_FILL);
+    ++controls_drawn_;
+}
+
+int EditorView::toHardwareStep(const OBX8Parameter& param, double hardware_value) {
+    double step = std::max(param.min_value, std::min(param.max_value, std::round(hardware_value)));
+    return static_cast<int>(step);
+}
+
+EditorRect EditorView::getControlBar(uint32_t param_id) const {
+    for (const Control& control : controls_) {
+        if (control.param->id == param_id) {
+            return control.bar;
+        }
+    }
+    return EditorRect{0, 0, 0, 0};
+}
+
+int EditorView::controlAt(int x, int y) const {
+    for (size_t i = 0; i < controls_.size(); ++i) {
+        if (controls_[i].rect.contains(x, y)) {
+            return static_cast<int>(i);
+        }
+    }
+    return -1;
+}
+
+void EditorView::mouseDown(int x, int y) {
+    if (drag_control_ >= 0) {
+        mouseUp();
+    }
+    int index = controlAt(x, y);
+    if (index < 0) {
+        return;
+    }
+    
+    const Control& control = controls_[index];
+    drag_control_ = index;
+    redraw_control_ = index;
+    drag_value_ = toHardwareStep(*control.param, store_.load(control.param->id));
+    pushEdit(EditorEdit{control.param->id, EDITOR_EDIT_BEGIN, 0.0});
+    dragTo(x);
+    if (edit_listener_) {
+        edit_listener_();
+    }
+}
+
+void EditorView::mouseDrag(int x, int y) {
+    if (drag_control_ < 0) {
+        return;
+    }
+    dragTo(x);
+    if (edit_listener_) {
+        edit_listener_();
+    }
+}
+
+void EditorView::mouseUp() {
+    if (drag_control_ < 0) {
+        return;
+    }
+    pushEdit(EditorEdit{controls_[drag_control_].param->id, EDITOR_EDIT_END, 0.0});
+    redraw_control_ = drag_control_;
+    drag_control_ = -1;
+    if (edit_listener_) {
+        edit_listener_();
+    }
+}
+
+void EditorView::dragTo(int x) {
+    Control& control = controls_[drag_control_];
+    const OBX8Parameter* param = control.param;
+    
+    // Only whole hardware steps are sent, and only when the step changes
+    double position = (x - control.bar.x) / double(std::max(1, control.bar.width - 1));
+    position = std::max(0.0, std::min(1.0, position));
+    int value = toHardwareStep(*param, param->min_value + position * (param->max_value - param->min_value));
+    if (value == drag_value_) {
+        return;
+    }
+    drag_value_ = value;
+    redraw_control_ = drag_control_;
+    pushEdit(EditorEdit{param->id, EDITOR_EDIT_VALUE, OBX8ParameterManager::normalizeParameterValue(param, value)});
+}
+
+void EditorView::pushEdit(const EditorEdit& edit) {
+    if (!edits_.push(edit)) {
+        ++edits_dropped_;
+    }
+}
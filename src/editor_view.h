@@ -0,0 +1,115 @@
+#pragma once
+#include "editor_canvas.h"
+#include "editor_edit_queue.h"
+#include "obx8_parameters.h"
+#include "param_display_table.h"
+#include "parameter_store.h"
+#include <functional>
+#include <string>
+#include <vector>
+
+// The plugin editor, independent of any window system: one panel per profile
+// section with a labelled value bar per parameter, drawn into an EditorCanvas.
+//
+// Values are read straight from the ParameterStore, never through a lock the
+// audio thread could hold. A frame first compares the store's version with the
+// one last drawn, so an idle editor costs one atomic load per frame; when it
+// moved, only the controls whose per-parameter sequence number changed are
+// redrawn and reported as dirty for the native view to blit. Frames are capped
+// at a maximum rate however often the platform timer fires.
+//
+// Dragging a bar queues BEGIN, VALUE... END edits for the audio thread, which
+// applies them and reports them to the host; the dragged control shows the
+// dragged value until it is released.
+// Main thread only.
+class EditorView {
+public:
+    EditorView(const OBX8ParameterManager& params, const ParameterStore& store,
+               ParameterDisplayTable& display_table, EditorEditQueue& edits);
+    
+    int width() const { return canvas_.width(); }
+    int height() const { return canvas_.height(); }
+    const EditorCanvas& canvas() const { return canvas_; }
+    
+    // Called after edits were queued so the plugin can get them applied
+    void setEditListener(std::function<void()> listener) { edit_listener_ = listener; }
+    
+    // Draws a frame if one is due and anything changed. Returns the areas drawn,
+    // empty when there was nothing to do; valid until the next call.
+    const std::vector<EditorRect>& update(uint64_t now_ns);
+    
+    // Forces a full redraw on the next frame (window shown, canvas lost)
+    void invalidate() { full_redraw_ = true; }
+    
+    void setMaxFrameRate(double frames_per_second);
+    
+    // Where a parameter's value bar is drawn, empty when it isn't shown
+    EditorRect getControlBar(uint32_t param_id) const;
+    
+    // Mouse input in canvas pixels
+    void mouseDown(int x, int y);
+    void mouseDrag(int x, int y);
+    void mouseUp();
+    
+    uint64_t getFramesDrawn() const { return frames_drawn_; }
+    uint64_t getControlsDrawn() const { return controls_drawn_; }
+    uint64_t getEditsDropped() const { return edits_dropped_; }
+    
+    // Window API name for an editor without a window, drawn offscreen only
+    static const char* const HEADLESS_API;
+    static constexpr double DEFAULT_MAX_FRAME_RATE = 30.0;
+    
+    // Layout, in canvas pixels
+    static const int COLUMNS = 4;
+    static const int MARGIN = 8;
+    static const int PANEL_WIDTH = 190;
+    static const int PANEL_TITLE_HEIGHT = 15;
+    static const int CONTROL_HEIGHT = 22;
+    static const int CONTROL_PADDING = 6;
+
+private:
+    struct Control {
+        const OBX8Parameter* param;
+        EditorRect rect;
+        EditorRect bar;
+        uint32_t drawn_sequence;
+    };
+    
+    struct Section {
+        std::string title;
+        EditorRect rect;
+    };
+    
+    const ParameterStore& store_;
+    ParameterDisplayTable& display_table_;
+    EditorEditQueue& edits_;
+    std::function<void()> edit_listener_;
+    
+    std::vector<Section> sections_;
+    std::vector<Control> controls_;
+    EditorCanvas canvas_;
+    std::vector<EditorRect> dirty_;
+    
+    uint64_t drawn_version_;
+    bool full_redraw_;
+    uint64_t frame_interval_ns_;
+    uint64_t last_frame_ns_;
+    
+    // Control being dragged, -1 for none, and the hardware value it was dragged to
+    int drag_control_;
+    int drag_value_;
+    int redraw_control_;  // grabbed, dragged or released since the last frame, -1 for none
+    
+    uint64_t frames_drawn_;
+    uint64_t controls_drawn_;
+    uint64_t edits_dropped_;
+    
+    static EditorCanvas layout(const OBX8ParameterManager& params, std::vector<Section>& sections,
+                               std::vector<Control>& controls);
+    void drawSection(const Section& section);
+    void drawControl(Control& control);
+    static int toHardwareStep(const OBX8Parameter& param, double hardware_value);
+    int controlAt(int x, int y) const;
+    void dragTo(int x);
+    void pushEdit(const EditorEdit& edit);
+};
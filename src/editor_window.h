@@ -0,0 +1,12 @@
+#pragma once
+#include <clap/clap.h>
+
+class EditorView;
+struct EditorWindow;
+
+// Native view for an EditorView inside the host's window. macOS only
+// (editor_window_cocoa.mm); elsewhere the editor only runs headless.
+// Main thread only.
+EditorWindow* createEditorWindow(EditorView& editor, const clap_window_t* parent);
+void destroyEditorWindow(EditorWindow* window);
+void setEditorWindowVisible(EditorWindow* window, bool visible);
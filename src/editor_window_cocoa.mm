@@ -0,0 +1,156 @@
+#import <Cocoa/Cocoa.h>
+#include "editor_window.h"
+#include "editor_view.h"
+#include <chrono>
+#include <cstring>
+
+// Blits the editor's canvas and forwards mouse input. A timer polls the editor at
+// twice its frame cap; a poll with nothing to draw is one atomic load, so many
+// open editors stay cheap. Only the areas the editor redrew are invalidated.
+@interface SPOBX8EditorNSView : NSView {
+    EditorView* editor_;
+    NSTimer* timer_;
+}
+- (instancetype)initWithEditor:(EditorView*)editor;
+- (void)stop;
+- (void)tick;
+@end
+
+@implementation SPOBX8EditorNSView
+
+- (instancetype)initWithEditor:(EditorView*)editor {
+    self = [super initWithFrame:NSMakeRect(0, 0, editor->width(), editor->height())];
+    if (self) {
+        editor_ = editor;
+        __weak SPOBX8EditorNSView* weak_self = self;
+        timer_ = [NSTimer timerWithTimeInterval:1.0 / (2.0 * EditorView::DEFAULT_MAX_FRAME_RATE)
+                                        repeats:YES
+                                          block:^(NSTimer* timer) {
+            [weak_self tick];
+        }];
+        [[NSRunLoop mainRunLoop] addTimer:timer_ forMode:NSRunLoopCommonModes];
+    }
+    return self;
+}
+
+- (void)stop {
+    [timer_ invalidate];
+    timer_ = nil;
+    editor_ = nullptr;
+}
+
+- (BOOL)isFlipped {
+    return YES;
+}
+
+- (BOOL)acceptsFirstMouse:(NSEvent*)event {
+    return YES;
+}
+
+- (void)tick {
+    if (!editor_ || self.hidden || !self.window) {
+        return;
+    }
+    uint64_t now_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+    for (const EditorRect& rect : editor_->update(now_ns)) {
+        [self setNeedsDisplayInRect:NSMakeRect(rect.x, rect.y, rect.width, rect.height)];
+    }
+}
+
+- (void)drawRect:(NSRect)dirty_rect {
+    if (!editor_) {
+        return;
+    }
+    const EditorCanvas& canvas = editor_->canvas();
+    CGContextRef context = [[NSGraphicsContext currentContext] CGContext];
+    
+    // The canvas is 0xAARRGGBB words: BGRA bytes in memory, alpha ignored
+    CGColorSpaceRef color_space = CGColorSpaceCreateDeviceRGB();
+    CGDataProviderRef provider = CGDataProviderCreateWithData(nullptr, canvas.pixels(),
+                                                              canvas.bytesPerRow() * canvas.height(), nullptr);
+    CGImageRef image = CGImageCreate(canvas.width(), canvas.height(), 8, 32, canvas.bytesPerRow(), color_space,
+                                     kCGImageAlphaNoneSkipFirst | kCGBitmapByteOrder32Little, provider,
+                                     nullptr, false, kCGRenderingIntentDefault);
+    
+    // AppKit clips to the dirty areas; the view is flipped, so draw the image upright
+    CGContextSaveGState(context);
+    CGContextSetInterpolationQuality(context, kCGInterpolationNone);
+    CGContextTranslateCTM(context, 0, canvas.height());
+    CGContextScaleCTM(context, 1.0, -1.0);
+    CGContextDrawImage(context, CGRectMake(0, 0, canvas.width(), canvas.height()), image);
+    CGContextRestoreGState(context);
+    
+    CGImageRelease(image);
+    CGDataProviderRelease(provider);
+    CGColorSpaceRelease(color_space);
+}
+
+- (NSPoint)canvasPoint:(NSEvent*)event {
+    return [self convertPoint:event.locationInWindow fromView:nil];
+}
+
+- (void)mouseDown:(NSEvent*)event {
+    NSPoint point = [self canvasPoint:event];
+    if (editor_) {
+        editor_->mouseDown(static_cast<int>(point.x), static_cast<int>(point.y));
+        [self tick];
+    }
+}
+
+- (void)mouseDragged:(NSEvent*)event {
+    NSPoint point = [self canvasPoint:event];
+    if (editor_) {
+        editor_->mouseDrag(static_cast<int>(point.x), static_cast<int>(point.y));
+        [self tick];
+    }
+}
+
+- (void)mouseUp:(NSEvent*)event {
+    if (editor_) {
+        editor_->mouseUp();
+        [self tick];
+    }
+}
+
+@end
+
+struct EditorWindow {
+    EditorView* editor;
+    SPOBX8EditorNSView* view;
+};
+
+EditorWindow* createEditorWindow(EditorView& editor, const clap_window_t* parent) {
+    if (!parent || !parent->api || strcmp(parent->api, CLAP_WINDOW_API_COCOA) != 0 || !parent->cocoa) {
+        return nullptr;
+    }
+    
+    NSView* parent_view = (__bridge NSView*)parent->cocoa;
+    EditorWindow* window = new EditorWindow();
+    window->editor = &editor;
+    window->view = [[SPOBX8EditorNSView alloc] initWithEditor:&editor];
+    [parent_view addSubview:window->view];
+    editor.invalidate();
+    return window;
+}
+
+void destroyEditorWindow(EditorWindow* window) {
+    if (!window) {
+        return;
+    }
+    [window->view stop];
+    [window->view removeFromSuperview];
+    window->view = nil;
+    delete window;
+}
+
+void setEditorWindowVisible(EditorWindow* window, bool visible) {
+    if (!window) {
+        return;
+    }
+    window->view.hidden = !visible;
+    if (visible) {
+        window->editor->invalidate();
+        [window->view tick];
+    }
+}
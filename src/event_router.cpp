@@ -0,0 +1,134 @@
+#include "event_router.h"
+#include <algorithm>
+
+EventRouter::EventRouter()
+    : ring_head_(0)
+    , ring_tail_(0)
+{
+}
+
+bool EventRouter::pushHardware(uint64_t arrival_ns, const MidiMessage& message) {
+    size_t head = ring_head_.load(std::memory_order_relaxed);
+    if (head - ring_tail_.load(std::memory_order_acquire) >= HARDWARE_RING_SIZE) {
+        return false;
+    }
+    ring_[head & (HARDWARE_RING_SIZE - 1)] = HardwareEvent{arrival_ns, message};
+    ring_head_.store(head + 1, std::memory_order_release);
+    return true;
+}
+
+bool EventRouter::hasHardware() const {
+    return ring_tail_.load(std::memory_order_relaxed) != ring_head_.load(std::memory_order_acquire);
+}
+
+size_t EventRouter::takeHardware(uint32_t frames, uint64_t window_start_ns, uint64_t window_end_ns) {
+    size_t tail = ring_tail_.load(std::memory_order_relaxed);
+    size_t head = ring_head_.load(std::memory_order_acquire);
+    double samples_per_ns = window_end_ns > window_start_ns ? frames / double(window_end_ns - window_start_ns) : 0.0;
+    uint32_t last_frame = frames > 0 ? frames - 1 : 0;
+    
+    size_t count = 0;
+    while (tail != head && count < MAX_HARDWARE_PER_BLOCK) {
+        const HardwareEvent& event = ring_[tail & (HARDWARE_RING_SIZE - 1)];
+        // Input arriving while this block is processed belongs to the next one
+        if (event.arrival_ns >= window_end_ns) {
+            break;
+        }
+        
+        double offset = event.arrival_ns > window_start_ns ? (event.arrival_ns - window_start_ns) * samples_per_ns : 0.0;
+        block_hardware_[count] = event;
+        block_hardware_times_[count] = std::min(last_frame, static_cast<uint32_t>(offset));
+        ++count;
+        ++tail;
+    }
+    
+    ring_tail_.store(tail, std::memory_order_release);
+    return count;
+}
+
+void EventRouter::dispatchHost(const clap_event_header_t *header) {
+    if (header->space_id != CLAP_CORE_EVENT_SPACE_ID) {
+        return;
+    }
+    
+    switch (header->type) {
+        case CLAP_EVENT_PARAM_VALUE:
+            if (handlers_.param_value) {
+                handlers_.param_value(*reinterpret_cast<const clap_event_param_value_t*>(header));
+            }
+            break;
+        case CLAP_EVENT_PARAM_MOD:
+            if (handlers_.param_mod) {
+                handlers_.param_mod(*reinterpret_cast<const clap_event_param_mod_t*>(header));
+            }
+            break;
+        case CLAP_EVENT_MIDI:
+            if (handlers_.host_midi) {
+                const clap_event_midi_t *midi_event = reinterpret_cast<const clap_event_midi_t*>(header);
+                MidiMessage message;
+                message.status = midi_event->data[0];
+                message.data1 = midi_event->data[1];
+                message.data2 = midi_event->data[2];
+                message.timestamp = header->time;
+                handlers_.host_midi(header->time, message);
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+size_t EventRouter::route(const clap_input_events_t *in, uint32_t frames, uint64_t window_start_ns,
+                          uint64_t window_end_ns, const TimedMidiMessage* internal, size_t internal_count) {
+    size_t hardware_count = takeHardware(frames, window_start_ns, window_end_ns);
+    uint32_t host_count = in ? in->size(in) : 0;
+    
+    size_t host_index = 0;
+    size_t hardware_index = 0;
+    size_t internal_index = 0;
+    const clap_event_header_t *host_event = host_count > 0 ? in->get(in, 0) : nullptr;
+    
+    // Three sorted sources, one pass; ties go internal, hardware, host
+    while (host_event || hardware_index < hardware_count || internal_index < internal_count) {
+        bool has_hardware = hardware_index < hardware_count;
+        bool has_internal = internal_index < internal_count;
+        uint32_t hardware_time = has_hardware ? block_hardware_times_[hardware_index] : 0;
+        uint32_t internal_time = has_internal ? internal[internal_index].time : 0;
+        
+        if (has_internal && (!has_hardware || internal_time <= hardware_time) &&
+            (!host_event || internal_time <= host_event->time)) {
+            if (handlers_.internal_midi) {
+                handlers_.internal_midi(internal_time, internal[internal_index].message);
+            }
+            ++internal_index;
+        } else if (has_hardware && (!host_event || hardware_time <= host_event->time)) {
+            if (handlers_.hardware_midi) {
+                const HardwareEvent& event = block_hardware_[hardware_index];
+                handlers_.hardware_midi(hardware_time, event.message, event.arrival_ns);
+            }
+            ++hardware_index;
+        } else {
+            dispatchHost(host_event);
+            ++host_index;
+            host_event = host_index < host_count ? in->get(in, static_cast<uint32_t>(host_index)) : nullptr;
+        }
+    }
+    
+    return host_count + hardware_count + internal_count;
+}
+
+size_t EventRouter::flushHardware() {
+    size_t dispatched = 0;
+    size_t tail = ring_tail_.load(std::memory_order_relaxed);
+    size_t head = ring_head_.load(std::memory_order_acquire);
+    while (tail != head) {
+        const HardwareEvent& event = ring_[tail & (HARDWARE_RING_SIZE - 1)];
+        if (handlers_.hardware_midi) {
+            handlers_.hardware_midi(0, event.message, event.arrival_ns);
+        }
+        ++tail;
+        ++dispatched;
+    }
+    ring_tail_.store(tail, std::memory_order_release);
+    return dispatched;
+}
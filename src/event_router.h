@@ -0,0 +1,76 @@
+#pragma once
+#include <clap/clap.h>
+#include "midi_handler.h"
+#include "midi_clock.h"
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+
+// Everything that happens to the plugin within a block, in one time-ordered
+// stream. One pass over the host's input events is merged by sample time with
+// the plugin's internal events for the block (MIDI clock) and with MIDI received
+// from the hardware since the last block, and each event is dispatched once to
+// the handler for its type.
+//
+// Hardware MIDI arrives on the device's receive thread and is queued in a
+// single-producer ring with its arrival time. A block picks up what arrived
+// during the previous block's period and places it at the matching offset, so
+// hardware input runs one block late but keeps its spacing and its order
+// against host events. At equal times internal events go first, then hardware,
+// then host events, so host automation in the same sample wins.
+class EventRouter {
+public:
+    struct Handlers {
+        std::function<void(const clap_event_param_value_t&)> param_value;
+        std::function<void(const clap_event_param_mod_t&)> param_mod;
+        std::function<void(uint32_t time, const MidiMessage&)> host_midi;
+        std::function<void(uint32_t time, const MidiMessage&, uint64_t arrival_ns)> hardware_midi;
+        std::function<void(uint32_t time, const MidiMessage&)> internal_midi;
+    };
+    
+    EventRouter();
+    
+    void setHandlers(const Handlers& handlers) { handlers_ = handlers; }
+    
+    // Receive thread. Returns false and drops the message when the ring is full.
+    bool pushHardware(uint64_t arrival_ns, const MidiMessage& message);
+    
+    // Audio thread (or wherever the queued hardware input is consumed)
+    bool hasHardware() const;
+    
+    // Routes one block: host events from in (may be null), internal events (sorted
+    // by time) and hardware input that arrived before window_end_ns. Hardware
+    // arrivals are placed frames * (arrival - window_start) / (window_end - window_start),
+    // clamped into the block. Returns the number of events dispatched.
+    size_t route(const clap_input_events_t *in, uint32_t frames, uint64_t window_start_ns, uint64_t window_end_ns,
+                 const TimedMidiMessage* internal, size_t internal_count);
+    
+    // Dispatches all queued hardware input at time 0 (processing stopped)
+    size_t flushHardware();
+    
+    // Hardware messages taken per block; the rest wait for the next one
+    static const size_t MAX_HARDWARE_PER_BLOCK = 256;
+    static const size_t HARDWARE_RING_SIZE = 1024;  // power of two
+
+private:
+    struct HardwareEvent {
+        uint64_t arrival_ns;
+        MidiMessage message;
+    };
+    
+    Handlers handlers_;
+    
+    // Single producer, single consumer
+    std::array<HardwareEvent, HARDWARE_RING_SIZE> ring_;
+    std::atomic<size_t> ring_head_;  // next write, owned by the producer
+    std::atomic<size_t> ring_tail_;  // next read, owned by the consumer
+    
+    // This block's hardware input with sample times
+    std::array<HardwareEvent, MAX_HARDWARE_PER_BLOCK> block_hardware_;
+    std::array<uint32_t, MAX_HARDWARE_PER_BLOCK> block_hardware_times_;
+    
+    size_t takeHardware(uint32_t frames, uint64_t window_start_ns, uint64_t window_end_ns);
+    void dispatchHost(const clap_event_header_t *header);
+};
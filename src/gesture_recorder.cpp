@@ -0,0 +1,118 @@
+#include "gesture_recorder.h"
+#include <algorithm>
+#include <limits>
+
+GestureRecorder::GestureRecorder(size_t parameter_count, size_t max_values_per_block)
+    : gestures_(parameter_count)
+    , event_count_(0)
+    , next_sequence_(0)
+    , values_this_block_(0)
+    , max_values_per_block_(max_values_per_block)
+    , tolerance_(DEFAULT_TOLERANCE_STEPS)
+    , idle_timeout_ns_(DEFAULT_IDLE_TIMEOUT_NS)
+{
+    active_ids_.reserve(parameter_count);
+    
+    // Per value at most a kept point plus a begin; per gesture a final point and an end
+    events_.resize(2 * max_values_per_block + 2 * parameter_count);
+    for (Gesture& gesture : gestures_) {
+        gesture.active = false;
+    }
+}
+
+void GestureRecorder::emit(uint64_t time_ns, uint32_t param_id, GestureEventType type, int32_t value) {
+    if (event_count_ < events_.size()) {
+        events_[event_count_++] = GestureEvent{time_ns, param_id, type, value, next_sequence_++};
+    }
+}
+
+void GestureRecorder::addValue(uint32_t param_id, int32_t value, uint64_t time_ns) {
+    if (param_id >= gestures_.size() || values_this_block_ >= max_values_per_block_) {
+        return;
+    }
+    ++values_this_block_;
+    
+    Gesture& gesture = gestures_[param_id];
+    if (!gesture.active) {
+        gesture.active = true;
+        gesture.anchor_time_ns = gesture.last_time_ns = time_ns;
+        gesture.anchor_value = gesture.last_value = value;
+        gesture.last_kept = true;
+        gesture.slope_low = -std::numeric_limits<double>::infinity();
+        gesture.slope_high = std::numeric_limits<double>::infinity();
+        active_ids_.push_back(param_id);
+        emit(time_ns, param_id, GESTURE_BEGIN);
+        emit(time_ns, param_id, GESTURE_POINT, value);
+        return;
+    }
+    
+    // Arrival times only move forward
+    time_ns = std::max(time_ns, gesture.last_time_ns);
+    
+    // The previous value now lies inside the segment: narrow the door to the
+    // slopes from the anchor that pass within the tolerance of it
+    if (!gesture.last_kept) {
+        double tolerance = tolerance_.load(std::memory_order_relaxed);
+        double dt = static_cast<double>(std::max<uint64_t>(1, gesture.last_time_ns - gesture.anchor_time_ns));
+        gesture.slope_low = std::max(gesture.slope_low, (gesture.last_value - tolerance - gesture.anchor_value) / dt);
+        gesture.slope_high = std::min(gesture.slope_high, (gesture.last_value + tolerance - gesture.anchor_value) / dt);
+    }
+    
+    // A segment ending here would miss a value in between: end it at the previous
+    // value instead, which fit when it arrived, and start the next one from there
+    double slope = (value - gesture.anchor_value) /
+                   static_cast<double>(std::max<uint64_t>(1, time_ns - gesture.anchor_time_ns));
+    if (slope < gesture.slope_low || slope > gesture.slope_high) {
+        emit(gesture.last_time_ns, param_id, GESTURE_POINT, gesture.last_value);
+        gesture.anchor_time_ns = gesture.last_time_ns;
+        gesture.anchor_value = gesture.last_value;
+        gesture.slope_low = -std::numeric_limits<double>::infinity();
+        gesture.slope_high = std::numeric_limits<double>::infinity();
+    }
+    
+    gesture.last_time_ns = time_ns;
+    gesture.last_value = value;
+    gesture.last_kept = false;
+}
+
+void GestureRecorder::endGesture(uint32_t param_id) {
+    Gesture& gesture = gestures_[param_id];
+    if (!gesture.last_kept) {
+        emit(gesture.last_time_ns, param_id, GESTURE_POINT, gesture.last_value);
+    }
+    emit(gesture.last_time_ns, param_id, GESTURE_END);
+    gesture.active = false;
+}
+
+void GestureRecorder::endIdleGestures(uint64_t now_ns) {
+    uint64_t timeout_ns = idle_timeout_ns_.load(std::memory_order_relaxed);
+    size_t kept = 0;
+    for (size_t i = 0; i < active_ids_.size(); ++i) {
+        uint32_t param_id = active_ids_[i];
+        const Gesture& gesture = gestures_[param_id];
+        if (now_ns > gesture.last_time_ns && now_ns - gesture.last_time_ns >= timeout_ns) {
+            endGesture(param_id);
+        } else {
+            active_ids_[kept++] = param_id;
+        }
+    }
+    active_ids_.resize(kept);
+}
+
+void GestureRecorder::endAllGestures() {
+    for (uint32_t param_id : active_ids_) {
+        endGesture(param_id);
+    }
+    active_ids_.clear();
+}
+
+const GestureEvent* GestureRecorder::takeEvents(size_t& count) {
+    // A parameter's events are already in time order; parameters interleave
+    std::sort(events_.begin(), events_.begin() + event_count_, [](const GestureEvent& a, const GestureEvent& b) {
+        return a.time_ns != b.time_ns ? a.time_ns < b.time_ns : a.sequence < b.sequence;
+    });
+    count = event_count_;
+    event_count_ = 0;
+    values_this_block_ = 0;
+    return events_.data();
+}
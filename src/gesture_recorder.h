@@ -0,0 +1,83 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+enum GestureEventType : uint8_t {
+    GESTURE_BEGIN,
+    GESTURE_POINT,
+    GESTURE_END
+};
+
+struct GestureEvent {
+    uint64_t time_ns;
+    uint32_t param_id;
+    GestureEventType type;
+    int32_t value;       // hardware units, GESTURE_POINT only
+    uint32_t sequence;   // emission order, keeps a gesture's events in order at equal times
+};
+
+// Turns hardware knob moves into host automation gestures. The first value of a
+// parameter begins a gesture, which ends once no value has arrived for the idle
+// timeout. In between, each gesture is thinned online by a swing door: a value is
+// kept only when the straight line from the last kept one to the newest value
+// would no longer pass within the tolerance of every value in between. Kept
+// points are received values, so a linear automation lane through them stays
+// within the tolerance of the whole move; below half a hardware step it rounds
+// back to exactly what was played.
+// Audio thread only, except the setters; nothing allocates after construction.
+class GestureRecorder {
+public:
+    GestureRecorder(size_t parameter_count, size_t max_values_per_block);
+    
+    // Distance from the kept line allowed per value, in hardware steps
+    void setTolerance(double steps) { tolerance_.store(steps, std::memory_order_relaxed); }
+    void setIdleTimeoutNs(uint64_t timeout_ns) { idle_timeout_ns_.store(timeout_ns, std::memory_order_relaxed); }
+    
+    // A value the hardware reported for a parameter. Values past
+    // max_values_per_block in one block are dropped until takeEvents().
+    void addValue(uint32_t param_id, int32_t value, uint64_t time_ns);
+    
+    // Ends the gestures that have been idle since before now_ns - timeout
+    void endIdleGestures(uint64_t now_ns);
+    
+    // Ends every gesture (processing stopped)
+    void endAllGestures();
+    
+    bool hasActiveGestures() const { return !active_ids_.empty(); }
+    bool hasEvents() const { return event_count_ > 0; }
+    
+    // The events produced since the last call, sorted by time, valid until the next call
+    const GestureEvent* takeEvents(size_t& count);
+    
+    static constexpr double DEFAULT_TOLERANCE_STEPS = 0.49;
+    static const uint64_t DEFAULT_IDLE_TIMEOUT_NS = 250000000;
+
+private:
+    struct Gesture {
+        bool active;
+        uint64_t anchor_time_ns;   // last kept point
+        int32_t anchor_value;
+        uint64_t last_time_ns;     // last received point
+        int32_t last_value;
+        bool last_kept;
+        double slope_low;          // the door: slopes from the anchor that fit every value in between
+        double slope_high;
+    };
+    
+    std::vector<Gesture> gestures_;
+    std::vector<uint32_t> active_ids_;
+    
+    std::vector<GestureEvent> events_;
+    size_t event_count_;
+    uint32_t next_sequence_;
+    size_t values_this_block_;
+    size_t max_values_per_block_;
+    
+    std::atomic<double> tolerance_;
+    std::atomic<uint64_t> idle_timeout_ns_;
+    
+    void emit(uint64_t time_ns, uint32_t param_id, GestureEventType type, int32_t value = 0);
+    void endGesture(uint32_t param_id);
+};
@@ -0,0 +1,123 @@
+#include "latency_probe.h"
+#include <algorithm>
+#include <cmath>
+
+static const uint32_t PROBE_VALID_BIT = 0x80000000u;
+
+LatencyProbe::LatencyProbe()
+    : enabled_(false)
+    , interval_ms_(500)
+    , next_probe_ns_(0)
+    , pending_probe_(0)
+    , pending_sent_ns_(0)
+    , lookahead_us_(0)
+    , unreported_lost_probes_(0) {
+}
+
+void LatencyProbe::setDevice(const std::string& device_name) {
+    std::lock_guard<std::mutex> lock(stats_mutex_);
+    foldLostProbes(histories_[device_name_]);
+    device_name_ = device_name;
+    pending_probe_.store(0, std::memory_order_relaxed);
+}
+
+bool LatencyProbe::isProbeDue(uint64_t now_ns) {
+    if (!isEnabled() || now_ns < next_probe_ns_) {
+        return false;
+    }
+    
+    // An unanswered probe past its timeout counts as lost and frees the slot
+    uint32_t pending = pending_probe_.load(std::memory_order_acquire);
+    if (pending != 0) {
+        uint64_t sent_ns = pending_sent_ns_.load(std::memory_order_relaxed);
+        if (now_ns - sent_ns < PROBE_TIMEOUT_NS) {
+            return false;
+        }
+        if (pending_probe_.compare_exchange_strong(pending, 0, std::memory_order_acq_rel)) {
+            unreported_lost_probes_.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+    
+    return true;
+}
+
+void LatencyProbe::onProbeSent(uint16_t nrpn_param, uint16_t value, uint64_t now_ns) {
+    next_probe_ns_ = now_ns + interval_ms_ * 1000000ULL;
+    pending_sent_ns_.store(now_ns, std::memory_order_relaxed);
+    pending_probe_.store(PROBE_VALID_BIT | (static_cast<uint32_t>(nrpn_param & 0x3FFF) << 14) | (value & 0x3FFF),
+                         std::memory_order_release);
+}
+
+bool LatencyProbe::onNRPNReceived(uint16_t nrpn_param, uint16_t value, uint64_t now_ns) {
+    uint32_t expected = PROBE_VALID_BIT | (static_cast<uint32_t>(nrpn_param & 0x3FFF) << 14) | (value & 0x3FFF);
+    if (pending_probe_.load(std::memory_order_acquire) != expected) {
+        return false;
+    }
+    
+    uint64_t sent_ns = pending_sent_ns_.load(std::memory_order_relaxed);
+    if (!pending_probe_.compare_exchange_strong(expected, 0, std::memory_order_acq_rel)) {
+        return false;
+    }
+    
+    addSample(static_cast<double>(now_ns - sent_ns) / 1000000.0);
+    return true;
+}
+
+void LatencyProbe::addSample(double rtt_ms) {
+    std::lock_guard<std::mutex> lock(stats_mutex_);
+    DeviceHistory& history = histories_[device_name_];
+    foldLostProbes(history);
+    
+    if (history.rtt_ms.size() < WINDOW_SIZE) {
+        history.rtt_ms.push_back(rtt_ms);
+    } else {
+        history.rtt_ms[history.next_index] = rtt_ms;
+    }
+    history.next_index = (history.next_index + 1) % WINDOW_SIZE;
+    
+    // Interarrival jitter as in RFC 3550: smoothed mean deviation between consecutive samples
+    if (history.last_rtt_ms >= 0.0) {
+        history.jitter_ms += (std::fabs(rtt_ms - history.last_rtt_ms) - history.jitter_ms) / 16.0;
+    }
+    history.last_rtt_ms = rtt_ms;
+    
+    updateStats(history);
+    
+    double lookahead_ms = history.stats.median_ms / 2.0 + 2.0 * history.stats.jitter_ms;
+    lookahead_us_.store(static_cast<uint32_t>(lookahead_ms * 1000.0), std::memory_order_relaxed);
+}
+
+void LatencyProbe::foldLostProbes(DeviceHistory& history) {
+    history.lost_probes += unreported_lost_probes_.exchange(0, std::memory_order_relaxed);
+    history.stats.lost_probes = history.lost_probes;
+}
+
+void LatencyProbe::updateStats(DeviceHistory& history) {
+    std::vector<double> sorted = history.rtt_ms;
+    std::sort(sorted.begin(), sorted.end());
+    
+    LatencyStats& stats = history.stats;
+    stats.sample_count = static_cast<uint32_t>(sorted.size());
+    stats.lost_probes = history.lost_probes;
+    stats.min_ms = sorted.front();
+    stats.median_ms = sorted[sorted.size() / 2];
+    stats.p99_ms = sorted[std::min(sorted.size() - 1, (sorted.size() * 99) / 100)];
+    stats.jitter_ms = history.jitter_ms;
+}
+
+LatencyStats LatencyProbe::getStats() const {
+    std::lock_guard<std::mutex> lock(stats_mutex_);
+    auto it = histories_.find(device_name_);
+    LatencyStats stats = (it != histories_.end()) ? it->second.stats : LatencyStats{};
+    stats.lost_probes += unreported_lost_probes_.load(std::memory_order_relaxed);
+    return stats;
+}
+
+std::map<std::string, LatencyStats> LatencyProbe::getAllStats() const {
+    std::lock_guard<std::mutex> lock(stats_mutex_);
+    std::map<std::string, LatencyStats> all_stats;
+    for (const auto& entry : histories_) {
+        all_stats[entry.first] = entry.second.stats;
+    }
+    return all_stats;
+}
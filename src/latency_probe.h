@@ -0,0 +1,80 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Rolling round-trip latency statistics for one device
+struct LatencyStats {
+    uint32_t sample_count;
+    uint32_t lost_probes;
+    double min_ms;
+    double median_ms;
+    double p99_ms;
+    double jitter_ms;
+};
+
+// Round-trip latency probe. The audio thread periodically re-writes a parameter
+// the hardware already holds, and the receive path matches the synth's echo of
+// that NRPN to time the round trip. Sending only touches atomics; statistics are
+// kept per device under a mutex that only the receive and main threads take.
+class LatencyProbe {
+public:
+    LatencyProbe();
+    
+    void setEnabled(bool enabled) { enabled_.store(enabled, std::memory_order_relaxed); }
+    bool isEnabled() const { return enabled_.load(std::memory_order_relaxed); }
+    void setIntervalMs(uint64_t interval_ms) { interval_ms_ = interval_ms; }
+    
+    // Main thread - statistics are collected per device name
+    void setDevice(const std::string& device_name);
+    
+    // Audio thread
+    bool isProbeDue(uint64_t now_ns);
+    void onProbeSent(uint16_t nrpn_param, uint16_t value, uint64_t now_ns);
+    
+    // Receive thread - returns true when the NRPN was the echo of a probe
+    bool onNRPNReceived(uint16_t nrpn_param, uint16_t value, uint64_t now_ns);
+    
+    // Diagnostics
+    LatencyStats getStats() const;
+    std::map<std::string, LatencyStats> getAllStats() const;
+    
+    // One-way latency estimate plus jitter margin, for scheduling output ahead of time
+    double getRecommendedLookaheadMs() const {
+        return lookahead_us_.load(std::memory_order_relaxed) / 1000.0;
+    }
+    
+private:
+    static const size_t WINDOW_SIZE = 256;
+    static const uint64_t PROBE_TIMEOUT_NS = 1000000000ULL;
+    
+    struct DeviceHistory {
+        std::vector<double> rtt_ms;  // ring buffer of the last WINDOW_SIZE samples
+        size_t next_index = 0;
+        uint32_t lost_probes = 0;
+        double last_rtt_ms = -1.0;
+        double jitter_ms = 0.0;
+        LatencyStats stats = {};
+    };
+    
+    std::atomic<bool> enabled_;
+    uint64_t interval_ms_;
+    uint64_t next_probe_ns_;
+    
+    // In-flight probe: NRPN parameter (high 16 bits) and value (low 16 bits), 0 when idle
+    std::atomic<uint32_t> pending_probe_;
+    std::atomic<uint64_t> pending_sent_ns_;
+    std::atomic<uint32_t> lookahead_us_;
+    std::atomic<uint32_t> unreported_lost_probes_;  // counted on the audio thread, folded in under the mutex
+    
+    mutable std::mutex stats_mutex_;
+    std::string device_name_;
+    std::map<std::string, DeviceHistory> histories_;
+    
+    void addSample(double rtt_ms);
+    void foldLostProbes(DeviceHistory& history);
+    static void updateStats(DeviceHistory& history);
+};
@@ -0,0 +1,163 @@
+#include "main_thread_queue.h"
+#include <cstring>
+
+MainThreadQueue::MainThreadQueue(size_t parameter_count, size_t payload_capacity)
+    : callback_requested_(false)
+    , pending_types_(0)
+    , parameter_count_(parameter_count)
+    , changed_parameters_(new std::atomic<uint64_t>[(parameter_count + 63) / 64])
+    , changed_words_((parameter_count + 63) / 64)
+    , cells_(new Cell[RING_SIZE])
+    , enqueue_position_(0)
+    , dequeue_position_(0)
+    , payload_capacity_(payload_capacity)
+    , payload_slots_(new PayloadSlot[PAYLOAD_SLOTS])
+{
+    for (size_t i = 0; i < changed_words_; ++i) {
+        changed_parameters_[i].store(0, std::memory_order_relaxed);
+    }
+    for (size_t i = 0; i < RING_SIZE; ++i) {
+        cells_[i].sequence.store(i, std::memory_order_relaxed);
+    }
+    for (size_t i = 0; i < PAYLOAD_SLOTS; ++i) {
+        payload_slots_[i].in_use.store(false, std::memory_order_relaxed);
+        payload_slots_[i].data.reset(new uint8_t[payload_capacity]);
+    }
+}
+
+void MainThreadQueue::requestCallback() {
+    // Sequentially consistent with the clear in drain(): either the consumer sees
+    // the work just published, or this producer sees the flag cleared and asks again
+    if (!callback_requested_.exchange(true)) {
+        if (request_callback_) {
+            request_callback_();
+        }
+    }
+}
+
+bool MainThreadQueue::post(MainThreadTaskType type) {
+    uint32_t bit = 1u << type;
+    if (pending_types_.fetch_or(bit) & bit) {
+        return false;
+    }
+    requestCallback();
+    return true;
+}
+
+bool MainThreadQueue::markParameterChanged(uint32_t id) {
+    if (id >= parameter_count_) {
+        return false;
+    }
+    
+    uint64_t bit = uint64_t(1) << (id % 64);
+    if (changed_parameters_[id / 64].fetch_or(bit) & bit) {
+        return false;
+    }
+    
+    // The parameter's bit is set before the task, so the handler always finds it
+    uint32_t type_bit = 1u << MAIN_TASK_PARAMS_CHANGED;
+    if (!(pending_types_.fetch_or(type_bit) & type_bit)) {
+        requestCallback();
+    }
+    return true;
+}
+
+bool MainThreadQueue::postPayload(MainThreadTaskType type, const uint8_t* data, size_t length) {
+    if (length > payload_capacity_) {
+        return false;
+    }
+    
+    for (uint32_t slot = 0; slot < PAYLOAD_SLOTS; ++slot) {
+        PayloadSlot& payload = payload_slots_[slot];
+        if (payload.in_use.load(std::memory_order_relaxed) || payload.in_use.exchange(true, std::memory_order_acquire)) {
+            continue;
+        }
+        
+        std::memcpy(payload.data.get(), data, length);
+        if (!pushCell(type, slot, length)) {
+            payload.in_use.store(false, std::memory_order_release);
+            return false;
+        }
+        requestCallback();
+        return true;
+    }
+    return false;
+}
+
+bool MainThreadQueue::pushCell(MainThreadTaskType type, uint32_t slot, size_t length) {
+    // Bounded MPMC ring (per-cell sequence numbers), used here with one consumer
+    size_t position = enqueue_position_.load(std::memory_order_relaxed);
+    Cell* cell = nullptr;
+    for (;;) {
+        cell = &cells_[position & (RING_SIZE - 1)];
+        size_t sequence = cell->sequence.load(std::memory_order_acquire);
+        intptr_t difference = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(position);
+        if (difference == 0) {
+            if (enqueue_position_.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                break;
+            }
+        } else if (difference < 0) {
+            return false;
+        } else {
+            position = enqueue_position_.load(std::memory_order_relaxed);
+        }
+    }
+    
+    cell->type = type;
+    cell->slot = slot;
+    cell->length = length;
+    cell->sequence.store(position + 1, std::memory_order_release);
+    return true;
+}
+
+bool MainThreadQueue::popCell(MainThreadTaskType& type, uint32_t& slot, size_t& length) {
+    Cell& cell = cells_[dequeue_position_ & (RING_SIZE - 1)];
+    size_t sequence = cell.sequence.load(std::memory_order_acquire);
+    if (sequence != dequeue_position_ + 1) {
+        return false;
+    }
+    
+    type = cell.type;
+    slot = cell.slot;
+    length = cell.length;
+    cell.sequence.store(dequeue_position_ + RING_SIZE, std::memory_order_release);
+    ++dequeue_position_;
+    return true;
+}
+
+size_t MainThreadQueue::drain(const std::function<void(const MainThreadTask&)>& handler) {
+    // Cleared before looking at the work: anything posted from here on asks again
+    callback_requested_.store(false);
+    size_t run = 0;
+    
+    MainThreadTaskType type;
+    uint32_t slot;
+    size_t length;
+    while (popCell(type, slot, length)) {
+        PayloadSlot& payload = payload_slots_[slot];
+        handler(MainThreadTask{type, payload.data.get(), length});
+        payload.in_use.store(false, std::memory_order_release);
+        ++run;
+    }
+    
+    for (uint32_t t = 0; t < MAIN_TASK_TYPE_COUNT; ++t) {
+        uint32_t bit = 1u << t;
+        if (pending_types_.fetch_and(~bit) & bit) {
+            handler(MainThreadTask{static_cast<MainThreadTaskType>(t), nullptr, 0});
+            ++run;
+        }
+    }
+    return run;
+}
+
+void MainThreadQueue::takeChangedParameters(std::vector<uint32_t>& ids) {
+    ids.clear();
+    for (size_t word = 0; word < changed_words_; ++word) {
+        uint64_t bits = changed_parameters_[word].exchange(0, std::memory_order_acq_rel);
+        for (uint32_t bit = 0; bits != 0; ++bit, bits >>= 1) {
+            if (bits & 1) {
+                ids.push_back(static_cast<uint32_t>(word * 64 + bit));
+            }
+        }
+    }
+}
@@ -0,0 +1,103 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+
+// Work handed to the main thread by the audio thread, the MIDI receive thread and
+// background threads
+enum MainThreadTaskType : uint8_t {
+    MAIN_TASK_FINISH_MIDI_INIT = 0,  // device enumeration finished
+    MAIN_TASK_SELECT_DEVICE,         // device selection parameter changed
+    MAIN_TASK_DECODE_PROGRAM_DUMP,   // payload: a SysEx message that may be a program dump
+    MAIN_TASK_APPLY_PROGRAM,         // the hardware changed program
+    MAIN_TASK_PARAMS_CHANGED,        // parameters changed outside the host (see markParameterChanged)
+    MAIN_TASK_UPDATE_PREFETCH,       // pick the next program dump to fetch
+    MAIN_TASK_SEQUENCER_WARNING,     // the step sequencer found steps it can't deliver in time
+    MAIN_TASK_LATENCY_CHANGED,       // the output lookahead estimate may have moved
+    MAIN_TASK_DATA_ENTRY_TIMEOUT,    // a data entry MSB from the hardware waits outside process()
+    
+    MAIN_TASK_TYPE_COUNT
+};
+
+struct MainThreadTask {
+    MainThreadTaskType type;
+    const uint8_t* data;  // payload tasks only, valid while the handler runs
+    size_t length;
+};
+
+// Lock-free multi-producer, single-consumer queue behind on_main_thread().
+//
+// Payload tasks go through a bounded ring in FIFO order. Every other task type
+// is coalesced: posting it while one is already pending does nothing, and
+// "parameter changed" notifications are per-parameter bits, so a knob sweep of
+// hundreds of messages is one task. Producers ask the host for a callback only
+// when the queue goes from idle to pending, so at most one request is
+// outstanding however much work piles up. Nothing blocks or allocates on the
+// producer side.
+class MainThreadQueue {
+public:
+    MainThreadQueue(size_t parameter_count, size_t payload_capacity);
+    
+    // Asks the host for a main-thread callback; called at most once per batch
+    void setCallbackRequester(std::function<void()> request) { request_callback_ = request; }
+    
+    // Any thread. Coalesced types only; returns false when the type was already pending.
+    bool post(MainThreadTaskType type);
+    
+    // Any thread. Copies the payload; returns false and drops it when every
+    // payload slot is in use or it is larger than payload_capacity.
+    bool postPayload(MainThreadTaskType type, const uint8_t* data, size_t length);
+    
+    // Any thread. Returns false when the parameter was already marked.
+    bool markParameterChanged(uint32_t id);
+    
+    // Main thread. Runs every pending task: payload tasks first in posting order,
+    // then coalesced types in enum order. Tasks posted by a handler for a type
+    // not yet reached in this pass run in the same pass; the rest get a new
+    // callback request. Returns the number of tasks run.
+    size_t drain(const std::function<void(const MainThreadTask&)>& handler);
+    
+    // Main thread, from a MAIN_TASK_PARAMS_CHANGED handler: the marked parameters,
+    // clearing their marks
+    void takeChangedParameters(std::vector<uint32_t>& ids);
+    
+    bool hasPending() const { return callback_requested_.load(std::memory_order_acquire); }
+    
+    static const size_t PAYLOAD_SLOTS = 4;
+    static const size_t RING_SIZE = 16;  // power of two, > PAYLOAD_SLOTS
+
+private:
+    struct Cell {
+        std::atomic<size_t> sequence;
+        MainThreadTaskType type;
+        uint32_t slot;
+        size_t length;
+    };
+    
+    struct PayloadSlot {
+        std::atomic<bool> in_use;
+        std::unique_ptr<uint8_t[]> data;
+    };
+    
+    std::function<void()> request_callback_;
+    std::atomic<bool> callback_requested_;
+    std::atomic<uint32_t> pending_types_;
+    
+    size_t parameter_count_;
+    std::unique_ptr<std::atomic<uint64_t>[]> changed_parameters_;
+    size_t changed_words_;
+    
+    std::unique_ptr<Cell[]> cells_;
+    std::atomic<size_t> enqueue_position_;
+    size_t dequeue_position_;
+    
+    size_t payload_capacity_;
+    std::unique_ptr<PayloadSlot[]> payload_slots_;
+    
+    void requestCallback();
+    bool pushCell(MainThreadTaskType type, uint32_t slot, size_t length);
+    bool popCell(MainThreadTaskType& type, uint32_t& slot, size_t& length);
+};
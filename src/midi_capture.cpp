@@ -0,0 +1,219 @@
+#include "midi_capture.h"
+#include <chrono>
+#include <cstring>
+
+static const char CAPTURE_MAGIC[8] = {'O', 'B', 'X', '8', 'C', 'A', 'P', '\0'};
+
+static_assert(sizeof(CaptureSession) <= MidiCapture::MAX_PAYLOAD, "session record too large");
+static_assert(sizeof(CaptureBlock) <= MidiCapture::MAX_PAYLOAD, "block record too large");
+static_assert(sizeof(CaptureParamEvent) <= MidiCapture::MAX_PAYLOAD, "param record too large");
+static_assert(sizeof(CaptureHostMidi) <= MidiCapture::MAX_PAYLOAD, "MIDI record too large");
+
+const char* const MidiCapture::ENV_VAR = "SPOBX8_CAPTURE";
+
+MidiCapture::MidiCapture()
+    : enqueue_pos_(0)
+    , dequeue_pos_(0)
+    , dropped_(0)
+    , active_(false)
+    , running_(false)
+    , file_(nullptr)
+    , reported_dropped_(0)
+{
+}
+
+MidiCapture::~MidiCapture() {
+    stop();
+}
+
+bool MidiCapture::start(const std::string& path) {
+    if (running_.load(std::memory_order_acquire)) {
+        return false;
+    }
+    
+    file_ = std::fopen(path.c_str(), "wb");
+    if (!file_) {
+        return false;
+    }
+    
+    uint32_t version = FILE_VERSION;
+    std::fwrite(CAPTURE_MAGIC, 1, sizeof(CAPTURE_MAGIC), file_);
+    std::fwrite(&version, sizeof(version), 1, file_);
+    
+    // The ring (half a megabyte) waits for the first capture, so instances that
+    // never record don't pay for it; it stays until destruction because a
+    // producer racing stop() may still be writing to it
+    if (!ring_) {
+        ring_.reset(new Slot[RING_SIZE]);
+        for (size_t i = 0; i < RING_SIZE; ++i) {
+            ring_[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+    
+    // Records left in the ring by a producer racing the previous stop() belong to that capture
+    drain(false);
+    reported_dropped_ = dropped_.load(std::memory_order_relaxed);
+    
+    running_.store(true, std::memory_order_release);
+    writer_thread_ = std::thread([this]() { writerLoop(); });
+    active_.store(true, std::memory_order_release);
+    return true;
+}
+
+void MidiCapture::stop() {
+    active_.store(false, std::memory_order_release);
+    if (!running_.exchange(false, std::memory_order_acq_rel)) {
+        return;
+    }
+    
+    if (writer_thread_.joinable()) {
+        writer_thread_.join();
+    }
+    
+    std::fclose(file_);
+    file_ = nullptr;
+}
+
+void MidiCapture::record(CaptureRecordType type, uint64_t time_ns, const void* payload, size_t length) {
+    // Acquire: the ring is allocated by the start() that set active_
+    if (!active_.load(std::memory_order_acquire) || length > MAX_PAYLOAD) {
+        return;
+    }
+    
+    // Bounded multi-producer ring: each slot's sequence says whether it is free
+    // for the producer at this position or holds data for the consumer
+    uint64_t pos = enqueue_pos_.load(std::memory_order_relaxed);
+    Slot* slot;
+    for (;;) {
+        slot = &ring_[pos & (RING_SIZE - 1)];
+        uint64_t sequence = slot->sequence.load(std::memory_order_acquire);
+        int64_t diff = static_cast<int64_t>(sequence) - static_cast<int64_t>(pos);
+        if (diff == 0) {
+            if (enqueue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                break;
+            }
+        } else if (diff < 0) {
+            dropped_.fetch_add(1, std::memory_order_relaxed);
+            return;
+        } else {
+            pos = enqueue_pos_.load(std::memory_order_relaxed);
+        }
+    }
+    
+    slot->time_ns = time_ns;
+    slot->type = type;
+    slot->length = static_cast<uint8_t>(length);
+    if (length > 0) {
+        std::memcpy(slot->payload, payload, length);
+    }
+    slot->sequence.store(pos + 1, std::memory_order_release);
+}
+
+void MidiCapture::recordDeviceMidi(CaptureRecordType type, uint64_t time_ns, const uint8_t* data, size_t length) {
+    while (length > 0) {
+        size_t chunk = length < MAX_PAYLOAD ? length : MAX_PAYLOAD;
+        record(type, time_ns, data, chunk);
+        data += chunk;
+        length -= chunk;
+    }
+}
+
+void MidiCapture::writerLoop() {
+    while (running_.load(std::memory_order_acquire)) {
+        if (drain(true) == 0) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        }
+    }
+    
+    // Producers stopped before running_ was cleared; pick up what they left
+    drain(true);
+    std::fflush(file_);
+}
+
+size_t MidiCapture::drain(bool write) {
+    size_t count = 0;
+    for (;;) {
+        Slot& slot = ring_[dequeue_pos_ & (RING_SIZE - 1)];
+        if (slot.sequence.load(std::memory_order_acquire) != dequeue_pos_ + 1) {
+            break;
+        }
+        
+        if (write) {
+            writeRecord(slot.time_ns, slot.type, slot.payload, slot.length);
+        }
+        slot.sequence.store(dequeue_pos_ + RING_SIZE, std::memory_order_release);
+        ++dequeue_pos_;
+        ++count;
+    }
+    
+    uint64_t dropped = dropped_.load(std::memory_order_relaxed);
+    if (write && dropped != reported_dropped_) {
+        uint64_t lost = dropped - reported_dropped_;
+        reported_dropped_ = dropped;
+        uint64_t now = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+        writeRecord(now, CAPTURE_DROPPED, &lost, sizeof(lost));
+    }
+    
+    return count;
+}
+
+void MidiCapture::writeRecord(uint64_t time_ns, uint8_t type, const void* payload, uint8_t length) {
+    std::fwrite(&time_ns, sizeof(time_ns), 1, file_);
+    std::fwrite(&type, 1, 1, file_);
+    std::fwrite(&length, 1, 1, file_);
+    if (length > 0) {
+        std::fwrite(payload, 1, length, file_);
+    }
+}
+
+CaptureReader::CaptureReader() : file_(nullptr) {
+}
+
+CaptureReader::~CaptureReader() {
+    close();
+}
+
+bool CaptureReader::open(const std::string& path) {
+    close();
+    file_ = std::fopen(path.c_str(), "rb");
+    if (!file_) {
+        return false;
+    }
+    
+    char magic[sizeof(CAPTURE_MAGIC)];
+    uint32_t version = 0;
+    if (std::fread(magic, 1, sizeof(magic), file_) != sizeof(magic) ||
+        std::memcmp(magic, CAPTURE_MAGIC, sizeof(magic)) != 0 ||
+        std::fread(&version, sizeof(version), 1, file_) != 1 ||
+        version != MidiCapture::FILE_VERSION) {
+        close();
+        return false;
+    }
+    return true;
+}
+
+bool CaptureReader::next(CaptureRecord& record) {
+    if (!file_) {
+        return false;
+    }
+    
+    uint8_t type = 0;
+    uint8_t length = 0;
+    if (std::fread(&record.time_ns, sizeof(record.time_ns), 1, file_) != 1 ||
+        std::fread(&type, 1, 1, file_) != 1 ||
+        std::fread(&length, 1, 1, file_) != 1) {
+        return false;
+    }
+    
+    record.type = static_cast<CaptureRecordType>(type);
+    record.payload.resize(length);
+    return length == 0 || std::fread(record.payload.data(), 1, length, file_) == length;
+}
+
+void CaptureReader::close() {
+    if (file_) {
+        std::fclose(file_);
+        file_ = nullptr;
+    }
+}
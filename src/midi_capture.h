@@ -0,0 +1,154 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Opt-in binary capture of everything that crosses the plugin boundary: MIDI to
+// and from the device, MIDI to and from the host, and the host's parameter events
+// with the block they arrived in. Producers on any thread push fixed-size records
+// into a lock-free ring; a background thread appends them to the file. Enable with
+// the SPOBX8_CAPTURE environment variable (a file path) or OBX8Plugin::startCapture().
+//
+// File layout, native byte order (little-endian on every supported platform):
+//   header: "OBX8CAP" + '\0', uint32 version
+//   record: uint64 time_ns, uint8 type, uint8 length, payload[length]
+// time_ns is the plugin's steady clock, so a replay can drive the plugin's timers
+// with the recorded values. Device data longer than one record is split into
+// consecutive records of the same type.
+
+enum CaptureRecordType : uint8_t {
+    CAPTURE_SESSION = 1,     // CaptureSession, written at activate()
+    CAPTURE_BLOCK,           // CaptureBlock, one per process() call
+    CAPTURE_FLUSH,           // CaptureFlush, params_flush() outside process()
+    CAPTURE_PARAM_VALUE,     // CaptureParamEvent
+    CAPTURE_PARAM_MOD,       // CaptureParamEvent
+    CAPTURE_HOST_MIDI_IN,    // CaptureHostMidi from the host's in_events
+    CAPTURE_HOST_MIDI_OUT,   // CaptureHostMidi pushed to the host's out_events
+    CAPTURE_DEVICE_MIDI_IN,  // raw bytes received from the device
+    CAPTURE_DEVICE_MIDI_OUT, // raw bytes sent to the device
+    CAPTURE_DROPPED,         // uint64 count of records lost to a full ring
+    CAPTURE_MAIN_THREAD,     // on_main_thread() callback, no payload
+    CAPTURE_RENDER_MODE      // CaptureRenderMode, at activate() and from render_set()
+};
+
+struct CaptureSession {
+    double sample_rate;
+    uint32_t min_frames;
+    uint32_t max_frames;
+};
+
+// The host's render mode: a clap_plugin_render_mode, or -1 while the host has
+// never set one (the plugin then guesses freewheeling from the clock)
+struct CaptureRenderMode {
+    int32_t mode;
+};
+
+// A block or flush record comes right after the event_count PARAM_VALUE,
+// PARAM_MOD and HOST_MIDI_IN records of its input event list
+struct CaptureBlock {
+    uint32_t frames;
+    uint32_t event_count;
+    int64_t steady_time;
+};
+
+struct CaptureFlush {
+    uint32_t event_count;
+};
+
+struct CaptureParamEvent {
+    uint32_t sample_time;
+    uint32_t param_id;
+    double value;
+};
+
+struct CaptureHostMidi {
+    uint32_t sample_time;
+    uint8_t data[3];
+    uint8_t reserved;
+};
+
+class MidiCapture {
+public:
+    static const char* const ENV_VAR;
+    static const uint32_t FILE_VERSION = 1;
+    static const size_t MAX_PAYLOAD = 46;
+    
+    MidiCapture();
+    ~MidiCapture();
+    
+    // Main thread
+    bool start(const std::string& path);
+    void stop();
+    
+    // Any thread, lock-free; records are dropped (and counted) when the ring is full
+    bool isActive() const { return active_.load(std::memory_order_relaxed); }
+    void record(CaptureRecordType type, uint64_t time_ns, const void* payload, size_t length);
+    void recordDeviceMidi(CaptureRecordType type, uint64_t time_ns, const uint8_t* data, size_t length);
+    
+    uint64_t getDroppedCount() const { return dropped_.load(std::memory_order_relaxed); }
+
+private:
+    struct alignas(64) Slot {
+        std::atomic<uint64_t> sequence;
+        uint64_t time_ns;
+        uint8_t type;
+        uint8_t length;
+        uint8_t payload[MAX_PAYLOAD];
+    };
+    
+    static const size_t RING_SIZE = 8192; // power of two
+    
+    std::unique_ptr<Slot[]> ring_;   // from the first start()
+    alignas(64) std::atomic<uint64_t> enqueue_pos_;
+    alignas(64) uint64_t dequeue_pos_;
+    alignas(64) std::atomic<uint64_t> dropped_;
+    std::atomic<bool> active_;
+    std::atomic<bool> running_;
+    
+    std::thread writer_thread_;
+    FILE* file_;
+    uint64_t reported_dropped_;
+    
+    void writerLoop();
+    size_t drain(bool write);
+    void writeRecord(uint64_t time_ns, uint8_t type, const void* payload, uint8_t length);
+};
+
+// Sequential reader for capture files, used by the replay tool
+struct CaptureRecord {
+    uint64_t time_ns;
+    CaptureRecordType type;
+    std::vector<uint8_t> payload;
+};
+
+class CaptureReader {
+public:
+    CaptureReader();
+    ~CaptureReader();
+    
+    bool open(const std::string& path);
+    bool next(CaptureRecord& record);
+    void close();
+    
+    // Copies a fixed-size payload out; false if the record is too short
+    template <typename T>
+    static bool decode(const CaptureRecord& record, T& out);
+
+private:
+    FILE* file_;
+};
+
+template <typename T>
+bool CaptureReader::decode(const CaptureRecord& record, T& out) {
+    if (record.payload.size() < sizeof(T)) {
+        return false;
+    }
+    std::memcpy(&out, record.payload.data(), sizeof(T));
+    return true;
+}
@@ -0,0 +1,90 @@
+#include "midi_clock.h"
+#include <algorithm>
+#include <cmath>
+
+MidiClockGenerator::MidiClockGenerator()
+    : running_(false)
+    , next_tick_(0)
+    , expected_beats_(0.0)
+{
+}
+
+void MidiClockGenerator::reset() {
+    running_ = false;
+    next_tick_ = 0;
+    expected_beats_ = 0.0;
+}
+
+void MidiClockGenerator::append(TimedMidiMessage* out, size_t& count, size_t capacity,
+                                uint32_t time, uint8_t status, uint8_t data1, uint8_t data2) {
+    if (count < capacity) {
+        out[count++] = {time, {status, data1, data2, time}};
+    }
+}
+
+size_t MidiClockGenerator::stop(TimedMidiMessage* out, size_t count, size_t capacity) {
+    if (running_) {
+        append(out, count, capacity, 0, MIDI_STOP);
+        running_ = false;
+    }
+    return count;
+}
+
+size_t MidiClockGenerator::process(const clap_event_transport_t* transport, bool enabled, uint32_t frames,
+                                   double sample_rate, TimedMidiMessage* out, size_t capacity,
+                                   uint32_t start_time) {
+    const uint32_t required = CLAP_TRANSPORT_HAS_TEMPO | CLAP_TRANSPORT_HAS_BEATS_TIMELINE;
+    if (!enabled || !transport || (transport->flags & required) != required ||
+        !(transport->flags & CLAP_TRANSPORT_IS_PLAYING) || transport->tempo <= 0.0 || sample_rate <= 0.0) {
+        return stop(out, 0, capacity);
+    }
+    
+    double beats = static_cast<double>(transport->song_pos_beats) / CLAP_BEATTIME_FACTOR;
+    double beats_per_sample = transport->tempo / 60.0 / sample_rate;
+    double ticks_per_sample = beats_per_sample * PPQN;
+    size_t count = 0;
+    
+    // A jump of more than half a tick is a relocation, not drift
+    if (running_ && std::abs(beats - expected_beats_) * PPQN > 0.5) {
+        count = stop(out, count, capacity);
+    }
+    
+    if (!running_) {
+        // Pre-roll: start the clock at the sample where the timeline reaches beat 0
+        if (beats < 0.0) {
+            start_time = std::max(start_time, static_cast<uint32_t>(std::min<double>(-beats / beats_per_sample, frames)));
+        }
+        if (start_time >= frames) {
+            return count;
+        }
+        
+        // Resume on the next sixteenth, which is what Song Position Pointer can address
+        double start_beats = beats + start_time * beats_per_sample;
+        int64_t sixteenth = std::max<int64_t>(0, static_cast<int64_t>(std::ceil(start_beats * 4.0 - 1e-9)));
+        sixteenth = std::min<int64_t>(sixteenth, MAX_SONG_POSITION);
+        if (sixteenth == 0) {
+            append(out, count, capacity, start_time, MIDI_START);
+        } else {
+            append(out, count, capacity, start_time, MIDI_SONG_POSITION,
+                   static_cast<uint8_t>(sixteenth & 0x7F), static_cast<uint8_t>((sixteenth >> 7) & 0x7F));
+            append(out, count, capacity, start_time, MIDI_CONTINUE);
+        }
+        next_tick_ = sixteenth * TICKS_PER_SIXTEENTH;
+        running_ = true;
+    }
+    
+    // Ticks fall where the timeline crosses them; one that is already due (the
+    // host's position moved within the drift tolerance) goes at the block start
+    double block_ticks = beats * PPQN;
+    for (;;) {
+        double offset = (static_cast<double>(next_tick_) - block_ticks) / ticks_per_sample;
+        if (offset >= frames) {
+            break;
+        }
+        append(out, count, capacity, static_cast<uint32_t>(std::max(0.0, offset)), MIDI_CLOCK);
+        ++next_tick_;
+    }
+    
+    expected_beats_ = beats + frames * beats_per_sample;
+    return count;
+}
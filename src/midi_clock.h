@@ -0,0 +1,53 @@
+#pragma once
+#include "midi_handler.h"
+#include <clap/clap.h>
+#include <cstddef>
+#include <cstdint>
+
+// A MIDI message with its sample offset in the block
+struct TimedMidiMessage {
+    uint32_t time;
+    MidiMessage message;
+};
+
+// MIDI clock (24 PPQN) and transport messages derived from the host timeline.
+// Each block's ticks are placed at the sample where the beat position crosses
+// them, so the output carries no block quantization; Start, or Song Position
+// Pointer plus Continue, is sent when the host starts playing, Stop when it stops,
+// and a relocation while playing (a loop, a jump) is Stop, SPP, Continue.
+// Clock only runs while the host plays. Audio thread only.
+class MidiClockGenerator {
+public:
+    MidiClockGenerator();
+    
+    static const int PPQN = 24;
+    static const int TICKS_PER_SIXTEENTH = PPQN / 4;
+    static const uint32_t MAX_SONG_POSITION = 0x3FFF;
+    
+    static const uint8_t MIDI_CLOCK = 0xF8;
+    static const uint8_t MIDI_START = 0xFA;
+    static const uint8_t MIDI_CONTINUE = 0xFB;
+    static const uint8_t MIDI_STOP = 0xFC;
+    static const uint8_t MIDI_SONG_POSITION = 0xF2;
+    
+    // Appends this block's messages to out, in time order, and returns how many.
+    // A null transport or one without tempo and beat position stops the clock,
+    // as does enabled == false. A clock that isn't running starts no earlier than
+    // start_time (the sample where it was enabled).
+    size_t process(const clap_event_transport_t* transport, bool enabled, uint32_t frames,
+                   double sample_rate, TimedMidiMessage* out, size_t capacity, uint32_t start_time = 0);
+    
+    // Forget the transport state without sending anything (e.g. on activate)
+    void reset();
+    
+    bool isRunning() const { return running_; }
+
+private:
+    bool running_;
+    int64_t next_tick_;          // index of the next tick to send, from beat 0
+    double expected_beats_;      // where the next block should start if nothing jumped
+    
+    size_t stop(TimedMidiMessage* out, size_t count, size_t capacity);
+    static void append(TimedMidiMessage* out, size_t& count, size_t capacity,
+                       uint32_t time, uint8_t status, uint8_t data1 = 0, uint8_t data2 = 0);
+};
@@ -1,10 +1,13 @@
 #include "midi_device_manager.h"
 #include <algorithm>
+#include <chrono>
 #include <iostream>
 #include <fstream>
+#include <thread>
 
 #ifdef __APPLE__
 #include <CoreFoundation/CoreFoundation.h>
+#include <mach/mach_time.h>
 
 static std::string CFStringToStdString(CFStringRef cf_string) {
     if (!cf_string) return "";
@@ -24,8 +27,15 @@ static std::string CFStringToStdString(CFStringRef cf_string) {
 }
 #endif
 
+const char* const MidiDeviceManager::LOOPBACK_DEVICE_NAME = "Loopback";
+const char* const MidiDeviceManager::NULL_DEVICE_NAME = "Null";
+
 MidiDeviceManager::MidiDeviceManager() 
     : is_connected_(false)
+    , is_open_(false)
+    , is_loopback_(false)
+    , is_null_device_(false)
+    , loopback_running_(false)
 #ifdef __APPLE__
     , midi_client_(0)
     , input_port_(0)
@@ -34,16 +44,37 @@ MidiDeviceManager::MidiDeviceManager()
     , selected_output_endpoint_(0)
 #endif
 {
-#ifdef __APPLE__
-    initializeCoreAudio();
+#ifdef __linux__
+    raw_midi_.setReceiveCallback([this](const uint8_t* data, size_t length, uint64_t arrival_ns) {
+        if (receive_callback_) {
+            receive_callback_(data, length, arrival_ns);
+        }
+    });
 #endif
-    refreshDeviceList();
 }
 
 MidiDeviceManager::~MidiDeviceManager() {
+    stopLoopbackDelivery();
 #ifdef __APPLE__
     cleanupCoreAudio();
 #endif
+#ifdef __linux__
+    raw_midi_.close();
+#endif
+}
+
+bool MidiDeviceManager::open() {
+    if (is_open_) {
+        return true;
+    }
+    
+#ifdef __APPLE__
+    initializeCoreAudio();
+#endif
+    refreshDeviceList();
+    
+    is_open_ = true;
+    return true;
 }
 
 #ifdef __APPLE__
@@ -91,7 +122,7 @@ void MidiDeviceManager::midiReadProc(const MIDIPacketList* packet_list, void* re
     
     const MIDIPacket* packet = &packet_list->packet[0];
     for (UInt32 i = 0; i < packet_list->numPackets; ++i) {
-        manager->receive_callback_(packet->data, packet->length);
+        manager->receive_callback_(packet->data, packet->length, 0);
         packet = MIDIPacketNext(packet);
     }
 }
@@ -240,6 +271,17 @@ void MidiDeviceManager::refreshDeviceList() {
         info.is_available = true;
         devices_.push_back(info);
     }
+#elif defined(__linux__)
+    // Raw MIDI devices are duplex byte streams, one entry each
+    for (const RawMidiPort& port : RawMidiTransport::listPorts()) {
+        MidiDeviceInfo info;
+        info.name = port.name;
+        info.id = port.path;
+        info.is_input = true;
+        info.is_output = true;
+        info.is_available = true;
+        devices_.push_back(info);
+    }
 #endif
 }
 
@@ -275,12 +317,31 @@ std::vector<std::string> MidiDeviceManager::getDeviceNames() const {
 }
 
 bool MidiDeviceManager::selectDevice(const std::string& device_name) {
+    // Senders stop seeing a device before it goes away
+    is_connected_.store(false, std::memory_order_release);
+    stopLoopbackDelivery();
+#ifdef __linux__
+    raw_midi_.close();
+#endif
+    is_loopback_.store(false, std::memory_order_relaxed);
+    is_null_device_.store(false, std::memory_order_relaxed);
+    
     if (device_name == "None") {
         selected_device_name_ = "";
-        is_connected_ = false;
         return true;
     }
     
+    if (device_name == LOOPBACK_DEVICE_NAME || device_name == NULL_DEVICE_NAME) {
+        selected_device_name_ = device_name;
+        is_loopback_.store(device_name == LOOPBACK_DEVICE_NAME, std::memory_order_relaxed);
+        is_null_device_.store(device_name == NULL_DEVICE_NAME, std::memory_order_relaxed);
+        if (isLoopback()) {
+            startLoopbackDelivery();
+        }
+        updateConnectionStatus();
+        return isConnected();
+    }
+    
     // Find the device - need to handle friendly names and connect to both input and output
     selected_device_name_ = device_name;
     
@@ -328,17 +389,77 @@ bool MidiDeviceManager::selectDevice(const std::string& device_name) {
             }
         }
     }
+#elif defined(__linux__)
+    std::string path;
+    for (const auto& device : devices_) {
+        std::string lower_name = device.name;
+        std::transform(lower_name.begin(), lower_name.end(), lower_name.begin(), ::tolower);
+        
+        bool is_obx8 = lower_name.find("obx") != std::string::npos ||
+                       lower_name.find("oberheim") != std::string::npos ||
+                       lower_name.find("ob-x8") != std::string::npos;
+        
+        if (device.name == device_name || (is_obx8 && device_name.find("Oberheim OB-X8") != std::string::npos)) {
+            path = device.id;
+            break;
+        }
+    }
+    // Anything else that looks like a path is opened as a byte stream
+    if (path.empty() && device_name.compare(0, 1, "/") == 0) {
+        path = device_name;
+    }
+    if (!path.empty()) {
+        raw_midi_.open(path);
+    }
 #endif
     
     updateConnectionStatus();
-    return is_connected_;
+    return isConnected();
 }
 
-bool MidiDeviceManager::sendMidiData(const uint8_t* data, size_t length) {
-    if (!is_connected_ || length == 0) {
+#ifdef __linux__
+bool MidiDeviceManager::selectFileDescriptors(int input_fd, int output_fd, const std::string& name) {
+    is_connected_.store(false, std::memory_order_release);
+    stopLoopbackDelivery();
+    is_loopback_.store(false, std::memory_order_relaxed);
+    is_null_device_.store(false, std::memory_order_relaxed);
+    selected_device_name_ = name;
+    raw_midi_.openFileDescriptors(input_fd, output_fd);
+    updateConnectionStatus();
+    return isConnected();
+}
+#endif
+
+#ifdef __APPLE__
+// steady_clock on Apple platforms counts CLOCK_UPTIME_RAW, the clock behind
+// mach_absolute_time(), so a steady time converts to CoreMIDI host time directly
+static MIDITimeStamp steadyNsToHostTime(uint64_t steady_ns) {
+    static const mach_timebase_info_data_t timebase = []() {
+        mach_timebase_info_data_t info;
+        mach_timebase_info(&info);
+        return info;
+    }();
+    return static_cast<MIDITimeStamp>(static_cast<__uint128_t>(steady_ns) * timebase.denom / timebase.numer);
+}
+#endif
+
+bool MidiDeviceManager::sendMidiData(const uint8_t* data, size_t length, uint64_t timestamp_ns) {
+    if (!isConnected() || length == 0) {
         return false;
     }
     
+    if (is_loopback_.load(std::memory_order_relaxed)) {
+        return loopback_queue_->push(data, length, timestamp_ns);
+    }
+    
+    if (is_null_device_.load(std::memory_order_relaxed)) {
+        return true;
+    }
+    
+#ifdef __linux__
+    return raw_midi_.send(data, length, timestamp_ns);
+#endif
+    
 #ifdef __APPLE__
     if (!output_port_ || !selected_output_endpoint_) {
         return false;
@@ -348,7 +469,8 @@ bool MidiDeviceManager::sendMidiData(const uint8_t* data, size_t length) {
     MIDIPacketList* packet_list = (MIDIPacketList*)packet_buffer;
     MIDIPacket* packet = MIDIPacketListInit(packet_list);
     
-    packet = MIDIPacketListAdd(packet_list, sizeof(packet_buffer), packet, 0, length, data);
+    MIDITimeStamp timestamp = timestamp_ns != 0 ? steadyNsToHostTime(timestamp_ns) : 0;
+    packet = MIDIPacketListAdd(packet_list, sizeof(packet_buffer), packet, timestamp, length, data);
     if (!packet) {
         return false;
     }
@@ -360,11 +482,69 @@ bool MidiDeviceManager::sendMidiData(const uint8_t* data, size_t length) {
     return false;
 }
 
-void MidiDeviceManager::setMidiReceiveCallback(std::function<void(const uint8_t*, size_t)> callback) {
+void MidiDeviceManager::startLoopbackDelivery() {
+    if (!loopback_queue_) {
+        loopback_queue_.reset(new MidiSendQueue(LOOPBACK_QUEUE_BYTES, LOOPBACK_QUEUE_BATCHES));
+    }
+    loopback_running_.store(true, std::memory_order_release);
+    loopback_thread_ = std::thread([this]() { loopbackDeliveryLoop(); });
+}
+
+void MidiDeviceManager::loopbackDeliveryLoop() {
+    std::vector<uint8_t> bytes;
+    uint64_t due_ns;
+    while (loopback_running_.load(std::memory_order_acquire)) {
+        // Equal due times keep their send order
+        while (loopback_queue_->pop(bytes, due_ns)) {
+            loopback_pending_.emplace(due_ns, std::move(bytes));
+        }
+        
+        uint64_t now_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+        while (!loopback_pending_.empty() && loopback_pending_.begin()->first <= now_ns) {
+            const std::vector<uint8_t>& data = loopback_pending_.begin()->second;
+            if (receive_callback_) {
+                receive_callback_(data.data(), data.size(), now_ns);
+            }
+            loopback_pending_.erase(loopback_pending_.begin());
+        }
+        
+        // Senders never wake this thread, so it looks again at least every poll period
+        uint64_t wake_ns = now_ns + LOOPBACK_POLL_NS;
+        if (!loopback_pending_.empty()) {
+            wake_ns = std::min(wake_ns, loopback_pending_.begin()->first);
+        }
+        std::this_thread::sleep_until(std::chrono::steady_clock::time_point(std::chrono::nanoseconds(wake_ns)));
+    }
+}
+
+void MidiDeviceManager::stopLoopbackDelivery() {
+    loopback_running_.store(false, std::memory_order_release);
+    if (loopback_thread_.joinable()) {
+        loopback_thread_.join();
+    }
+    
+    // Whatever was still on its way is dropped with the device
+    loopback_pending_.clear();
+    if (loopback_queue_) {
+        std::vector<uint8_t> bytes;
+        uint64_t due_ns;
+        while (loopback_queue_->pop(bytes, due_ns)) {
+        }
+    }
+}
+
+void MidiDeviceManager::setMidiReceiveCallback(std::function<void(const uint8_t*, size_t, uint64_t)> callback) {
     receive_callback_ = callback;
 }
 
 void MidiDeviceManager::updateConnectionStatus() {
     // Check if we have output connected (needed for sending data to hardware)
-    is_connected_ = !selected_device_name_.empty() && selected_output_endpoint_ != 0;
+    bool connected = isLoopback() || isNullDevice();
+#ifdef __APPLE__
+    connected = connected || (!selected_device_name_.empty() && selected_output_endpoint_ != 0);
+#elif defined(__linux__)
+    connected = connected || raw_midi_.isOpen();
+#endif
+    is_connected_.store(connected, std::memory_order_release);
 }
\ No newline at end of file
@@ -1,5 +1,11 @@
 #pragma once
+#include "midi_send_queue.h"
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <memory>
 #include <string>
+#include <thread>
 #include <vector>
 #include <functional>
 
@@ -7,6 +13,10 @@
 #include <CoreMIDI/CoreMIDI.h>
 #endif
 
+#ifdef __linux__
+#include "raw_midi_transport.h"
+#endif
+
 struct MidiDeviceInfo {
     std::string name;
     std::string id;
@@ -17,9 +27,21 @@ struct MidiDeviceInfo {
 
 class MidiDeviceManager {
 public:
+    // Built-in loopback stand-in: selecting it feeds everything sent straight back
+    // to the receive callback, so the send and receive paths can run without hardware
+    static const char* const LOOPBACK_DEVICE_NAME;
+    // Built-in null device: connected, accepts and discards everything (capture replay)
+    static const char* const NULL_DEVICE_NAME;
+    
     MidiDeviceManager();
     ~MidiDeviceManager();
     
+    // Transport setup - creates the OS MIDI client/ports and enumerates devices.
+    // Construction does no I/O so plugin scanning stays cheap; call open() once,
+    // off the audio thread, before selecting a device. Safe to call repeatedly.
+    bool open();
+    bool isOpen() const { return is_open_; }
+    
     // Device enumeration
     void refreshDeviceList();
     const std::vector<MidiDeviceInfo>& getDevices() const { return devices_; }
@@ -29,18 +51,58 @@ public:
     bool selectDevice(const std::string& device_name);
     std::string getSelectedDeviceName() const { return selected_device_name_; }
     
-    // MIDI I/O
-    bool sendMidiData(const uint8_t* data, size_t length);
-    void setMidiReceiveCallback(std::function<void(const uint8_t*, size_t)> callback);
+    // MIDI I/O. timestamp_ns schedules the send on the steady clock
+    // (std::chrono::steady_clock); 0 or a time already past sends immediately.
+    // Sends come from one thread at a time. The loopback device honours the
+    // timestamp too: every send is handed to its delivery thread, which calls the
+    // receive callback when it is due, like a device's input thread. The null
+    // device ignores it.
+    bool sendMidiData(const uint8_t* data, size_t length, uint64_t timestamp_ns = 0);
+    // The callback gets the bytes and, where the transport timestamps input, their
+    // arrival on the steady clock (0 when it doesn't)
+    void setMidiReceiveCallback(std::function<void(const uint8_t*, size_t, uint64_t)> callback);
+    
+#ifdef __linux__
+    // Uses already open descriptors as the device - a pipe or pseudo-terminal pair,
+    // say. Selecting a path outside the device list (a FIFO, a tty) opens it the
+    // same way. The manager owns the descriptors from here on.
+    bool selectFileDescriptors(int input_fd, int output_fd, const std::string& name);
+#endif
     
-    // Connection status
-    bool isConnected() const { return is_connected_; }
+    // Connection status. Any thread: selection happens on the main thread while
+    // the audio thread sends.
+    bool isConnected() const { return is_connected_.load(std::memory_order_acquire); }
+    bool isLoopback() const { return is_loopback_.load(std::memory_order_acquire); }
+    bool isNullDevice() const { return is_null_device_.load(std::memory_order_acquire); }
     
 private:
     std::vector<MidiDeviceInfo> devices_;
     std::string selected_device_name_;
-    bool is_connected_;
-    std::function<void(const uint8_t*, size_t)> receive_callback_;
+    // Device kind flags are set before is_connected_ is published, and a new
+    // selection clears is_connected_ first, so a sender that sees it connected
+    // sees the matching kind
+    std::atomic<bool> is_connected_;
+    bool is_open_;
+    std::atomic<bool> is_loopback_;
+    std::atomic<bool> is_null_device_;
+    std::function<void(const uint8_t*, size_t, uint64_t)> receive_callback_;
+    
+    // Loopback delivery: sends reach the delivery thread through a lock-free
+    // queue (created on first selection and kept, since a sender may still hold
+    // it), which orders them by due time in loopback_pending_. Started when the
+    // loopback is selected.
+    std::unique_ptr<MidiSendQueue> loopback_queue_;
+    std::thread loopback_thread_;
+    std::atomic<bool> loopback_running_;
+    std::multimap<uint64_t, std::vector<uint8_t>> loopback_pending_;  // delivery thread only
+    static const size_t LOOPBACK_QUEUE_BYTES = 65536;
+    static const size_t LOOPBACK_QUEUE_BATCHES = 1024;
+    // Longest the delivery thread sleeps before looking for new sends
+    static const uint64_t LOOPBACK_POLL_NS = 500000;
+    
+    void startLoopbackDelivery();
+    void loopbackDeliveryLoop();
+    void stopLoopbackDelivery();
     
 #ifdef __APPLE__
     MIDIClientRef midi_client_;
@@ -54,5 +116,10 @@ private:
     static void midiReadProc(const MIDIPacketList* packet_list, void* read_proc_ref_con, void* src_conn_ref_con);
 #endif
     
+#ifdef __linux__
+    // ALSA raw MIDI device (or any byte stream) in use; devices_ ids are its paths
+    RawMidiTransport raw_midi_;
+#endif
+    
     void updateConnectionStatus();
 };
\ No newline at end of file
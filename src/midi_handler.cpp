@@ -1,22 +1,51 @@
 #include "midi_handler.h"
+#include "plugin_metrics.h"
 
-MidiHandler::MidiHandler() : nrpn_state_(WAITING_FOR_NRPN_MSB) {
+MidiHandler::MidiHandler()
+    : bank_msb_(0), bank_lsb_(0), metrics_(nullptr) {
+    data_entry_timeout_ns_.store(DEFAULT_DATA_ENTRY_TIMEOUT_NS, std::memory_order_relaxed);
     resetNRPNState();
 }
 
 MidiHandler::~MidiHandler() {
 }
 
-void MidiHandler::processMidiMessage(const MidiMessage& message) {
-    if ((message.status & 0xF0) == 0xB0) { // Control Change
+void MidiHandler::processMidiMessage(const MidiMessage& message, uint64_t time_ns) {
+    bool is_cc = (message.status & 0xF0) == 0xB0;
+    
+    // A held data MSB is complete once anything but its LSB follows (realtime
+    // bytes may interleave), or it waited too long
+    if (data_entry_pending_ && message.status < 0xF8) {
+        bool timed_out = time_ns > data_entry_time_ns_ &&
+                         time_ns - data_entry_time_ns_ >= data_entry_timeout_ns_.load(std::memory_order_relaxed);
+        if (timed_out || !is_cc || message.data1 != CC_DATA_LSB) {
+            data_entry_pending_ = false;
+            deliverNRPN(data_msb_ << 7);
+        }
+    }
+    
+    if (is_cc) { // Control Change
         uint8_t cc = message.data1;
         uint8_t value = message.data2;
         
-        if (cc == CC_NRPN_MSB || cc == CC_NRPN_LSB || cc == CC_DATA_MSB || cc == CC_DATA_LSB) {
-            processNRPNCC(cc, value);
+        if (cc == CC_NRPN_MSB || cc == CC_NRPN_LSB || cc == CC_DATA_MSB || cc == CC_DATA_LSB ||
+            cc == CC_DATA_INCREMENT || cc == CC_DATA_DECREMENT) {
+            processNRPNCC(cc, value, time_ns);
+        } else if (cc == CC_RPN_MSB || cc == CC_RPN_LSB) {
+            // Data entry now addresses an RPN
+            nrpn_parts_ = 0;
+            rpn_selected_ = true;
+        } else if (cc == CC_BANK_SELECT_MSB) {
+            bank_msb_ = value;
+        } else if (cc == CC_BANK_SELECT_LSB) {
+            bank_lsb_ = value;
         } else {
             processCC(cc, value);
         }
+    } else if ((message.status & 0xF0) == 0xC0) { // Program Change
+        if (program_change_callback_) {
+            program_change_callback_((bank_msb_ << 7) | bank_lsb_, message.data1);
+        }
     }
 }
 
@@ -26,51 +55,77 @@ void MidiHandler::processCC(uint8_t cc, uint8_t value) {
     }
 }
 
-void MidiHandler::processNRPNCC(uint8_t cc, uint8_t value) {
+bool MidiHandler::isInboundNRPNSelected() const {
+    // Both halves of the address received, and not the null NRPN (127/127)
+    return nrpn_parts_ == (NRPN_MSB_RECEIVED | NRPN_LSB_RECEIVED) && !(nrpn_msb_ == 0x7F && nrpn_lsb_ == 0x7F);
+}
+
+void MidiHandler::processNRPNCC(uint8_t cc, uint8_t value, uint64_t time_ns) {
     switch (cc) {
         case CC_NRPN_MSB:
-            nrpn_msb_ = value;
-            nrpn_state_ = WAITING_FOR_NRPN_LSB;
-            break;
-            
         case CC_NRPN_LSB:
-            if (nrpn_state_ == WAITING_FOR_NRPN_LSB) {
+            // Either half may change on its own; a new address starts from a value of 0
+            if (cc == CC_NRPN_MSB) {
+                nrpn_msb_ = value;
+                nrpn_parts_ |= NRPN_MSB_RECEIVED;
+            } else {
                 nrpn_lsb_ = value;
-                nrpn_state_ = WAITING_FOR_DATA_MSB;
+                nrpn_parts_ |= NRPN_LSB_RECEIVED;
             }
-            break;
+            rpn_selected_ = false;
+            data_msb_ = 0;
+            return;
             
+        default:
+            break;
+    }
+    
+    if (!isInboundNRPNSelected()) {
+        if (!rpn_selected_ && metrics_) {
+            metrics_->add(METRIC_PARSE_ERRORS);
+        }
+        return;
+    }
+    
+    switch (cc) {
         case CC_DATA_MSB:
-            if (nrpn_state_ == WAITING_FOR_DATA_MSB) {
-                data_msb_ = value;
-                nrpn_state_ = WAITING_FOR_DATA_LSB;
-            }
+            data_msb_ = value;
+            data_entry_pending_ = true;
+            data_entry_time_ns_ = time_ns;
             break;
             
         case CC_DATA_LSB:
-            if (nrpn_state_ == WAITING_FOR_DATA_LSB) {
-                data_lsb_ = value;
-                nrpn_state_ = NRPN_COMPLETE;
-                
-                // Complete NRPN message received
-                NRPNMessage nrpn;
-                nrpn.parameter = (nrpn_msb_ << 7) | nrpn_lsb_;
-                nrpn.value = (data_msb_ << 7) | data_lsb_;
-                nrpn.timestamp = 0; // TODO: Add proper timestamp
-                nrpn.is_complete = true;
-                
-                incoming_nrpn_queue_.push(nrpn);
-                
-                if (nrpn_callback_) {
-                    nrpn_callback_(nrpn.parameter, nrpn.value);
-                }
-                
-                resetNRPNState();
+            data_entry_pending_ = false;
+            deliverNRPN((data_msb_ << 7) | value);
+            break;
+            
+        case CC_DATA_INCREMENT:
+        case CC_DATA_DECREMENT:
+            // The data byte is ignored: senders disagree on whether it is a step count
+            if (nrpn_increment_callback_) {
+                nrpn_increment_callback_((nrpn_msb_ << 7) | nrpn_lsb_, cc == CC_DATA_INCREMENT ? 1 : -1);
             }
             break;
     }
 }
 
+void MidiHandler::deliverNRPN(uint16_t value) {
+    NRPNMessage nrpn;
+    nrpn.parameter = (nrpn_msb_ << 7) | nrpn_lsb_;
+    nrpn.value = value;
+    nrpn.is_complete = true;
+    
+    processNRPNMessage(nrpn);
+}
+
+void MidiHandler::completeDataEntry(uint64_t now_ns) {
+    if (data_entry_pending_ && now_ns > data_entry_time_ns_ &&
+        now_ns - data_entry_time_ns_ >= data_entry_timeout_ns_.load(std::memory_order_relaxed)) {
+        data_entry_pending_ = false;
+        deliverNRPN(data_msb_ << 7);
+    }
+}
+
 void MidiHandler::processNRPNMessage(const NRPNMessage& nrpn) {
     if (nrpn_callback_) {
         nrpn_callback_(nrpn.parameter, nrpn.value);
@@ -78,44 +133,16 @@ void MidiHandler::processNRPNMessage(const NRPNMessage& nrpn) {
 }
 
 void MidiHandler::sendNRPN(uint16_t parameter, uint16_t value) {
-    uint8_t nrpn_msb = (parameter >> 7) & 0x7F;
-    uint8_t nrpn_lsb = parameter & 0x7F;
-    uint8_t data_msb = (value >> 7) & 0x7F;
-    uint8_t data_lsb = value & 0x7F;
-    
-    // Send NRPN parameter MSB
-    MidiMessage msg1 = {0xB0, CC_NRPN_MSB, nrpn_msb, 0};
-    outgoing_midi_queue_.push(msg1);
-    
-    // Send NRPN parameter LSB
-    MidiMessage msg2 = {0xB0, CC_NRPN_LSB, nrpn_lsb, 0};
-    outgoing_midi_queue_.push(msg2);
-    
-    // Send data MSB
-    MidiMessage msg3 = {0xB0, CC_DATA_MSB, data_msb, 0};
-    outgoing_midi_queue_.push(msg3);
-    
-    // Send data LSB
-    MidiMessage msg4 = {0xB0, CC_DATA_LSB, data_lsb, 0};
-    outgoing_midi_queue_.push(msg4);
-}
-
-void MidiHandler::sendCC(uint8_t cc, uint8_t value) {
-    MidiMessage msg = {0xB0, cc, value, 0};
-    outgoing_midi_queue_.push(msg);
+    uint32_t packet_value = UmpCodec::scaleUp(value & 0x3FFF, NRPN_VALUE_BITS, 32);
+    outgoing_packet_queue_.push(UmpCodec::nrpn(0, parameter, packet_value));
 }
 
-bool MidiHandler::hasNRPNMessage() const {
-    return !incoming_nrpn_queue_.empty();
+void MidiHandler::sendNRPNIncrement(uint16_t parameter, int steps) {
+    outgoing_packet_queue_.push(UmpCodec::relativeNrpn(0, parameter, steps));
 }
 
-NRPNMessage MidiHandler::popNRPNMessage() {
-    if (!incoming_nrpn_queue_.empty()) {
-        NRPNMessage nrpn = incoming_nrpn_queue_.front();
-        incoming_nrpn_queue_.pop();
-        return nrpn;
-    }
-    return NRPNMessage{0, 0, 0, false};
+void MidiHandler::sendCC(uint8_t cc, uint8_t value) {
+    outgoing_packet_queue_.push(UmpCodec::fromMidi1(0xB0, cc, value));
 }
 
 void MidiHandler::setNRPNCallback(std::function<void(uint16_t, uint16_t)> callback) {
@@ -126,28 +153,37 @@ void MidiHandler::setCCCallback(std::function<void(uint8_t, uint8_t)> callback)
     cc_callback_ = callback;
 }
 
-void MidiHandler::getOutgoingMessages(std::vector<MidiMessage>& messages) {
-    messages.clear();
-    while (!outgoing_midi_queue_.empty()) {
-        messages.push_back(outgoing_midi_queue_.front());
-        outgoing_midi_queue_.pop();
+void MidiHandler::setNRPNIncrementCallback(std::function<void(uint16_t, int)> callback) {
+    nrpn_increment_callback_ = callback;
+}
+
+void MidiHandler::setProgramChangeCallback(std::function<void(uint16_t, uint8_t)> callback) {
+    program_change_callback_ = callback;
+}
+
+void MidiHandler::getOutgoingPackets(std::vector<UmpPacket>& packets) {
+    packets.clear();
+    if (metrics_) {
+        metrics_->updateHighWater(METRIC_OUTGOING_QUEUE_HIGH_WATER, outgoing_packet_queue_.size());
+    }
+    while (!outgoing_packet_queue_.empty()) {
+        packets.push_back(outgoing_packet_queue_.front());
+        outgoing_packet_queue_.pop();
     }
 }
 
 void MidiHandler::clearOutgoingMessages() {
-    while (!outgoing_midi_queue_.empty()) {
-        outgoing_midi_queue_.pop();
+    while (!outgoing_packet_queue_.empty()) {
+        outgoing_packet_queue_.pop();
     }
 }
 
 void MidiHandler::resetNRPNState() {
-    nrpn_state_ = WAITING_FOR_NRPN_MSB;
+    nrpn_parts_ = 0;
+    rpn_selected_ = false;
     nrpn_msb_ = 0;
     nrpn_lsb_ = 0;
     data_msb_ = 0;
-    data_lsb_ = 0;
+    data_entry_pending_ = false;
+    data_entry_time_ns_ = 0;
 }
-
-bool MidiHandler::isNRPNComplete() {
-    return nrpn_state_ == NRPN_COMPLETE;
-}
\ No newline at end of file
@@ -1,8 +1,12 @@
 #pragma once
+#include "ump.h"
 #include <clap/clap.h>
 #include <vector>
 #include <functional>
 #include <queue>
+#include <atomic>
+
+class PluginMetrics;
 
 struct MidiMessage {
     uint8_t status;
@@ -11,10 +15,11 @@ struct MidiMessage {
     uint32_t timestamp;
 };
 
+// A decoded NRPN write. Its arrival time is the time_ns of the message that
+// completed it, which the caller of processMidiMessage already has.
 struct NRPNMessage {
     uint16_t parameter;
     uint16_t value;
-    uint32_t timestamp;
     bool is_complete;
 };
 
@@ -23,14 +28,27 @@ public:
     MidiHandler();
     ~MidiHandler();
     
-    // MIDI message processing
-    void processMidiMessage(const MidiMessage& message);
+    // MIDI message processing. time_ns is when the message arrived (0 if unknown)
+    // and times out a data entry MSB waiting for its LSB.
+    void processMidiMessage(const MidiMessage& message, uint64_t time_ns = 0);
     void processNRPNMessage(const NRPNMessage& nrpn);
     
-    // NRPN handling
+    // Inbound NRPN data entry. The selected NRPN stays selected until another
+    // address arrives, so hardware may send it once and then only the data bytes
+    // that change. A data MSB (CC6) sets the LSB to 0 and is held for a CC38 to
+    // complete it; it is delivered on its own when anything else arrives or the
+    // timeout passes. A CC38 alone changes the LSB of the last value. Increment and
+    // decrement (CC96/CC97) go to their own callback, one step per message.
+    void completeDataEntry(uint64_t now_ns);  // delivers a held MSB once timed out
+    bool hasPendingDataEntry() const { return data_entry_pending_; }
+    void setDataEntryTimeoutNs(uint64_t timeout_ns) { data_entry_timeout_ns_.store(timeout_ns, std::memory_order_relaxed); }
+    static const uint64_t DEFAULT_DATA_ENTRY_TIMEOUT_NS = 10000000;
+    
+    // NRPN handling. Each write is queued as one packet (see UmpCodec); the MIDI 1.0
+    // messages are produced where it leaves the plugin.
     void sendNRPN(uint16_t parameter, uint16_t value);
-    bool hasNRPNMessage() const;
-    NRPNMessage popNRPNMessage();
+    // Data increment/decrement of an NRPN by steps
+    void sendNRPNIncrement(uint16_t parameter, int steps);
     
     // CC handling
     void sendCC(uint8_t cc, uint8_t value);
@@ -38,44 +56,67 @@ public:
     // Callbacks
     void setNRPNCallback(std::function<void(uint16_t, uint16_t)> callback);
     void setCCCallback(std::function<void(uint8_t, uint8_t)> callback);
+    void setNRPNIncrementCallback(std::function<void(uint16_t, int)> callback);
+    // Program change, with the bank from the last bank select (CC0 MSB, CC32 LSB)
+    void setProgramChangeCallback(std::function<void(uint16_t, uint8_t)> callback);
+    
+    // Optional metrics sink for parse errors and outgoing queue depth (not owned)
+    void setMetrics(PluginMetrics* metrics) { metrics_ = metrics; }
     
     // Queue management
-    void getOutgoingMessages(std::vector<MidiMessage>& messages);
+    void getOutgoingPackets(std::vector<UmpPacket>& packets);
+    bool hasOutgoingMessages() const { return !outgoing_packet_queue_.empty(); }
     void clearOutgoingMessages();
     
 private:
-    // NRPN state machine
-    enum NRPNState {
-        WAITING_FOR_NRPN_MSB,
-        WAITING_FOR_NRPN_LSB,
-        WAITING_FOR_DATA_MSB,
-        WAITING_FOR_DATA_LSB,
-        NRPN_COMPLETE
+    // Inbound NRPN address and data entry state
+    enum NRPNAddressPart : uint8_t {
+        NRPN_MSB_RECEIVED = 1,
+        NRPN_LSB_RECEIVED = 2
     };
     
-    NRPNState nrpn_state_;
+    uint8_t nrpn_parts_;      // NRPNAddressPart bits since the last reset
+    bool rpn_selected_;       // data entry belongs to an RPN, which is ignored
     uint16_t nrpn_msb_;
     uint16_t nrpn_lsb_;
     uint16_t data_msb_;
-    uint16_t data_lsb_;
+    bool data_entry_pending_;
+    uint64_t data_entry_time_ns_;
+    std::atomic<uint64_t> data_entry_timeout_ns_;
     
-    // Message queues
-    std::queue<NRPNMessage> incoming_nrpn_queue_;
-    std::queue<MidiMessage> outgoing_midi_queue_;
+    // Outgoing packets; inbound NRPNs go straight to the callback
+    std::queue<UmpPacket> outgoing_packet_queue_;
     
     // Callbacks
     std::function<void(uint16_t, uint16_t)> nrpn_callback_;
     std::function<void(uint8_t, uint8_t)> cc_callback_;
+    std::function<void(uint16_t, int)> nrpn_increment_callback_;
+    std::function<void(uint16_t, uint8_t)> program_change_callback_;
+    
+    // Bank select state for program changes
+    uint8_t bank_msb_;
+    uint8_t bank_lsb_;
+    
+    PluginMetrics* metrics_;
     
     // Helper methods
     void processCC(uint8_t cc, uint8_t value);
-    void processNRPNCC(uint8_t cc, uint8_t value);
+    void processNRPNCC(uint8_t cc, uint8_t value, uint64_t time_ns);
+    void deliverNRPN(uint16_t value);
+    bool isInboundNRPNSelected() const;
     void resetNRPNState();
-    bool isNRPNComplete();
     
     // MIDI CC constants
     static const uint8_t CC_NRPN_MSB = 99;
     static const uint8_t CC_NRPN_LSB = 98;
     static const uint8_t CC_DATA_MSB = 6;
     static const uint8_t CC_DATA_LSB = 38;
+    static const uint8_t CC_BANK_SELECT_MSB = 0;
+    static const uint8_t CC_BANK_SELECT_LSB = 32;
+    static const uint8_t CC_DATA_INCREMENT = 96;
+    static const uint8_t CC_DATA_DECREMENT = 97;
+    // NRPN values are 14-bit on the wire and 32-bit in packets
+    static const unsigned NRPN_VALUE_BITS = 14;
+    static const uint8_t CC_RPN_LSB = 100;
+    static const uint8_t CC_RPN_MSB = 101;
 };
\ No newline at end of file
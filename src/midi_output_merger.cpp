@@ -0,0 +1,117 @@
+#include "midi_output_merger.h"
+#include "ump_midi1_encoder.h"
+#include "trace.h"
+#include <algorithm>
+
+MidiOutputMerger::MidiOutputMerger()
+    : unit_count_(0)
+    , samples_per_byte_(0.0)
+{
+}
+
+bool MidiOutputMerger::pushPriority(uint32_t time, const UmpPacket& packet) {
+    if (unit_count_ >= MAX_UNITS) {
+        return false;
+    }
+    push(LANE_PRIORITY, time, packet);
+    return true;
+}
+
+bool MidiOutputMerger::pushSequence(uint32_t time, const UmpPacket* packets, size_t count) {
+    return pushAll(LANE_SEQUENCE, time, packets, count);
+}
+
+bool MidiOutputMerger::pushBulk(uint32_t time, const UmpPacket* packets, size_t count) {
+    return pushAll(LANE_BULK, time, packets, count);
+}
+
+bool MidiOutputMerger::pushAll(Lane lane, uint32_t time, const UmpPacket* packets, size_t count) {
+    if (count > MAX_UNITS - unit_count_) {
+        return false;
+    }
+    for (size_t i = 0; i < count; ++i) {
+        push(lane, time, packets[i]);
+    }
+    return true;
+}
+
+void MidiOutputMerger::push(Lane lane, uint32_t time, const UmpPacket& packet) {
+    Unit& unit = units_[unit_count_];
+    unit.packet = packet;
+    unit.time = time;
+    unit.sequence = static_cast<uint16_t>(unit_count_);
+    unit.bytes = static_cast<uint16_t>(UmpMidi1Encoder::maxWireLength(packet));
+    unit.lane = lane;
+    ++unit_count_;
+}
+
+size_t MidiOutputMerger::nextInLane(size_t index, Lane lane) const {
+    while (index < unit_count_ && units_[index].lane != lane) {
+        ++index;
+    }
+    return index;
+}
+
+bool MidiOutputMerger::overtakes(const Unit& unit, const Unit& ahead) const {
+    // Due while the packet ahead would have been on the wire, had it gone out on
+    // time. The window is fixed by that packet's own time, so a steady stream from
+    // a higher lane delays it by at most about its transmission time rather than
+    // to the end of the block.
+    return unit.time < ahead.time + ahead.bytes * samples_per_byte_;
+}
+
+void MidiOutputMerger::drain(const std::function<void(uint32_t, const UmpPacket&)>& emit) {
+    // Lanes are filled in host event order, but an edit can be pushed after notes
+    // with a later time, so sort once; at equal times the higher lane goes first
+    std::sort(units_.begin(), units_.begin() + unit_count_, [](const Unit& a, const Unit& b) {
+        if (a.time != b.time) {
+            return a.time < b.time;
+        }
+        if (a.lane != b.lane) {
+            return a.lane < b.lane;
+        }
+        return a.sequence < b.sequence;
+    });
+    
+    size_t next[LANE_COUNT];
+    for (int lane = 0; lane < LANE_COUNT; ++lane) {
+        next[lane] = nextInLane(0, static_cast<Lane>(lane));
+    }
+    uint32_t last_time = 0;
+    
+    for (;;) {
+        // Walk up from the lowest lane: each higher lane's next packet takes over
+        // when it overtakes the one picked so far
+        int pick = LANE_COUNT;
+        for (int lane = LANE_COUNT - 1; lane >= 0; --lane) {
+            if (next[lane] >= unit_count_) {
+                continue;
+            }
+            if (pick == LANE_COUNT || overtakes(units_[next[lane]], units_[next[pick]])) {
+                if (pick != LANE_COUNT && units_[next[pick]].time < units_[next[lane]].time) {
+                    // A higher lane overtakes a packet that was due first
+                    if (lane == LANE_PRIORITY) {
+                        SPOBX8_TRACE_INSTANT("scheduler", "priority_overtakes_edit", units_[next[lane]].time);
+                    } else {
+                        SPOBX8_TRACE_INSTANT("scheduler", "sequence_overtakes_edit", units_[next[lane]].time);
+                    }
+                }
+                pick = lane;
+            }
+        }
+        if (pick == LANE_COUNT) {
+            break;
+        }
+        
+        const Unit& unit = units_[next[pick]];
+        last_time = std::max(unit.time, last_time);
+        emit(last_time, unit.packet);
+        next[pick] = nextInLane(next[pick] + 1, static_cast<Lane>(pick));
+    }
+    
+    clear();
+}
+
+void MidiOutputMerger::clear() {
+    unit_count_ = 0;
+}
@@ -0,0 +1,67 @@
+#pragma once
+#include "ump.h"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+
+// Merges the outgoing packet streams of a block into one time-ordered stream: a
+// priority lane of performance messages (notes, bend, pressure, mod wheel,
+// sustain), a sequence lane of step sequencer writes and a bulk lane of parameter
+// edits. An edit is a single packet (a whole NRPN write or data increment run),
+// so nothing can land between the address and data of an NRPN once it is
+// converted to MIDI 1.0. A packet due before the lower-lane packet ahead of it
+// would finish on the wire goes first and that packet moves back: performance
+// over sequencer writes and edits, sequencer writes over edits, since a step's
+// writes have to land before the step. Audio thread only, fixed storage.
+class MidiOutputMerger {
+public:
+    MidiOutputMerger();
+    
+    // DIN MIDI runs at 31250 baud, 10 bits per byte
+    static constexpr double DIN_SECONDS_PER_BYTE = 320e-6;
+    
+    // Wire time of one byte in samples; 0 treats the link as instantaneous
+    void setSamplesPerByte(double samples_per_byte) { samples_per_byte_ = samples_per_byte; }
+    
+    // All return false and drop the input when the block's storage is used up;
+    // pushSequence and pushBulk take all of their packets or none
+    bool pushPriority(uint32_t time, const UmpPacket& packet);
+    bool pushSequence(uint32_t time, const UmpPacket* packets, size_t count);
+    bool pushBulk(uint32_t time, const UmpPacket* packets, size_t count);
+    
+    // Hands everything pushed since the last drain to emit(time, packet). Times
+    // never decrease. Leaves the merger empty.
+    void drain(const std::function<void(uint32_t, const UmpPacket&)>& emit);
+    
+    void clear();
+    bool empty() const { return unit_count_ == 0; }
+    
+    static const size_t MAX_UNITS = 512;
+
+private:
+    // In priority order
+    enum Lane : uint8_t {
+        LANE_PRIORITY = 0,
+        LANE_SEQUENCE,
+        LANE_BULK,
+        LANE_COUNT
+    };
+    
+    struct Unit {
+        UmpPacket packet;
+        uint32_t time;
+        uint16_t sequence;
+        uint16_t bytes;   // on a MIDI 1.0 wire
+        Lane lane;
+    };
+    
+    std::array<Unit, MAX_UNITS> units_;
+    size_t unit_count_;
+    double samples_per_byte_;
+    
+    void push(Lane lane, uint32_t time, const UmpPacket& packet);
+    bool pushAll(Lane lane, uint32_t time, const UmpPacket* packets, size_t count);
+    size_t nextInLane(size_t index, Lane lane) const;
+    bool overtakes(const Unit& unit, const Unit& ahead) const;
+};
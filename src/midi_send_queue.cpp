@@ -0,0 +1,65 @@
+#include "midi_send_queue.h"
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+size_t roundUpToPowerOfTwo(size_t value) {
+    size_t result = 1;
+    while (result < value) {
+        result <<= 1;
+    }
+    return result;
+}
+
+} // namespace
+
+MidiSendQueue::MidiSendQueue(size_t byte_capacity, size_t batch_capacity)
+    : byte_capacity_(roundUpToPowerOfTwo(byte_capacity))
+    , batch_capacity_(roundUpToPowerOfTwo(batch_capacity))
+    , bytes_(new uint8_t[byte_capacity_])
+    , batches_(new Batch[batch_capacity_])
+    , byte_head_(0)
+    , byte_tail_(0)
+    , batch_head_(0)
+    , batch_tail_(0)
+{
+}
+
+bool MidiSendQueue::push(const uint8_t* data, size_t length, uint64_t due_ns) {
+    size_t batch_head = batch_head_.load(std::memory_order_relaxed);
+    if (length == 0 || batch_head - batch_tail_.load(std::memory_order_acquire) >= batch_capacity_ ||
+        byte_head_ - byte_tail_.load(std::memory_order_acquire) + length > byte_capacity_) {
+        return false;
+    }
+    
+    // The bytes may wrap around the end of the ring
+    size_t offset = byte_head_ & (byte_capacity_ - 1);
+    size_t first = std::min(length, byte_capacity_ - offset);
+    std::memcpy(bytes_.get() + offset, data, first);
+    std::memcpy(bytes_.get(), data + first, length - first);
+    byte_head_ += length;
+    
+    batches_[batch_head & (batch_capacity_ - 1)] = Batch{due_ns, static_cast<uint32_t>(length)};
+    batch_head_.store(batch_head + 1, std::memory_order_release);
+    return true;
+}
+
+bool MidiSendQueue::pop(std::vector<uint8_t>& bytes, uint64_t& due_ns) {
+    size_t batch_tail = batch_tail_.load(std::memory_order_relaxed);
+    if (batch_tail == batch_head_.load(std::memory_order_acquire)) {
+        return false;
+    }
+    
+    const Batch& batch = batches_[batch_tail & (batch_capacity_ - 1)];
+    size_t byte_tail = byte_tail_.load(std::memory_order_relaxed);
+    size_t offset = byte_tail & (byte_capacity_ - 1);
+    size_t first = std::min<size_t>(batch.length, byte_capacity_ - offset);
+    bytes.assign(bytes_.get() + offset, bytes_.get() + offset + first);
+    bytes.insert(bytes.end(), bytes_.get(), bytes_.get() + (batch.length - first));
+    due_ns = batch.due_ns;
+    
+    byte_tail_.store(byte_tail + batch.length, std::memory_order_release);
+    batch_tail_.store(batch_tail + 1, std::memory_order_release);
+    return true;
+}
@@ -0,0 +1,41 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// Timestamped MIDI bytes on their way from the sending thread to a transport's
+// delivery thread. Each push is one batch, popped whole and in push order; the
+// consumer decides when a batch is due. Single producer (sends come from one
+// thread at a time: process(), or a parameter flush while not processing),
+// single consumer; the producer never blocks or allocates.
+class MidiSendQueue {
+public:
+    // Both capacities are rounded up to powers of two
+    MidiSendQueue(size_t byte_capacity, size_t batch_capacity);
+    
+    // Producer. Returns false and queues nothing when the batch doesn't fit.
+    bool push(const uint8_t* data, size_t length, uint64_t due_ns);
+    
+    // Consumer. Replaces bytes with the oldest batch and sets due_ns to its time.
+    bool pop(std::vector<uint8_t>& bytes, uint64_t& due_ns);
+    bool empty() const {
+        return batch_head_.load(std::memory_order_acquire) == batch_tail_.load(std::memory_order_relaxed);
+    }
+
+private:
+    struct Batch {
+        uint64_t due_ns;
+        uint32_t length;
+    };
+    
+    size_t byte_capacity_;
+    size_t batch_capacity_;
+    std::unique_ptr<uint8_t[]> bytes_;
+    std::unique_ptr<Batch[]> batches_;
+    size_t byte_head_;                  // next byte written, producer only
+    std::atomic<size_t> byte_tail_;     // next byte read, owned by the consumer
+    std::atomic<size_t> batch_head_;    // next batch written, owned by the producer
+    std::atomic<size_t> batch_tail_;    // next batch read, owned by the consumer
+};
@@ -0,0 +1,156 @@
+#include "midi_stream_parser.h"
+#include "plugin_metrics.h"
+
+MidiStreamParser::MidiStreamParser(size_t max_sysex_length)
+    : metrics_(nullptr)
+    , running_status_(0)
+    , data_count_(0)
+    , data_needed_(0)
+    , max_sysex_length_(max_sysex_length)
+    , in_sysex_(false)
+    , sysex_overflow_(false)
+{
+    data_[0] = data_[1] = 0;
+    sysex_buffer_.reserve(max_sysex_length_);
+}
+
+void MidiStreamParser::reset() {
+    running_status_ = 0;
+    data_count_ = 0;
+    data_needed_ = 0;
+    in_sysex_ = false;
+    sysex_overflow_ = false;
+    sysex_buffer_.clear();
+}
+
+void MidiStreamParser::parse(const uint8_t* data, size_t length) {
+    for (size_t i = 0; i < length; ++i) {
+        uint8_t byte = data[i];
+        
+        // Realtime bytes may appear anywhere, even inside SysEx, and don't disturb running status
+        if (byte >= 0xF8) {
+            emit(byte, 0, 0);
+            continue;
+        }
+        
+        if (byte & 0x80) {
+            handleStatusByte(byte);
+        } else {
+            handleDataByte(byte);
+        }
+    }
+}
+
+void MidiStreamParser::handleStatusByte(uint8_t status) {
+    if (in_sysex_) {
+        if (status == 0xF7) {
+            if (sysex_overflow_) {
+                parseError();
+            } else {
+                sysex_buffer_.push_back(status);
+                if (sysex_callback_) {
+                    sysex_callback_(sysex_buffer_.data(), sysex_buffer_.size());
+                }
+            }
+            in_sysex_ = false;
+            sysex_buffer_.clear();
+            return;
+        }
+        
+        // Any other status byte terminates the SysEx without delivering it
+        parseError();
+        in_sysex_ = false;
+        sysex_buffer_.clear();
+    }
+    
+    if (data_count_ != 0) {
+        parseError(); // previous message was cut short
+    }
+    data_count_ = 0;
+    
+    if (status == 0xF0) {
+        in_sysex_ = true;
+        sysex_overflow_ = false;
+        sysex_buffer_.push_back(status);
+        running_status_ = 0;
+        return;
+    }
+    
+    if (status == 0xF7) {
+        parseError(); // end of exclusive without a start
+        return;
+    }
+    
+    data_needed_ = dataLength(status);
+    if (data_needed_ == 0) {
+        running_status_ = 0; // system common messages cancel running status
+        emit(status, 0, 0);
+        return;
+    }
+    
+    // System common messages clear this again once their data is complete
+    running_status_ = status;
+}
+
+void MidiStreamParser::handleDataByte(uint8_t byte) {
+    if (in_sysex_) {
+        if (sysex_buffer_.size() + 1 >= max_sysex_length_) {
+            sysex_overflow_ = true;
+        } else {
+            sysex_buffer_.push_back(byte);
+        }
+        return;
+    }
+    
+    if (running_status_ == 0) {
+        parseError(); // data byte without a status
+        return;
+    }
+    
+    data_[data_count_++] = byte;
+    if (data_count_ < data_needed_) {
+        return;
+    }
+    
+    uint8_t status = running_status_;
+    data_count_ = 0;
+    
+    // System common messages are complete now and leave no running status
+    if (status >= 0xF0) {
+        running_status_ = 0;
+    }
+    emit(status, data_[0], data_needed_ > 1 ? data_[1] : 0);
+}
+
+void MidiStreamParser::emit(uint8_t status, uint8_t data1, uint8_t data2) {
+    if (message_callback_) {
+        MidiMessage msg = {status, data1, data2, 0};
+        message_callback_(msg);
+    }
+}
+
+void MidiStreamParser::parseError() {
+    if (metrics_) {
+        metrics_->add(METRIC_PARSE_ERRORS);
+    }
+}
+
+uint8_t MidiStreamParser::dataLength(uint8_t status) {
+    switch (status & 0xF0) {
+        case 0xC0: // Program change
+        case 0xD0: // Channel pressure
+            return 1;
+        case 0xF0:
+            switch (status) {
+                case 0xF1: // MTC quarter frame
+                case 0xF3: // Song select
+                    return 1;
+                case 0xF2: // Song position pointer
+                    return 2;
+                default:
+                    return 0;
+            }
+        default:
+            return 2;
+    }
+}
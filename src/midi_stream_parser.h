@@ -0,0 +1,52 @@
+#pragma once
+#include "midi_handler.h"
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+class PluginMetrics;
+
+// Splits a raw MIDI byte stream into messages. A single OS packet may hold
+// several messages, running status, interleaved realtime bytes or a chunk of a
+// SysEx that continues in the next packet. Channel and system messages are
+// delivered as MidiMessage (unused data bytes are 0); complete SysEx messages
+// are delivered including their F0/F7 framing.
+class MidiStreamParser {
+public:
+    explicit MidiStreamParser(size_t max_sysex_length = DEFAULT_MAX_SYSEX_LENGTH);
+    
+    void setMessageCallback(std::function<void(const MidiMessage&)> callback) { message_callback_ = callback; }
+    void setSysExCallback(std::function<void(const uint8_t*, size_t)> callback) { sysex_callback_ = callback; }
+    
+    // Optional metrics sink for malformed input (not owned)
+    void setMetrics(PluginMetrics* metrics) { metrics_ = metrics; }
+    
+    void parse(const uint8_t* data, size_t length);
+    void reset();
+    
+    static const size_t DEFAULT_MAX_SYSEX_LENGTH = 4096;
+    
+private:
+    std::function<void(const MidiMessage&)> message_callback_;
+    std::function<void(const uint8_t*, size_t)> sysex_callback_;
+    PluginMetrics* metrics_;
+    
+    // Channel/system message assembly
+    uint8_t running_status_;
+    uint8_t data_[2];
+    uint8_t data_count_;
+    uint8_t data_needed_;
+    
+    // SysEx assembly - capacity is reserved up front and never grown
+    std::vector<uint8_t> sysex_buffer_;
+    size_t max_sysex_length_;
+    bool in_sysex_;
+    bool sysex_overflow_;
+    
+    void handleStatusByte(uint8_t status);
+    void handleDataByte(uint8_t byte);
+    void emit(uint8_t status, uint8_t data1, uint8_t data2);
+    void parseError();
+    static uint8_t dataLength(uint8_t status);
+};
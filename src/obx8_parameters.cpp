@@ -1,87 +1,139 @@
 #include "obx8_parameters.h"
+#include "debug_log.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
 
-OBX8ParameterManager::OBX8ParameterManager() {
+OBX8ParameterManager::OBX8ParameterManager()
+    : OBX8ParameterManager(sharedProfile().get())
+{
+}
+
+OBX8ParameterManager::OBX8ParameterManager(const DeviceProfile* profile) {
     // MIDI Device Selector - Removed NRPN 30 conflict (now uses no NRPN)
     addParameter(MIDI_DEVICE_SELECTION, "midi_device", "MIDI Device", 0, 0, 0, 0.0, 1.0, 0.0, "", true,
                 {});
     
-    // Oscillator 1 parameters - Using correct OB-X8 v2 manual NRPN numbers
-    addParameter(OSC1_FREQUENCY, "osc1_frequency", "Osc 1 Frequency", 0, 1, 16, 0.0, 63.0, 32.0, "");
-    addParameter(OSC1_WAVEFORM, "osc1_waveform", "Osc 1 Waveform", 0, 5, 17, 0.0, 3.0, 0.0, "", true,
-                {"Triangle", "Sawtooth", "Pulse", "Pulse+Saw"});
-    addParameter(OSC1_PULSE_WIDTH, "osc1_pulse_width", "Osc 1 Pulse Width", 0, 7, 18, 0.0, 127.0, 64.0, "%");
-    addParameter(OSC1_LEVEL, "osc1_level", "Osc 1 Level", 0, 19, 19, 0.0, 1.0, 1.0, "", true, {"Off", "On"});
-    
-    // Oscillator 2 parameters
-    addParameter(OSC2_FREQUENCY, "osc2_frequency", "Osc 2 Frequency", 0, 2, 20, 0.0, 63.0, 32.0, "");
-    addParameter(OSC2_WAVEFORM, "osc2_waveform", "Osc 2 Waveform", 0, 6, 21, 0.0, 3.0, 0.0, "", true,
-                {"Triangle", "Sawtooth", "Pulse", "Pulse+Saw"});
-    addParameter(OSC2_PULSE_WIDTH, "osc2_pulse_width", "Osc 2 Pulse Width", 0, 8, 22, 0.0, 127.0, 64.0, "%");
-    // OSC 2 DETUNE parameter (NRPN 3)
-    addParameter(OSC2_DETUNE, "osc2_detune", "Osc 2 Detune", 0, 3, 23, 0.0, 63.0, 32.0, "");
-    
-    // OSC SYNC is a single parameter (NRPN 13) that affects both oscillators
-    addParameter(OSC_SYNC, "osc_sync", "Osc Sync", 0, 13, 24, 0.0, 1.0, 0.0, "", true, {"Off", "On"});
-    addParameter(OSC2_LEVEL, "osc2_level", "Osc 2 Level", 0, 20, 25, 0.0, 1.0, 1.0, "", true, {"Off", "On"});
-    
-    // Noise Level parameter (NRPN 21)
-    addParameter(NOISE_LEVEL, "noise_level", "Noise Level", 0, 21, 26, 0.0, 1.0, 0.0, "", true, {"Off", "On"});
-    
-    // Filter parameters
-    addParameter(FILTER_FREQUENCY, "filter_frequency", "Filter Frequency", 0, 22, 26, 0.0, 175.0, 88.0, "");
-    addParameter(FILTER_RESONANCE, "filter_resonance", "Filter Resonance", 0, 23, 27, 0.0, 127.0, 0.0, "");
-    addParameter(FILTER_TRACKING, "filter_tracking", "Filter Tracking", 0, 25, 28, 0.0, 1.0, 0.0, "", true, {"Off", "On"});
-    addParameter(FILTER_POLE, "filter_pole", "Filter Type", 0, 24, 29, 0.0, 6.0, 0.0, "", true, {"OB-X/SEM 2-Pole LP", "SEM 2-Pole HP", "SEM 2-Pole BP", "SEM 2-Pole Notch", "OB-Xa/8 2-Pole LP", "OB-Xa/8 4-Pole LP", "Modified 4-Pole LP"});
-    
-    // VINTAGE parameter (NRPN 26)
-    addParameter(VINTAGE, "vintage", "Vintage", 0, 26, 30, 0.0, 127.0, 64.0, "");
-    
-    // Envelope 1 (Filter) parameters
-    addParameter(ENV1_ATTACK, "env1_attack", "Filter Env Attack", 0, 60, 30, 0.0, 255.0, 0.0, "");
-    addParameter(ENV1_DECAY, "env1_decay", "Filter Env Decay", 0, 62, 31, 0.0, 255.0, 64.0, "");
-    addParameter(ENV1_SUSTAIN, "env1_sustain", "Filter Env Sustain", 0, 64, 32, 0.0, 127.0, 100.0, "");
-    addParameter(ENV1_RELEASE, "env1_release", "Filter Env Release", 0, 66, 33, 0.0, 255.0, 64.0, "");
-    
-    // Envelope 2 (Volume) parameters
-    addParameter(ENV2_ATTACK, "env2_attack", "Volume Env Attack", 0, 61, 34, 0.0, 255.0, 0.0, "");
-    addParameter(ENV2_DECAY, "env2_decay", "Volume Env Decay", 0, 63, 35, 0.0, 255.0, 64.0, "");
-    addParameter(ENV2_SUSTAIN, "env2_sustain", "Volume Env Sustain", 0, 65, 36, 0.0, 127.0, 100.0, "");
-    addParameter(ENV2_RELEASE, "env2_release", "Volume Env Release", 0, 67, 37, 0.0, 255.0, 64.0, "");
-    
-    // LFO 1 parameters
-    addParameter(LFO1_RATE, "lfo1_rate", "LFO 1 Rate", 0, 29, 38, 0.0, 127.0, 32.0, "");
-    addParameter(LFO1_SHAPE, "lfo1_shape", "LFO 1 Shape", 0, 30, 39, 0.0, 5.0, 0.0, "", true,
-                {"Sine", "Saw Up", "Saw Down", "Triangle", "Square", "Sample & Hold"});
-    addParameter(LFO1_AMOUNT, "lfo1_amount", "LFO 1 Depth 1", 0, 31, 40, 0.0, 127.0, 0.0, "");
-    
-    // LFO 2 parameters
-    addParameter(LFO2_RATE, "lfo2_rate", "LFO 2 Rate", 0, 54, 41, 0.0, 127.0, 32.0, "");
-    addParameter(LFO2_SHAPE, "lfo2_shape", "LFO 2 Shape", 0, 55, 42, 0.0, 5.0, 0.0, "", true,
-                {"Triangle", "Square", "Saw Up", "S&H", "Saw Down", "Noise"});
-    addParameter(LFO2_AMOUNT, "lfo2_amount", "LFO 2 Depth", 0, 58, 43, 0.0, 127.0, 0.0, "");
-    
-    // Filter Modulation parameter (NRPN 59)
-    addParameter(FILTER_MODULATION, "filter_modulation", "Filter Modulation", 0, 59, 44, 0.0, 127.0, 0.0, "");
-    
-    // Master parameters
-    addParameter(MASTER_VOLUME, "master_volume", "Program Volume", 0, 73, 7, 0.0, 127.0, 100.0, "");
-    addParameter(MASTER_TUNE, "master_tune", "Master Tune", 1, 1, 44, -50.0, 50.0, 0.0, "cents");
-    
-    // Performance parameters
-    addParameter(PORTAMENTO_RATE, "portamento_rate", "Portamento Rate", 0, 14, 0, 0.0, 127.0, 0.0, "");
-    addParameter(PROGRAM_VOLUME, "program_volume", "Program Volume", 0, 73, 0, 0.0, 127.0, 100.0, "");
-    addParameter(UNISON, "unison", "Unison", 0, 74, 0, 0.0, 1.0, 0.0, "", true, {"Off", "On"});
-    addParameter(UNISON_VOICE_COUNT, "unison_voice_count", "Unison Voice Count", 0, 75, 0, 0.0, 7.0, 2.0, "", true, {"2", "3", "4", "5", "6", "7", "8"});
-    addParameter(ENVELOPE_TYPE, "envelope_type", "Envelope Type", 0, 96, 0, 0.0, 2.0, 0.0, "", true, {"ADSR", "Multi-Trigger", "Free-Run"});
+    // MIDI output route - plugin-side setting, never sent to the hardware
+    addParameter(MIDI_OUTPUT_ROUTE, "midi_output_route", "MIDI Output Route", 0, 0, 0, 0.0, 1.0, 0.0, "", true,
+                {"Direct to Device", "Host MIDI Out"});
+    
+    // MIDI clock output - plugin-side setting, never sent to the hardware
+    addParameter(MIDI_CLOCK_OUTPUT, "midi_clock_output", "MIDI Clock Output", 0, 0, 0, 0.0, 1.0, 0.0, "", true,
+                {"Off", "On"});
+    
+    // Parameter write encoding - plugin-side setting, never sent to the hardware.
+    // NRPN Only is for hardware set to ignore parameter CCs.
+    addParameter(MIDI_PARAMETER_ENCODING, "midi_parameter_encoding", "Parameter Encoding", 0, 0, 0, 0.0, 1.0, 0.0,
+                "", true, {"Smallest", "NRPN Only"});
+    
+    // Step sequencer - plugin-side settings. While a record step is chosen, edits
+    // to hardware parameters are also stored as that step's locks.
+    std::vector<std::string> step_numbers;
+    for (int step = 1; step <= 16; ++step) {
+        step_numbers.push_back(std::to_string(step));
+    }
+    std::vector<std::string> record_steps = {"Off"};
+    record_steps.insert(record_steps.end(), step_numbers.begin(), step_numbers.end());
+    addParameter(SEQUENCER_ENABLE, "sequencer_enable", "Step Sequencer", 0, 0, 0, 0.0, 1.0, 0.0, "", true,
+                {"Off", "On"}, "Sequencer");
+    addParameter(SEQUENCER_LENGTH, "sequencer_length", "Sequence Length", 0, 0, 0, 0.0, 15.0, 15.0, "", true,
+                step_numbers, "Sequencer");
+    addParameter(SEQUENCER_RECORD_STEP, "sequencer_record_step", "Lock Record Step", 0, 0, 0, 0.0, 16.0, 0.0, "",
+                true, record_steps, "Sequencer");
+    
+    // Hardware parameters come from the device profile
+    if (profile) {
+        profile_name_ = profile->name();
+        addProfileParameters(*profile);
+    }
     
     buildMaps();
 }
 
+std::vector<uint32_t> OBX8ParameterManager::reservedParameterIds() {
+    return {MIDI_DEVICE_SELECTION, MIDI_OUTPUT_ROUTE, MIDI_CLOCK_OUTPUT, MIDI_PARAMETER_ENCODING,
+            SEQUENCER_ENABLE, SEQUENCER_LENGTH, SEQUENCER_RECORD_STEP};
+}
+
+static std::shared_ptr<const DeviceProfile> loadSharedProfile() {
+    std::ofstream debug_file = openDebugLog();
+    std::vector<uint32_t> reserved_ids = OBX8ParameterManager::reservedParameterIds();
+    std::string cache_dir = DeviceProfile::defaultCacheDirectory();
+    std::string error;
+    std::unique_ptr<DeviceProfile> profile;
+    
+    const char* profile_path = std::getenv(DeviceProfile::PROFILE_ENV_VAR);
+    if (profile_path && *profile_path) {
+        std::ifstream file(profile_path, std::ios::binary);
+        if (file) {
+            std::stringstream text;
+            text << file.rdbuf();
+            profile = DeviceProfile::load(text.str(), reserved_ids, cache_dir, error);
+        } else {
+            error = "cannot read file";
+        }
+        if (!profile && debug_file.is_open()) {
+            debug_file << "Device profile " << profile_path << " rejected (" << error << "), using built-in profile" << std::endl;
+        }
+    }
+    
+    if (!profile) {
+        profile = DeviceProfile::load(DEFAULT_DEVICE_PROFILE, reserved_ids, cache_dir, error);
+        if (!profile && debug_file.is_open()) {
+            debug_file << "Built-in device profile rejected: " << error << std::endl;
+        }
+    }
+    
+    if (profile && debug_file.is_open()) {
+        debug_file << "Device profile '" << profile->name() << "': " << profile->parameterCount() << " parameters, "
+                   << (profile->wasCompiled() ? "compiled" : "mapped from cache") << std::endl;
+        for (const auto& warning : profile->getWarnings()) {
+            debug_file << "Device profile warning: " << warning << std::endl;
+        }
+    }
+    return std::shared_ptr<const DeviceProfile>(std::move(profile));
+}
+
+std::shared_ptr<const DeviceProfile> OBX8ParameterManager::sharedProfile() {
+    static std::shared_ptr<const DeviceProfile> profile = loadSharedProfile();
+    return profile;
+}
+
+void OBX8ParameterManager::addProfileParameters(const DeviceProfile& profile) {
+    for (size_t i = 0; i < profile.parameterCount(); ++i) {
+        const DeviceProfileRecord& record = profile.parameter(i);
+        
+        OBX8Parameter param;
+        param.id = record.id;
+        param.name = profile.string(record.name);
+        param.display_name = profile.string(record.display_name);
+        param.nrpn_msb = record.nrpn_msb;
+        param.nrpn_lsb = record.nrpn_lsb;
+        param.midi_cc = record.midi_cc;
+        param.min_value = record.min_value;
+        param.max_value = record.max_value;
+        param.default_value = record.default_value;
+        param.unit = profile.string(record.unit);
+        param.group = profile.string(record.group);
+        param.is_stepped = (record.flags & PROFILE_PARAM_STEPPED) != 0;
+        for (uint32_t step = 0; step < record.step_count; ++step) {
+            param.step_names.push_back(profile.stepName(record, step));
+        }
+        param.step_indexed = param.is_stepped && param.step_names.size() > 2;
+        param.supports_data_increment = (record.flags & PROFILE_PARAM_RELATIVE) != 0;
+        
+        parameters_.push_back(param);
+    }
+}
+
 void OBX8ParameterManager::addParameter(uint32_t id, const std::string& name, const std::string& display_name,
                                        uint16_t nrpn_msb, uint16_t nrpn_lsb, uint8_t midi_cc,
                                        double min_val, double max_val, double default_val,
                                        const std::string& unit, bool stepped,
-                                       const std::vector<std::string>& step_names) {
+                                       const std::vector<std::string>& step_names, const std::string& group) {
     OBX8Parameter param;
     param.id = id;
     param.name = name;
@@ -93,48 +145,137 @@ void OBX8ParameterManager::addParameter(uint32_t id, const std::string& name, co
     param.max_value = max_val;
     param.default_value = default_val;
     param.unit = unit;
+    param.group = group;
     param.is_stepped = stepped;
     param.step_names = step_names;
+    param.step_indexed = stepped && step_names.size() > 2;
+    // Continuous parameters accept data increment/decrement; switches and menus are always written absolutely
+    param.supports_data_increment = !stepped && (nrpn_msb != 0 || nrpn_lsb != 0);
     
     parameters_.push_back(param);
 }
 
 void OBX8ParameterManager::buildMaps() {
+    uint32_t max_id = 0;
     for (const auto& param : parameters_) {
-        id_map_[param.id] = &param;
+        max_id = std::max(max_id, param.id);
+    }
+    by_id_.assign(parameters_.empty() ? 0 : max_id + 1, nullptr);
+    by_nrpn_.clear();
+    by_cc_.fill(nullptr);
+    
+    // Later definitions win where a profile assigns an NRPN or CC twice
+    for (const auto& param : parameters_) {
+        by_id_[param.id] = &param;
         
-        uint32_t nrpn_key = (param.nrpn_msb << 16) | param.nrpn_lsb;
-        nrpn_map_[nrpn_key] = &param;
+        // Plugin-side parameters have no NRPN and must not shadow hardware NRPN 0
+        if (param.nrpn_msb != 0 || param.nrpn_lsb != 0) {
+            uint32_t nrpn_key = (param.nrpn_msb << 16) | param.nrpn_lsb;
+            by_nrpn_[nrpn_key] = &param;
+        }
         
-        if (param.midi_cc != 0) {
-            cc_map_[param.midi_cc] = &param;
+        if (param.midi_cc != 0 && param.midi_cc < by_cc_.size()) {
+            by_cc_[param.midi_cc] = &param;
+        }
+    }
+    
+    // Writes go out as CC only where the CC reaches this parameter and nothing else
+    std::array<int, 128> cc_users = {};
+    for (const auto& param : parameters_) {
+        if (param.midi_cc != 0 && param.midi_cc < cc_users.size()) {
+            ++cc_users[param.midi_cc];
+        }
+    }
+    exact_cc_.assign(by_id_.size(), 0);
+    for (const auto& param : parameters_) {
+        uint8_t cc = param.midi_cc;
+        bool hardware = param.nrpn_msb != 0 || param.nrpn_lsb != 0;
+        if (hardware && cc != 0 && cc < CC_CHANNEL_MODE_FIRST && cc_users[cc] == 1 &&
+            !DeviceProfile::isReservedController(cc) && isCCValueExact(&param)) {
+            exact_cc_[param.id] = cc;
         }
     }
 }
 
 const OBX8Parameter* OBX8ParameterManager::getParameterById(uint32_t id) const {
-    auto it = id_map_.find(id);
-    return (it != id_map_.end()) ? it->second : nullptr;
+    return id < by_id_.size() ? by_id_[id] : nullptr;
 }
 
 const OBX8Parameter* OBX8ParameterManager::getParameterByNRPN(uint16_t msb, uint16_t lsb) const {
     uint32_t nrpn_key = (msb << 16) | lsb;
-    auto it = nrpn_map_.find(nrpn_key);
-    return (it != nrpn_map_.end()) ? it->second : nullptr;
+    auto it = by_nrpn_.find(nrpn_key);
+    return (it != by_nrpn_.end()) ? it->second : nullptr;
 }
 
 const OBX8Parameter* OBX8ParameterManager::getParameterByCC(uint8_t cc) const {
-    auto it = cc_map_.find(cc);
-    return (it != cc_map_.end()) ? it->second : nullptr;
+    return cc < by_cc_.size() ? by_cc_[cc] : nullptr;
 }
 
-void OBX8ParameterManager::updateParameterStepNames(uint32_t id, const std::vector<std::string>& step_names) {
+bool OBX8ParameterManager::updateParameterStepNames(uint32_t id, const std::vector<std::string>& step_names) {
     for (auto& param : parameters_) {
         if (param.id == id) {
+            if (param.step_names == step_names) {
+                return false;
+            }
             param.step_names = step_names;
-            // Ensure max_value is at least 1 to avoid division by zero
-            param.max_value = static_cast<double>(std::max(1, static_cast<int>(step_names.size()) - 1));
-            break;
+            return true;
         }
     }
+    return false;
+}
+
+double OBX8ParameterManager::normalizeParameterValue(const OBX8Parameter* param, double value) {
+    // For stepped parameters with multiple steps, normalize differently for DAW compatibility
+    if (param->step_indexed) {
+        // Return the step index directly (0, 1, 2, 3, etc.)
+        return value;
+    }
+    return (value - param->min_value) / (param->max_value - param->min_value);
+}
+
+double OBX8ParameterManager::denormalizeParameterValue(const OBX8Parameter* param, double normalized) {
+    // For stepped parameters with multiple steps, the value is already the step index
+    if (param->step_indexed) {
+        return normalized;
+    }
+    return param->min_value + normalized * (param->max_value - param->min_value);
+}
+
+int OBX8ParameterManager::parameterToHardwareValue(const OBX8Parameter* param, double value) {
+    double actual_value = denormalizeParameterValue(param, value);
+    
+    // Hardware only has integer steps; round so values read back from the hardware
+    // survive the normalize/denormalize round trip
+    actual_value = std::round(actual_value);
+    
+    // Clamp to valid range
+    actual_value = std::max(param->min_value, std::min(param->max_value, actual_value));
+    return static_cast<int>(actual_value);
+}
+
+uint16_t OBX8ParameterManager::parameterToNRPNValue(const OBX8Parameter* param, double value) {
+    // Use the actual parameter range from the OBX8 manual, not 14-bit range,
+    // counted from the bottom of the range (Master Tune goes below zero)
+    return static_cast<uint16_t>(parameterToHardwareValue(param, value) - static_cast<int>(param->min_value));
+}
+
+double OBX8ParameterManager::nrpnToParameterValue(const OBX8Parameter* param, uint16_t nrpn_value) {
+    // Convert from hardware value directly to parameter value
+    double actual_value = param->min_value + static_cast<double>(nrpn_value);
+    
+    // Clamp to parameter range
+    actual_value = std::max(param->min_value, std::min(param->max_value, actual_value));
+    
+    return normalizeParameterValue(param, actual_value);
+}
+
+uint16_t OBX8ParameterManager::nrpnValueRange(const OBX8Parameter* param) {
+    return static_cast<uint16_t>(param->max_value - param->min_value);
+}
+
+int OBX8ParameterManager::ccToHardwareValue(const OBX8Parameter* param, uint8_t cc_value) {
+    int range = nrpnValueRange(param);
+    int offset = range <= 127 ? std::min<int>(cc_value, range)
+                              : static_cast<int>(std::lround(cc_value * range / 127.0));
+    return static_cast<int>(param->min_value) + offset;
 }
\ No newline at end of file
@@ -1,7 +1,10 @@
 #pragma once
+#include "device_profile.h"
+#include <array>
+#include <memory>
 #include <string>
+#include <unordered_map>
 #include <vector>
-#include <map>
 
 struct OBX8Parameter {
     uint32_t id;
@@ -14,13 +17,27 @@ struct OBX8Parameter {
     double max_value;
     double default_value;
     std::string unit;
+    std::string group;            // profile section, shown as the parameter's module
     bool is_stepped;
     std::vector<std::string> step_names;
+    bool step_indexed;            // the normalized value is the step index; fixed when added
+    bool supports_data_increment; // hardware applies CC96/CC97 to this NRPN
 };
 
 class OBX8ParameterManager {
 public:
+    // Plugin-side settings plus the hardware parameters of the shared profile
     OBX8ParameterManager();
+    explicit OBX8ParameterManager(const DeviceProfile* profile);
+    
+    // Process-wide profile, loaded on first use: the file named by $SPOBX8_PROFILE
+    // when it validates, else the built-in one. Null only if neither loads.
+    static std::shared_ptr<const DeviceProfile> sharedProfile();
+    
+    // IDs of the plugin-side settings, which profiles must leave free
+    static std::vector<uint32_t> reservedParameterIds();
+    
+    const std::string& getProfileName() const { return profile_name_; }
     
     const std::vector<OBX8Parameter>& getParameters() const { return parameters_; }
     const OBX8Parameter* getParameterById(uint32_t id) const;
@@ -29,24 +46,54 @@ public:
     
     uint32_t getParameterCount() const { return parameters_.size(); }
     
-    void updateParameterStepNames(uint32_t id, const std::vector<std::string>& step_names);
-    
+    // Main thread. Replaces the names only: the range and step_indexed stay as
+    // added, because the audio thread converts values with them. Returns false
+    // when the names are unchanged.
+    bool updateParameterStepNames(uint32_t id, const std::vector<std::string>& step_names);
+    
+    // Conversions between the host's normalized values, hardware units and MIDI data.
+    // NRPN data is the hardware value's offset from the bottom of its range, so
+    // ranges below zero stay unsigned on the wire. CC data is the same offset for
+    // ranges that fit in 7 bits, and the range scaled onto 0-127 for wider ones.
+    static double normalizeParameterValue(const OBX8Parameter* param, double value);
+    static double denormalizeParameterValue(const OBX8Parameter* param, double normalized);
+    static int parameterToHardwareValue(const OBX8Parameter* param, double value);
+    static uint16_t parameterToNRPNValue(const OBX8Parameter* param, double value);
+    static double nrpnToParameterValue(const OBX8Parameter* param, uint16_t nrpn_value);
+    static uint16_t nrpnValueRange(const OBX8Parameter* param);
+    static int ccToHardwareValue(const OBX8Parameter* param, uint8_t cc_value);
+    static bool isCCValueExact(const OBX8Parameter* param) { return nrpnValueRange(param) <= 127; }
+    
+    // The CC that can carry every value of a hardware parameter exactly, as its
+    // NRPN data, and addresses nothing else: 0 when the parameter has no CC, its
+    // range needs more than 7 bits, or the CC is shared, reserved by the MIDI
+    // layer or a channel mode message
+    uint8_t getExactCC(uint32_t id) const { return id < exact_cc_.size() ? exact_cc_[id] : 0; }
+
 private:
     std::vector<OBX8Parameter> parameters_;
-    std::map<uint32_t, const OBX8Parameter*> id_map_;
-    std::map<uint32_t, const OBX8Parameter*> nrpn_map_;
-    std::map<uint8_t, const OBX8Parameter*> cc_map_;
+    std::string profile_name_;
+    
+    // Lookups over parameters_: IDs are dense, CCs fit an array, NRPNs are sparse
+    std::vector<const OBX8Parameter*> by_id_;
+    std::unordered_map<uint32_t, const OBX8Parameter*> by_nrpn_;
+    std::array<const OBX8Parameter*, 128> by_cc_;
+    std::vector<uint8_t> exact_cc_;
+    static const uint8_t CC_CHANNEL_MODE_FIRST = 120;  // 120-127 are channel mode messages
     
     void addParameter(uint32_t id, const std::string& name, const std::string& display_name,
                      uint16_t nrpn_msb, uint16_t nrpn_lsb, uint8_t midi_cc,
                      double min_val, double max_val, double default_val,
                      const std::string& unit = "", bool stepped = false,
-                     const std::vector<std::string>& step_names = {});
+                     const std::vector<std::string>& step_names = {}, const std::string& group = "MIDI");
+    void addProfileParameters(const DeviceProfile& profile);
     
     void buildMaps();
 };
 
-// Common OBX8 parameter IDs
+// Parameter IDs of the built-in profile (profiles/obx8.profile) and the
+// plugin-side settings. A profile may define further parameters, numbered from
+// PARAM_COUNT; code only names the ones it treats specially.
 enum OBX8ParamID {
     // Oscillator 1
     OSC1_FREQUENCY = 0,
@@ -105,5 +152,20 @@ enum OBX8ParamID {
     // MIDI Device Selection
     MIDI_DEVICE_SELECTION,
     
+    // MIDI output route (direct to device or through the host's note port)
+    MIDI_OUTPUT_ROUTE,
+    
+    // MIDI clock and transport output following the host timeline
+    MIDI_CLOCK_OUTPUT,
+    
+    // How parameter writes are encoded (smallest exact message or always NRPN)
+    MIDI_PARAMETER_ENCODING,
+    
+    // Parameter-lock step sequencer: on/off, pattern length, and the step that
+    // edits are recorded to as locks
+    SEQUENCER_ENABLE,
+    SEQUENCER_LENGTH,
+    SEQUENCER_RECORD_STEP,
+    
     PARAM_COUNT
 };
\ No newline at end of file
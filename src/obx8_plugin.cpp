@@ -1,5 +1,9 @@
 #include "obx8_plugin.h"
+#include "program_dump.h"
+#include "debug_log.h"
+#include "trace.h"
 #include <cstring>
+#include <cstdlib>
 #include <cmath>
 #include <algorithm>
 #include <iostream>
@@ -30,15 +34,86 @@ OBX8Plugin::OBX8Plugin(const clap_host_t *host)
     , midi_handler_(std::make_unique<MidiHandler>())
     , midi_device_manager_(std::make_unique<MidiDeviceManager>())
     , sample_rate_(44100.0)
+    , min_frames_(0)
+    , max_frames_(0)
     , is_active_(false)
     , is_processing_(false)
+    , process_sleeping_(false)
+    , midi_init_started_(false)
+    , midi_ready_(false)
+    , main_thread_queue_(param_manager_->getParameterCount(), MidiStreamParser::DEFAULT_MAX_SYSEX_LENGTH)
+    , block_message_count_(0)
+    , current_block_frames_(0)
+    , block_time_ns_(0)
+    , render_offline_(false)
+    , render_time_ns_(0)
+    , rendered_frames_(0)
+    , inbound_time_ns_(0)
+    , inbound_from_hardware_(false)
+    , device_arrival_ns_(0)
+    , gesture_recorder_(param_manager_->getParameterCount(), EventRouter::MAX_HARDWARE_PER_BLOCK)
+    , gesture_events_(nullptr)
+    , gesture_event_count_(0)
+    , gesture_event_index_(0)
+    , window_start_ns_(0)
+    , step_sequencer_(param_manager_->getParameterCount())
+    , lock_on_hardware_(new bool[param_manager_->getParameterCount()]())
+    , sequencer_encoding_(-1.0)
+    , reported_undeliverable_steps_(0)
+    , output_timeline_ns_(0.0)
+    , current_program_key_(-1)
+    , program_awaiting_dump_(false)
+    , prefetch_key_(-1)
+    , prefetch_outstanding_key_(-1)
+    , prefetch_timeouts_(0)
+    , prefetch_enabled_(false)
+    , prefetch_sent_ms_(0)
+    , last_live_edit_ms_(0)
+    , reported_latency_samples_(0)
+    , latency_restart_requested_(false)
+    , next_probe_param_index_(0)
     , gui_created_(false)
     , gui_scale_(1.0)
     , gui_width_(800)
     , gui_height_(600)
+    , editor_window_(nullptr)
     , suppress_feedback_(false) {
     
     initializeParameters();
+    sequencer_written_.reserve(param_manager_->getParameterCount());
+    
+    // Typed handlers for the per-block event stream
+    EventRouter::Handlers handlers;
+    handlers.param_value = [this](const clap_event_param_value_t& event) {
+        handleParameterChange(event.param_id, event.value, event.header.time);
+    };
+    handlers.param_mod = [this](const clap_event_param_mod_t& event) {
+        handleParameterMod(event);
+    };
+    handlers.host_midi = [this](uint32_t time, const MidiMessage& msg) {
+        handleHostMidi(time, msg);
+    };
+    handlers.hardware_midi = [this](uint32_t time, const MidiMessage& msg, uint64_t arrival_ns) {
+        handleHardwareMidi(msg, arrival_ns);
+    };
+    handlers.internal_midi = [this](uint32_t time, const MidiMessage& msg) {
+        // MIDI clock and transport
+        if (output_merger_.pushPriority(time, UmpCodec::fromMidi1(msg.status, msg.data1, msg.data2))) {
+            metrics_.add(METRIC_CLOCK_MESSAGES);
+        } else {
+            metrics_.add(METRIC_SEND_FAILURES);
+        }
+    };
+    event_router_.setHandlers(handlers);
+    
+    main_thread_queue_.setCallbackRequester([this]() {
+        metrics_.add(METRIC_HOST_CALLBACK_REQUESTS);
+        if (host_ && host_->request_callback) {
+            host_->request_callback(host_);
+        }
+    });
+    
+    midi_handler_->setMetrics(&metrics_);
     
     // Set up MIDI callbacks
     midi_handler_->setNRPNCallback([this](uint16_t parameter, uint16_t value) {
@@ -49,22 +124,44 @@ OBX8Plugin::OBX8Plugin(const clap_host_t *host)
         onCCReceived(cc, value);
     });
     
+    midi_handler_->setNRPNIncrementCallback([this](uint16_t parameter, int steps) {
+        onNRPNIncrementReceived(parameter, steps);
+    });
+    
+    midi_handler_->setProgramChangeCallback([this](uint16_t bank, uint8_t program) {
+        onProgramChange(bank, program);
+    });
+    
+    // Device packets can carry several messages or part of a SysEx
+    stream_parser_.setMetrics(&metrics_);
+    stream_parser_.setMessageCallback([this](const MidiMessage& msg) {
+        onHardwareMessage(msg);
+    });
+    stream_parser_.setSysExCallback([this](const uint8_t* data, size_t length) {
+        onSysExReceived(data, length);
+    });
+    
     // Set up MIDI device callback
-    midi_device_manager_->setMidiReceiveCallback([this](const uint8_t* data, size_t length) {
-        if (length >= 3) {
-            MidiMessage msg;
-            msg.status = data[0];
-            msg.data1 = data[1];
-            msg.data2 = data[2];
-            msg.timestamp = 0;
-            midi_handler_->processMidiMessage(msg);
-        }
+    midi_device_manager_->setMidiReceiveCallback([this](const uint8_t* data, size_t length, uint64_t arrival_ns) {
+        receiveMidiData(data, length, arrival_ns);
     });
     
-    updateMidiDeviceList();
+    if (const char* capture_path = std::getenv(MidiCapture::ENV_VAR)) {
+        startCapture(capture_path);
+    }
+    if (std::getenv(Tracer::ENV_VAR)) {
+        Tracer::start();
+    }
+    
+    // MIDI transport and device selection are deferred until activate() so that
+    // host plugin scans only pay for in-memory setup
 }
 
 OBX8Plugin::~OBX8Plugin() {
+    joinMidiInitialization();
+    // The device's delivery thread calls into members declared after it, which
+    // would otherwise be destroyed first
+    midi_device_manager_.reset();
 }
 
 bool OBX8Plugin::init() {
@@ -72,26 +169,60 @@ bool OBX8Plugin::init() {
 }
 
 void OBX8Plugin::destroy() {
-    // GUI cleanup would go here if implemented
+    gui_destroy();
+    joinMidiInitialization();
 }
 
 bool OBX8Plugin::activate(double sample_rate, uint32_t min_frames, uint32_t max_frames) {
     sample_rate_ = sample_rate;
+    min_frames_ = min_frames;
+    max_frames_ = max_frames;
     is_active_ = true;
+    output_merger_.setSamplesPerByte(MidiOutputMerger::DIN_SECONDS_PER_BYTE * sample_rate_);
+    outgoing_scratch_.reserve(MidiOutputMerger::MAX_UNITS);
+    midi_clock_.reset();
+    step_sequencer_.reset();
+    output_timeline_ns_ = 0.0;
+    render_pacer_.reset();
+    rendered_frames_ = 0;
+    captureSession();
+    
+    // Hosts only re-query latency across activation, so latch the current estimate
+    reported_latency_samples_ = static_cast<uint32_t>(getOutputLookaheadMs() * sample_rate_ / 1000.0);
+    latency_restart_requested_ = false;
+    
+    startMidiInitialization();
     return true;
 }
 
 void OBX8Plugin::deactivate() {
     is_active_ = false;
+    
+    std::ofstream debug_file = openDebugLog();
+    debug_file << "=== metrics at deactivate ===" << std::endl;
+    metrics_.snapshot().writeText(debug_file);
+    debug_file.close();
+    
+    if (const char* trace_path = std::getenv(Tracer::ENV_VAR)) {
+        Tracer::exportChromeJson(trace_path);
+    }
 }
 
 bool OBX8Plugin::start_processing() {
-    is_processing_ = true;
+    is_processing_.store(true, std::memory_order_release);
     return true;
 }
 
 void OBX8Plugin::stop_processing() {
-    is_processing_ = false;
+    is_processing_.store(false, std::memory_order_release);
+    
+    // Input queued for a block that won't come
+    event_router_.flushHardware();
+    
+    // Gestures can't be closed without a block to send the end in
+    gesture_recorder_.endAllGestures();
+    gesture_recorder_.takeEvents(gesture_event_count_);
+    gesture_event_count_ = 0;
 }
 
 void OBX8Plugin::reset() {
@@ -99,17 +230,80 @@ void OBX8Plugin::reset() {
 }
 
 clap_process_status OBX8Plugin::process(const clap_process_t *process) {
-    // Process incoming MIDI events
-    processIncomingMidi(process->in_events);
+    // Nothing arrived and nothing is due: skip the block and let the host stop
+    // calling until it has events for us or wakeProcessing() asks it to resume
+    uint32_t event_count = process->in_events ? process->in_events->size(process->in_events) : 0;
+    if (event_count == 0 && process->audio_outputs_count == 0 && enterIdle()) {
+        metrics_.add(METRIC_IDLE_BLOCKS);
+        return CLAP_PROCESS_SLEEP;
+    }
+    
+    SPOBX8_TRACE_THREAD_NAME("audio");
+    SPOBX8_TRACE_SCOPE("audio", "process", process->frames_count);
+    auto process_start = std::chrono::steady_clock::now();
+    block_message_count_ = 0;
+    current_block_frames_ = process->frames_count;
+    block_time_ns_ = getCurrentTimeNs();
+    updateOutputTimeline();
+    
+    // Faster than real time the song position stands in for the clock, so an
+    // export throttles the same way every time
+    render_offline_ = render_pacer_.onBlock(block_time_ns_, process->frames_count, sample_rate_);
+    int64_t block_frame = process->steady_time >= 0 ? process->steady_time : rendered_frames_;
+    render_time_ns_ = static_cast<uint64_t>(block_frame * 1e9 / sample_rate_);
+    rendered_frames_ = block_frame + process->frames_count;
+    if (render_offline_) {
+        metrics_.add(METRIC_OFFLINE_BLOCKS);
+    }
+    
+    metrics_.add(METRIC_PROCESS_CALLS);
+    if (process->in_events) {
+        metrics_.add(METRIC_HOST_EVENTS, event_count);
+        metrics_.record(METRIC_EVENTS_PER_BLOCK, event_count);
+    }
+    
+    if (capture_.isActive()) {
+        uint32_t captured = captureInputEvents(process->in_events);
+        CaptureBlock block = {process->frames_count, captured, process->steady_time};
+        capture_.record(CAPTURE_BLOCK, block_time_ns_, &block, sizeof(block));
+    }
+    
+    // Edits from the editor go first, like host events at the block start
+    if (!editor_edits_.empty()) {
+        applyEditorEdits(process->out_events);
+    }
+    
+    // Host events, MIDI clock and hardware input in one pass, in sample order
+    size_t clock_count = runMidiClock(process->transport, process->in_events, process->frames_count);
+    uint64_t block_duration_ns = static_cast<uint64_t>(process->frames_count * 1e9 / sample_rate_);
+    window_start_ns_ = block_time_ns_ > block_duration_ns ? block_time_ns_ - block_duration_ns : 0;
+    event_router_.route(process->in_events, process->frames_count, window_start_ns_, block_time_ns_,
+                        clock_messages_, clock_count);
     
-    // Process parameter automation (including Bitwig LFOs)
-    if (process->in_events && process->out_events) {
-        params_flush(process->in_events, process->out_events);
+    // A data MSB from the hardware whose LSB never came
+    if (midi_handler_->hasPendingDataEntry()) {
+        midi_handler_->completeDataEntry(block_time_ns_);
     }
     
-    // Process outgoing MIDI events
+    // Automation points recorded from the hardware go out with the MIDI below
+    if (gesture_recorder_.hasActiveGestures()) {
+        gesture_recorder_.endIdleGestures(block_time_ns_);
+    }
+    gesture_events_ = gesture_recorder_.takeEvents(gesture_event_count_);
+    gesture_event_index_ = 0;
+    
+    // Step sequencer writes for steps starting within the lookahead
+    runStepSequencer(process->transport, process->frames_count);
+    
+    // Everything the block produced goes out once, merged by time
     processOutgoingMidi(process->out_events);
     
+    // Measure round-trip latency while the link is otherwise idle
+    runLatencyProbe();
+    
+    // Request the next uncached program dump, also only on an idle link
+    runProgramPrefetch();
+    
     // This is a hardware editor, so we don't process audio
     // Just copy input to output if audio ports are connected
     if (process->audio_inputs_count > 0 && process->audio_outputs_count > 0) {
@@ -122,6 +316,13 @@ clap_process_status OBX8Plugin::process(const clap_process_t *process) {
         }
     }
     
+    output_timeline_ns_ += process->frames_count * 1e9 / sample_rate_;
+    current_block_frames_ = 0;
+    block_time_ns_ = 0;
+    metrics_.record(METRIC_MESSAGES_PER_BLOCK, block_message_count_);
+    metrics_.record(METRIC_PROCESS_DURATION_NS, std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - process_start).count());
+    
     return CLAP_PROCESS_CONTINUE;
 }
 
@@ -174,30 +375,605 @@ const void* OBX8Plugin::get_extension(const char *id) {
         return &state_ext;
     }
     
+    if (strcmp(id, CLAP_EXT_LATENCY) == 0) {
+        static const clap_plugin_latency_t latency_ext = {
+            .get = [](const clap_plugin_t *plugin) -> uint32_t {
+                return static_cast<const OBX8Plugin*>(plugin->plugin_data)->latency_get();
+            }
+        };
+        return &latency_ext;
+    }
+    
+    if (strcmp(id, CLAP_EXT_GUI) == 0) {
+        static const clap_plugin_gui_t gui_ext = {
+            .is_api_supported = [](const clap_plugin_t *plugin, const char *api, bool is_floating) -> bool {
+                return static_cast<OBX8Plugin*>(plugin->plugin_data)->gui_is_api_supported(api, is_floating);
+            },
+            .get_preferred_api = [](const clap_plugin_t *plugin, const char **api, bool *is_floating) -> bool {
+                return static_cast<OBX8Plugin*>(plugin->plugin_data)->gui_get_preferred_api(api, is_floating);
+            },
+            .create = [](const clap_plugin_t *plugin, const char *api, bool is_floating) -> bool {
+                return static_cast<OBX8Plugin*>(plugin->plugin_data)->gui_create(api, is_floating);
+            },
+            .destroy = [](const clap_plugin_t *plugin) {
+                static_cast<OBX8Plugin*>(plugin->plugin_data)->gui_destroy();
+            },
+            .set_scale = [](const clap_plugin_t *plugin, double scale) -> bool {
+                return static_cast<OBX8Plugin*>(plugin->plugin_data)->gui_set_scale(scale);
+            },
+            .get_size = [](const clap_plugin_t *plugin, uint32_t *width, uint32_t *height) -> bool {
+                return static_cast<OBX8Plugin*>(plugin->plugin_data)->gui_get_size(width, height);
+            },
+            .can_resize = [](const clap_plugin_t *plugin) -> bool {
+                return static_cast<OBX8Plugin*>(plugin->plugin_data)->gui_can_resize();
+            },
+            .get_resize_hints = [](const clap_plugin_t *plugin, clap_gui_resize_hints_t *hints) -> bool {
+                return static_cast<OBX8Plugin*>(plugin->plugin_data)->gui_get_resize_hints(hints);
+            },
+            .adjust_size = [](const clap_plugin_t *plugin, uint32_t *width, uint32_t *height) -> bool {
+                return static_cast<OBX8Plugin*>(plugin->plugin_data)->gui_adjust_size(width, height);
+            },
+            .set_size = [](const clap_plugin_t *plugin, uint32_t width, uint32_t height) -> bool {
+                return static_cast<OBX8Plugin*>(plugin->plugin_data)->gui_set_size(width, height);
+            },
+            .set_parent = [](const clap_plugin_t *plugin, const clap_window_t *window) -> bool {
+                return static_cast<OBX8Plugin*>(plugin->plugin_data)->gui_set_parent(window);
+            },
+            .set_transient = [](const clap_plugin_t *plugin, const clap_window_t *window) -> bool {
+                return static_cast<OBX8Plugin*>(plugin->plugin_data)->gui_set_transient(window);
+            },
+            .suggest_title = [](const clap_plugin_t *plugin, const char *title) {
+                static_cast<OBX8Plugin*>(plugin->plugin_data)->gui_suggest_title(title);
+            },
+            .show = [](const clap_plugin_t *plugin) -> bool {
+                return static_cast<OBX8Plugin*>(plugin->plugin_data)->gui_show();
+            },
+            .hide = [](const clap_plugin_t *plugin) -> bool {
+                return static_cast<OBX8Plugin*>(plugin->plugin_data)->gui_hide();
+            }
+        };
+        return &gui_ext;
+    }
+    
+    if (strcmp(id, CLAP_EXT_RENDER) == 0) {
+        static const clap_plugin_render_t render_ext = {
+            .has_hard_realtime_requirement = [](const clap_plugin_t *plugin) -> bool {
+                return static_cast<const OBX8Plugin*>(plugin->plugin_data)->render_has_hard_realtime_requirement();
+            },
+            .set = [](const clap_plugin_t *plugin, clap_plugin_render_mode mode) -> bool {
+                return static_cast<OBX8Plugin*>(plugin->plugin_data)->render_set(mode);
+            }
+        };
+        return &render_ext;
+    }
+    
     return nullptr;
 }
 
 void OBX8Plugin::on_main_thread() {
-    // Handle main thread callbacks
+    SPOBX8_TRACE_THREAD_NAME("main");
+    SPOBX8_TRACE_SCOPE("main", "on_main_thread", 0);
+    if (capture_.isActive()) {
+        capture_.record(CAPTURE_MAIN_THREAD, getCurrentTimeNs(), nullptr, 0);
+    }
+    
+    // MIDI setup starts on the first callback when activate() hasn't started it
+    if (!midi_ready_ && !midi_init_started_.load(std::memory_order_acquire)) {
+        startMidiInitialization();
+    }
+    
+    main_thread_queue_.drain([this](const MainThreadTask& task) {
+        runMainThreadTask(task);
+    });
+    
+    // A task may have left work for the audio thread (a prefetch request, a newly connected device)
+    wakeProcessing();
 }
 
-void OBX8Plugin::initializeParameters() {
-    param_values_.resize(param_manager_->getParameterCount());
+void OBX8Plugin::runMainThreadTask(const MainThreadTask& task) {
+    switch (task.type) {
+        case MAIN_TASK_FINISH_MIDI_INIT:
+            if (!midi_ready_) {
+                finishMidiInitialization();
+            }
+            break;
+        case MAIN_TASK_SELECT_DEVICE:
+            onMidiDeviceSelected(MIDI_DEVICE_SELECTION, getNormalizedValue(MIDI_DEVICE_SELECTION));
+            break;
+        case MAIN_TASK_DECODE_PROGRAM_DUMP:
+            decodeProgramDump(task.data, task.length);
+            break;
+        case MAIN_TASK_APPLY_PROGRAM:
+            applyCachedProgram();
+            main_thread_queue_.post(MAIN_TASK_UPDATE_PREFETCH);
+            break;
+        case MAIN_TASK_PARAMS_CHANGED:
+            // However many changes arrived since the last callback, the host rescans once
+            main_thread_queue_.takeChangedParameters(changed_param_ids_);
+            if (!changed_param_ids_.empty()) {
+                rescanHostParams(CLAP_PARAM_RESCAN_VALUES);
+            }
+            break;
+        case MAIN_TASK_UPDATE_PREFETCH:
+            updateProgramPrefetch();
+            break;
+        case MAIN_TASK_SEQUENCER_WARNING:
+            warnUndeliverableSteps();
+            break;
+        case MAIN_TASK_LATENCY_CHANGED:
+            checkReportedLatency();
+            break;
+        case MAIN_TASK_DATA_ENTRY_TIMEOUT:
+            completeIdleDataEntry();
+            break;
+        default:
+            break;
+    }
+}
+
+void OBX8Plugin::notifyParameterChanged(clap_id param_id) {
+    if (!main_thread_queue_.markParameterChanged(param_id)) {
+        metrics_.add(METRIC_PARAM_NOTIFICATIONS_COALESCED);
+    }
+}
+
+void OBX8Plugin::startMidiInitialization() {
+    if (midi_init_started_.exchange(true)) {
+        return;
+    }
+    
+    // Opening CoreMIDI and enumerating devices can take a long time with many
+    // interfaces attached, so keep it off the host's main thread
+    midi_init_thread_ = std::thread([this]() {
+        midi_device_manager_->open();
+        main_thread_queue_.post(MAIN_TASK_FINISH_MIDI_INIT);
+    });
+}
+
+void OBX8Plugin::finishMidiInitialization() {
+    joinMidiInitialization();
+    midi_ready_ = true;
+    
+    updateMidiDeviceList();
+    
+    // A device restored from saved state wins over auto-detection
+    if (!pending_device_name_.empty()) {
+        selectMidiDevice(pending_device_name_);
+        pending_device_name_.clear();
+    } else {
+        autoSelectFirstOBX8Device();
+    }
+}
+
+uint32_t OBX8Plugin::latency_get() const {
+    return reported_latency_samples_;
+}
+
+bool OBX8Plugin::gui_is_api_supported(const char *api, bool is_floating) {
+    if (!api || is_floating) {
+        return false;
+    }
+    if (strcmp(api, EditorView::HEADLESS_API) == 0) {
+        return true;
+    }
+#ifdef __APPLE__
+    return strcmp(api, CLAP_WINDOW_API_COCOA) == 0;
+#else
+    return false;
+#endif
+}
+
+bool OBX8Plugin::gui_get_preferred_api(const char **api, bool *is_floating) {
+#ifdef __APPLE__
+    *api = CLAP_WINDOW_API_COCOA;
+    *is_floating = false;
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool OBX8Plugin::gui_create(const char *api, bool is_floating) {
+    if (gui_created_ || !gui_is_api_supported(api, is_floating)) {
+        return false;
+    }
+    
+    editor_view_.reset(new EditorView(*param_manager_, *param_store_, display_table_, editor_edits_));
+    editor_view_->setEditListener([this]() {
+        onEditorEdit();
+    });
+    gui_width_ = static_cast<uint32_t>(editor_view_->width());
+    gui_height_ = static_cast<uint32_t>(editor_view_->height());
+    gui_created_ = true;
+    return true;
+}
+
+void OBX8Plugin::gui_destroy() {
+#ifdef __APPLE__
+    destroyEditorWindow(editor_window_);
+#endif
+    editor_window_ = nullptr;
+    editor_view_.reset();
+    gui_created_ = false;
+}
+
+bool OBX8Plugin::gui_set_scale(double scale) {
+    // The canvas has a fixed pixel size; the native view scales it with the window
+    gui_scale_ = scale;
+    return false;
+}
+
+bool OBX8Plugin::gui_get_size(uint32_t *width, uint32_t *height) {
+    if (!gui_created_) {
+        return false;
+    }
+    *width = gui_width_;
+    *height = gui_height_;
+    return true;
+}
+
+bool OBX8Plugin::gui_can_resize() {
+    return false;
+}
+
+bool OBX8Plugin::gui_get_resize_hints(clap_gui_resize_hints_t *hints) {
+    return false;
+}
+
+bool OBX8Plugin::gui_adjust_size(uint32_t *width, uint32_t *height) {
+    return gui_get_size(width, height);
+}
+
+bool OBX8Plugin::gui_set_size(uint32_t width, uint32_t height) {
+    return gui_created_ && width == gui_width_ && height == gui_height_;
+}
+
+bool OBX8Plugin::gui_set_parent(const clap_window_t *window) {
+#ifdef __APPLE__
+    if (editor_view_ && !editor_window_) {
+        editor_window_ = createEditorWindow(*editor_view_, window);
+    }
+    return editor_window_ != nullptr;
+#else
+    return false;
+#endif
+}
+
+bool OBX8Plugin::gui_set_transient(const clap_window_t *window) {
+    return false;
+}
+
+void OBX8Plugin::gui_suggest_title(const char *title) {
+}
+
+bool OBX8Plugin::gui_show() {
+    if (!editor_view_) {
+        return false;
+    }
+    editor_view_->invalidate();
+#ifdef __APPLE__
+    setEditorWindowVisible(editor_window_, true);
+#endif
+    return true;
+}
+
+bool OBX8Plugin::gui_hide() {
+    if (!editor_view_) {
+        return false;
+    }
+#ifdef __APPLE__
+    setEditorWindowVisible(editor_window_, false);
+#endif
+    return true;
+}
+
+bool OBX8Plugin::render_set(clap_plugin_render_mode mode) {
+    // Hosts that honour the realtime requirement never ask for offline; a bounce
+    // that happens anyway is paced to the wire. Once the host has named a mode,
+    // freewheel detection from the wall clock stays off.
+    render_pacer_.setRenderMode(mode == CLAP_RENDER_OFFLINE ? RenderPacer::RENDER_MODE_OFFLINE
+                                                            : RenderPacer::RENDER_MODE_REALTIME);
+    captureRenderMode();
+    return true;
+}
+
+void OBX8Plugin::setLatencyProbeEnabled(bool enabled) {
+    latency_probe_.setEnabled(enabled);
+    main_thread_queue_.post(MAIN_TASK_LATENCY_CHANGED);
+    wakeProcessing();
+}
+
+double OBX8Plugin::getOutputLookaheadMs() const {
+    return latency_probe_.isEnabled() ? latency_probe_.getRecommendedLookaheadMs() : 0.0;
+}
+
+void OBX8Plugin::checkReportedLatency() {
+    // A restart interrupts the host's audio, so the estimate has to move a clear
+    // step from the reported latency, and one request covers every move until
+    // activate() latches the new value
+    if (!is_active_ || latency_restart_requested_ || sample_rate_ <= 0.0) {
+        return;
+    }
+    double reported_ms = reported_latency_samples_ * 1000.0 / sample_rate_;
+    if (std::abs(getOutputLookaheadMs() - reported_ms) <= LATENCY_RESTART_THRESHOLD_MS) {
+        return;
+    }
+    latency_restart_requested_ = true;
+    if (host_ && host_->request_restart) {
+        host_->request_restart(host_);
+    }
+}
+
+bool OBX8Plugin::selectMidiDevice(const std::string& device_name) {
+    bool connected = midi_device_manager_->selectDevice(device_name);
+    latency_probe_.setDevice(device_name);
+    main_thread_queue_.post(MAIN_TASK_LATENCY_CHANGED);
+    invalidateHardwareMirror();
+    wakeProcessing();
+    return connected;
+}
+
+void OBX8Plugin::setProgramPrefetchEnabled(bool enabled) {
+    prefetch_enabled_.store(enabled, std::memory_order_relaxed);
+    main_thread_queue_.post(MAIN_TASK_UPDATE_PREFETCH);
+}
+
+void OBX8Plugin::onProgramChange(uint16_t bank, uint8_t program) {
+    // Cache keys and dump requests carry a 7-bit bank
+    int32_t key = bank < 128 ? static_cast<int32_t>(PatchCache::makeKey(static_cast<uint8_t>(bank), program)) : -1;
+    current_program_key_.store(key, std::memory_order_release);
+    prefetch_timeouts_.store(0, std::memory_order_relaxed);
+    main_thread_queue_.post(MAIN_TASK_APPLY_PROGRAM);
+}
+
+void OBX8Plugin::onSysExReceived(const uint8_t* data, size_t length) {
+    // Only program dumps are decoded, on the main thread; anything else stops here
+    if (length <= ProgramDumpCodec::HEADER_LENGTH || data[1] != ProgramDumpCodec::MANUFACTURER_ID ||
+        data[2] != ProgramDumpCodec::MODEL_ID || data[3] != ProgramDumpCodec::COMMAND_PROGRAM_DUMP) {
+        return;
+    }
+    main_thread_queue_.postPayload(MAIN_TASK_DECODE_PROGRAM_DUMP, data, length);
+}
+
+void OBX8Plugin::decodeProgramDump(const uint8_t* data, size_t length) {
+    uint8_t bank = 0;
+    uint8_t program = 0;
+    std::vector<int32_t> values;
+    if (!ProgramDumpCodec::decode(data, length, *param_manager_, bank, program, values)) {
+        return;
+    }
+    
+    metrics_.add(METRIC_PROGRAM_DUMPS_RECEIVED);
+    int32_t key = static_cast<int32_t>(PatchCache::makeKey(bank, program));
+    patch_cache_.store(key, values);
+    
+    int32_t expected = key;
+    prefetch_outstanding_key_.compare_exchange_strong(expected, -1, std::memory_order_acq_rel);
+    prefetch_timeouts_.store(0, std::memory_order_relaxed);
+    
+    // The current program missed the cache and nothing has been edited since - apply it now
+    if (key == current_program_key_.load(std::memory_order_acquire) &&
+        program_awaiting_dump_.load(std::memory_order_acquire)) {
+        main_thread_queue_.post(MAIN_TASK_APPLY_PROGRAM);
+    }
+    
+    main_thread_queue_.post(MAIN_TASK_UPDATE_PREFETCH);
+}
+
+void OBX8Plugin::applyCachedProgram() {
+    int32_t key = current_program_key_.load(std::memory_order_acquire);
+    if (key < 0) {
+        return;
+    }
+    
+    std::vector<int32_t> values;
+    if (!patch_cache_.lookup(key, values)) {
+        // The synth now holds a program we know nothing about
+        metrics_.add(METRIC_PROGRAM_CACHE_MISSES);
+        invalidateHardwareMirror();
+        program_awaiting_dump_.store(true, std::memory_order_release);
+        return;
+    }
+    
+    metrics_.add(METRIC_PROGRAM_CACHE_HITS);
+    program_awaiting_dump_.store(false, std::memory_order_release);
+    
+    for (const auto& param : param_manager_->getParameters()) {
+        if (param.id >= values.size() || values[param.id] < 0 || param.id >= param_store_->size()) {
+            continue;
+        }
+        uint16_t nrpn_value = static_cast<uint16_t>(values[param.id]);
+        setNormalizedValue(param.id, nrpnToParameterValue(&param, nrpn_value), PARAM_SOURCE_HARDWARE);
+        last_sent_nrpn_value_[param.id].store(nrpn_value, std::memory_order_relaxed);
+    }
+    
+    // One rescan covers every parameter the program changed
+    rescanHostParams(CLAP_PARAM_RESCAN_VALUES);
+}
+
+void OBX8Plugin::rescanHostParams(clap_param_rescan_flags flags) {
+    if (!host_ || !host_->get_extension) {
+        return;
+    }
+    
+    const clap_host_params_t* host_params =
+        static_cast<const clap_host_params_t*>(host_->get_extension(host_, CLAP_EXT_PARAMS));
+    if (host_params && host_params->rescan) {
+        host_params->rescan(host_, flags);
+    }
+}
+
+void OBX8Plugin::updateProgramPrefetch() {
+    int32_t current = current_program_key_.load(std::memory_order_acquire);
+    if (current < 0 || !prefetch_enabled_.load(std::memory_order_relaxed) ||
+        prefetch_timeouts_.load(std::memory_order_relaxed) >= PREFETCH_MAX_TIMEOUTS) {
+        prefetch_key_.store(-1, std::memory_order_release);
+        return;
+    }
     
-    for (uint32_t i = 0; i < param_manager_->getParameterCount(); ++i) {
-        const auto& params = param_manager_->getParameters();
-        if (i < params.size()) {
-            param_values_[i] = normalizeParameterValue(&params[i], params[i].default_value);
+    // Current program first, then the rest of its bank in order
+    uint8_t bank = static_cast<uint8_t>(current >> 7);
+    uint8_t program = static_cast<uint8_t>(current & 0x7F);
+    for (uint32_t n = 0; n < PROGRAMS_PER_BANK; ++n) {
+        uint32_t key = PatchCache::makeKey(bank, static_cast<uint8_t>((program + n) % PROGRAMS_PER_BANK));
+        if (!patch_cache_.contains(key)) {
+            prefetch_key_.store(static_cast<int32_t>(key), std::memory_order_release);
+            return;
+        }
+    }
+    
+    prefetch_key_.store(-1, std::memory_order_release);
+}
+
+void OBX8Plugin::runProgramPrefetch() {
+    // An export keeps the link for its own output
+    if (render_offline_ || getOutputRoute() != OUTPUT_ROUTE_DIRECT || !midi_device_manager_->isConnected()) {
+        return;
+    }
+    
+    uint64_t now_ms = getEventTimeNs() / 1000000;
+    if (prefetch_outstanding_key_.load(std::memory_order_acquire) >= 0) {
+        if (now_ms - prefetch_sent_ms_ < PREFETCH_TIMEOUT_MS) {
+            return;
         }
+        
+        // No answer - give up on this request and let the main thread decide what's next
+        prefetch_outstanding_key_.store(-1, std::memory_order_release);
+        prefetch_timeouts_.fetch_add(1, std::memory_order_relaxed);
+        main_thread_queue_.post(MAIN_TASK_UPDATE_PREFETCH);
+        return;
+    }
+    
+    // Live edits always win - only use a link that has been quiet for a while
+    if (block_message_count_ != 0 || now_ms - last_live_edit_ms_ < PREFETCH_EDIT_HOLDOFF_MS) {
+        return;
+    }
+    
+    int32_t key = prefetch_key_.exchange(-1, std::memory_order_acq_rel);
+    if (key < 0) {
+        return;
+    }
+    
+    uint8_t request[ProgramDumpCodec::REQUEST_LENGTH];
+    size_t length = ProgramDumpCodec::buildRequest(static_cast<uint8_t>(key >> 7), static_cast<uint8_t>(key & 0x7F),
+                                                   request, sizeof(request));
+    
+    prefetch_sent_ms_ = now_ms;
+    prefetch_outstanding_key_.store(key, std::memory_order_release);
+    
+    SPOBX8_TRACE_INSTANT("scheduler", "program_prefetch", key);
+    if (sendToDevice(request, length)) {
+        metrics_.add(METRIC_PROGRAM_DUMPS_REQUESTED);
+    }
+}
+
+void OBX8Plugin::runLatencyProbe() {
+    // Only probe an otherwise idle direct link so the measurement doesn't queue behind
+    // edits, and not during an export, where paced output would skew it
+    if (block_message_count_ != 0 || render_offline_ || !midi_device_manager_->isConnected() ||
+        getOutputRoute() != OUTPUT_ROUTE_DIRECT) {
+        return;
+    }
+    
+    uint64_t now_ns = getEventTimeNs();
+    if (!latency_probe_.isProbeDue(now_ns)) {
+        return;
     }
     
-    // Auto-select first OBX8 device if available
-    autoSelectFirstOBX8Device();
+    // Re-write a value the hardware already holds so the probe is inaudible
+    const auto& params = param_manager_->getParameters();
+    for (size_t n = 0; n < params.size(); ++n) {
+        size_t index = (next_probe_param_index_ + n) % params.size();
+        const OBX8Parameter& param = params[index];
+        if (param.id >= param_store_->size() || (param.nrpn_msb == 0 && param.nrpn_lsb == 0)) {
+            continue;
+        }
+        
+        int32_t hardware_value = last_sent_nrpn_value_[param.id].load(std::memory_order_relaxed);
+        if (hardware_value < 0) {
+            continue;
+        }
+        
+        next_probe_param_index_ = index + 1;
+        uint16_t nrpn_param = (param.nrpn_msb << 7) | param.nrpn_lsb;
+        
+        std::ofstream debug_file = openDebugLog();
+        debug_file << "Latency probe - param: " << param.display_name << ", value: " << hardware_value << std::endl;
+        
+        // Arm before sending: a loopback echo can arrive before the send returns
+        SPOBX8_TRACE_INSTANT("scheduler", "latency_probe", nrpn_param);
+        latency_probe_.onProbeSent(nrpn_param, static_cast<uint16_t>(hardware_value), now_ns);
+        midi_handler_->sendNRPN(nrpn_param, static_cast<uint16_t>(hardware_value));
+        sendQueuedMidiToDevice(debug_file);
+        debug_file.close();
+        return;
+    }
+}
+
+void OBX8Plugin::invalidateHardwareMirror() {
+    // A newly selected device may hold anything, so force the next write of every parameter
+    for (size_t i = 0; i < param_store_->size(); ++i) {
+        last_sent_nrpn_value_[i].store(-1, std::memory_order_relaxed);
+    }
+    midi1_encoder_.invalidateSelectedNRPN();
+}
+
+void OBX8Plugin::forgetHardwareValues(const UmpPacket* packets, size_t count) {
+    // Writes that never left leave their parameters' hardware values unknown, so
+    // the next write of each goes out in full rather than being skipped
+    for (size_t i = 0; i < count; ++i) {
+        const UmpPacket& packet = packets[i];
+        const OBX8Parameter* param = nullptr;
+        if (UmpCodec::isNrpn(packet) || UmpCodec::isRelativeNrpn(packet)) {
+            uint16_t number = UmpCodec::nrpnNumber(packet);
+            param = param_manager_->getParameterByNRPN(number >> 7, number & 0x7F);
+        } else if (UmpCodec::messageType(packet) == UmpCodec::TYPE_MIDI1_CHANNEL_VOICE &&
+                   (UmpCodec::statusByte(packet) & 0xF0) == 0xB0) {
+            param = param_manager_->getParameterByCC(UmpCodec::data1(packet));
+        }
+        if (param && param->id < param_store_->size()) {
+            last_sent_nrpn_value_[param->id].store(-1, std::memory_order_relaxed);
+        }
+    }
+}
+
+void OBX8Plugin::joinMidiInitialization() {
+    if (midi_init_thread_.joinable()) {
+        midi_init_thread_.join();
+    }
+}
+
+void OBX8Plugin::initializeParameters() {
+    param_store_ = std::make_unique<ParameterStore>(param_manager_->getParameterCount());
+    
+    last_sent_nrpn_value_.reset(new std::atomic<int32_t>[param_store_->size()]);
+    relative_updates_since_absolute_.reset(new uint8_t[param_store_->size()]());
+    invalidateHardwareMirror();
+    
+    for (const auto& param : param_manager_->getParameters()) {
+        param_store_->store(param.id, param.default_value, PARAM_SOURCE_DEFAULT);
+    }
+}
+
+double OBX8Plugin::getNormalizedValue(clap_id param_id) const {
+    const OBX8Parameter* param = param_manager_->getParameterById(param_id);
+    if (!param) {
+        return 0.0;
+    }
+    return normalizeParameterValue(param, param_store_->load(param_id));
+}
+
+void OBX8Plugin::setNormalizedValue(clap_id param_id, double value, ParameterSource source) {
+    const OBX8Parameter* param = param_manager_->getParameterById(param_id);
+    if (!param) {
+        return;
+    }
+    param_store_->store(param_id, denormalizeParameterValue(param, value), source);
 }
 
 uint32_t OBX8Plugin::params_count() const {
     uint32_t count = param_manager_->getParameterCount();
-    std::ofstream debug_file("/tmp/spobx8_debug.log", std::ios::app);
+    std::ofstream debug_file = openDebugLog();
     debug_file << "*** params_count() called, returning: " << count << std::endl;
     debug_file.close();
     return count;
@@ -214,7 +990,8 @@ bool OBX8Plugin::params_get_info(uint32_t param_index, clap_param_info_t *param_
     param_info->id = param.id;
     strncpy(param_info->name, param.display_name.c_str(), sizeof(param_info->name) - 1);
     param_info->name[sizeof(param_info->name) - 1] = '\0';
-    strncpy(param_info->module, "OBX8", sizeof(param_info->module) - 1);
+    std::string module = param.group.empty() ? "OBX8" : "OBX8/" + param.group;
+    strncpy(param_info->module, module.c_str(), sizeof(param_info->module) - 1);
     param_info->module[sizeof(param_info->module) - 1] = '\0';
     
     // Always register parameters with normalized 0.0-1.0 range for CLAP automation compatibility
@@ -226,283 +1003,1016 @@ bool OBX8Plugin::params_get_info(uint32_t param_index, clap_param_info_t *param_
     if (param.is_stepped) {
         param_info->flags |= CLAP_PARAM_IS_STEPPED;
         
-        // For MIDI device selection, mark as enum for better dropdown support
-        if (param.id == MIDI_DEVICE_SELECTION) {
+        // For MIDI device selection and output route, mark as enum for better dropdown support
+        if (param.id == MIDI_DEVICE_SELECTION || param.id == MIDI_OUTPUT_ROUTE || param.id == MIDI_CLOCK_OUTPUT ||
+            param.id == MIDI_PARAMETER_ENCODING || param.id == SEQUENCER_ENABLE || param.id == SEQUENCER_LENGTH ||
+            param.id == SEQUENCER_RECORD_STEP) {
             param_info->flags |= CLAP_PARAM_IS_ENUM;
         }
     }
     
-    return true;
+    return true;
+}
+
+bool OBX8Plugin::params_get_value(clap_id param_id, double *value) const {
+    if (param_id >= param_store_->size()) {
+        return false;
+    }
+    
+    *value = getNormalizedValue(param_id);
+    return true;
+}
+
+bool OBX8Plugin::params_value_to_text(clap_id param_id, double value, char *display, uint32_t size) const {
+    const OBX8Parameter* param = param_manager_->getParameterById(param_id);
+    if (!param || size == 0) {
+        return false;
+    }
+    
+    // Display exactly what the hardware will receive
+    const std::string* text = display_table_.getText(*param, parameterToHardwareValue(param, value));
+    if (text) {
+        strncpy(display, text->c_str(), size - 1);
+        display[size - 1] = '\0';
+        return true;
+    }
+    
+    snprintf(display, size, "%.2f%s", denormalizeParameterValue(param, value), param->unit.c_str());
+    return true;
+}
+
+bool OBX8Plugin::params_text_to_value(clap_id param_id, const char *display, double *value) const {
+    const OBX8Parameter* param = param_manager_->getParameterById(param_id);
+    if (!param) {
+        return false;
+    }
+    
+    // Step names, display strings and numbers with or without the unit suffix
+    double hardware_value;
+    if (!display_table_.parseText(*param, display, &hardware_value)) {
+        return false;
+    }
+    
+    *value = normalizeParameterValue(param, hardware_value);
+    return true;
+}
+
+void OBX8Plugin::params_flush(const clap_input_events_t *in, const clap_output_events_t *out) {
+    SPOBX8_TRACE_SCOPE("params", "params_flush", in->size(in));
+    std::ofstream debug_file = openDebugLog();
+    debug_file << "=== *** PARAMS_FLUSH *** called ===" << std::endl;
+    
+    // process() captures its own events; this is the host flushing outside a block
+    if (current_block_frames_ == 0 && capture_.isActive()) {
+        CaptureFlush flush = {captureInputEvents(in)};
+        capture_.record(CAPTURE_FLUSH, getCurrentTimeNs(), &flush, sizeof(flush));
+    }
+    
+    debug_file << "Event count: " << in->size(in) << std::endl;
+    debug_file.close();
+    
+    // Editor edits the host flushed for us while not processing
+    applyEditorEdits(out);
+    
+    // Outside a block there is no hardware input or clock to merge; this only
+    // dispatches the host's events
+    event_router_.route(in, 0, 0, 0, nullptr, 0);
+    
+    // Process any outgoing MIDI messages generated by parameter changes
+    processOutgoingMidi(out);
+}
+
+uint32_t OBX8Plugin::note_ports_count(bool is_input) const {
+    return 1; // One MIDI port for both input and output
+}
+
+bool OBX8Plugin::note_ports_get(uint32_t index, bool is_input, clap_note_port_info_t *info) const {
+    if (index != 0) {
+        return false;
+    }
+    
+    info->id = 0;
+    strncpy(info->name, is_input ? "MIDI In" : "MIDI Out", sizeof(info->name) - 1);
+    info->name[sizeof(info->name) - 1] = '\0';
+    info->supported_dialects = CLAP_NOTE_DIALECT_MIDI;
+    info->preferred_dialect = CLAP_NOTE_DIALECT_MIDI;
+    
+    return true;
+}
+
+void OBX8Plugin::handleParameterChange(clap_id param_id, double value, uint32_t time, ParameterSource source) {
+    // Write to debug file
+    std::ofstream debug_file = openDebugLog();
+    debug_file << "=== handleParameterChange called ===" << std::endl;
+    debug_file << "param_id: " << param_id << ", value: " << value << std::endl;
+    
+    if (param_id < param_store_->size()) {
+        setNormalizedValue(param_id, value, source);
+        
+        if (param_id == MIDI_DEVICE_SELECTION) {
+            // Opening a port can block - the main thread picks up the stored value
+            debug_file << "Device selection queued for the main thread" << std::endl;
+            main_thread_queue_.post(MAIN_TASK_SELECT_DEVICE);
+        } else if (param_id == MIDI_OUTPUT_ROUTE) {
+            // The hardware may have missed anything sent while routed elsewhere
+            debug_file << "Output route changed to " << getOutputRoute() << std::endl;
+            invalidateHardwareMirror();
+        } else if (param_id == MIDI_CLOCK_OUTPUT) {
+            // Picked up by the clock generator on the next block
+            debug_file << "MIDI clock output " << (value >= 0.5 ? "on" : "off") << std::endl;
+        } else if (param_id == MIDI_PARAMETER_ENCODING) {
+            // Applies from the next write; the hardware holds the same values either way
+            debug_file << "Parameter encoding " << (value >= 0.5 ? "NRPN only" : "smallest") << std::endl;
+        } else if (param_id == SEQUENCER_ENABLE || param_id == SEQUENCER_LENGTH || param_id == SEQUENCER_RECORD_STEP) {
+            // Picked up by the step sequencer on the next block
+            debug_file << "Step sequencer setting " << param_id << " = " << value << std::endl;
+        } else {
+            recordStepLock(param_id, value);
+            debug_file << "Calling sendParameterToHardware" << std::endl;
+            sendParameterToHardware(param_id, value, time);
+        }
+    } else {
+        debug_file << "param_id out of range: " << param_id << " >= " << param_store_->size() << std::endl;
+    }
+    
+    debug_file << "=== handleParameterChange end ===" << std::endl;
+    debug_file.close();
+}
+
+void OBX8Plugin::sendParameterToHardware(clap_id param_id, double value, uint32_t time) {
+    // Write to debug file
+    std::ofstream debug_file = openDebugLog();
+    debug_file << "=== sendParameterToHardware called ===" << std::endl;
+    debug_file << "param_id: " << param_id << ", value: " << value << std::endl;
+    
+    // MIDI throttling for high-frequency modulation (LFO) 
+    uint64_t current_time = getRenderTimeNs(time) / 1000000;
+    auto last_time_it = last_param_send_time_.find(param_id);
+    auto last_value_it = last_param_value_.find(param_id);
+    
+    // Check if we should throttle based on time and value change
+    if (last_time_it != last_param_send_time_.end() && last_value_it != last_param_value_.end()) {
+        uint64_t time_since_last = current_time - last_time_it->second;
+        double value_change = std::abs(value - last_value_it->second);
+        
+        // Throttle if too soon AND value change is small (more permissive for LFOs)
+        if (time_since_last < MIDI_THROTTLE_MS && value_change < 0.005) {
+            debug_file << "Throttling parameter send - too soon (" << time_since_last 
+                      << "ms) and small change (" << value_change << ")" << std::endl;
+            debug_file.close();
+            metrics_.add(METRIC_SENDS_THROTTLED);
+            SPOBX8_TRACE_INSTANT("params", "throttled", param_id);
+            return;
+        }
+    }
+    
+    // Update tracking
+    last_param_send_time_[param_id] = current_time;
+    last_param_value_[param_id] = value;
+    
+    // Live edits hold off program prefetch and make a late dump of the current program stale
+    last_live_edit_ms_ = getEventTimeNs() / 1000000;
+    program_awaiting_dump_.store(false, std::memory_order_relaxed);
+    
+    const OBX8Parameter* param = param_manager_->getParameterById(param_id);
+    bool host_routed = getOutputRoute() == OUTPUT_ROUTE_HOST;
+    if (!param || (!host_routed && !midi_device_manager_->isConnected())) {
+        debug_file << "Not sending - param: " << (param ? "ok" : "null") 
+                  << ", connected: " << (midi_device_manager_->isConnected() ? "yes" : "no") << std::endl;
+        debug_file.close();
+        return;
+    }
+    
+    if (!encodeParameterWrite(param, value, debug_file)) {
+        debug_file.close();
+        return;
+    }
+    
+    // Inside process() the packet joins the block's merged output at its event time.
+    // Outside it, host-routed output stays queued for processOutgoingMidi and direct
+    // output is sent to the device right away.
+    if (current_block_frames_ > 0) {
+        queueOutgoingEdit(param_id, time);
+    } else if (!host_routed) {
+        sendQueuedMidiToDevice(debug_file);
+    }
+    
+    debug_file << "=== sendParameterToHardware end ===" << std::endl;
+    debug_file.close();
+}
+
+bool OBX8Plugin::encodeParameterWrite(const OBX8Parameter* param, double value, std::ofstream& debug_file) {
+    clap_id param_id = param->id;
+    
+    // Convert normalized value to NRPN value
+    uint16_t nrpn_value = parameterToNRPNValue(param, value);
+    uint16_t nrpn_param = (param->nrpn_msb << 7) | param->nrpn_lsb;
+    
+    // Skip the write when the hardware already holds this value
+    int32_t previous_value = -1;
+    if (param_id < param_store_->size()) {
+        previous_value = last_sent_nrpn_value_[param_id].exchange(nrpn_value, std::memory_order_relaxed);
+        if (previous_value == nrpn_value) {
+            debug_file << "Coalescing parameter send - hardware already at " << nrpn_value << std::endl;
+            metrics_.add(METRIC_SENDS_COALESCED);
+            SPOBX8_TRACE_INSTANT("params", "coalesced", param_id);
+            return false;
+        }
+    }
+    
+    // Parameters whose whole range fits a CC of their own go out as that CC: 3 bytes,
+    // absolute and exact, which no NRPN form beats
+    uint8_t exact_cc = 0;
+    if (param_store_->load(MIDI_PARAMETER_ENCODING) < 0.5) {
+        exact_cc = param_manager_->getExactCC(param_id);
+    }
+    
+    // Small steps from a known hardware value go out as data increment/decrement when
+    // that is fewer bytes than a full NRPN; every few relative updates an absolute
+    // write is forced so a lost message can't leave the hardware off for long
+    int steps = previous_value < 0 ? 0 : static_cast<int>(nrpn_value) - previous_value;
+    int abs_steps = steps < 0 ? -steps : steps;
+    int relative_bytes = (midi1_encoder_.isNRPNSelected(nrpn_param) ? 0 : NRPN_ADDRESS_BYTES) +
+                         abs_steps * DATA_INCREMENT_BYTES;
+    bool send_relative = exact_cc == 0 && param->supports_data_increment && previous_value >= 0 &&
+                         abs_steps <= DATA_INCREMENT_MAX_STEPS &&
+                         relative_bytes < NRPN_ABSOLUTE_BYTES &&
+                         relative_updates_since_absolute_[param_id] < ABSOLUTE_REFRESH_INTERVAL;
+    
+    if (exact_cc != 0) {
+        debug_file << "Sending CC - param: " << param->display_name
+                  << ", CC: " << (int)exact_cc << ", value: " << nrpn_value << std::endl;
+    } else {
+        debug_file << "Sending NRPN - param: " << param->display_name 
+                  << ", NRPN: " << nrpn_param << ", value: " << nrpn_value
+                  << (send_relative ? " (relative)" : "") << std::endl;
+    }
+    
+    // Send to hardware via MIDI device manager - suppress feedback
+    suppress_feedback_.store(true, std::memory_order_release);
+    if (exact_cc != 0) {
+        midi_handler_->sendCC(exact_cc, static_cast<uint8_t>(nrpn_value));
+        metrics_.add(METRIC_CC_SENDS);
+        SPOBX8_TRACE_INSTANT("params", "send_cc", param_id);
+    } else if (send_relative) {
+        midi_handler_->sendNRPNIncrement(nrpn_param, steps);
+        ++relative_updates_since_absolute_[param_id];
+        metrics_.add(METRIC_RELATIVE_SENDS);
+        metrics_.add(METRIC_NRPN_SENT);
+        SPOBX8_TRACE_INSTANT("params", "send_relative", param_id);
+    } else {
+        midi_handler_->sendNRPN(nrpn_param, nrpn_value);
+        metrics_.add(METRIC_NRPN_SENT);
+        SPOBX8_TRACE_INSTANT("params", "send_nrpn", param_id);
+    }
+    if (!send_relative && param_id < param_store_->size()) {
+        relative_updates_since_absolute_[param_id] = 0;
+    }
+    suppress_feedback_.store(false, std::memory_order_release);
+    return true;
+}
+
+void OBX8Plugin::sendQueuedMidiToDevice(std::ofstream& debug_file) {
+    std::vector<UmpPacket> packets;
+    midi_handler_->getOutgoingPackets(packets);
+    
+    debug_file << "Got " << packets.size() << " MIDI packets" << std::endl;
+    
+    for (const auto& packet : packets) {
+        // One write per packet so an NRPN reaches the driver in one piece
+        uint8_t midi_data[UmpMidi1Encoder::MAX_BYTES];
+        size_t length = midi1_encoder_.encodeBytes(packet, midi_data);
+        if (length == 0) {
+            continue;
+        }
+        debug_file << "MIDI out:" << std::hex;
+        for (size_t i = 0; i < length; ++i) {
+            debug_file << " " << (int)midi_data[i];
+        }
+        debug_file << std::dec << std::endl;
+        bool sent = sendToDevice(midi_data, length);
+        debug_file << "Send result: " << (sent ? "success" : "failed") << std::endl;
+        
+        if (!sent) {
+            // The hardware's NRPN address and this parameter's value are now unknown
+            midi1_encoder_.invalidateSelectedNRPN();
+            forgetHardwareValues(&packet, 1);
+        }
+    }
+}
+
+void OBX8Plugin::queueOutgoingEdit(clap_id param_id, uint32_t time) {
+    midi_handler_->getOutgoingPackets(outgoing_scratch_);
+    if (output_merger_.pushBulk(time, outgoing_scratch_.data(), outgoing_scratch_.size())) {
+        return;
+    }
+    
+    // Out of room for this block: the write is lost, so the hardware can't be
+    // assumed to hold the value
+    if (param_id < param_store_->size()) {
+        last_sent_nrpn_value_[param_id].store(-1, std::memory_order_relaxed);
+    }
+    metrics_.add(METRIC_SEND_FAILURES);
+}
+
+bool OBX8Plugin::sendToDevice(const uint8_t* data, size_t length, uint64_t timestamp_ns) {
+    if (capture_.isActive()) {
+        capture_.recordDeviceMidi(CAPTURE_DEVICE_MIDI_OUT, getEventTimeNs(), data, length);
+    }
+    
+    bool sent;
+    {
+        SPOBX8_TRACE_SCOPE("midi_out", "os_send", length);
+        sent = midi_device_manager_->sendMidiData(data, length, timestamp_ns);
+    }
+    if (sent) {
+        metrics_.add(METRIC_BYTES_SENT, length);
+    } else {
+        metrics_.add(METRIC_SEND_FAILURES);
+    }
+    ++block_message_count_;
+    return sent;
+}
+
+void OBX8Plugin::paceToWire(size_t length) {
+    uint64_t wait_ns = render_pacer_.reserveWire(length, getCurrentTimeNs());
+    if (wait_ns == 0) {
+        return;
+    }
+    metrics_.add(METRIC_PACING_WAITS);
+    if (time_source_ns_) {
+        // An injected clock (replay) doesn't move while this thread sleeps, so a
+        // wall-time wait would only grow with every send. The booking against the
+        // injected clock is the wait; its next reading drains the wire.
+        return;
+    }
+    SPOBX8_TRACE_SCOPE("midi_out", "pacing_wait", length);
+    std::this_thread::sleep_for(std::chrono::nanoseconds(wait_ns));
+    render_pacer_.addPacedTime(wait_ns);
+}
+
+void OBX8Plugin::receiveMidiData(const uint8_t* data, size_t length, uint64_t arrival_ns) {
+    SPOBX8_TRACE_THREAD_NAME("midi_in");
+    SPOBX8_TRACE_SCOPE("midi_in", "parse_device_midi", length);
+    metrics_.add(METRIC_BYTES_RECEIVED, length);
+    // Every message parsed from these bytes carries their arrival time
+    device_arrival_ns_ = arrival_ns != 0 ? arrival_ns : getCurrentTimeNs();
+    if (capture_.isActive()) {
+        capture_.recordDeviceMidi(CAPTURE_DEVICE_MIDI_IN, device_arrival_ns_, data, length);
+    }
+    stream_parser_.parse(data, length);
+}
+
+bool OBX8Plugin::startCapture(const std::string& path) {
+    if (!capture_.start(path)) {
+        return false;
+    }
+    if (is_active_) {
+        captureSession();
+    }
+    return true;
+}
+
+void OBX8Plugin::captureSession() {
+    if (capture_.isActive()) {
+        CaptureSession session = {sample_rate_, min_frames_, max_frames_};
+        capture_.record(CAPTURE_SESSION, getCurrentTimeNs(), &session, sizeof(session));
+        captureRenderMode();
+    }
+}
+
+void OBX8Plugin::captureRenderMode() {
+    if (capture_.isActive()) {
+        RenderPacer::RenderMode mode = render_pacer_.getRenderMode();
+        CaptureRenderMode record = {mode == RenderPacer::RENDER_MODE_UNKNOWN ? -1
+                                    : mode == RenderPacer::RENDER_MODE_OFFLINE ? int32_t(CLAP_RENDER_OFFLINE)
+                                                                               : int32_t(CLAP_RENDER_REALTIME)};
+        capture_.record(CAPTURE_RENDER_MODE, getCurrentTimeNs(), &record, sizeof(record));
+    }
+}
+
+uint32_t OBX8Plugin::captureInputEvents(const clap_input_events_t *in_events) {
+    uint32_t event_count = in_events ? in_events->size(in_events) : 0;
+    uint32_t captured = 0;
+    uint64_t now_ns = getEventTimeNs();
+    
+    // One record per event, in list order, ahead of the BLOCK/FLUSH record they belong to
+    for (uint32_t i = 0; i < event_count; ++i) {
+        const clap_event_header_t *header = in_events->get(in_events, i);
+        if (header->space_id != CLAP_CORE_EVENT_SPACE_ID) {
+            continue;
+        }
+        
+        if (header->type == CLAP_EVENT_PARAM_VALUE) {
+            const clap_event_param_value_t *event = reinterpret_cast<const clap_event_param_value_t*>(header);
+            CaptureParamEvent record = {header->time, event->param_id, event->value};
+            capture_.record(CAPTURE_PARAM_VALUE, now_ns, &record, sizeof(record));
+            ++captured;
+        } else if (header->type == CLAP_EVENT_PARAM_MOD) {
+            const clap_event_param_mod_t *event = reinterpret_cast<const clap_event_param_mod_t*>(header);
+            CaptureParamEvent record = {header->time, event->param_id, event->amount};
+            capture_.record(CAPTURE_PARAM_MOD, now_ns, &record, sizeof(record));
+            ++captured;
+        } else if (header->type == CLAP_EVENT_MIDI) {
+            const clap_event_midi_t *event = reinterpret_cast<const clap_event_midi_t*>(header);
+            CaptureHostMidi record = {header->time, {event->data[0], event->data[1], event->data[2]}, 0};
+            capture_.record(CAPTURE_HOST_MIDI_IN, now_ns, &record, sizeof(record));
+            ++captured;
+        }
+    }
+    return captured;
+}
+
+void OBX8Plugin::handleParameterMod(const clap_event_param_mod_t& mod_event) {
+    std::ofstream debug_file = openDebugLog();
+    const OBX8Parameter* param = param_manager_->getParameterById(mod_event.param_id);
+    debug_file << "*** BITWIG LFO MOD EVENT *** - ID: " << mod_event.param_id 
+              << " (" << (param ? param->display_name : "UNKNOWN") << ")"
+              << ", modulation amount: " << mod_event.amount << std::endl;
+    
+    // For LFO modulation, scale Bitwig's large values to reasonable range
+    if (mod_event.param_id < param_store_->size()) {
+        // Get the BASE parameter value (not previously modulated value)
+        double base_value = getNormalizedValue(mod_event.param_id);
+        
+        // Scale Bitwig's large modulation values (~10) to normalized range (0-1)
+        // Assuming max Bitwig mod ~10.0 maps to full parameter range
+        double normalized_mod = mod_event.amount / 10.0;
+        
+        // Simple additive modulation with clamping
+        double modulated_value = base_value + normalized_mod;
+        modulated_value = std::max(0.0, std::min(1.0, modulated_value));
+        
+        debug_file << "Base: " << base_value << ", Raw Mod: " << mod_event.amount 
+                  << ", Normalized Mod: " << normalized_mod << ", Final: " << modulated_value << std::endl;
+        debug_file.close();
+        
+        // Send modulated value to hardware but DON'T store it back to the parameter store
+        // This prevents feedback loops
+        sendParameterToHardware(mod_event.param_id, modulated_value, mod_event.header.time);
+    }
+}
+
+void OBX8Plugin::handleHostMidi(uint32_t time, const MidiMessage& msg) {
+    if (isPerformanceMessage(msg)) {
+        // Played notes go to the hardware, not through the editor's MIDI input
+        if (output_merger_.pushPriority(time, UmpCodec::fromMidi1(msg.status, msg.data1, msg.data2))) {
+            metrics_.add(METRIC_PASSTHROUGH_MESSAGES);
+        } else {
+            metrics_.add(METRIC_SEND_FAILURES);
+        }
+        return;
+    }
+    
+    inbound_time_ns_ = getEventTimeNs();
+    inbound_from_hardware_ = false;
+    midi_handler_->processMidiMessage(msg, inbound_time_ns_);
+}
+
+void OBX8Plugin::handleHardwareMidi(const MidiMessage& msg, uint64_t arrival_ns) {
+    inbound_time_ns_ = arrival_ns;
+    inbound_from_hardware_ = true;
+    midi_handler_->processMidiMessage(msg, arrival_ns);
+}
+
+void OBX8Plugin::onHardwareMessage(const MidiMessage& msg) {
+    uint64_t arrival_ns = device_arrival_ns_;
+    
+    // While processing, hardware input joins the block's event stream on the audio thread
+    if (is_processing_.load(std::memory_order_acquire)) {
+        if (!event_router_.pushHardware(arrival_ns, msg)) {
+            metrics_.add(METRIC_HARDWARE_EVENTS_DROPPED);
+        }
+        wakeProcessing();
+        return;
+    }
+    
+    // Without blocks nothing else times out a data MSB left waiting for its LSB
+    std::lock_guard<std::mutex> lock(idle_inbound_mutex_);
+    handleHardwareMidi(msg, arrival_ns);
+    if (midi_handler_->hasPendingDataEntry()) {
+        main_thread_queue_.post(MAIN_TASK_DATA_ENTRY_TIMEOUT);
+    }
+}
+
+void OBX8Plugin::completeIdleDataEntry() {
+    std::lock_guard<std::mutex> lock(idle_inbound_mutex_);
+    // Once processing, process() times it out against the block time
+    if (is_processing_.load(std::memory_order_acquire) || !midi_handler_->hasPendingDataEntry()) {
+        return;
+    }
+    
+    uint64_t now_ns = getCurrentTimeNs();
+    inbound_time_ns_ = now_ns;
+    inbound_from_hardware_ = true;
+    midi_handler_->completeDataEntry(now_ns);
+    
+    // Not due yet: look again on the next callback
+    if (midi_handler_->hasPendingDataEntry()) {
+        main_thread_queue_.post(MAIN_TASK_DATA_ENTRY_TIMEOUT);
+    }
+}
+
+bool OBX8Plugin::hasPendingWork() const {
+    if (event_router_.hasHardware() || !output_merger_.empty() || midi_handler_->hasOutgoingMessages() ||
+        midi_handler_->hasPendingDataEntry() || gesture_recorder_.hasActiveGestures() || !editor_edits_.empty()) {
+        return true;
+    }
+    
+    // The clock and the step sequencer follow the transport, and the host doesn't
+    // wake us when that starts
+    if (midi_clock_.isRunning() || param_store_->load(MIDI_CLOCK_OUTPUT) >= 0.5 ||
+        step_sequencer_.isRunning() || param_store_->load(SEQUENCER_ENABLE) >= 0.5) {
+        return true;
+    }
+    
+    // Timed work on the direct link: latency probes, prefetch requests and their timeouts
+    if (getOutputRoute() != OUTPUT_ROUTE_DIRECT || !midi_device_manager_->isConnected()) {
+        return false;
+    }
+    return latency_probe_.isEnabled() || prefetch_key_.load(std::memory_order_acquire) >= 0 ||
+           prefetch_outstanding_key_.load(std::memory_order_acquire) >= 0;
 }
 
-bool OBX8Plugin::params_get_value(clap_id param_id, double *value) const {
-    if (param_id >= param_values_.size()) {
+bool OBX8Plugin::enterIdle() {
+    process_sleeping_.store(true, std::memory_order_relaxed);
+    
+    // Pairs with the fence in wakeProcessing(): either this check sees work handed
+    // over since the last block, or the other side sees the flag and wakes us
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (hasPendingWork()) {
+        process_sleeping_.store(false, std::memory_order_relaxed);
         return false;
     }
-    
-    *value = param_values_[param_id];
     return true;
 }
 
-bool OBX8Plugin::params_value_to_text(clap_id param_id, double value, char *display, uint32_t size) const {
-    const OBX8Parameter* param = param_manager_->getParameterById(param_id);
-    if (!param) {
-        return false;
+void OBX8Plugin::wakeProcessing() {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (process_sleeping_.load(std::memory_order_relaxed) && process_sleeping_.exchange(false)) {
+        metrics_.add(METRIC_PROCESS_WAKEUPS);
+        host_->request_process(host_);
     }
-    
-    double actual_value = denormalizeParameterValue(param, value);
-    
-    if (param->is_stepped && !param->step_names.empty()) {
-        int step = static_cast<int>(actual_value);
-        if (step >= 0 && step < static_cast<int>(param->step_names.size())) {
-            strncpy(display, param->step_names[step].c_str(), size - 1);
-            display[size - 1] = '\0';
+}
+
+bool OBX8Plugin::isPerformanceMessage(const MidiMessage& message) {
+    switch (message.status & 0xF0) {
+        case 0x80: // Note off
+        case 0x90: // Note on
+        case 0xA0: // Polyphonic aftertouch
+        case 0xD0: // Channel aftertouch
+        case 0xE0: // Pitch bend
             return true;
-        }
+        case 0xB0:
+            return message.data1 == CC_MOD_WHEEL || message.data1 == CC_SUSTAIN;
+        default:
+            return false;
     }
-    
-    snprintf(display, size, "%.2f%s", actual_value, param->unit.c_str());
-    return true;
 }
 
-bool OBX8Plugin::params_text_to_value(clap_id param_id, const char *display, double *value) const {
-    const OBX8Parameter* param = param_manager_->getParameterById(param_id);
-    if (!param) {
-        return false;
+size_t OBX8Plugin::runMidiClock(const clap_event_transport_t *transport, const clap_input_events_t *in_events,
+                                uint32_t frames) {
+    // The clock is generated before the router applies this block's events, so a
+    // "MIDI Clock Output" change in the block is read here: switched on, the clock
+    // starts at the event's sample; switched off, it stops for the whole block
+    bool enabled = param_store_->load(MIDI_CLOCK_OUTPUT) >= 0.5;
+    uint32_t start_time = 0;
+    uint32_t event_count = in_events ? in_events->size(in_events) : 0;
+    for (uint32_t i = 0; i < event_count; ++i) {
+        const clap_event_header_t *header = in_events->get(in_events, i);
+        if (header->space_id != CLAP_CORE_EVENT_SPACE_ID || header->type != CLAP_EVENT_PARAM_VALUE) {
+            continue;
+        }
+        const clap_event_param_value_t *event = reinterpret_cast<const clap_event_param_value_t *>(header);
+        if (event->param_id == MIDI_CLOCK_OUTPUT) {
+            bool on = event->value >= 0.5;
+            if (on && !enabled) {
+                start_time = header->time;
+            }
+            enabled = on;
+        }
     }
-    
-    // Try to parse as number first
-    double parsed_value = atof(display);
-    *value = normalizeParameterValue(param, parsed_value);
-    return true;
+    return midi_clock_.process(transport, enabled, frames, sample_rate_, clock_messages_, MAX_CLOCK_MESSAGES_PER_BLOCK,
+                               start_time);
 }
 
-void OBX8Plugin::params_flush(const clap_input_events_t *in, const clap_output_events_t *out) {
-    std::ofstream debug_file("/tmp/spobx8_debug.log", std::ios::app);
-    debug_file << "=== *** PARAMS_FLUSH *** called ===" << std::endl;
+void OBX8Plugin::runStepSequencer(const clap_event_transport_t *transport, uint32_t frames) {
+    // Write sizes follow the encoding setting, the pattern length its parameter
+    double encoding = param_store_->load(MIDI_PARAMETER_ENCODING);
+    if (encoding != sequencer_encoding_) {
+        sequencer_encoding_ = encoding;
+        updateSequencerWriteBytes();
+    }
+    step_sequencer_.setLength(static_cast<uint32_t>(param_store_->load(SEQUENCER_LENGTH)) + 1);
     
-    uint32_t event_count = in->size(in);
-    debug_file << "*** BITWIG LFO TEST *** Event count: " << event_count << std::endl;
+    bool host_routed = getOutputRoute() == OUTPUT_ROUTE_HOST;
+    bool enabled = param_store_->load(SEQUENCER_ENABLE) >= 0.5 && (host_routed || midi_device_manager_->isConnected());
+    // Writes have to reach the hardware the measured output lookahead earlier too
+    step_sequencer_.setDeliveryMarginSeconds(StepSequencer::DELIVERY_MARGIN_SECONDS + getOutputLookaheadMs() / 1000.0);
+    size_t count = step_sequencer_.process(transport, enabled, frames, sample_rate_, scheduled_steps_,
+                                           StepSequencer::MAX_STEPS_PER_BLOCK);
     
-    for (uint32_t i = 0; i < event_count; ++i) {
-        const clap_event_header_t *header = in->get(in, i);
-        debug_file << "*** BITWIG *** Event " << i << " type: " << header->type 
-                   << " (PARAM_VALUE=" << CLAP_EVENT_PARAM_VALUE << ", PARAM_MOD=" << CLAP_EVENT_PARAM_MOD << ", MIDI=" << CLAP_EVENT_MIDI << ")" << std::endl;
-        
-        if (header->type == CLAP_EVENT_PARAM_VALUE) {
-            const clap_event_param_value_t *param_event = 
-                reinterpret_cast<const clap_event_param_value_t*>(header);
-            
-            const OBX8Parameter* param = param_manager_->getParameterById(param_event->param_id);
-            debug_file << "*** AUTOMATION EVENT *** - ID: " << param_event->param_id 
-                      << " (" << (param ? param->display_name : "UNKNOWN") << ")"
-                      << ", value: " << param_event->value << std::endl;
-            
-            handleParameterChange(param_event->param_id, param_event->value);
-        } else if (header->type == CLAP_EVENT_PARAM_MOD) {
-            const clap_event_param_mod_t *mod_event = 
-                reinterpret_cast<const clap_event_param_mod_t*>(header);
-            
-            const OBX8Parameter* param = param_manager_->getParameterById(mod_event->param_id);
-            debug_file << "*** BITWIG LFO MOD EVENT *** - ID: " << mod_event->param_id 
-                      << " (" << (param ? param->display_name : "UNKNOWN") << ")"
-                      << ", modulation amount: " << mod_event->amount << std::endl;
-            
-            // For LFO modulation, scale Bitwig's large values to reasonable range
-            if (mod_event->param_id < param_values_.size()) {
-                // Get the BASE parameter value (not previously modulated value)
-                double base_value = param_values_[mod_event->param_id];
-                
-                // Scale Bitwig's large modulation values (~10) to normalized range (0-1)
-                // Assuming max Bitwig mod ~10.0 maps to full parameter range
-                double normalized_mod = mod_event->amount / 10.0;
-                
-                // Simple additive modulation with clamping
-                double modulated_value = base_value + normalized_mod;
-                modulated_value = std::max(0.0, std::min(1.0, modulated_value));
-                
-                debug_file << "Base: " << base_value << ", Raw Mod: " << mod_event->amount 
-                          << ", Normalized Mod: " << normalized_mod << ", Final: " << modulated_value << std::endl;
-                
-                // Send modulated value to hardware but DON'T store it back to param_values_
-                // This prevents feedback loops
-                sendParameterToHardware(mod_event->param_id, modulated_value);
-            }
+    // Warn once per change of the delivery check, from the main thread
+    uint32_t undeliverable = step_sequencer_.getUndeliverableSteps();
+    if (undeliverable != reported_undeliverable_steps_) {
+        reported_undeliverable_steps_ = undeliverable;
+        if (undeliverable != 0) {
+            main_thread_queue_.post(MAIN_TASK_SEQUENCER_WARNING);
         }
     }
     
-    // Process any outgoing MIDI messages generated by parameter changes
-    processOutgoingMidi(out);
-    
-    debug_file << "=== params_flush end ===" << std::endl;
-    debug_file.close();
-}
-
-uint32_t OBX8Plugin::note_ports_count(bool is_input) const {
-    return 1; // One MIDI port for both input and output
-}
-
-bool OBX8Plugin::note_ports_get(uint32_t index, bool is_input, clap_note_port_info_t *info) const {
-    if (index != 0) {
-        return false;
+    bool stopped = step_sequencer_.takeStopped();
+    if (count == 0 && !stopped) {
+        return;
     }
     
-    info->id = 0;
-    strncpy(info->name, is_input ? "MIDI In" : "MIDI Out", sizeof(info->name) - 1);
-    info->name[sizeof(info->name) - 1] = '\0';
-    info->supported_dialects = CLAP_NOTE_DIALECT_MIDI;
-    info->preferred_dialect = CLAP_NOTE_DIALECT_MIDI;
+    // Packets queued outside process() predate the block (see processOutgoingMidi)
+    // and must not be mistaken for step writes
+    if (midi_handler_->hasOutgoingMessages()) {
+        midi_handler_->getOutgoingPackets(outgoing_scratch_);
+        if (!output_merger_.pushBulk(0, outgoing_scratch_.data(), outgoing_scratch_.size())) {
+            forgetHardwareValues(outgoing_scratch_.data(), outgoing_scratch_.size());
+            metrics_.add(METRIC_SEND_FAILURES);
+        }
+    }
     
-    return true;
+    if (stopped) {
+        restoreLockedParameters();
+    }
+    for (size_t i = 0; i < count; ++i) {
+        writeStepLocks(scheduled_steps_[i]);
+    }
 }
 
-void OBX8Plugin::handleParameterChange(clap_id param_id, double value) {
-    // Write to debug file
-    std::ofstream debug_file("/tmp/spobx8_debug.log", std::ios::app);
-    debug_file << "=== handleParameterChange called ===" << std::endl;
-    debug_file << "param_id: " << param_id << ", value: " << value << std::endl;
+void OBX8Plugin::writeStepLocks(const ScheduledStep& scheduled) {
+    SPOBX8_TRACE_SCOPE("sequencer", "write_step", scheduled.step);
+    std::ofstream debug_file = openDebugLog();
+    metrics_.add(METRIC_SEQUENCER_STEPS);
     
-    if (param_id < param_values_.size()) {
-        param_values_[param_id] = value;
-        
-        if (param_id == MIDI_DEVICE_SELECTION) {
-            debug_file << "Calling onMidiDeviceSelected" << std::endl;
-            onMidiDeviceSelected(param_id, value);
-        } else {
-            debug_file << "Calling sendParameterToHardware" << std::endl;
-            sendParameterToHardware(param_id, value);
+    // Each parameter gets its lock, or its own value back after a lock. A step too
+    // dense for the tempo is cut to the budget in parameter order, so the same
+    // writes drop every time round and the rest still arrive on time.
+    size_t budget_left = scheduled.budget_bytes;
+    sequencer_written_.clear();
+    for (uint32_t id = 0; id < step_sequencer_.getParameterCount(); ++id) {
+        uint8_t write_bytes = step_sequencer_.getWriteBytes(id);
+        double value;
+        bool locked = step_sequencer_.getLock(scheduled.step, id, &value);
+        if (write_bytes == 0 || (!locked && !lock_on_hardware_[id])) {
+            continue;
         }
-    } else {
-        debug_file << "param_id out of range: " << param_id << " >= " << param_values_.size() << std::endl;
+        if (!locked) {
+            value = getNormalizedValue(id);
+        }
+        if (write_bytes > budget_left) {
+            metrics_.add(METRIC_SEQUENCER_WRITES_DROPPED);
+            continue;
+        }
+        if (encodeParameterWrite(param_manager_->getParameterById(id), value, debug_file)) {
+            budget_left -= write_bytes;
+            sequencer_written_.push_back(id);
+            metrics_.add(METRIC_SEQUENCER_WRITES);
+        }
+        lock_on_hardware_[id] = locked;
     }
     
-    debug_file << "=== handleParameterChange end ===" << std::endl;
+    queueSequencerWrites(scheduled.boundary);
     debug_file.close();
 }
 
-void OBX8Plugin::sendParameterToHardware(clap_id param_id, double value) {
-    // Write to debug file
-    std::ofstream debug_file("/tmp/spobx8_debug.log", std::ios::app);
-    debug_file << "=== sendParameterToHardware called ===" << std::endl;
-    debug_file << "param_id: " << param_id << ", value: " << value << std::endl;
-    
-    // MIDI throttling for high-frequency modulation (LFO) 
-    uint64_t current_time = getCurrentTimeMs();
-    auto last_time_it = last_param_send_time_.find(param_id);
-    auto last_value_it = last_param_value_.find(param_id);
+void OBX8Plugin::restoreLockedParameters() {
+    std::ofstream debug_file = openDebugLog();
+    debug_file << "Step sequencer stopped - restoring locked parameters" << std::endl;
     
-    // Check if we should throttle based on time and value change
-    if (last_time_it != last_param_send_time_.end() && last_value_it != last_param_value_.end()) {
-        uint64_t time_since_last = current_time - last_time_it->second;
-        double value_change = std::abs(value - last_value_it->second);
-        
-        // Throttle if too soon AND value change is small (more permissive for LFOs)
-        if (time_since_last < MIDI_THROTTLE_MS && value_change < 0.005) {
-            debug_file << "Throttling parameter send - too soon (" << time_since_last 
-                      << "ms) and small change (" << value_change << ")" << std::endl;
-            debug_file.close();
-            return;
+    sequencer_written_.clear();
+    for (uint32_t id = 0; id < step_sequencer_.getParameterCount(); ++id) {
+        if (!lock_on_hardware_[id]) {
+            continue;
         }
+        if (encodeParameterWrite(param_manager_->getParameterById(id), getNormalizedValue(id), debug_file)) {
+            sequencer_written_.push_back(id);
+        }
+        lock_on_hardware_[id] = false;
     }
     
-    // Update tracking
-    last_param_send_time_[param_id] = current_time;
-    last_param_value_[param_id] = value;
-    
-    const OBX8Parameter* param = param_manager_->getParameterById(param_id);
-    if (!param || !midi_device_manager_->isConnected()) {
-        debug_file << "Not sending - param: " << (param ? "ok" : "null") 
-                  << ", connected: " << (midi_device_manager_->isConnected() ? "yes" : "no") << std::endl;
-        debug_file.close();
+    queueSequencerWrites(0.0);
+    debug_file.close();
+}
+
+void OBX8Plugin::queueSequencerWrites(double boundary) {
+    midi_handler_->getOutgoingPackets(outgoing_scratch_);
+    if (outgoing_scratch_.empty()) {
         return;
     }
     
-    // Convert normalized value to NRPN value
-    uint16_t nrpn_value = parameterToNRPNValue(param, value);
-    uint16_t nrpn_param = (param->nrpn_msb << 7) | param->nrpn_lsb;
+    // Start early enough for the last byte to arrive the margin before the step;
+    // a step whose start already passed goes out at once
+    size_t bytes = 0;
+    for (const UmpPacket& packet : outgoing_scratch_) {
+        bytes += UmpMidi1Encoder::maxWireLength(packet);
+    }
+    double start = boundary - (bytes * MidiOutputMerger::DIN_SECONDS_PER_BYTE +
+                               step_sequencer_.getDeliveryMarginSeconds()) * sample_rate_;
+    uint32_t max_time = current_block_frames_ > 0 ? current_block_frames_ - 1 : 0;
+    uint32_t time = start <= 0.0 ? 0 : static_cast<uint32_t>(std::min<double>(start, max_time));
     
-    debug_file << "Sending NRPN - param: " << param->display_name 
-              << ", NRPN: " << nrpn_param << ", value: " << nrpn_value << std::endl;
+    SPOBX8_TRACE_INSTANT("sequencer", "queue_writes", static_cast<int64_t>(bytes));
+    if (output_merger_.pushSequence(time, outgoing_scratch_.data(), outgoing_scratch_.size())) {
+        return;
+    }
     
-    // Send NRPN to hardware via MIDI device manager - suppress feedback
-    suppress_feedback_ = true;
-    midi_handler_->sendNRPN(nrpn_param, nrpn_value);
-    suppress_feedback_ = false;
+    // Lost: neither the lock nor the restored value can be assumed on the hardware
+    for (uint32_t id : sequencer_written_) {
+        last_sent_nrpn_value_[id].store(-1, std::memory_order_relaxed);
+        lock_on_hardware_[id] = true;
+    }
+    metrics_.add(METRIC_SEND_FAILURES);
+}
+
+void OBX8Plugin::updateSequencerWriteBytes() {
+    // Worst case per write: a CC where one carries the parameter exactly, else a
+    // full NRPN (relative updates are only ever chosen when smaller)
+    bool smallest = sequencer_encoding_ < 0.5;
+    for (const auto& param : param_manager_->getParameters()) {
+        uint8_t bytes = 0;
+        if (param.nrpn_msb != 0 || param.nrpn_lsb != 0) {
+            bytes = smallest && param_manager_->getExactCC(param.id) != 0 ? CC_WRITE_BYTES : NRPN_ABSOLUTE_BYTES;
+        }
+        step_sequencer_.setWriteBytes(param.id, bytes);
+    }
+}
+
+bool OBX8Plugin::setStepLock(uint32_t step, clap_id param_id, double value) {
+    const OBX8Parameter* param = param_manager_->getParameterById(param_id);
+    if (!param || (param->nrpn_msb == 0 && param->nrpn_lsb == 0) || step >= StepSequencer::MAX_STEPS) {
+        return false;
+    }
+    step_sequencer_.setLock(step, param_id, value);
+    return true;
+}
+
+void OBX8Plugin::clearStepLock(uint32_t step, clap_id param_id) {
+    step_sequencer_.clearLock(step, param_id);
+}
+
+void OBX8Plugin::recordStepLock(clap_id param_id, double value) {
+    // Lock record: edits land on the chosen step instead of only moving the value
+    uint32_t record_step = static_cast<uint32_t>(param_store_->load(SEQUENCER_RECORD_STEP));
+    if (record_step > 0 && setStepLock(record_step - 1, param_id, value)) {
+        SPOBX8_TRACE_INSTANT("sequencer", "record_lock", param_id);
+    }
+}
+
+void OBX8Plugin::warnUndeliverableSteps() {
+    uint32_t steps = step_sequencer_.getUndeliverableSteps();
+    if (steps == 0) {
+        return;
+    }
     
-    // Get outgoing MIDI messages and send them through device manager
-    std::vector<MidiMessage> messages;
-    midi_handler_->getOutgoingMessages(messages);
+    std::string step_list;
+    for (uint32_t step = 0; step < StepSequencer::MAX_STEPS; ++step) {
+        if (steps & (1u << step)) {
+            step_list += (step_list.empty() ? "" : ", ") + std::to_string(step + 1);
+        }
+    }
+    bool several = (steps & (steps - 1)) != 0;
+    char message[256];
+    snprintf(message, sizeof(message),
+             "Step sequencer: %s %s %s up to %u bytes, but at %.1f BPM the MIDI link carries %u per step; "
+             "the writes that don't fit are dropped",
+             several ? "steps" : "step", step_list.c_str(), several ? "need" : "needs",
+             step_sequencer_.getWorstStepBytes(), step_sequencer_.getCheckedTempo(),
+             step_sequencer_.getStepBudgetBytes());
     
-    debug_file << "Got " << messages.size() << " MIDI messages" << std::endl;
+    std::ofstream debug_file = openDebugLog();
+    debug_file << message << std::endl;
+    debug_file.close();
     
-    for (const auto& msg : messages) {
-        uint8_t midi_data[3] = {msg.status, msg.data1, msg.data2};
-        debug_file << "MIDI out: " << std::hex << (int)msg.status 
-                  << " " << (int)msg.data1 << " " << (int)msg.data2 << std::dec << std::endl;
-        bool sent = midi_device_manager_->sendMidiData(midi_data, 3);
-        debug_file << "Send result: " << (sent ? "success" : "failed") << std::endl;
+    const clap_host_log_t* host_log = nullptr;
+    if (host_ && host_->get_extension) {
+        host_log = static_cast<const clap_host_log_t*>(host_->get_extension(host_, CLAP_EXT_LOG));
     }
+    if (host_log && host_log->log) {
+        host_log->log(host_, CLAP_LOG_WARNING, message);
+    } else {
+        std::cerr << message << std::endl;
+    }
+}
+
+void OBX8Plugin::updateOutputTimeline() {
+    double error = static_cast<double>(block_time_ns_) - output_timeline_ns_;
+    double block_ms = max_frames_ * 1000.0 / sample_rate_;
+    double resync_ns = std::max(OUTPUT_TIMELINE_RESYNC_MS, 2.0 * block_ms) * 1e6;
     
-    debug_file << "=== sendParameterToHardware end ===" << std::endl;
-    debug_file.close();
+    if (output_timeline_ns_ == 0.0 || std::abs(error) > resync_ns) {
+        output_timeline_ns_ = static_cast<double>(block_time_ns_);
+    } else {
+        output_timeline_ns_ += error * OUTPUT_TIMELINE_GAIN;
+    }
 }
 
-void OBX8Plugin::processIncomingMidi(const clap_input_events_t *in_events) {
-    std::ofstream debug_file("/tmp/spobx8_debug.log", std::ios::app);
-    debug_file << "=== processIncomingMidi called ===" << std::endl;
+uint64_t OBX8Plugin::getDeviceTimeNs(uint32_t sample_time) const {
+    // Audio rendered in this block plays about one buffer later, and scheduling
+    // that far ahead keeps the timestamps in the future despite call jitter; the
+    // measured output lookahead adds the device's own delay on top
+    uint32_t lookahead_frames = max_frames_ > 0 ? max_frames_ : current_block_frames_;
+    return static_cast<uint64_t>(output_timeline_ns_ + (lookahead_frames + sample_time) * 1e9 / sample_rate_ +
+                                 getOutputLookaheadMs() * 1e6);
+}
+
+void OBX8Plugin::processOutgoingMidi(const clap_output_events_t *out_events) {
+    SPOBX8_TRACE_SCOPE("midi_out", "merge_output", 0);
+    
+    // Packets queued outside process() (host-routed edits from a flush) predate
+    // everything merged in this block
+    midi_handler_->getOutgoingPackets(outgoing_scratch_);
+    if (!output_merger_.pushBulk(0, outgoing_scratch_.data(), outgoing_scratch_.size())) {
+        forgetHardwareValues(outgoing_scratch_.data(), outgoing_scratch_.size());
+        metrics_.add(METRIC_SEND_FAILURES);
+    }
     
-    uint32_t event_count = in_events->size(in_events);
-    debug_file << "Event count: " << event_count << std::endl;
+    // The merger orders the block by event time, so clamping into the block keeps
+    // times non-decreasing; each packet's MIDI 1.0 messages go out together
+    bool host_routed = getOutputRoute() == OUTPUT_ROUTE_HOST;
+    uint32_t max_time = current_block_frames_ > 0 ? current_block_frames_ - 1 : 0;
+    bool host_queue_full = false;
     
-    for (uint32_t i = 0; i < event_count; ++i) {
-        const clap_event_header_t *header = in_events->get(in_events, i);
-        debug_file << "Event " << i << " type: " << header->type << " (CLAP_EVENT_PARAM_VALUE=" << CLAP_EVENT_PARAM_VALUE << ")" << std::endl;
+    output_merger_.drain([&](uint32_t event_time, const UmpPacket& packet) {
+        uint32_t time = std::min(event_time, max_time);
+        pushGestureEvents(out_events, time);
+        
+        if (!host_routed) {
+            // Direct output is scheduled at the event's offset from the block start,
+            // one write per packet so an NRPN reaches the driver in one piece
+            uint8_t bytes[UmpMidi1Encoder::MAX_BYTES];
+            size_t length = midi1_encoder_.encodeBytes(packet, bytes);
+            if (length == 0) {
+                return;
+            }
+            // Faster than real time the device timeline means nothing; send now at wire pace
+            uint64_t timestamp_ns = 0;
+            if (render_offline_) {
+                paceToWire(length);
+            } else if (block_time_ns_ != 0) {
+                timestamp_ns = getDeviceTimeNs(time);
+            }
+            if (!sendToDevice(bytes, length, timestamp_ns)) {
+                // The hardware's NRPN address and this parameter's value are now unknown
+                midi1_encoder_.invalidateSelectedNRPN();
+                forgetHardwareValues(&packet, 1);
+            }
+            return;
+        }
         
-        if (header->type == CLAP_EVENT_MIDI) {
-            const clap_event_midi_t *midi_event = 
-                reinterpret_cast<const clap_event_midi_t*>(header);
+        if (host_queue_full) {
+            forgetHardwareValues(&packet, 1);
+            return;
+        }
+        MidiMessage messages[UmpMidi1Encoder::MAX_MESSAGES];
+        size_t count = midi1_encoder_.encode(packet, messages);
+        for (size_t i = 0; i < count; ++i) {
+            const MidiMessage& msg = messages[i];
+            
+            clap_event_midi_t midi_event;
+            midi_event.header.size = sizeof(clap_event_midi_t);
+            midi_event.header.time = time;
+            midi_event.header.space_id = CLAP_CORE_EVENT_SPACE_ID;
+            midi_event.header.type = CLAP_EVENT_MIDI;
+            midi_event.header.flags = 0;
+            midi_event.port_index = 0;
+            midi_event.data[0] = msg.status;
+            midi_event.data[1] = msg.data1;
+            midi_event.data[2] = msg.data2;
             
-            MidiMessage msg;
-            msg.status = midi_event->data[0];
-            msg.data1 = midi_event->data[1];
-            msg.data2 = midi_event->data[2];
-            msg.timestamp = header->time;
+            if (!out_events->try_push(out_events, &midi_event.header)) {
+                // Host queue full - drop the rest rather than send data without its address
+                midi1_encoder_.invalidateSelectedNRPN();
+                forgetHardwareValues(&packet, 1);
+                metrics_.add(METRIC_SEND_FAILURES);
+                host_queue_full = true;
+                break;
+            }
+            
+            metrics_.add(METRIC_BYTES_SENT, UmpMidi1Encoder::messageLength(msg));
+            ++block_message_count_;
             
-            midi_handler_->processMidiMessage(msg);
-            debug_file << "Processed MIDI event" << std::endl;
-        } else if (header->type == CLAP_EVENT_PARAM_VALUE) {
-            // Skip parameter events here - they're handled in params_flush()
-            debug_file << "Skipping parameter event in processIncomingMidi (handled in params_flush)" << std::endl;
+            if (capture_.isActive()) {
+                CaptureHostMidi record = {time, {msg.status, msg.data1, msg.data2}, 0};
+                capture_.record(CAPTURE_HOST_MIDI_OUT, getEventTimeNs(), &record, sizeof(record));
+            }
+        }
+    });
+    pushGestureEvents(out_events, max_time);
+}
+
+void OBX8Plugin::applyEditorEdits(const clap_output_events_t *out_events) {
+    // The host records editor moves as gestures; the hardware gets them like automation
+    EditorEdit edit;
+    while (editor_edits_.pop(edit)) {
+        if (edit.param_id >= param_store_->size()) {
+            continue;
+        }
+        
+        bool pushed = true;
+        if (edit.type == EDITOR_EDIT_VALUE) {
+            handleParameterChange(edit.param_id, edit.value, 0, PARAM_SOURCE_PLUGIN);
+            if (out_events) {
+                clap_event_param_value_t event = {};
+                event.header = {sizeof(event), 0, CLAP_CORE_EVENT_SPACE_ID, CLAP_EVENT_PARAM_VALUE, 0};
+                event.param_id = edit.param_id;
+                event.note_id = -1;
+                event.port_index = -1;
+                event.channel = -1;
+                event.key = -1;
+                event.value = edit.value;
+                pushed = out_events->try_push(out_events, &event.header);
+            }
+        } else if (out_events) {
+            clap_event_param_gesture_t event = {};
+            uint16_t type = edit.type == EDITOR_EDIT_BEGIN ? CLAP_EVENT_PARAM_GESTURE_BEGIN : CLAP_EVENT_PARAM_GESTURE_END;
+            event.header = {sizeof(event), 0, CLAP_CORE_EVENT_SPACE_ID, type, 0};
+            event.param_id = edit.param_id;
+            pushed = out_events->try_push(out_events, &event.header);
+        }
+        if (!pushed) {
+            metrics_.add(METRIC_SEND_FAILURES);
         }
     }
-    
-    debug_file << "=== processIncomingMidi end ===" << std::endl;
-    debug_file.close();
 }
 
-void OBX8Plugin::processOutgoingMidi(const clap_output_events_t *out_events) {
-    std::vector<MidiMessage> messages;
-    midi_handler_->getOutgoingMessages(messages);
+void OBX8Plugin::onEditorEdit() {
+    // A sleeping or stopped audio thread won't look at the queue by itself
+    wakeProcessing();
+    if (!is_processing_.load(std::memory_order_acquire) && host_ && host_->get_extension) {
+        const clap_host_params_t* host_params =
+            static_cast<const clap_host_params_t*>(host_->get_extension(host_, CLAP_EXT_PARAMS));
+        if (host_params && host_params->request_flush) {
+            host_params->request_flush(host_);
+        }
+    }
+}
+
+void OBX8Plugin::pushGestureEvents(const clap_output_events_t *out_events, uint32_t up_to_time) {
+    // Placed in the block like the hardware input they came from; older ones at 0
+    double samples_per_ns = block_time_ns_ > window_start_ns_
+        ? current_block_frames_ / double(block_time_ns_ - window_start_ns_) : 0.0;
+    double last_frame = current_block_frames_ > 0 ? current_block_frames_ - 1 : 0;
     
-    for (const auto& msg : messages) {
-        clap_event_midi_t midi_event;
-        midi_event.header.size = sizeof(clap_event_midi_t);
-        midi_event.header.time = msg.timestamp;
-        midi_event.header.space_id = CLAP_CORE_EVENT_SPACE_ID;
-        midi_event.header.type = CLAP_EVENT_MIDI;
-        midi_event.header.flags = 0;
-        midi_event.port_index = 0;
-        midi_event.data[0] = msg.status;
-        midi_event.data[1] = msg.data1;
-        midi_event.data[2] = msg.data2;
+    while (gesture_event_index_ < gesture_event_count_) {
+        const GestureEvent& gesture = gesture_events_[gesture_event_index_];
+        double offset = gesture.time_ns > window_start_ns_ ? (gesture.time_ns - window_start_ns_) * samples_per_ns : 0.0;
+        uint32_t time = static_cast<uint32_t>(std::min(offset, last_frame));
+        if (time > up_to_time) {
+            return;
+        }
+        ++gesture_event_index_;
         
-        out_events->try_push(out_events, &midi_event.header);
+        const OBX8Parameter* param = param_manager_->getParameterById(gesture.param_id);
+        if (!param || !out_events) {
+            continue;
+        }
+        
+        bool pushed;
+        if (gesture.type == GESTURE_POINT) {
+            clap_event_param_value_t event = {};
+            event.header = {sizeof(event), time, CLAP_CORE_EVENT_SPACE_ID, CLAP_EVENT_PARAM_VALUE, 0};
+            event.param_id = gesture.param_id;
+            event.note_id = -1;
+            event.port_index = -1;
+            event.channel = -1;
+            event.key = -1;
+            event.value = normalizeParameterValue(param, gesture.value);
+            pushed = out_events->try_push(out_events, &event.header);
+            metrics_.add(METRIC_GESTURE_POINTS);
+        } else {
+            clap_event_param_gesture_t event = {};
+            uint16_t type = gesture.type == GESTURE_BEGIN ? CLAP_EVENT_PARAM_GESTURE_BEGIN : CLAP_EVENT_PARAM_GESTURE_END;
+            event.header = {sizeof(event), time, CLAP_CORE_EVENT_SPACE_ID, type, 0};
+            event.param_id = gesture.param_id;
+            pushed = out_events->try_push(out_events, &event.header);
+        }
+        if (!pushed) {
+            metrics_.add(METRIC_SEND_FAILURES);
+        }
     }
 }
 
+OutputRoute OBX8Plugin::getOutputRoute() const {
+    return param_store_->load(MIDI_OUTPUT_ROUTE) >= 0.5 ? OUTPUT_ROUTE_HOST : OUTPUT_ROUTE_DIRECT;
+}
+
 void OBX8Plugin::onNRPNReceived(uint16_t parameter, uint16_t value) {
+    metrics_.add(METRIC_NRPN_RECEIVED);
+    
+    // Echo of a latency probe - the value is unchanged, so nothing to report, but
+    // the new measurement may move the output lookahead
+    if (latency_probe_.onNRPNReceived(parameter, value, inbound_time_ns_)) {
+        main_thread_queue_.post(MAIN_TASK_LATENCY_CHANGED);
+        return;
+    }
+    
     // Skip feedback if this NRPN was sent by automation
-    if (suppress_feedback_) {
+    if (suppress_feedback_.load(std::memory_order_acquire)) {
         return;
     }
     
@@ -512,69 +2022,80 @@ void OBX8Plugin::onNRPNReceived(uint16_t parameter, uint16_t value) {
     
     const OBX8Parameter* param = param_manager_->getParameterByNRPN(nrpn_msb, nrpn_lsb);
     if (param) {
-        double normalized_value = nrpnToParameterValue(param, value);
-        param_values_[param->id] = normalized_value;
-        
-        // Notify host of parameter change (only for hardware knob changes)
-        if (host_ && host_->request_callback) {
-            host_->request_callback(host_);
+        // Echo of the value we last wrote - the hardware matches the store already
+        int32_t previous = last_sent_nrpn_value_[param->id].exchange(value, std::memory_order_relaxed);
+        if (previous == value) {
+            return;
         }
+        
+        double normalized_value = nrpnToParameterValue(param, value);
+        setNormalizedValue(param->id, normalized_value, PARAM_SOURCE_HARDWARE);
+        recordStepLock(param->id, normalized_value);
+        notifyParameterChanged(param->id);
+        recordGestureValue(param, static_cast<int>(std::min(param->max_value, param->min_value + value)));
+    }
+}
+
+void OBX8Plugin::onNRPNIncrementReceived(uint16_t parameter, int steps) {
+    const OBX8Parameter* param = param_manager_->getParameterByNRPN((parameter >> 7) & 0x7F, parameter & 0x7F);
+    if (!param || param->id >= param_store_->size()) {
+        return;
+    }
+    
+    // Step from what the hardware last reported, or from the stored value
+    int32_t current = last_sent_nrpn_value_[param->id].load(std::memory_order_relaxed);
+    if (current < 0) {
+        current = parameterToNRPNValue(param, getNormalizedValue(param->id));
     }
+    int32_t range = OBX8ParameterManager::nrpnValueRange(param);
+    onNRPNReceived(parameter, static_cast<uint16_t>(std::max(0, std::min(range, current + steps))));
 }
 
 void OBX8Plugin::onCCReceived(uint8_t cc, uint8_t value) {
+    metrics_.add(METRIC_CC_RECEIVED);
+    
     const OBX8Parameter* param = param_manager_->getParameterByCC(cc);
     if (param) {
-        double normalized_value = static_cast<double>(value) / 127.0;
-        param_values_[param->id] = normalized_value;
-        
-        // Notify host of parameter change
-        if (host_ && host_->request_callback) {
-            host_->request_callback(host_);
-        }
+        // The CC value goes through the parameter's range like NRPN data; a scaled
+        // value says nothing exact about the hardware's NRPN value
+        int hardware_value = OBX8ParameterManager::ccToHardwareValue(param, value);
+        double normalized_value = normalizeParameterValue(param, hardware_value);
+        setNormalizedValue(param->id, normalized_value, PARAM_SOURCE_HARDWARE);
+        recordStepLock(param->id, normalized_value);
+        last_sent_nrpn_value_[param->id].store(
+            OBX8ParameterManager::isCCValueExact(param) ? hardware_value - static_cast<int>(param->min_value) : -1,
+            std::memory_order_relaxed);
+        notifyParameterChanged(param->id);
+        recordGestureValue(param, hardware_value);
     }
 }
 
-double OBX8Plugin::normalizeParameterValue(const OBX8Parameter* param, double value) const {
-    // For stepped parameters with multiple steps, normalize differently for DAW compatibility
-    if (param->is_stepped && param->step_names.size() > 2) {
-        // Return the step index directly (0, 1, 2, 3, etc.)
-        return value;
+void OBX8Plugin::recordGestureValue(const OBX8Parameter* param, int hardware_value) {
+    // Knob moves on the hardware while processing become host automation gestures
+    if (inbound_from_hardware_ && block_time_ns_ != 0) {
+        gesture_recorder_.addValue(param->id, hardware_value, inbound_time_ns_);
+        metrics_.add(METRIC_GESTURE_VALUES);
     }
-    return (value - param->min_value) / (param->max_value - param->min_value);
+}
+
+double OBX8Plugin::normalizeParameterValue(const OBX8Parameter* param, double value) const {
+    return OBX8ParameterManager::normalizeParameterValue(param, value);
 }
 
 double OBX8Plugin::denormalizeParameterValue(const OBX8Parameter* param, double normalized) const {
-    // For stepped parameters with multiple steps, the value is already the step index
-    if (param->is_stepped && param->step_names.size() > 2) {
-        return normalized;
-    }
-    return param->min_value + normalized * (param->max_value - param->min_value);
+    return OBX8ParameterManager::denormalizeParameterValue(param, normalized);
+}
+
+int OBX8Plugin::parameterToHardwareValue(const OBX8Parameter* param, double value) const {
+    return OBX8ParameterManager::parameterToHardwareValue(param, value);
 }
 
 uint16_t OBX8Plugin::parameterToNRPNValue(const OBX8Parameter* param, double value) {
-    double actual_value = denormalizeParameterValue(param, value);
-    
-    // For stepped parameters, ensure we get exact integer values
-    if (param->is_stepped) {
-        actual_value = std::round(actual_value);
-        // Clamp to valid range
-        actual_value = std::max(param->min_value, std::min(param->max_value, actual_value));
-    }
-    
-    // Use the actual parameter range from the OBX8 manual, not 14-bit range
-    // The manual specifies exact ranges for each parameter
-    return static_cast<uint16_t>(actual_value);
+    return OBX8ParameterManager::parameterToNRPNValue(param, value);
 }
 
 double OBX8Plugin::nrpnToParameterValue(const OBX8Parameter* param, uint16_t nrpn_value) {
-    // Convert from hardware value directly to parameter value
-    double actual_value = static_cast<double>(nrpn_value);
-    
-    // Clamp to parameter range
-    actual_value = std::max(param->min_value, std::min(param->max_value, actual_value));
-    
-    return normalizeParameterValue(param, actual_value);
+    return OBX8ParameterManager::nrpnToParameterValue(param, nrpn_value);
 }
 
 void OBX8Plugin::onMidiDeviceSelected(clap_id param_id, double value) {
@@ -582,6 +2103,10 @@ void OBX8Plugin::onMidiDeviceSelected(clap_id param_id, double value) {
         return;
     }
     
+    if (!midi_ready_) {
+        return; // Device list not enumerated yet
+    }
+    
     auto device_names = midi_device_manager_->getDeviceNames();
     int device_index = static_cast<int>(denormalizeParameterValue(
         param_manager_->getParameterById(param_id), value));
@@ -590,7 +2115,7 @@ void OBX8Plugin::onMidiDeviceSelected(clap_id param_id, double value) {
         std::string selected_device = device_names[device_index];
         
         if (selected_device != "None") {
-            midi_device_manager_->selectDevice(selected_device);
+            selectMidiDevice(selected_device);
         }
     }
 }
@@ -598,21 +2123,23 @@ void OBX8Plugin::onMidiDeviceSelected(clap_id param_id, double value) {
 void OBX8Plugin::updateMidiDeviceList() {
     midi_device_manager_->refreshDeviceList();
     
-    // Update the parameter's step names to reflect current devices
+    // The device names are the selection parameter's value texts. Its range and
+    // value conversion don't depend on them, so an active host only has to
+    // re-read the texts, and only when the list actually changed.
     std::vector<std::string> device_names = midi_device_manager_->getDeviceNames();
-    param_manager_->updateParameterStepNames(MIDI_DEVICE_SELECTION, device_names);
-    
-    // Notify host that parameter info has changed
-    if (host_ && host_->request_restart) {
-        host_->request_restart(host_);
+    if (!param_manager_->updateParameterStepNames(MIDI_DEVICE_SELECTION, device_names)) {
+        return;
     }
+    display_table_.invalidate(MIDI_DEVICE_SELECTION);
+    rescanHostParams(CLAP_PARAM_RESCAN_INFO | CLAP_PARAM_RESCAN_TEXT);
 }
 
 bool OBX8Plugin::state_save(const clap_ostream_t *stream) const {
     try {
-        // Create a simple state format: version + parameter count + parameter values
-        uint32_t version = 1;
-        uint32_t param_count = static_cast<uint32_t>(param_values_.size());
+        // Create a simple state format: version + parameter count + parameter values,
+        // then the device name and (since version 2) the step sequencer locks
+        uint32_t version = 2;
+        uint32_t param_count = static_cast<uint32_t>(param_store_->size());
         
         // Write version
         if (stream->write(stream, &version, sizeof(version)) != sizeof(version)) {
@@ -625,15 +2152,16 @@ bool OBX8Plugin::state_save(const clap_ostream_t *stream) const {
         }
         
         // Write all parameter values
-        for (const auto& value : param_values_) {
-            double param_value = value;
+        for (uint32_t i = 0; i < param_count; ++i) {
+            double param_value = getNormalizedValue(i);
             if (stream->write(stream, &param_value, sizeof(param_value)) != sizeof(param_value)) {
                 return false;
             }
         }
         
         // Write selected MIDI device name (if any)
-        std::string selected_device = midi_device_manager_->getSelectedDeviceName();
+        std::string selected_device = midi_ready_ ? midi_device_manager_->getSelectedDeviceName()
+                                                  : pending_device_name_;
         uint32_t device_name_length = static_cast<uint32_t>(selected_device.length());
         
         if (stream->write(stream, &device_name_length, sizeof(device_name_length)) != sizeof(device_name_length)) {
@@ -646,6 +2174,33 @@ bool OBX8Plugin::state_save(const clap_ostream_t *stream) const {
             }
         }
         
+        // Step sequencer locks as (step, parameter, value); the length is a parameter.
+        // The count comes from the same scan as the locks written, so an edit racing
+        // the save can't make them disagree; an empty pattern isn't scanned at all.
+        bool has_locks = step_sequencer_.getLockCount() != 0;
+        uint32_t lock_count = 0;
+        double lock_value;
+        for (uint32_t step = 0; has_locks && step < StepSequencer::MAX_STEPS; ++step) {
+            for (uint32_t id = 0; id < param_count; ++id) {
+                lock_count += step_sequencer_.getLock(step, id, &lock_value) ? 1 : 0;
+            }
+        }
+        if (stream->write(stream, &lock_count, sizeof(lock_count)) != sizeof(lock_count)) {
+            return false;
+        }
+        for (uint32_t step = 0; lock_count != 0 && step < StepSequencer::MAX_STEPS; ++step) {
+            for (uint32_t id = 0; id < param_count; ++id) {
+                if (!step_sequencer_.getLock(step, id, &lock_value)) {
+                    continue;
+                }
+                if (stream->write(stream, &step, sizeof(step)) != sizeof(step) ||
+                    stream->write(stream, &id, sizeof(id)) != sizeof(id) ||
+                    stream->write(stream, &lock_value, sizeof(lock_value)) != sizeof(lock_value)) {
+                    return false;
+                }
+            }
+        }
+        
         return true;
     } catch (...) {
         return false;
@@ -661,7 +2216,7 @@ bool OBX8Plugin::state_load(const clap_istream_t *stream) {
         }
         
         // Check version compatibility
-        if (version != 1) {
+        if (version != 1 && version != 2) {
             return false; // Unsupported version
         }
         
@@ -672,7 +2227,7 @@ bool OBX8Plugin::state_load(const clap_istream_t *stream) {
         }
         
         // Ensure parameter count matches current plugin
-        if (param_count > param_values_.size()) {
+        if (param_count > param_store_->size()) {
             return false; // Invalid parameter count
         }
         
@@ -683,8 +2238,8 @@ bool OBX8Plugin::state_load(const clap_istream_t *stream) {
                 return false;
             }
             
-            if (i < param_values_.size()) {
-                param_values_[i] = param_value;
+            if (i < param_store_->size()) {
+                setNormalizedValue(i, param_value, PARAM_SOURCE_STATE);
             }
         }
         
@@ -703,13 +2258,39 @@ bool OBX8Plugin::state_load(const clap_istream_t *stream) {
             
             std::string device_name(device_name_buffer.data());
             
-            // Try to select the saved MIDI device
-            midi_device_manager_->selectDevice(device_name);
+            // Try to select the saved MIDI device, or remember it until the
+            // deferred MIDI setup has enumerated devices
+            if (midi_ready_) {
+                selectMidiDevice(device_name);
+            } else {
+                pending_device_name_ = device_name;
+            }
+        }
+        
+        // Step sequencer locks; a version 1 state has none
+        step_sequencer_.clear();
+        if (version >= 2) {
+            uint32_t lock_count;
+            if (stream->read(stream, &lock_count, sizeof(lock_count)) != sizeof(lock_count) ||
+                lock_count > StepSequencer::MAX_STEPS * param_store_->size()) {
+                return false;
+            }
+            for (uint32_t i = 0; i < lock_count; ++i) {
+                uint32_t step;
+                uint32_t lock_param_id;
+                double lock_value;
+                if (stream->read(stream, &step, sizeof(step)) != sizeof(step) ||
+                    stream->read(stream, &lock_param_id, sizeof(lock_param_id)) != sizeof(lock_param_id) ||
+                    stream->read(stream, &lock_value, sizeof(lock_value)) != sizeof(lock_value)) {
+                    return false;
+                }
+                setStepLock(step, lock_param_id, lock_value);
+            }
         }
         
         // Notify host that parameters have changed
-        if (host_ && host_->request_callback) {
-            host_->request_callback(host_);
+        for (uint32_t i = 0; i < param_count; ++i) {
+            notifyParameterChanged(i);
         }
         
         return true;
@@ -719,9 +2300,30 @@ bool OBX8Plugin::state_load(const clap_istream_t *stream) {
 }
 
 uint64_t OBX8Plugin::getCurrentTimeMs() const {
+    return getCurrentTimeNs() / 1000000;
+}
+
+uint64_t OBX8Plugin::getEventTimeNs() const {
+    // Everything done for one block shares its start time, so timers don't depend
+    // on how long the block takes and a replay sees the same times
+    return block_time_ns_ != 0 ? block_time_ns_ : getCurrentTimeNs();
+}
+
+uint64_t OBX8Plugin::getRenderTimeNs(uint32_t sample_time) const {
+    // Offline the event's own song position: blocks then carry no wall time at all
+    if (render_offline_ && block_time_ns_ != 0) {
+        return render_time_ns_ + static_cast<uint64_t>(sample_time * 1e9 / sample_rate_);
+    }
+    return getEventTimeNs();
+}
+
+uint64_t OBX8Plugin::getCurrentTimeNs() const {
+    if (time_source_ns_) {
+        return time_source_ns_();
+    }
     auto now = std::chrono::steady_clock::now();
     auto duration = now.time_since_epoch();
-    return std::chrono::duration_cast<std::chrono::milliseconds>(duration).count();
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count();
 }
 
 void OBX8Plugin::autoSelectFirstOBX8Device() {
@@ -732,10 +2334,10 @@ void OBX8Plugin::autoSelectFirstOBX8Device() {
         const std::string& device_name = device_names[i];
         if (device_name.find("Oberheim OB-X8") != std::string::npos) {
             // Set MIDI device parameter to this device
-            param_values_[MIDI_DEVICE_SELECTION] = static_cast<double>(i);
+            param_store_->store(MIDI_DEVICE_SELECTION, static_cast<double>(i), PARAM_SOURCE_PLUGIN);
             
             // Actually select the device
-            midi_device_manager_->selectDevice(device_name);
+            selectMidiDevice(device_name);
             return;
         }
     }
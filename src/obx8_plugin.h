@@ -3,8 +3,38 @@
 #include "obx8_parameters.h"
 #include "midi_handler.h"
 #include "midi_device_manager.h"
+#include "plugin_metrics.h"
+#include "latency_probe.h"
+#include "param_display_table.h"
+#include "parameter_store.h"
+#include "midi_stream_parser.h"
+#include "patch_cache.h"
+#include "midi_capture.h"
+#include "midi_output_merger.h"
+#include "ump_midi1_encoder.h"
+#include "midi_clock.h"
+#include "step_sequencer.h"
+#include "gesture_recorder.h"
+#include "render_pacer.h"
+#include "editor_edit_queue.h"
+#include "editor_view.h"
+#include "editor_window.h"
+#include "main_thread_queue.h"
+#include "event_router.h"
 #include <vector>
 #include <memory>
+#include <fstream>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <string>
+#include <functional>
+
+// Where outgoing hardware MIDI goes
+enum OutputRoute {
+    OUTPUT_ROUTE_DIRECT = 0,  // straight to the selected MIDI device
+    OUTPUT_ROUTE_HOST = 1     // through the CLAP note port, using the DAW's MIDI routing and timing
+};
 
 class OBX8Plugin {
 public:
@@ -35,6 +65,13 @@ public:
     uint32_t note_ports_count(bool is_input) const;
     bool note_ports_get(uint32_t index, bool is_input, clap_note_port_info_t *info) const;
     
+    // Latency extension
+    uint32_t latency_get() const;
+    
+    // Render extension - the hardware only plays in real time
+    bool render_has_hard_realtime_requirement() const { return true; }
+    bool render_set(clap_plugin_render_mode mode);
+    
     // State extension
     bool state_save(const clap_ostream_t *stream) const;
     bool state_load(const clap_istream_t *stream);
@@ -56,6 +93,63 @@ public:
     bool gui_show();
     bool gui_hide();
     
+    // The editor created by gui_create(), null without one. With the
+    // EditorView::HEADLESS_API it has no window and is drawn by calling update().
+    EditorView* getEditorView() const { return editor_view_.get(); }
+    
+    // Diagnostics - safe to poll from any thread without disturbing process()
+    MetricsSnapshot getMetricsSnapshot() const { return metrics_.snapshot(); }
+    void resetMetrics() { metrics_.reset(); }
+    
+    // Round-trip latency measurement against the selected device
+    void setLatencyProbeEnabled(bool enabled);
+    LatencyStats getLatencyStats() const { return latency_probe_.getStats(); }
+    std::map<std::string, LatencyStats> getLatencyStatsByDevice() const { return latency_probe_.getAllStats(); }
+    double getOutputLookaheadMs() const;
+    
+    // Main thread - select a MIDI device by name (including the loopback stand-in)
+    bool selectMidiDevice(const std::string& device_name);
+    bool isMidiReady() const { return midi_ready_; }
+    
+    // Automation recorded from the hardware: allowed deviation of the thinned
+    // gesture in hardware steps, and the pause that ends a gesture
+    void setGestureTolerance(double steps) { gesture_recorder_.setTolerance(steps); }
+    void setGestureIdleTimeoutMs(double timeout_ms) {
+        gesture_recorder_.setIdleTimeoutNs(static_cast<uint64_t>(timeout_ms * 1e6));
+    }
+    
+    // How long a data entry MSB from the hardware waits for its LSB
+    void setDataEntryTimeoutMs(double timeout_ms) {
+        midi_handler_->setDataEntryTimeoutNs(static_cast<uint64_t>(timeout_ms * 1e6));
+    }
+    
+    // Background program dump prefetch for the current bank (direct route only).
+    // Off by default: the dump format in program_dump.h is unverified on hardware.
+    void setProgramPrefetchEnabled(bool enabled);
+    size_t getCachedProgramCount() const { return patch_cache_.size(); }
+    
+    // Binary capture of MIDI traffic and host events (also enabled by the
+    // SPOBX8_CAPTURE environment variable); see midi_capture.h for the format
+    bool startCapture(const std::string& path);
+    void stopCapture() { capture_.stop(); }
+    bool isCapturing() const { return capture_.isActive(); }
+    
+    // Bytes from the MIDI device - called by the device manager's receive callback,
+    // and by the replay tool to feed captured input. arrival_ns is when the bytes
+    // arrived on the steady clock when the transport knows it, 0 for now.
+    void receiveMidiData(const uint8_t* data, size_t length, uint64_t arrival_ns = 0);
+    
+    // Replaces the steady clock behind every plugin timer (throttling, prefetch,
+    // latency probe). The replay tool drives it from captured timestamps.
+    void setTimeSource(std::function<uint64_t()> now_ns) { time_source_ns_ = now_ns; }
+    
+    // Step sequencer pattern. Locks take normalized values like the host and only
+    // hardware parameters can be locked; setStepLock returns false for the rest.
+    // Any thread. Saved with the plugin state.
+    bool setStepLock(uint32_t step, clap_id param_id, double value);
+    void clearStepLock(uint32_t step, clap_id param_id);
+    const StepSequencer& getStepSequencer() const { return step_sequencer_; }
+
 private:
     const clap_host_t *host_;
     std::unique_ptr<OBX8ParameterManager> param_manager_;
@@ -64,33 +158,227 @@ private:
     
     // Plugin state
     double sample_rate_;
+    uint32_t min_frames_;
+    uint32_t max_frames_;
     bool is_active_;
-    bool is_processing_;
+    std::atomic<bool> is_processing_;
+    
+    // Set when process() returned CLAP_PROCESS_SLEEP; whoever gives the audio
+    // thread work clears it and asks the host to resume processing
+    std::atomic<bool> process_sleeping_;
+    
+    // Deferred MIDI setup - transport opening and device enumeration run on a
+    // background thread started from activate() or the first main-thread callback,
+    // and the result is applied on the main thread.
+    std::thread midi_init_thread_;
+    std::atomic<bool> midi_init_started_;
+    std::atomic<bool> midi_ready_;
+    std::string pending_device_name_;
+    
+    // Work for the main thread from every other thread, run from on_main_thread()
+    // with at most one host callback request outstanding
+    MainThreadQueue main_thread_queue_;
+    std::vector<uint32_t> changed_param_ids_;
+    
+    // Parameter values, in hardware units - written from the audio, main and
+    // MIDI receive threads, read lock-free from all of them
+    std::unique_ptr<ParameterStore> param_store_;
+    
+    // Display strings and text parsing, built lazily per parameter (main thread only)
+    mutable ParameterDisplayTable display_table_;
+    
+    // Runtime metrics updated on the hot paths
+    PluginMetrics metrics_;
+    uint32_t block_message_count_;
+    
+    // Frames in the block being processed, 0 outside process() (host-routed output clamps to it)
+    uint32_t current_block_frames_;
     
-    // Parameter values
-    std::vector<double> param_values_;
+    // Clock reading at the start of the block being processed, 0 outside process()
+    uint64_t block_time_ns_;
     
-    // GUI state
+    // Offline and freewheel rendering. While the host runs faster than real time,
+    // render_offline_ is set and render_time_ns_ is the block's song position,
+    // from the host's sample counter (or the frames seen when it has none).
+    RenderPacer render_pacer_;
+    bool render_offline_;
+    uint64_t render_time_ns_;
+    int64_t rendered_frames_;
+    
+    // Host events, clock and hardware input of a block, merged by sample time
+    EventRouter event_router_;
+    
+    // When the MIDI being handled arrived (hardware) or was scheduled (host), and
+    // whether it came from the hardware
+    uint64_t inbound_time_ns_;
+    bool inbound_from_hardware_;
+    
+    // Outside process() hardware input is handled on the receive thread; the main
+    // thread takes this too when it times out a data entry MSB left waiting there.
+    // The audio thread never takes it.
+    std::mutex idle_inbound_mutex_;
+    // Arrival of the device bytes being parsed; device input thread
+    uint64_t device_arrival_ns_;
+    
+    // Hardware knob moves during processing, thinned into host automation gestures.
+    // Each block's events go out with the block's MIDI, merged by time; the
+    // window is the period hardware input of the block arrived in.
+    GestureRecorder gesture_recorder_;
+    const GestureEvent* gesture_events_;
+    size_t gesture_event_count_;
+    size_t gesture_event_index_;
+    uint64_t window_start_ns_;
+    
+    // MIDI going out during the block being processed: host notes and controllers
+    // forwarded on the priority lane and parameter edit packets, merged and sent
+    // once at the end of process() with their event times. Packets become MIDI 1.0
+    // only here, in the encoder, which also knows the NRPN selected on the wire.
+    MidiOutputMerger output_merger_;
+    UmpMidi1Encoder midi1_encoder_;
+    std::vector<UmpPacket> outgoing_scratch_;
+    
+    // MIDI clock and transport generated from the host timeline
+    MidiClockGenerator midi_clock_;
+    static const size_t MAX_CLOCK_MESSAGES_PER_BLOCK = 128;
+    TimedMidiMessage clock_messages_[MAX_CLOCK_MESSAGES_PER_BLOCK];
+    
+    // Parameter-lock step sequencer following the host transport. Step writes go
+    // out on the merger's sequence lane, ahead of live edits. lock_on_hardware_
+    // marks parameters the hardware may still hold a lock value for; the encoding
+    // setting the write sizes were computed for is kept to notice a change.
+    StepSequencer step_sequencer_;
+    ScheduledStep scheduled_steps_[StepSequencer::MAX_STEPS_PER_BLOCK];
+    std::unique_ptr<bool[]> lock_on_hardware_;
+    std::vector<uint32_t> sequencer_written_;
+    double sequencer_encoding_;
+    // Undeliverable steps last reported, so each change of the check warns once
+    uint32_t reported_undeliverable_steps_;
+    
+    // Device-clock time of the current block's first sample, for scheduling direct
+    // output. process() calls arrive with scheduling jitter, so this runs as a
+    // sample clock advanced by each block's duration and only pulled gently toward
+    // the measured call times; 0 until the first block.
+    double output_timeline_ns_;
+    
+    // Last NRPN value written to (or reported by) the hardware per parameter,
+    // -1 when unknown. Writes it already holds are skipped and relative updates
+    // are computed from it, so every write that fails to go out resets its entry.
+    std::unique_ptr<std::atomic<int32_t>[]> last_sent_nrpn_value_;
+    
+    // Relative (CC96/CC97) updates sent per parameter since its last absolute write
+    std::unique_ptr<uint8_t[]> relative_updates_since_absolute_;
+    
+    // Incoming byte stream from the device, split into messages and SysEx
+    MidiStreamParser stream_parser_;
+    
+    // Program dumps cached per bank/program. Dumps are decoded and a program
+    // change applies the cached values on the main thread; the audio thread
+    // requests missing dumps of the current bank while the link is idle, one at a
+    // time. Keys are PatchCache::makeKey() values, -1 for none.
+    PatchCache patch_cache_;
+    std::atomic<int32_t> current_program_key_;
+    std::atomic<bool> program_awaiting_dump_;
+    std::atomic<int32_t> prefetch_key_;
+    std::atomic<int32_t> prefetch_outstanding_key_;
+    std::atomic<uint32_t> prefetch_timeouts_;
+    std::atomic<bool> prefetch_enabled_;
+    uint64_t prefetch_sent_ms_;
+    uint64_t last_live_edit_ms_;
+    
+    // Traffic capture and the clock override used when replaying one
+    MidiCapture capture_;
+    std::function<uint64_t()> time_source_ns_;
+    
+    // Round-trip latency probe. The reported plugin latency is fixed at activate();
+    // once the estimate moves further than this from it the host is asked to restart.
+    static constexpr double LATENCY_RESTART_THRESHOLD_MS = 1.0;
+    LatencyProbe latency_probe_;
+    uint32_t reported_latency_samples_;
+    bool latency_restart_requested_;
+    size_t next_probe_param_index_;
+    
+    // GUI state. Editor edits reach the audio thread through editor_edits_ and
+    // are applied at the start of the next block or params flush.
     bool gui_created_;
     double gui_scale_;
     uint32_t gui_width_;
     uint32_t gui_height_;
+    EditorEditQueue editor_edits_;
+    std::unique_ptr<EditorView> editor_view_;
+    EditorWindow* editor_window_;
     
     // Helper methods
     void initializeParameters();
-    void handleParameterChange(clap_id param_id, double value);
-    void sendParameterToHardware(clap_id param_id, double value);
-    void processIncomingMidi(const clap_input_events_t *in_events);
+    void handleParameterChange(clap_id param_id, double value, uint32_t time = 0,
+                               ParameterSource source = PARAM_SOURCE_HOST);
+    void sendParameterToHardware(clap_id param_id, double value, uint32_t time = 0);
+    // Queues a write of value (normalized) in the fewest bytes on the MIDI handler;
+    // false when the hardware already holds it
+    bool encodeParameterWrite(const OBX8Parameter* param, double value, std::ofstream& debug_file);
+    OutputRoute getOutputRoute() const;
+    void handleParameterMod(const clap_event_param_mod_t& mod_event);
+    void handleHostMidi(uint32_t time, const MidiMessage& msg);
+    void handleHardwareMidi(const MidiMessage& msg, uint64_t arrival_ns);
+    void onHardwareMessage(const MidiMessage& msg);
+    void completeIdleDataEntry();
+    bool hasPendingWork() const;
+    bool enterIdle();
+    void wakeProcessing();
     void processOutgoingMidi(const clap_output_events_t *out_events);
+    void applyEditorEdits(const clap_output_events_t *out_events);
+    void onEditorEdit();
     void onNRPNReceived(uint16_t parameter, uint16_t value);
+    void onNRPNIncrementReceived(uint16_t parameter, int steps);
     void onCCReceived(uint8_t cc, uint8_t value);
+    void recordGestureValue(const OBX8Parameter* param, int hardware_value);
+    void pushGestureEvents(const clap_output_events_t *out_events, uint32_t up_to_time);
     void onMidiDeviceSelected(clap_id param_id, double value);
     void updateMidiDeviceList();
     void autoSelectFirstOBX8Device();
+    void startMidiInitialization();
+    void finishMidiInitialization();
+    void joinMidiInitialization();
+    void invalidateHardwareMirror();
+    void forgetHardwareValues(const UmpPacket* packets, size_t count);
+    void runLatencyProbe();
+    void onProgramChange(uint16_t bank, uint8_t program);
+    void onSysExReceived(const uint8_t* data, size_t length);
+    void decodeProgramDump(const uint8_t* data, size_t length);
+    void runMainThreadTask(const MainThreadTask& task);
+    void notifyParameterChanged(clap_id param_id);
+    void applyCachedProgram();
+    void updateProgramPrefetch();
+    void runProgramPrefetch();
+    void rescanHostParams(clap_param_rescan_flags flags);
+    void sendQueuedMidiToDevice(std::ofstream& debug_file);
+    void queueOutgoingEdit(clap_id param_id, uint32_t time);
+    bool sendToDevice(const uint8_t* data, size_t length, uint64_t timestamp_ns = 0);
+    void paceToWire(size_t length);
+    static bool isPerformanceMessage(const MidiMessage& message);
+    size_t runMidiClock(const clap_event_transport_t *transport, const clap_input_events_t *in_events,
+                        uint32_t frames);
+    void runStepSequencer(const clap_event_transport_t *transport, uint32_t frames);
+    void writeStepLocks(const ScheduledStep& scheduled);
+    void restoreLockedParameters();
+    void queueSequencerWrites(double boundary);
+    void updateSequencerWriteBytes();
+    void recordStepLock(clap_id param_id, double value);
+    void warnUndeliverableSteps();
+    void checkReportedLatency();
+    void updateOutputTimeline();
+    uint64_t getDeviceTimeNs(uint32_t sample_time) const;
+    void captureSession();
+    void captureRenderMode();
+    uint32_t captureInputEvents(const clap_input_events_t *in_events);
+    
+    // Parameter store access in the host's normalized domain
+    double getNormalizedValue(clap_id param_id) const;
+    void setNormalizedValue(clap_id param_id, double value, ParameterSource source);
     
     // Parameter conversion helpers
     double normalizeParameterValue(const OBX8Parameter* param, double value) const;
     double denormalizeParameterValue(const OBX8Parameter* param, double normalized) const;
+    int parameterToHardwareValue(const OBX8Parameter* param, double value) const;
     uint16_t parameterToNRPNValue(const OBX8Parameter* param, double value);
     double nrpnToParameterValue(const OBX8Parameter* param, uint16_t nrpn_value);
     
@@ -99,10 +387,39 @@ private:
     std::map<clap_id, double> last_param_value_;
     
     // MIDI loop prevention
-    bool suppress_feedback_;
+    std::atomic<bool> suppress_feedback_;
     static const uint64_t MIDI_THROTTLE_MS = 5; // 5ms minimum between sends (better for LFOs)
-    uint64_t getCurrentTimeMs() const;
     
+    // Controllers forwarded with notes; no parameter is mapped to either
+    static const uint8_t CC_MOD_WHEEL = 1;
+    static const uint8_t CC_SUSTAIN = 64;
+    
+    // Output timeline: fraction of the measured call-time error applied per block,
+    // and the error beyond which the timeline restarts (after a stall or xrun)
+    static constexpr double OUTPUT_TIMELINE_GAIN = 1.0 / 32.0;
+    static constexpr double OUTPUT_TIMELINE_RESYNC_MS = 50.0;
+    
+    // Data increment/decrement encoding: the largest step sent relatively, and how many
+    // relative updates a parameter may take before the next absolute write bounds drift
+    static const int DATA_INCREMENT_MAX_STEPS = 3;
+    static const uint8_t ABSOLUTE_REFRESH_INTERVAL = 16;
+    static const int NRPN_ADDRESS_BYTES = 6;
+    static const int NRPN_ABSOLUTE_BYTES = 12;
+    static const int CC_WRITE_BYTES = 3;
+    static const int DATA_INCREMENT_BYTES = 3;
+    
+    // Program prefetch pacing: a request waits this long after the last live edit,
+    // is abandoned after the timeout, and prefetch stops for the current program
+    // after this many timeouts in a row (the synth isn't answering)
+    static const uint64_t PREFETCH_EDIT_HOLDOFF_MS = 250;
+    static const uint64_t PREFETCH_TIMEOUT_MS = 1000;
+    static const uint32_t PREFETCH_MAX_TIMEOUTS = 3;
+    static const uint8_t PROGRAMS_PER_BANK = 128;
+    uint64_t getCurrentTimeMs() const;
+    uint64_t getCurrentTimeNs() const;
+    uint64_t getEventTimeNs() const;
+    uint64_t getRenderTimeNs(uint32_t sample_time) const;
+
 };
 
 // CLAP plugin descriptor
@@ -0,0 +1,132 @@
+#include "param_display_table.h"
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdlib>
+
+ParameterDisplayTable::Table& ParameterDisplayTable::getTable(const OBX8Parameter& param) {
+    if (param.id >= tables_.size()) {
+        tables_.resize(param.id + 1);
+    }
+    
+    Table& table = tables_[param.id];
+    if (table.built) {
+        return table;
+    }
+    
+    // Stepped parameters with names are indexed by step, everything else by integer hardware value
+    int first_step = 0;
+    int last_step = 0;
+    if (param.is_stepped && !param.step_names.empty()) {
+        last_step = static_cast<int>(param.step_names.size()) - 1;
+    } else {
+        first_step = static_cast<int>(std::ceil(param.min_value));
+        last_step = static_cast<int>(std::floor(param.max_value));
+    }
+    
+    table.min_step = first_step;
+    table.texts.clear();
+    table.index.clear();
+    table.texts.reserve(std::max(0, last_step - first_step + 1));
+    table.index.reserve(std::max(0, last_step - first_step + 1));
+    
+    for (int step = first_step; step <= last_step; ++step) {
+        std::string text = (param.is_stepped && !param.step_names.empty())
+            ? param.step_names[step]
+            : formatValue(param, step);
+        table.index.emplace(normalizeText(text.c_str()), step);
+        table.texts.push_back(std::move(text));
+    }
+    
+    table.built = true;
+    return table;
+}
+
+const std::string* ParameterDisplayTable::getText(const OBX8Parameter& param, int hardware_value) {
+    Table& table = getTable(param);
+    int offset = hardware_value - table.min_step;
+    if (offset < 0 || offset >= static_cast<int>(table.texts.size())) {
+        return nullptr;
+    }
+    return &table.texts[offset];
+}
+
+bool ParameterDisplayTable::parseText(const OBX8Parameter& param, const char* text, double* hardware_value) {
+    Table& table = getTable(param);
+    std::string key = normalizeText(text);
+    if (key.empty()) {
+        return false;
+    }
+    
+    // Exact display strings and step names
+    auto it = table.index.find(key);
+    if (it != table.index.end()) {
+        *hardware_value = it->second;
+        return true;
+    }
+    
+    // Numbers, optionally followed by the parameter's unit
+    std::string unit = normalizeText(param.unit.c_str());
+    if (!unit.empty() && key.size() > unit.size() &&
+        key.compare(key.size() - unit.size(), unit.size(), unit) == 0) {
+        key.erase(key.size() - unit.size());
+        while (!key.empty() && std::isspace(static_cast<unsigned char>(key.back()))) {
+            key.pop_back();
+        }
+    }
+    
+    char* end = nullptr;
+    double parsed = std::strtod(key.c_str(), &end);
+    if (end == key.c_str() || *end != '\0') {
+        return false;
+    }
+    
+    double max_value = (param.is_stepped && !param.step_names.empty())
+        ? static_cast<double>(param.step_names.size() - 1)
+        : param.max_value;
+    double min_value = (param.is_stepped && !param.step_names.empty()) ? 0.0 : param.min_value;
+    if (param.is_stepped) {
+        parsed = std::round(parsed);
+    }
+    *hardware_value = std::max(min_value, std::min(max_value, parsed));
+    return true;
+}
+
+void ParameterDisplayTable::invalidate(uint32_t param_id) {
+    if (param_id < tables_.size()) {
+        tables_[param_id].built = false;
+    }
+}
+
+std::string ParameterDisplayTable::formatValue(const OBX8Parameter& param, int hardware_value) {
+    std::string text = std::to_string(hardware_value);
+    if (!param.unit.empty()) {
+        // Word units read better with a space ("-12 cents"), symbols without ("64%")
+        if (std::isalpha(static_cast<unsigned char>(param.unit[0]))) {
+            text += ' ';
+        }
+        text += param.unit;
+    }
+    return text;
+}
+
+std::string ParameterDisplayTable::normalizeText(const char* text) {
+    std::string normalized;
+    if (!text) {
+        return normalized;
+    }
+    
+    const char* begin = text;
+    while (*begin && std::isspace(static_cast<unsigned char>(*begin))) {
+        ++begin;
+    }
+    
+    normalized = begin;
+    while (!normalized.empty() && std::isspace(static_cast<unsigned char>(normalized.back()))) {
+        normalized.pop_back();
+    }
+    
+    std::transform(normalized.begin(), normalized.end(), normalized.begin(),
+                   [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    return normalized;
+}
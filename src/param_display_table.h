@@ -0,0 +1,37 @@
+#pragma once
+#include "obx8_parameters.h"
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Preformatted display strings for every hardware step of every parameter, plus a
+// hashed reverse index from display text / step names back to hardware values.
+// Tables are built on first use of each parameter so instantiation stays cheap.
+// Like the CLAP text callbacks that use it, it is main-thread only.
+class ParameterDisplayTable {
+public:
+    ParameterDisplayTable() = default;
+    
+    // Display text for an integer hardware value, or nullptr if it is out of range
+    const std::string* getText(const OBX8Parameter& param, int hardware_value);
+    
+    // Resolve step names, numbers and unit-suffixed numbers to a hardware value
+    bool parseText(const OBX8Parameter& param, const char* text, double* hardware_value);
+    
+    // Call when a parameter's step names or range change
+    void invalidate(uint32_t param_id);
+    
+private:
+    struct Table {
+        bool built = false;
+        int min_step = 0;
+        std::vector<std::string> texts;
+        std::unordered_map<std::string, int> index;
+    };
+    
+    std::vector<Table> tables_;
+    
+    Table& getTable(const OBX8Parameter& param);
+    static std::string formatValue(const OBX8Parameter& param, int hardware_value);
+    static std::string normalizeText(const char* text);
+};
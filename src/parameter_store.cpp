@@ -0,0 +1,74 @@
+#include "parameter_store.h"
+#include <cmath>
+#include <limits>
+
+ParameterStore::ParameterStore(size_t count)
+    : count_(count)
+    , slots_(new std::atomic<uint64_t>[count])
+    , version_(0) {
+    for (size_t i = 0; i < count_; ++i) {
+        slots_[i].store(pack(0, PARAM_SOURCE_DEFAULT, 0), std::memory_order_relaxed);
+    }
+}
+
+void ParameterStore::store(uint32_t id, double value, ParameterSource source) {
+    if (id >= count_) {
+        return;
+    }
+    
+    int32_t fixed = toFixed(value);
+    std::atomic<uint64_t>& slot = slots_[id];
+    
+    // CAS so concurrent writers each get their own sequence number
+    uint64_t current = slot.load(std::memory_order_relaxed);
+    uint64_t desired;
+    do {
+        uint32_t sequence = static_cast<uint32_t>((current >> 40) + 1) & SEQUENCE_MASK;
+        desired = pack(fixed, source, sequence);
+    } while (!slot.compare_exchange_weak(current, desired, std::memory_order_release, std::memory_order_relaxed));
+    
+    version_.fetch_add(1, std::memory_order_release);
+}
+
+double ParameterStore::load(uint32_t id) const {
+    if (id >= count_) {
+        return 0.0;
+    }
+    return fromFixed(static_cast<int32_t>(slots_[id].load(std::memory_order_acquire) & 0xFFFFFFFF));
+}
+
+ParameterEntry ParameterStore::read(uint32_t id) const {
+    if (id >= count_) {
+        return ParameterEntry{0.0, PARAM_SOURCE_DEFAULT, 0};
+    }
+    return unpack(slots_[id].load(std::memory_order_acquire));
+}
+
+int32_t ParameterStore::toFixed(double value) {
+    double scaled = std::round(value * (1 << FRACTION_BITS));
+    if (scaled > std::numeric_limits<int32_t>::max()) {
+        return std::numeric_limits<int32_t>::max();
+    }
+    if (scaled < std::numeric_limits<int32_t>::min()) {
+        return std::numeric_limits<int32_t>::min();
+    }
+    return static_cast<int32_t>(scaled);
+}
+
+double ParameterStore::fromFixed(int32_t fixed) {
+    return static_cast<double>(fixed) / (1 << FRACTION_BITS);
+}
+
+uint64_t ParameterStore::pack(int32_t fixed, ParameterSource source, uint32_t sequence) {
+    return (static_cast<uint64_t>(sequence & SEQUENCE_MASK) << 40) |
+           (static_cast<uint64_t>(source) << 32) |
+           static_cast<uint32_t>(fixed);
+}
+
+ParameterEntry ParameterStore::unpack(uint64_t word) {
+    ParameterEntry entry;
+    entry.value = fromFixed(static_cast<int32_t>(word & 0xFFFFFFFF));
+    entry.source = static_cast<ParameterSource>((word >> 32) & 0xFF);
+    entry.sequence = static_cast<uint32_t>((word >> 40) & SEQUENCE_MASK);
+    return entry;
+}
@@ -0,0 +1,52 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+// Where the current value of a parameter came from
+enum ParameterSource : uint8_t {
+    PARAM_SOURCE_DEFAULT = 0,
+    PARAM_SOURCE_HOST,
+    PARAM_SOURCE_HARDWARE,
+    PARAM_SOURCE_STATE,
+    PARAM_SOURCE_PLUGIN
+};
+
+struct ParameterEntry {
+    double value;          // hardware units
+    ParameterSource source;
+    uint32_t sequence;     // per-parameter write counter (24-bit, wraps)
+};
+
+// Parameter values shared by the audio, main and MIDI receive threads. Each
+// parameter is one 64-bit atomic word holding a Q16.16 fixed-point value in
+// hardware units, the source of the last write and a sequence number, so reads
+// never block and can never observe a torn or half-applied update.
+class ParameterStore {
+public:
+    ParameterStore(size_t count);
+    
+    size_t size() const { return count_; }
+    
+    void store(uint32_t id, double value, ParameterSource source);
+    double load(uint32_t id) const;
+    ParameterEntry read(uint32_t id) const;
+    
+    // Bumped on every write - lets readers cheaply detect that anything changed
+    uint64_t getVersion() const { return version_.load(std::memory_order_acquire); }
+    
+    // Fixed-point resolution: 1/65536 of a hardware step
+    static int32_t toFixed(double value);
+    static double fromFixed(int32_t fixed);
+    
+private:
+    static const int FRACTION_BITS = 16;
+    static const uint64_t SEQUENCE_MASK = 0xFFFFFF;
+    
+    size_t count_;
+    std::unique_ptr<std::atomic<uint64_t>[]> slots_;
+    std::atomic<uint64_t> version_;
+    
+    static uint64_t pack(int32_t fixed, ParameterSource source, uint32_t sequence);
+    static ParameterEntry unpack(uint64_t word);
+};
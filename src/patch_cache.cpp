@@ -0,0 +1,54 @@
+#include "patch_cache.h"
+
+PatchCache::PatchCache(size_t capacity)
+    : capacity_(capacity > 0 ? capacity : 1)
+{
+}
+
+void PatchCache::store(uint32_t key, const std::vector<int32_t>& values) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    
+    auto it = index_.find(key);
+    if (it != index_.end()) {
+        it->second->second = values;
+        entries_.splice(entries_.begin(), entries_, it->second);
+        return;
+    }
+    
+    if (entries_.size() >= capacity_) {
+        index_.erase(entries_.back().first);
+        entries_.pop_back();
+    }
+    
+    entries_.emplace_front(key, values);
+    index_[key] = entries_.begin();
+}
+
+bool PatchCache::lookup(uint32_t key, std::vector<int32_t>& values) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    
+    auto it = index_.find(key);
+    if (it == index_.end()) {
+        return false;
+    }
+    
+    entries_.splice(entries_.begin(), entries_, it->second);
+    values = it->second->second;
+    return true;
+}
+
+bool PatchCache::contains(uint32_t key) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return index_.find(key) != index_.end();
+}
+
+size_t PatchCache::size() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return entries_.size();
+}
+
+void PatchCache::clear() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    entries_.clear();
+    index_.clear();
+}
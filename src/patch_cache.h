@@ -0,0 +1,38 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// In-memory LRU cache of decoded programs, keyed by bank and program number.
+// Each entry holds per-parameter NRPN values indexed by parameter id (-1 when
+// the program doesn't set that parameter). Filled from the MIDI receive thread
+// and read on the main thread; never touched by the audio thread.
+class PatchCache {
+public:
+    explicit PatchCache(size_t capacity = DEFAULT_CAPACITY);
+    
+    static uint32_t makeKey(uint8_t bank, uint8_t program) { return (static_cast<uint32_t>(bank) << 7) | program; }
+    
+    void store(uint32_t key, const std::vector<int32_t>& values);
+    
+    // Copies the program out and marks it most recently used
+    bool lookup(uint32_t key, std::vector<int32_t>& values);
+    bool contains(uint32_t key) const;
+    
+    size_t size() const;
+    void clear();
+    
+    static const size_t DEFAULT_CAPACITY = 256;
+    
+private:
+    typedef std::list<std::pair<uint32_t, std::vector<int32_t>>> EntryList;
+    
+    mutable std::mutex mutex_;
+    size_t capacity_;
+    EntryList entries_; // most recently used first
+    std::unordered_map<uint32_t, EntryList::iterator> index_;
+};
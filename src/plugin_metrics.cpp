@@ -0,0 +1,154 @@
+#include "plugin_metrics.h"
+
+static size_t histogramBucket(uint64_t value) {
+    size_t bucket = 0;
+    while (value != 0 && bucket < METRIC_HISTOGRAM_BUCKETS - 1) {
+        value >>= 1;
+        ++bucket;
+    }
+    return bucket;
+}
+
+void PluginMetrics::record(MetricHistogramID id, uint64_t value) {
+    MetricHistogram& histogram = histograms_[id];
+    histogram.count.fetch_add(1, std::memory_order_relaxed);
+    histogram.sum.fetch_add(value, std::memory_order_relaxed);
+    histogram.buckets[histogramBucket(value)].fetch_add(1, std::memory_order_relaxed);
+    
+    uint64_t current = histogram.max.load(std::memory_order_relaxed);
+    while (value > current && !histogram.max.compare_exchange_weak(current, value, std::memory_order_relaxed)) {
+    }
+}
+
+MetricsSnapshot PluginMetrics::snapshot() const {
+    MetricsSnapshot snapshot;
+    
+    for (size_t i = 0; i < METRIC_COUNTER_COUNT; ++i) {
+        snapshot.counters[i] = counters_[i].value.load(std::memory_order_relaxed);
+    }
+    
+    for (size_t i = 0; i < METRIC_HIGH_WATER_COUNT; ++i) {
+        snapshot.high_water[i] = high_water_[i].value.load(std::memory_order_relaxed);
+    }
+    
+    for (size_t i = 0; i < METRIC_HISTOGRAM_COUNT; ++i) {
+        const MetricHistogram& histogram = histograms_[i];
+        MetricHistogramSnapshot& out = snapshot.histograms[i];
+        out.count = histogram.count.load(std::memory_order_relaxed);
+        out.sum = histogram.sum.load(std::memory_order_relaxed);
+        out.max = histogram.max.load(std::memory_order_relaxed);
+        for (size_t b = 0; b < METRIC_HISTOGRAM_BUCKETS; ++b) {
+            out.buckets[b] = histogram.buckets[b].load(std::memory_order_relaxed);
+        }
+    }
+    
+    return snapshot;
+}
+
+void PluginMetrics::reset() {
+    for (auto& counter : counters_) {
+        counter.value.store(0, std::memory_order_relaxed);
+    }
+    
+    for (auto& high_water : high_water_) {
+        high_water.value.store(0, std::memory_order_relaxed);
+    }
+    
+    for (auto& histogram : histograms_) {
+        histogram.count.store(0, std::memory_order_relaxed);
+        histogram.sum.store(0, std::memory_order_relaxed);
+        histogram.max.store(0, std::memory_order_relaxed);
+        for (auto& bucket : histogram.buckets) {
+            bucket.store(0, std::memory_order_relaxed);
+        }
+    }
+}
+
+uint64_t MetricHistogramSnapshot::percentileUpperBound(double percentile) const {
+    if (count == 0) {
+        return 0;
+    }
+    
+    uint64_t target = static_cast<uint64_t>(percentile * count);
+    uint64_t seen = 0;
+    for (size_t b = 0; b < METRIC_HISTOGRAM_BUCKETS; ++b) {
+        seen += buckets[b];
+        if (seen > target) {
+            return b == 0 ? 0 : (uint64_t(1) << b) - 1;
+        }
+    }
+    return max;
+}
+
+const char* MetricsSnapshot::counterName(MetricCounterID id) {
+    switch (id) {
+        case METRIC_PROCESS_CALLS: return "process_calls";
+        case METRIC_HOST_EVENTS: return "host_events";
+        case METRIC_NRPN_SENT: return "nrpn_sent";
+        case METRIC_NRPN_RECEIVED: return "nrpn_received";
+        case METRIC_CC_RECEIVED: return "cc_received";
+        case METRIC_BYTES_SENT: return "bytes_sent";
+        case METRIC_BYTES_RECEIVED: return "bytes_received";
+        case METRIC_SEND_FAILURES: return "send_failures";
+        case METRIC_SENDS_THROTTLED: return "sends_throttled";
+        case METRIC_SENDS_COALESCED: return "sends_coalesced";
+        case METRIC_PARSE_ERRORS: return "parse_errors";
+        case METRIC_RELATIVE_SENDS: return "relative_sends";
+        case METRIC_PROGRAM_DUMPS_REQUESTED: return "program_dumps_requested";
+        case METRIC_PROGRAM_DUMPS_RECEIVED: return "program_dumps_received";
+        case METRIC_PROGRAM_CACHE_HITS: return "program_cache_hits";
+        case METRIC_PROGRAM_CACHE_MISSES: return "program_cache_misses";
+        case METRIC_PASSTHROUGH_MESSAGES: return "passthrough_messages";
+        case METRIC_CLOCK_MESSAGES: return "clock_messages";
+        case METRIC_HOST_CALLBACK_REQUESTS: return "host_callback_requests";
+        case METRIC_PARAM_NOTIFICATIONS_COALESCED: return "param_notifications_coalesced";
+        case METRIC_HARDWARE_EVENTS_DROPPED: return "hardware_events_dropped";
+        case METRIC_IDLE_BLOCKS: return "idle_blocks";
+        case METRIC_PROCESS_WAKEUPS: return "process_wakeups";
+        case METRIC_GESTURE_VALUES: return "gesture_values";
+        case METRIC_GESTURE_POINTS: return "gesture_points";
+        case METRIC_OFFLINE_BLOCKS: return "offline_blocks";
+        case METRIC_PACING_WAITS: return "pacing_waits";
+        case METRIC_CC_SENDS: return "cc_sends";
+        case METRIC_SEQUENCER_STEPS: return "sequencer_steps";
+        case METRIC_SEQUENCER_WRITES: return "sequencer_writes";
+        case METRIC_SEQUENCER_WRITES_DROPPED: return "sequencer_writes_dropped";
+        default: return "unknown";
+    }
+}
+
+const char* MetricsSnapshot::highWaterName(MetricHighWaterID id) {
+    switch (id) {
+        case METRIC_OUTGOING_QUEUE_HIGH_WATER: return "outgoing_queue_high_water";
+        default: return "unknown";
+    }
+}
+
+const char* MetricsSnapshot::histogramName(MetricHistogramID id) {
+    switch (id) {
+        case METRIC_EVENTS_PER_BLOCK: return "events_per_block";
+        case METRIC_PROCESS_DURATION_NS: return "process_duration_ns";
+        case METRIC_MESSAGES_PER_BLOCK: return "messages_per_block";
+        default: return "unknown";
+    }
+}
+
+void MetricsSnapshot::writeText(std::ostream& out) const {
+    for (size_t i = 0; i < METRIC_COUNTER_COUNT; ++i) {
+        out << counterName(static_cast<MetricCounterID>(i)) << " " << counters[i] << "\n";
+    }
+    
+    for (size_t i = 0; i < METRIC_HIGH_WATER_COUNT; ++i) {
+        out << highWaterName(static_cast<MetricHighWaterID>(i)) << " " << high_water[i] << "\n";
+    }
+    
+    for (size_t i = 0; i < METRIC_HISTOGRAM_COUNT; ++i) {
+        const MetricHistogramSnapshot& histogram = histograms[i];
+        out << histogramName(static_cast<MetricHistogramID>(i))
+            << " count=" << histogram.count
+            << " mean=" << histogram.mean()
+            << " p50<=" << histogram.percentileUpperBound(0.50)
+            << " p99<=" << histogram.percentileUpperBound(0.99)
+            << " max=" << histogram.max << "\n";
+    }
+}
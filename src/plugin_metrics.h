@@ -0,0 +1,123 @@
+#pragma once
+#include <atomic>
+#include <array>
+#include <cstdint>
+#include <ostream>
+
+// Lock-free runtime metrics for the MIDI pipeline. Writers (audio, CoreMIDI and
+// main threads) only do relaxed atomic adds on cache-line padded slots, so
+// updating a metric never blocks and never bounces a line shared with another
+// writer. Readers take a snapshot() at any time from any thread.
+
+enum MetricCounterID {
+    METRIC_PROCESS_CALLS = 0,
+    METRIC_HOST_EVENTS,
+    METRIC_NRPN_SENT,
+    METRIC_NRPN_RECEIVED,
+    METRIC_CC_RECEIVED,
+    METRIC_BYTES_SENT,
+    METRIC_BYTES_RECEIVED,
+    METRIC_SEND_FAILURES,
+    METRIC_SENDS_THROTTLED,
+    METRIC_SENDS_COALESCED,
+    METRIC_PARSE_ERRORS,
+    METRIC_RELATIVE_SENDS,
+    METRIC_PROGRAM_DUMPS_REQUESTED,
+    METRIC_PROGRAM_DUMPS_RECEIVED,
+    METRIC_PROGRAM_CACHE_HITS,
+    METRIC_PROGRAM_CACHE_MISSES,
+    METRIC_PASSTHROUGH_MESSAGES,
+    METRIC_CLOCK_MESSAGES,
+    METRIC_HOST_CALLBACK_REQUESTS,
+    METRIC_PARAM_NOTIFICATIONS_COALESCED,
+    METRIC_HARDWARE_EVENTS_DROPPED,
+    METRIC_IDLE_BLOCKS,
+    METRIC_PROCESS_WAKEUPS,
+    METRIC_GESTURE_VALUES,
+    METRIC_GESTURE_POINTS,
+    METRIC_OFFLINE_BLOCKS,
+    METRIC_PACING_WAITS,
+    METRIC_CC_SENDS,
+    METRIC_SEQUENCER_STEPS,
+    METRIC_SEQUENCER_WRITES,
+    METRIC_SEQUENCER_WRITES_DROPPED,
+    
+    METRIC_COUNTER_COUNT
+};
+
+enum MetricHighWaterID {
+    METRIC_OUTGOING_QUEUE_HIGH_WATER = 0,
+    
+    METRIC_HIGH_WATER_COUNT
+};
+
+enum MetricHistogramID {
+    METRIC_EVENTS_PER_BLOCK = 0,
+    METRIC_PROCESS_DURATION_NS,
+    METRIC_MESSAGES_PER_BLOCK,
+    
+    METRIC_HISTOGRAM_COUNT
+};
+
+// Bucket 0 counts zero samples, bucket i counts samples in [2^(i-1), 2^i)
+static const size_t METRIC_HISTOGRAM_BUCKETS = 40;
+
+struct alignas(64) MetricCounter {
+    std::atomic<uint64_t> value{0};
+};
+
+struct alignas(64) MetricHistogram {
+    std::atomic<uint64_t> count{0};
+    std::atomic<uint64_t> sum{0};
+    std::atomic<uint64_t> max{0};
+    std::array<std::atomic<uint64_t>, METRIC_HISTOGRAM_BUCKETS> buckets{};
+};
+
+struct MetricHistogramSnapshot {
+    uint64_t count;
+    uint64_t sum;
+    uint64_t max;
+    std::array<uint64_t, METRIC_HISTOGRAM_BUCKETS> buckets;
+    
+    double mean() const { return count ? static_cast<double>(sum) / count : 0.0; }
+    // Upper bound of the bucket containing the given percentile (0.0-1.0)
+    uint64_t percentileUpperBound(double percentile) const;
+};
+
+struct MetricsSnapshot {
+    std::array<uint64_t, METRIC_COUNTER_COUNT> counters;
+    std::array<uint64_t, METRIC_HIGH_WATER_COUNT> high_water;
+    std::array<MetricHistogramSnapshot, METRIC_HISTOGRAM_COUNT> histograms;
+    
+    void writeText(std::ostream& out) const;
+    
+    static const char* counterName(MetricCounterID id);
+    static const char* highWaterName(MetricHighWaterID id);
+    static const char* histogramName(MetricHistogramID id);
+};
+
+class PluginMetrics {
+public:
+    PluginMetrics() = default;
+    
+    void add(MetricCounterID id, uint64_t amount = 1) {
+        counters_[id].value.fetch_add(amount, std::memory_order_relaxed);
+    }
+    
+    void updateHighWater(MetricHighWaterID id, uint64_t value) {
+        std::atomic<uint64_t>& slot = high_water_[id].value;
+        uint64_t current = slot.load(std::memory_order_relaxed);
+        while (value > current && !slot.compare_exchange_weak(current, value, std::memory_order_relaxed)) {
+        }
+    }
+    
+    void record(MetricHistogramID id, uint64_t value);
+    
+    MetricsSnapshot snapshot() const;
+    void reset();
+    
+private:
+    std::array<MetricCounter, METRIC_COUNTER_COUNT> counters_;
+    std::array<MetricCounter, METRIC_HIGH_WATER_COUNT> high_water_;
+    std::array<MetricHistogram, METRIC_HISTOGRAM_COUNT> histograms_;
+};
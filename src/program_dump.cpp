@@ -0,0 +1,66 @@
+#include "program_dump.h"
+
+size_t ProgramDumpCodec::buildRequest(uint8_t bank, uint8_t program, uint8_t* out, size_t capacity) {
+    if (capacity < REQUEST_LENGTH) {
+        return 0;
+    }
+    
+    out[0] = 0xF0;
+    out[1] = MANUFACTURER_ID;
+    out[2] = MODEL_ID;
+    out[3] = COMMAND_REQUEST_PROGRAM;
+    out[4] = bank & 0x7F;
+    out[5] = program & 0x7F;
+    out[6] = 0xF7;
+    return REQUEST_LENGTH;
+}
+
+bool ProgramDumpCodec::decode(const uint8_t* data, size_t length, const OBX8ParameterManager& params,
+                              uint8_t& bank, uint8_t& program, std::vector<int32_t>& nrpn_values) {
+    if (length < HEADER_LENGTH + 1 || data[0] != 0xF0 || data[length - 1] != 0xF7 ||
+        data[1] != MANUFACTURER_ID || data[2] != MODEL_ID || data[3] != COMMAND_PROGRAM_DUMP) {
+        return false;
+    }
+    
+    bank = data[4];
+    program = data[5];
+    
+    std::vector<uint8_t> payload;
+    unpack(data + HEADER_LENGTH, length - HEADER_LENGTH - 1, payload);
+    
+    nrpn_values.assign(params.getParameterCount(), -1);
+    size_t offset = 0;
+    for (const auto& param : params.getParameters()) {
+        if (!isDumpParameter(param)) {
+            continue;
+        }
+        if (offset + 2 > payload.size() || param.id >= nrpn_values.size()) {
+            return false; // truncated or a different layout
+        }
+        
+        int32_t value = ((payload[offset] & 0x7F) << 7) | (payload[offset + 1] & 0x7F);
+        offset += 2;
+        
+        // Values outside the parameter's range mean the layout doesn't match
+        if (value > OBX8ParameterManager::nrpnValueRange(&param)) {
+            return false;
+        }
+        nrpn_values[param.id] = value;
+    }
+    
+    return true;
+}
+
+void ProgramDumpCodec::unpack(const uint8_t* packed, size_t length, std::vector<uint8_t>& out) {
+    out.clear();
+    for (size_t group = 0; group < length; group += 8) {
+        uint8_t msbits = packed[group];
+        for (size_t i = 1; i < 8 && group + i < length; ++i) {
+            out.push_back(packed[group + i] | (((msbits >> (i - 1)) & 1) << 7));
+        }
+    }
+}
+
+bool ProgramDumpCodec::isDumpParameter(const OBX8Parameter& param) {
+    return param.nrpn_msb != 0 || param.nrpn_lsb != 0;
+}
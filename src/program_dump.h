@@ -0,0 +1,41 @@
+#pragma once
+#include "obx8_parameters.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Program dump SysEx. Framing follows the Sequential convention the OB-X8 is
+// built on: F0 <manufacturer> <model> <command> <bank> <program> [data] F7, with
+// the dump payload in packed-MS-bit form (each group of up to 7 bytes is
+// preceded by a byte holding their top bits).
+//
+// The model id and the payload layout are not in the published parameter list
+// this plugin is built from, so both are assumptions: the payload is read as
+// one 14-bit value (MSB, LSB) per hardware parameter, in parameter id order.
+// Verify against a real dump before trusting decoded values, and before turning
+// bank prefetch on by default (OBX8Plugin::setProgramPrefetchEnabled).
+class ProgramDumpCodec {
+public:
+    static const uint8_t MANUFACTURER_ID = 0x01;
+    static const uint8_t MODEL_ID = 0x58;
+    static const uint8_t COMMAND_PROGRAM_DUMP = 0x02;
+    static const uint8_t COMMAND_REQUEST_PROGRAM = 0x05;
+    static const size_t REQUEST_LENGTH = 7;
+    
+    // Writes a program dump request into out; returns its length, or 0 if it doesn't fit
+    static size_t buildRequest(uint8_t bank, uint8_t program, uint8_t* out, size_t capacity);
+    
+    // Decodes a complete program dump into per-parameter NRPN values indexed by
+    // parameter id (-1 for parameters the dump doesn't carry). Returns false for
+    // any other SysEx, including the echo of our own request.
+    static bool decode(const uint8_t* data, size_t length, const OBX8ParameterManager& params,
+                       uint8_t& bank, uint8_t& program, std::vector<int32_t>& nrpn_values);
+    
+    // Packed-MS-bit payload to 8-bit bytes
+    static void unpack(const uint8_t* packed, size_t length, std::vector<uint8_t>& out);
+    
+    // Plugin-side settings (no NRPN) are not part of a program
+    static bool isDumpParameter(const OBX8Parameter& param);
+    
+    static const size_t HEADER_LENGTH = 6;
+};
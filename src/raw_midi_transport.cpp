@@ -0,0 +1,361 @@
+#include "raw_midi_transport.h"
+#include "midi_send_queue.h"
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <dirent.h>
+#include <fcntl.h>
+#include <fstream>
+#include <iostream>
+#include <pthread.h>
+#include <signal.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+
+namespace {
+
+// steady_clock is CLOCK_MONOTONIC on Linux, so its times arm a timerfd directly
+uint64_t steadyNowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+bool setNonBlocking(int fd) {
+    int flags = fcntl(fd, F_GETFL);
+    return flags >= 0 && fcntl(fd, F_SETFL, flags | O_NONBLOCK) == 0;
+}
+
+// First line of /proc/asound/card<card>/midi<device>, which names the device
+std::string portName(const std::string& card, const std::string& device) {
+    std::ifstream info("/proc/asound/card" + card + "/midi" + device);
+    std::string name;
+    if (!std::getline(info, name) || name.empty()) {
+        name = "MIDI " + card + "-" + device;
+    }
+    return name;
+}
+
+} // namespace
+
+RawMidiTransport::RawMidiTransport()
+    : input_fd_(-1)
+    , output_fd_(-1)
+    , epoll_fd_(-1)
+    , timer_fd_(-1)
+    , running_(false)
+    , output_open_(false)
+    , wake_fd_(-1)
+    , write_offset_(0)
+    , write_armed_(false)
+    , input_open_(false)
+    , bytes_written_(0)
+    , write_stalls_(0)
+{
+}
+
+RawMidiTransport::~RawMidiTransport() {
+    close();
+    if (wake_fd_ >= 0) {
+        ::close(wake_fd_);
+    }
+}
+
+std::vector<RawMidiPort> RawMidiTransport::listPorts() {
+    std::vector<RawMidiPort> ports;
+    DIR* dir = opendir("/dev/snd");
+    if (!dir) {
+        return ports;
+    }
+    while (dirent* entry = readdir(dir)) {
+        // midiC<card>D<device>
+        std::string file = entry->d_name;
+        size_t device_mark = file.find('D', 5);
+        if (file.compare(0, 5, "midiC") != 0 || device_mark == std::string::npos) {
+            continue;
+        }
+        std::string card = file.substr(5, device_mark - 5);
+        std::string device = file.substr(device_mark + 1);
+        ports.push_back(RawMidiPort{portName(card, device), "/dev/snd/" + file});
+    }
+    closedir(dir);
+    std::sort(ports.begin(), ports.end(),
+              [](const RawMidiPort& a, const RawMidiPort& b) { return a.path < b.path; });
+    return ports;
+}
+
+bool RawMidiTransport::open(const std::string& path) {
+    close();
+    
+    // Output-only devices refuse O_RDWR
+    int fd = ::open(path.c_str(), O_RDWR | O_NONBLOCK | O_CLOEXEC);
+    if (fd < 0) {
+        fd = ::open(path.c_str(), O_WRONLY | O_NONBLOCK | O_CLOEXEC);
+        if (fd < 0) {
+            std::cerr << "Failed to open MIDI device " << path << ": " << std::strerror(errno) << std::endl;
+            return false;
+        }
+        return openFileDescriptors(-1, fd);
+    }
+    return openFileDescriptors(fd, fd);
+}
+
+bool RawMidiTransport::openFileDescriptors(int input_fd, int output_fd) {
+    close();
+    input_fd_ = input_fd;
+    output_fd_ = output_fd;
+    input_open_ = input_fd_ >= 0;
+    
+    // Instances that never open a port don't pay for the queue
+    if (!send_queue_) {
+        send_queue_.reset(new MidiSendQueue(QUEUE_BYTES, MAX_BATCHES));
+        write_buffer_.reserve(QUEUE_BYTES);
+    }
+    if (wake_fd_ < 0) {
+        wake_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    }
+    // A send that raced the last close() may have left bytes behind
+    discardQueued();
+    
+    epoll_fd_ = epoll_create1(EPOLL_CLOEXEC);
+    timer_fd_ = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    bool ready = epoll_fd_ >= 0 && wake_fd_ >= 0 && timer_fd_ >= 0 &&
+                 (input_fd_ < 0 || setNonBlocking(input_fd_)) && (output_fd_ < 0 || setNonBlocking(output_fd_));
+    
+    epoll_event event = {};
+    event.events = EPOLLIN;
+    event.data.fd = wake_fd_;
+    ready = ready && epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, wake_fd_, &event) == 0;
+    event.data.fd = timer_fd_;
+    ready = ready && epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, timer_fd_, &event) == 0;
+    if (ready && input_fd_ >= 0) {
+        event.data.fd = input_fd_;
+        ready = epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, input_fd_, &event) == 0;
+    }
+    if (ready && output_fd_ >= 0 && output_fd_ != input_fd_) {
+        // Registered with no events until a write blocks
+        event.events = 0;
+        event.data.fd = output_fd_;
+        ready = epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, output_fd_, &event) == 0;
+    }
+    if (!ready) {
+        std::cerr << "Failed to set up MIDI I/O: " << std::strerror(errno) << std::endl;
+        closeDescriptors();
+        return false;
+    }
+    
+    output_open_.store(output_fd_ >= 0, std::memory_order_relaxed);
+    running_.store(true, std::memory_order_release);
+    io_thread_ = std::thread([this]() { ioLoop(); });
+    return true;
+}
+
+void RawMidiTransport::close() {
+    if (io_thread_.joinable()) {
+        running_.store(false, std::memory_order_release);
+        uint64_t one = 1;
+        ssize_t result = write(wake_fd_, &one, sizeof(one));
+        (void)result;
+        io_thread_.join();
+    }
+    running_.store(false, std::memory_order_release);
+    output_open_.store(false, std::memory_order_relaxed);
+    
+    // With the I/O thread gone this thread is the queue's consumer
+    closeDescriptors();
+    discardQueued();
+}
+
+void RawMidiTransport::closeDescriptors() {
+    // The eventfd stays: a send may still be signalling it
+    for (int* fd : {&output_fd_, &input_fd_, &timer_fd_, &epoll_fd_}) {
+        if (*fd >= 0 && (fd != &output_fd_ || output_fd_ != input_fd_)) {
+            ::close(*fd);
+        }
+    }
+    input_fd_ = output_fd_ = epoll_fd_ = timer_fd_ = -1;
+    write_buffer_.clear();
+    write_offset_ = 0;
+    write_armed_ = false;
+    input_open_ = false;
+}
+
+void RawMidiTransport::discardQueued() {
+    std::vector<uint8_t> bytes;
+    uint64_t due_ns;
+    while (send_queue_ && send_queue_->pop(bytes, due_ns)) {
+    }
+    pending_.clear();
+}
+
+bool RawMidiTransport::send(const uint8_t* data, size_t length, uint64_t timestamp_ns) {
+    // The queue and eventfd outlive close(), so a send that loses the race with
+    // it only leaves bytes the next open discards
+    if (length == 0 || !isOpen() || !output_open_.load(std::memory_order_relaxed) ||
+        !send_queue_->push(data, length, timestamp_ns)) {
+        return false;
+    }
+    
+    // Adds to the eventfd counter; never blocks
+    uint64_t one = 1;
+    ssize_t result = write(wake_fd_, &one, sizeof(one));
+    (void)result;
+    return true;
+}
+
+void RawMidiTransport::ioLoop() {
+    // A write to a pipe or FIFO nobody reads any more fails with EPIPE instead of
+    // raising SIGPIPE, which would end the host
+    sigset_t pipe_signal;
+    sigemptyset(&pipe_signal);
+    sigaddset(&pipe_signal, SIGPIPE);
+    pthread_sigmask(SIG_BLOCK, &pipe_signal, nullptr);
+    
+    epoll_event events[4];
+    while (running_.load(std::memory_order_acquire)) {
+        int count = epoll_wait(epoll_fd_, events, 4, -1);
+        if (count < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            std::cerr << "MIDI I/O wait failed: " << std::strerror(errno) << std::endl;
+            break;
+        }
+        
+        for (int i = 0; i < count; ++i) {
+            int fd = events[i].data.fd;
+            if (fd == wake_fd_ || fd == timer_fd_) {
+                uint64_t expirations;
+                ssize_t result = read(fd, &expirations, sizeof(expirations));
+                (void)result;
+            }
+            if (fd == input_fd_ && (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR))) {
+                readInput();
+            }
+        }
+        if (!running_.load(std::memory_order_acquire)) {
+            break;
+        }
+        // Cheap when nothing is due: one clock read and a look at the earliest batch
+        takeQueuedBatches();
+        flushOutput();
+    }
+}
+
+void RawMidiTransport::readInput() {
+    uint8_t buffer[READ_CHUNK];
+    while (input_open_) {
+        ssize_t length = read(input_fd_, buffer, sizeof(buffer));
+        if (length > 0) {
+            if (receive_callback_) {
+                receive_callback_(buffer, static_cast<size_t>(length), steadyNowNs());
+            }
+            continue;
+        }
+        if (length < 0 && errno == EINTR) {
+            continue;
+        }
+        if (length < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            return;
+        }
+        // End of stream (the writer went away) or the device failed: stop reading
+        // but keep writing
+        input_open_ = false;
+        updateEvents();
+    }
+}
+
+void RawMidiTransport::takeQueuedBatches() {
+    // A batch already due is filed under its arrival, behind the due batches
+    // before it and ahead of anything later
+    uint64_t now_ns = steadyNowNs();
+    std::vector<uint8_t> bytes;
+    uint64_t due_ns;
+    while (send_queue_->pop(bytes, due_ns)) {
+        pending_.emplace(std::max(due_ns, now_ns), std::move(bytes));
+    }
+}
+
+void RawMidiTransport::takeDueBatches(uint64_t now_ns) {
+    write_buffer_.clear();
+    write_offset_ = 0;
+    
+    auto due_end = pending_.upper_bound(now_ns);
+    for (auto it = pending_.begin(); it != due_end; ++it) {
+        write_buffer_.insert(write_buffer_.end(), it->second.begin(), it->second.end());
+    }
+    pending_.erase(pending_.begin(), due_end);
+    if (!pending_.empty()) {
+        armTimer(pending_.begin()->first);
+    }
+}
+
+void RawMidiTransport::flushOutput() {
+    if (output_fd_ < 0) {
+        return;
+    }
+    
+    while (true) {
+        if (write_offset_ == write_buffer_.size()) {
+            takeDueBatches(steadyNowNs());
+            if (write_buffer_.empty()) {
+                break;
+            }
+        }
+        
+        ssize_t written = write(output_fd_, write_buffer_.data() + write_offset_, write_buffer_.size() - write_offset_);
+        if (written > 0) {
+            write_offset_ += static_cast<size_t>(written);
+            bytes_written_.fetch_add(static_cast<uint64_t>(written), std::memory_order_relaxed);
+            continue;
+        }
+        if (written < 0 && errno == EINTR) {
+            continue;
+        }
+        if (written < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            // The device buffer is full; carry on from here when it drains
+            if (!write_armed_) {
+                write_stalls_.fetch_add(1, std::memory_order_relaxed);
+                write_armed_ = true;
+                updateEvents();
+            }
+            return;
+        }
+        std::cerr << "MIDI write failed: " << std::strerror(errno) << std::endl;
+        write_buffer_.clear();
+        write_offset_ = 0;
+    }
+    
+    if (write_armed_) {
+        write_armed_ = false;
+        updateEvents();
+    }
+}
+
+void RawMidiTransport::updateEvents() {
+    epoll_event event = {};
+    if (output_fd_ == input_fd_) {
+        event.events = (input_open_ ? static_cast<uint32_t>(EPOLLIN) : 0u) |
+                       (write_armed_ ? static_cast<uint32_t>(EPOLLOUT) : 0u);
+        event.data.fd = output_fd_;
+        epoll_ctl(epoll_fd_, EPOLL_CTL_MOD, output_fd_, &event);
+        return;
+    }
+    if (!input_open_ && input_fd_ >= 0) {
+        epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, input_fd_, nullptr);
+    }
+    if (output_fd_ >= 0) {
+        event.events = write_armed_ ? static_cast<uint32_t>(EPOLLOUT) : 0u;
+        event.data.fd = output_fd_;
+        epoll_ctl(epoll_fd_, EPOLL_CTL_MOD, output_fd_, &event);
+    }
+}
+
+void RawMidiTransport::armTimer(uint64_t due_ns) {
+    itimerspec spec = {};
+    spec.it_value.tv_sec = static_cast<time_t>(due_ns / 1000000000ull);
+    spec.it_value.tv_nsec = static_cast<long>(due_ns % 1000000000ull);
+    timerfd_settime(timer_fd_, TFD_TIMER_ABSTIME, &spec, nullptr);
+}
@@ -0,0 +1,107 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+class MidiSendQueue;
+
+struct RawMidiPort {
+    std::string name;  // ALSA's name for the device, e.g. "OB-X8 MIDI 1"
+    std::string path;  // /dev/snd/midiC<card>D<device>
+};
+
+// MIDI as a plain byte stream over file descriptors: ALSA raw MIDI devices, or
+// any pipe, FIFO or pseudo-terminal. Linux only (raw_midi_transport.cpp).
+//
+// One I/O thread serves both directions through epoll. Reads are delivered as
+// they come with their steady-clock arrival time. Sends go through a lock-free
+// queue and an eventfd wake-up to the I/O thread, which orders the batches by
+// due time (one already due counts as due when it arrives, so sends that are
+// due keep their order and never wait behind a later batch). Every due batch
+// goes out in one non-blocking write, and a write the descriptor can't take
+// whole continues when it becomes writable.
+//
+// Writes are not paced here: the raw MIDI driver clocks bytes onto the wire at
+// the port's own rate and a full driver buffer is what turns a write short, so
+// the EPOLLOUT continuation is the pacing. Holding bytes back to DIN speed in
+// user space would only slow USB ports, and the plugin already keeps its own
+// traffic within the wire budget.
+class RawMidiTransport {
+public:
+    // bytes, length, arrival time on the steady clock (std::chrono::steady_clock)
+    using ReceiveCallback = std::function<void(const uint8_t*, size_t, uint64_t)>;
+    
+    static const size_t QUEUE_BYTES = 65536;
+    static const size_t MAX_BATCHES = 1024;
+    static const size_t READ_CHUNK = 4096;
+    
+    RawMidiTransport();
+    ~RawMidiTransport();
+    RawMidiTransport(const RawMidiTransport&) = delete;
+    RawMidiTransport& operator=(const RawMidiTransport&) = delete;
+    
+    // Set before opening; called on the I/O thread
+    void setReceiveCallback(ReceiveCallback callback) { receive_callback_ = std::move(callback); }
+    
+    // Opens path for reading and writing (write only when it can't be read) and
+    // starts the I/O thread. Closes whatever was open first.
+    bool open(const std::string& path);
+    // The same over descriptors the caller already has, which may be one and the
+    // same; the transport makes them non-blocking and owns them from here on
+    bool openFileDescriptors(int input_fd, int output_fd);
+    void close();
+    bool isOpen() const { return running_.load(std::memory_order_acquire); }
+    
+    // One sending thread at a time (see MidiSendQueue); never blocks. Queues the
+    // bytes to go out at timestamp_ns (steady clock; 0 or a time already past
+    // sends as soon as possible). False when closed, write-less or full.
+    bool send(const uint8_t* data, size_t length, uint64_t timestamp_ns = 0);
+    
+    uint64_t getBytesWritten() const { return bytes_written_.load(std::memory_order_relaxed); }
+    uint64_t getWriteStalls() const { return write_stalls_.load(std::memory_order_relaxed); }
+    
+    // Raw MIDI devices present now, named from /proc/asound
+    static std::vector<RawMidiPort> listPorts();
+
+private:
+    int input_fd_;
+    int output_fd_;
+    int epoll_fd_;
+    int timer_fd_;   // timerfd on CLOCK_MONOTONIC: earliest pending batch due
+    std::thread io_thread_;
+    std::atomic<bool> running_;
+    std::atomic<bool> output_open_;
+    ReceiveCallback receive_callback_;
+    
+    // Created on the first open and kept until destruction, so a send racing
+    // close() never touches a released queue or descriptor
+    std::unique_ptr<MidiSendQueue> send_queue_;
+    int wake_fd_;    // eventfd: batch queued or shutdown
+    
+    // I/O thread only: batches taken off the queue by due time, and the write in
+    // progress
+    std::multimap<uint64_t, std::vector<uint8_t>> pending_;
+    std::vector<uint8_t> write_buffer_;
+    size_t write_offset_;
+    bool write_armed_;   // waiting for EPOLLOUT
+    bool input_open_;
+    
+    std::atomic<uint64_t> bytes_written_;
+    std::atomic<uint64_t> write_stalls_;
+    
+    void ioLoop();
+    void readInput();
+    void takeQueuedBatches();
+    void flushOutput();
+    void takeDueBatches(uint64_t now_ns);
+    void updateEvents();
+    void armTimer(uint64_t due_ns);
+    void closeDescriptors();
+    void discardQueued();
+};
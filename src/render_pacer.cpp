@@ -0,0 +1,64 @@
+#include "render_pacer.h"
+#include <algorithm>
+
+RenderPacer::RenderPacer()
+    : render_mode_(RENDER_MODE_UNKNOWN)
+    , freewheeling_(false)
+    , window_start_ns_(0)
+    , window_audio_ns_(0)
+    , window_paced_ns_(0)
+    , last_block_ns_(0)
+    , wire_free_ns_(0)
+{
+}
+
+bool RenderPacer::onBlock(uint64_t wall_ns, uint32_t frames, double sample_rate) {
+    if (getRenderMode() != RENDER_MODE_UNKNOWN) {
+        // The host said how it renders; a stalled or racing wall clock is not a hint
+        freewheeling_ = false;
+        window_start_ns_ = 0;
+        return isOfflineRequested();
+    }
+    
+    bool gap = wall_ns < last_block_ns_ || wall_ns - last_block_ns_ > DETECTION_WINDOW_NS;
+    if (window_start_ns_ == 0 || gap) {
+        window_start_ns_ = wall_ns;
+        window_audio_ns_ = 0;
+        window_paced_ns_ = 0;
+    } else if (window_audio_ns_ >= DETECTION_WINDOW_NS) {
+        // Compare the audio of the blocks so far with the wall time they took
+        uint64_t elapsed_ns = wall_ns - window_start_ns_;
+        elapsed_ns = elapsed_ns > window_paced_ns_ ? elapsed_ns - window_paced_ns_ : 0;
+        double ratio = window_audio_ns_ / double(std::max<uint64_t>(1, elapsed_ns));
+        if (ratio > FREEWHEEL_ENTER_RATIO) {
+            freewheeling_ = true;
+        } else if (ratio < FREEWHEEL_EXIT_RATIO) {
+            freewheeling_ = false;
+        }
+        window_start_ns_ = wall_ns;
+        window_audio_ns_ = 0;
+        window_paced_ns_ = 0;
+    }
+    last_block_ns_ = wall_ns;
+    
+    if (sample_rate > 0.0) {
+        window_audio_ns_ += static_cast<uint64_t>(frames * 1e9 / sample_rate);
+    }
+    return isFasterThanRealtime();
+}
+
+uint64_t RenderPacer::reserveWire(size_t length, uint64_t wall_ns) {
+    uint64_t start_ns = std::max(wire_free_ns_, wall_ns);
+    wire_free_ns_ = start_ns + length * WIRE_NS_PER_BYTE;
+    uint64_t allowed_ns = wall_ns + WIRE_BURST_NS;
+    return wire_free_ns_ > allowed_ns ? wire_free_ns_ - allowed_ns : 0;
+}
+
+void RenderPacer::reset() {
+    freewheeling_ = false;
+    window_start_ns_ = 0;
+    window_audio_ns_ = 0;
+    window_paced_ns_ = 0;
+    last_block_ns_ = 0;
+    wire_free_ns_ = 0;
+}
@@ -0,0 +1,67 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+// Keeps the hardware link sane when the host renders faster than real time:
+// offline, as announced through the CLAP render extension, or freewheeling, as
+// seen from process() calls covering more audio than the wall clock advances.
+// The wall-clock guess only applies while the host hasn't named a render mode;
+// an explicit realtime mode turns it off and an explicit offline mode wins.
+// In that mode the plugin times its decisions from the song position so every
+// export makes the same ones, and direct output is held to wire speed: before
+// a send the audio thread waits until the link has drained to a short burst,
+// which a render that isn't real time can afford.
+// Audio thread only, except setRenderMode().
+class RenderPacer {
+public:
+    enum RenderMode {
+        RENDER_MODE_UNKNOWN,    // host never called render_set(): detect from the wall clock
+        RENDER_MODE_REALTIME,
+        RENDER_MODE_OFFLINE
+    };
+    
+    RenderPacer();
+    
+    // From the render extension (main thread)
+    void setRenderMode(RenderMode mode) { render_mode_.store(mode, std::memory_order_relaxed); }
+    RenderMode getRenderMode() const { return render_mode_.load(std::memory_order_relaxed); }
+    bool isOfflineRequested() const { return getRenderMode() == RENDER_MODE_OFFLINE; }
+    
+    // Once per processed block, with the wall clock at its start. Returns whether
+    // the block belongs to a render running faster than real time; only guesses
+    // from the wall clock under RENDER_MODE_UNKNOWN.
+    bool onBlock(uint64_t wall_ns, uint32_t frames, double sample_rate);
+    bool isFasterThanRealtime() const { return isOfflineRequested() || freewheeling_; }
+    
+    // Books length bytes on the wire from wall_ns and returns how long to wait
+    // before handing them to the driver so the backlog stays within the burst
+    uint64_t reserveWire(size_t length, uint64_t wall_ns);
+    
+    // Time spent waiting on the wire, which must not count as the host being slow
+    void addPacedTime(uint64_t ns) { window_paced_ns_ += ns; }
+    
+    void reset();
+    
+    // 31250 baud with start and stop bits
+    static const uint64_t WIRE_NS_PER_BYTE = 320000;
+    static const uint64_t WIRE_BURST_NS = 32 * WIRE_NS_PER_BYTE;
+    
+    // Audio per detection window, and the audio/wall ratios that enter and leave
+    // freewheeling; a gap longer than a window (transport stopped, instance
+    // asleep) starts a new window instead of reading as a slow host
+    static const uint64_t DETECTION_WINDOW_NS = 250000000;
+    static constexpr double FREEWHEEL_ENTER_RATIO = 1.5;
+    static constexpr double FREEWHEEL_EXIT_RATIO = 1.1;
+
+private:
+    std::atomic<RenderMode> render_mode_;
+    bool freewheeling_;
+    
+    uint64_t window_start_ns_;   // wall clock, 0 before the first block
+    uint64_t window_audio_ns_;   // audio covered by the window's blocks
+    uint64_t window_paced_ns_;   // wall time spent waiting on the wire
+    uint64_t last_block_ns_;
+    
+    uint64_t wire_free_ns_;      // when the last booked byte leaves the wire
+};
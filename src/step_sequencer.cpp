@@ -0,0 +1,245 @@
+#include "step_sequencer.h"
+#include "midi_output_merger.h"
+#include <algorithm>
+#include <cmath>
+
+const float StepSequencer::NO_LOCK = -1.0f;
+
+StepSequencer::StepSequencer(size_t parameter_count)
+    : parameter_count_(parameter_count)
+    , length_(MAX_STEPS)
+    , locks_(new std::atomic<float>[MAX_STEPS * parameter_count])
+    , lock_count_(0)
+    , write_bytes_(new std::atomic<uint8_t>[parameter_count])
+    , delivery_margin_seconds_(DELIVERY_MARGIN_SECONDS)
+    , version_(1)
+    , running_(false)
+    , stopped_(false)
+    , next_step_(0)
+    , expected_beats_(0.0)
+    , checked_version_(0)
+    , step_bytes_()
+    , undeliverable_steps_(0)
+    , worst_step_bytes_(0)
+    , step_budget_bytes_(0)
+    , checked_tempo_(0.0)
+{
+    for (size_t i = 0; i < MAX_STEPS * parameter_count_; ++i) {
+        locks_[i].store(NO_LOCK, std::memory_order_relaxed);
+    }
+    for (size_t i = 0; i < parameter_count_; ++i) {
+        write_bytes_[i].store(0, std::memory_order_relaxed);
+    }
+}
+
+void StepSequencer::setLength(uint32_t steps) {
+    steps = std::max<uint32_t>(1, std::min(steps, MAX_STEPS));
+    if (length_.exchange(steps, std::memory_order_relaxed) != steps) {
+        version_.fetch_add(1, std::memory_order_release);
+    }
+}
+
+void StepSequencer::setLock(uint32_t step, uint32_t param_id, double value) {
+    if (step >= MAX_STEPS || param_id >= parameter_count_ || value < 0.0) {
+        return;
+    }
+    float previous = locks_[step * parameter_count_ + param_id].exchange(static_cast<float>(value),
+                                                                         std::memory_order_relaxed);
+    if (previous < 0.0f) {
+        lock_count_.fetch_add(1, std::memory_order_relaxed);
+    }
+    version_.fetch_add(1, std::memory_order_release);
+}
+
+void StepSequencer::clearLock(uint32_t step, uint32_t param_id) {
+    if (step >= MAX_STEPS || param_id >= parameter_count_) {
+        return;
+    }
+    if (locks_[step * parameter_count_ + param_id].exchange(NO_LOCK, std::memory_order_relaxed) >= 0.0f) {
+        lock_count_.fetch_sub(1, std::memory_order_relaxed);
+    }
+    version_.fetch_add(1, std::memory_order_release);
+}
+
+void StepSequencer::clearStep(uint32_t step) {
+    if (step >= MAX_STEPS) {
+        return;
+    }
+    uint32_t cleared = 0;
+    for (size_t i = 0; i < parameter_count_; ++i) {
+        if (locks_[step * parameter_count_ + i].exchange(NO_LOCK, std::memory_order_relaxed) >= 0.0f) {
+            ++cleared;
+        }
+    }
+    lock_count_.fetch_sub(cleared, std::memory_order_relaxed);
+    version_.fetch_add(1, std::memory_order_release);
+}
+
+void StepSequencer::clear() {
+    // Loading a state clears the pattern first, and most states have no locks
+    if (getLockCount() == 0) {
+        return;
+    }
+    for (uint32_t step = 0; step < MAX_STEPS; ++step) {
+        clearStep(step);
+    }
+}
+
+bool StepSequencer::getLock(uint32_t step, uint32_t param_id, double* value) const {
+    if (step >= MAX_STEPS || param_id >= parameter_count_) {
+        return false;
+    }
+    float lock = locks_[step * parameter_count_ + param_id].load(std::memory_order_relaxed);
+    if (lock < 0.0f) {
+        return false;
+    }
+    *value = lock;
+    return true;
+}
+
+void StepSequencer::setWriteBytes(uint32_t param_id, uint8_t bytes) {
+    if (param_id < parameter_count_ && write_bytes_[param_id].exchange(bytes, std::memory_order_relaxed) != bytes) {
+        version_.fetch_add(1, std::memory_order_release);
+    }
+}
+
+uint8_t StepSequencer::getWriteBytes(uint32_t param_id) const {
+    return param_id < parameter_count_ ? write_bytes_[param_id].load(std::memory_order_relaxed) : 0;
+}
+
+void StepSequencer::setDeliveryMarginSeconds(double seconds) {
+    seconds = std::max(seconds, DELIVERY_MARGIN_SECONDS);
+    if (delivery_margin_seconds_.exchange(seconds, std::memory_order_relaxed) != seconds) {
+        version_.fetch_add(1, std::memory_order_release);
+    }
+}
+
+size_t StepSequencer::stepBudgetBytes(double tempo, double margin_seconds) {
+    if (tempo <= 0.0) {
+        return 0;
+    }
+    double step_seconds = 60.0 / tempo / STEPS_PER_BEAT;
+    double usable = step_seconds * LINK_BUDGET - margin_seconds;
+    return usable > 0.0 ? static_cast<size_t>(usable / MidiOutputMerger::DIN_SECONDS_PER_BYTE) : 0;
+}
+
+void StepSequencer::checkDelivery(double tempo) {
+    uint64_t version = version_.load(std::memory_order_acquire);
+    if (version == checked_version_ && tempo == checked_tempo_.load(std::memory_order_relaxed)) {
+        return;
+    }
+    checked_version_ = version;
+    
+    // A step writes its own locks, and puts back the parameters the step before it
+    // locked; a lock that repeats the previous step's value costs nothing
+    uint32_t length = getLength();
+    size_t budget = stepBudgetBytes(tempo, getDeliveryMarginSeconds());
+    uint32_t undeliverable = 0;
+    size_t worst = 0;
+    for (uint32_t step = 0; step < length; ++step) {
+        uint32_t previous = (step + length - 1) % length;
+        size_t bytes = 0;
+        for (size_t id = 0; id < parameter_count_; ++id) {
+            uint8_t write_bytes = write_bytes_[id].load(std::memory_order_relaxed);
+            float lock = locks_[step * parameter_count_ + id].load(std::memory_order_relaxed);
+            float previous_lock = locks_[previous * parameter_count_ + id].load(std::memory_order_relaxed);
+            if (write_bytes != 0 && (lock >= 0.0f || previous_lock >= 0.0f) && lock != previous_lock) {
+                bytes += write_bytes;
+            }
+        }
+        step_bytes_[step] = bytes;
+        worst = std::max(worst, bytes);
+        if (bytes > budget) {
+            undeliverable |= 1u << step;
+        }
+    }
+    
+    undeliverable_steps_.store(undeliverable, std::memory_order_relaxed);
+    worst_step_bytes_.store(static_cast<uint32_t>(worst), std::memory_order_relaxed);
+    step_budget_bytes_.store(static_cast<uint32_t>(budget), std::memory_order_relaxed);
+    checked_tempo_.store(tempo, std::memory_order_relaxed);
+}
+
+size_t StepSequencer::process(const clap_event_transport_t* transport, bool enabled, uint32_t frames,
+                              double sample_rate, ScheduledStep* out, size_t capacity) {
+    const uint32_t required = CLAP_TRANSPORT_HAS_TEMPO | CLAP_TRANSPORT_HAS_BEATS_TIMELINE;
+    if (!enabled || !transport || (transport->flags & required) != required ||
+        transport->tempo <= 0.0 || sample_rate <= 0.0) {
+        stop();
+        return 0;
+    }
+    
+    // Checked while stopped too, so a pattern too dense for the tempo is reported
+    // before it plays
+    checkDelivery(transport->tempo);
+    if (!(transport->flags & CLAP_TRANSPORT_IS_PLAYING)) {
+        stop();
+        return 0;
+    }
+    
+    double beats = static_cast<double>(transport->song_pos_beats) / CLAP_BEATTIME_FACTOR;
+    double beats_per_sample = transport->tempo / 60.0 / sample_rate;
+    double steps_per_sample = beats_per_sample * STEPS_PER_BEAT;
+    double block_steps = beats * STEPS_PER_BEAT;
+    
+    // A jump of more than half a clock tick is a relocation: carry on from the step
+    // playing at the new position, written at once
+    if (running_ && std::abs(beats - expected_beats_) * 24.0 > 0.5) {
+        running_ = false;
+    }
+    if (!running_) {
+        next_step_ = std::max<int64_t>(0, static_cast<int64_t>(std::floor(block_steps + 1e-9)));
+        running_ = true;
+    }
+    
+    uint32_t length = getLength();
+    double margin_seconds = getDeliveryMarginSeconds();
+    size_t budget = stepBudgetBytes(transport->tempo, margin_seconds);
+    double samples_per_byte = MidiOutputMerger::DIN_SECONDS_PER_BYTE * sample_rate;
+    double margin_samples = margin_seconds * sample_rate;
+    size_t count = 0;
+    
+    while (count < capacity) {
+        uint32_t step = static_cast<uint32_t>(next_step_ % length);
+        double boundary = (static_cast<double>(next_step_) - block_steps) / steps_per_sample;
+        size_t bytes = std::min(step_bytes_[step], budget);
+        if (boundary - bytes * samples_per_byte - margin_samples >= frames) {
+            break;
+        }
+        
+        // A step already under way (on start or relocation) is written at once, and
+        // only as much of it as goes out before the next step's writes have to start
+        size_t step_budget = budget;
+        if (boundary <= 0.0) {
+            uint32_t next = static_cast<uint32_t>((next_step_ + 1) % length);
+            double next_start = boundary + 1.0 / steps_per_sample -
+                                std::min(step_bytes_[next], budget) * samples_per_byte - margin_samples;
+            step_budget = next_start > 0.0 ? std::min(budget, static_cast<size_t>(next_start / samples_per_byte)) : 0;
+        }
+        out[count++] = ScheduledStep{step, boundary, step_budget};
+        ++next_step_;
+    }
+    
+    expected_beats_ = beats + frames * beats_per_sample;
+    return count;
+}
+
+void StepSequencer::stop() {
+    if (running_) {
+        running_ = false;
+        stopped_ = true;
+    }
+}
+
+bool StepSequencer::takeStopped() {
+    bool stopped = stopped_;
+    stopped_ = false;
+    return stopped;
+}
+
+void StepSequencer::reset() {
+    running_ = false;
+    stopped_ = false;
+    next_step_ = 0;
+    expected_beats_ = 0.0;
+}
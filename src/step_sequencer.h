@@ -0,0 +1,118 @@
+#pragma once
+#include <clap/clap.h>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+// A step the audio thread must start writing in the current block
+struct ScheduledStep {
+    uint32_t step;          // pattern step
+    double boundary;        // sample offset of the step's start from the block start (may be past the block)
+    size_t budget_bytes;    // most bytes its writes may take
+};
+
+// Parameter-lock step sequencer: a pattern of up to MAX_STEPS sixteenth-note
+// steps, each locking any subset of the hardware parameters to a value. The
+// pattern follows the host timeline like the MIDI clock. A step's writes are
+// scheduled to finish arriving the delivery margin before the step starts, so
+// they start that far plus their wire time ahead of it; a parameter locked on one
+// step and not the next returns to its own value. The margin is
+// DELIVERY_MARGIN_SECONDS until the plugin widens it by the measured output
+// latency.
+//
+// The link carries LINK_BUDGET of a step's duration worth of writes per step,
+// leaving the rest for notes, clock and live edits. A step that needs more than
+// that at the current tempo is undeliverable: its writes are cut to the budget
+// and the step is reported so the plugin can warn.
+//
+// The pattern is edited from any thread and read lock-free by the audio thread;
+// each lock is its own atomic, so a step being edited can play half-changed for a
+// block but never tears a value.
+class StepSequencer {
+public:
+    explicit StepSequencer(size_t parameter_count);
+    
+    static const uint32_t MAX_STEPS = 16;
+    static const uint32_t STEPS_PER_BEAT = 4;
+    static const size_t MAX_STEPS_PER_BLOCK = 8;
+    static constexpr double LINK_BUDGET = 0.75;
+    static constexpr double DELIVERY_MARGIN_SECONDS = 0.002;
+    
+    // Pattern. Values are normalized like host parameter values. Out-of-range
+    // steps and parameters are ignored; setting the current length does nothing.
+    void setLength(uint32_t steps);
+    uint32_t getLength() const { return length_.load(std::memory_order_relaxed); }
+    void setLock(uint32_t step, uint32_t param_id, double value);
+    void clearLock(uint32_t step, uint32_t param_id);
+    void clearStep(uint32_t step);
+    void clear();
+    bool getLock(uint32_t step, uint32_t param_id, double* value) const;
+    // Locks in the whole pattern, so callers can skip scanning an empty one
+    uint32_t getLockCount() const { return lock_count_.load(std::memory_order_relaxed); }
+    size_t getParameterCount() const { return parameter_count_; }
+    
+    // How long before its step a step's last write should arrive. Any thread.
+    void setDeliveryMarginSeconds(double seconds);
+    double getDeliveryMarginSeconds() const { return delivery_margin_seconds_.load(std::memory_order_relaxed); }
+    
+    // Upper bound of the bytes one write of the parameter takes; 0 for parameters
+    // that can't be locked (plugin settings). Set by the plugin for every
+    // parameter, and again when the encoding setting changes.
+    void setWriteBytes(uint32_t param_id, uint8_t bytes);
+    uint8_t getWriteBytes(uint32_t param_id) const;
+    
+    // Audio thread. Appends the steps whose writes start in this block, in order,
+    // and returns how many. A null transport, one without tempo and beat position,
+    // a stopped one or enabled == false stops the sequencer.
+    size_t process(const clap_event_transport_t* transport, bool enabled, uint32_t frames,
+                   double sample_rate, ScheduledStep* out, size_t capacity);
+    
+    // Audio thread. True once after the sequencer stopped: locked values still on
+    // the hardware should go back to the parameters' own values.
+    bool takeStopped();
+    
+    // Forget the transport state (e.g. on activate)
+    void reset();
+    bool isRunning() const { return running_; }
+    
+    // Delivery check at the last tempo seen: one bit per undeliverable step, the
+    // bytes the worst step needs and the per-step budget. Any thread.
+    uint32_t getUndeliverableSteps() const { return undeliverable_steps_.load(std::memory_order_relaxed); }
+    uint32_t getWorstStepBytes() const { return worst_step_bytes_.load(std::memory_order_relaxed); }
+    uint32_t getStepBudgetBytes() const { return step_budget_bytes_.load(std::memory_order_relaxed); }
+    double getCheckedTempo() const { return checked_tempo_.load(std::memory_order_relaxed); }
+    
+    // Bytes per step the link carries at a tempo, within the budget and margin
+    static size_t stepBudgetBytes(double tempo, double margin_seconds = DELIVERY_MARGIN_SECONDS);
+
+private:
+    size_t parameter_count_;
+    std::atomic<uint32_t> length_;
+    // MAX_STEPS rows of parameter_count_ values; negative when not locked
+    std::unique_ptr<std::atomic<float>[]> locks_;
+    std::atomic<uint32_t> lock_count_;
+    std::unique_ptr<std::atomic<uint8_t>[]> write_bytes_;
+    std::atomic<double> delivery_margin_seconds_;
+    // Bumped by every pattern, write size or margin change
+    std::atomic<uint64_t> version_;
+    
+    // Audio thread: transport following
+    bool running_;
+    bool stopped_;
+    int64_t next_step_;         // sixteenths from beat 0 of the next step to schedule
+    double expected_beats_;     // where the next block should start if nothing jumped
+    
+    // Audio thread: per-step estimates for the pattern and tempo last checked
+    uint64_t checked_version_;
+    size_t step_bytes_[MAX_STEPS];
+    std::atomic<uint32_t> undeliverable_steps_;
+    std::atomic<uint32_t> worst_step_bytes_;
+    std::atomic<uint32_t> step_budget_bytes_;
+    std::atomic<double> checked_tempo_;
+    
+    static const float NO_LOCK;
+    
+    void checkDelivery(double tempo);
+    void stop();
+};
@@ -0,0 +1,230 @@
+#include "trace.h"
+#include <cstdio>
+#include <vector>
+
+const char* const Tracer::ENV_VAR = "SPOBX8_TRACE";
+
+std::atomic<bool> Tracer::recording_(false);
+
+namespace {
+
+enum TracePhase : uint8_t {
+    TRACE_PHASE_COMPLETE,
+    TRACE_PHASE_INSTANT
+};
+
+struct TraceRecord {
+    const char* category;
+    const char* name;
+    uint64_t start_ns;
+    uint64_t duration_ns;
+    int64_t arg;
+    TracePhase phase;
+};
+
+// A ring belongs to a live thread, holds the records of one that exited until
+// an export writes them, or is free for the next thread
+enum TraceBufferState : uint8_t {
+    TRACE_BUFFER_LIVE,
+    TRACE_BUFFER_RETIRED,
+    TRACE_BUFFER_FREE
+};
+
+// Never freed: the exporter may read a ring while its thread exits
+struct TraceThreadBuffer {
+    TraceRecord records[Tracer::RECORDS_PER_THREAD];
+    std::atomic<uint64_t> head{0};  // records written, owned by the thread
+    std::atomic<const char*> name{nullptr};
+    std::atomic<uint32_t> tid{0};
+    std::atomic<uint8_t> state{TRACE_BUFFER_LIVE};
+};
+
+std::atomic<TraceThreadBuffer*> g_buffers[Tracer::MAX_THREADS];
+std::atomic<size_t> g_buffer_claims(0);
+std::atomic<uint32_t> g_next_tid(1);
+std::atomic<uint64_t> g_threads_without_buffer(0);
+std::atomic<uint64_t> g_epoch_ns(0);
+
+thread_local TraceThreadBuffer* t_buffer = nullptr;
+thread_local bool t_out_of_buffers = false;
+
+// Retires the thread's ring when the thread exits. Only touched when a ring is
+// claimed, so recording never pays for the destructor registration.
+struct TraceBufferOwner {
+    TraceThreadBuffer* buffer = nullptr;
+    ~TraceBufferOwner() {
+        if (buffer) {
+            buffer->state.store(TRACE_BUFFER_RETIRED, std::memory_order_release);
+        }
+    }
+};
+thread_local TraceBufferOwner t_buffer_owner;
+
+TraceThreadBuffer* claimFreeBuffer() {
+    size_t count = g_buffer_claims.load(std::memory_order_acquire);
+    if (count > Tracer::MAX_THREADS) {
+        count = Tracer::MAX_THREADS;
+    }
+    for (size_t i = 0; i < count; ++i) {
+        TraceThreadBuffer* buffer = g_buffers[i].load(std::memory_order_acquire);
+        uint8_t free_state = TRACE_BUFFER_FREE;
+        if (buffer && buffer->state.compare_exchange_strong(free_state, TRACE_BUFFER_LIVE,
+                                                            std::memory_order_acquire)) {
+            return buffer;
+        }
+    }
+    
+    size_t index = g_buffer_claims.fetch_add(1, std::memory_order_relaxed);
+    if (index >= Tracer::MAX_THREADS) {
+        return nullptr;
+    }
+    TraceThreadBuffer* buffer = new TraceThreadBuffer();
+    buffer->tid.store(g_next_tid.fetch_add(1, std::memory_order_relaxed), std::memory_order_relaxed);
+    g_buffers[index].store(buffer, std::memory_order_release);
+    return buffer;
+}
+
+TraceThreadBuffer* threadBuffer() {
+    if (t_buffer || t_out_of_buffers) {
+        return t_buffer;
+    }
+    TraceThreadBuffer* buffer = claimFreeBuffer();
+    if (!buffer) {
+        t_out_of_buffers = true;
+        g_threads_without_buffer.fetch_add(1, std::memory_order_relaxed);
+        return nullptr;
+    }
+    t_buffer_owner.buffer = buffer;
+    t_buffer = buffer;
+    return buffer;
+}
+
+void append(const TraceRecord& record) {
+    TraceThreadBuffer* buffer = threadBuffer();
+    if (!buffer) {
+        return;
+    }
+    uint64_t head = buffer->head.load(std::memory_order_relaxed);
+    buffer->records[head & (Tracer::RECORDS_PER_THREAD - 1)] = record;
+    buffer->head.store(head + 1, std::memory_order_release);
+}
+
+double toMicroseconds(uint64_t time_ns, uint64_t epoch_ns) {
+    return (static_cast<double>(time_ns) - static_cast<double>(epoch_ns)) / 1000.0;
+}
+
+} // namespace
+
+bool Tracer::isAvailable() {
+    return SPOBX8_TRACING != 0;
+}
+
+bool Tracer::start() {
+    if (!isAvailable()) {
+        return false;
+    }
+    uint64_t unset = 0;
+    g_epoch_ns.compare_exchange_strong(unset, nowNs(), std::memory_order_relaxed);
+    recording_.store(true, std::memory_order_relaxed);
+    return true;
+}
+
+void Tracer::stop() {
+    recording_.store(false, std::memory_order_relaxed);
+}
+
+void Tracer::complete(const char* category, const char* name, uint64_t start_ns, uint64_t end_ns, int64_t arg) {
+    append(TraceRecord{category, name, start_ns, end_ns - start_ns, arg, TRACE_PHASE_COMPLETE});
+}
+
+void Tracer::instant(const char* category, const char* name, int64_t arg) {
+    append(TraceRecord{category, name, nowNs(), 0, arg, TRACE_PHASE_INSTANT});
+}
+
+void Tracer::nameThread(const char* name) {
+    if (TraceThreadBuffer* buffer = threadBuffer()) {
+        buffer->name.store(name, std::memory_order_relaxed);
+    }
+}
+
+bool Tracer::exportChromeJson(const std::string& path) {
+    if (!isAvailable()) {
+        return false;
+    }
+    FILE* file = std::fopen(path.c_str(), "w");
+    if (!file) {
+        return false;
+    }
+    
+    uint64_t epoch_ns = g_epoch_ns.load(std::memory_order_relaxed);
+    size_t buffer_count = g_buffer_claims.load(std::memory_order_acquire);
+    if (buffer_count > MAX_THREADS) {
+        buffer_count = MAX_THREADS;
+    }
+    
+    std::fprintf(file, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+    bool first_event = true;
+    std::vector<TraceRecord> records;
+    records.reserve(RECORDS_PER_THREAD);
+    
+    for (size_t i = 0; i < buffer_count; ++i) {
+        TraceThreadBuffer* buffer = g_buffers[i].load(std::memory_order_acquire);
+        if (!buffer) {
+            continue;
+        }
+        // A free ring was written by an earlier export
+        uint8_t state = buffer->state.load(std::memory_order_acquire);
+        if (state == TRACE_BUFFER_FREE) {
+            continue;
+        }
+        uint32_t tid = buffer->tid.load(std::memory_order_acquire);
+        
+        if (const char* name = buffer->name.load(std::memory_order_relaxed)) {
+            std::fprintf(file, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"%s\"}}",
+                         first_event ? "" : ",\n", tid, name);
+            first_event = false;
+        }
+        
+        // Copy the ring, then drop whatever the thread overwrote meanwhile
+        uint64_t head = buffer->head.load(std::memory_order_acquire);
+        uint64_t first = head > RECORDS_PER_THREAD ? head - RECORDS_PER_THREAD : 0;
+        records.clear();
+        for (uint64_t index = first; index < head; ++index) {
+            records.push_back(buffer->records[index & (RECORDS_PER_THREAD - 1)]);
+        }
+        uint64_t head_after = buffer->head.load(std::memory_order_acquire);
+        uint64_t valid_from = head_after > RECORDS_PER_THREAD ? head_after - RECORDS_PER_THREAD : 0;
+        size_t skip = valid_from > first ? static_cast<size_t>(valid_from - first) : 0;
+        
+        for (size_t r = skip; r < records.size(); ++r) {
+            const TraceRecord& record = records[r];
+            if (record.start_ns < epoch_ns) {
+                continue;
+            }
+            std::fprintf(file, "%s{\"name\":\"%s\",\"cat\":\"%s\",", first_event ? "" : ",\n", record.name,
+                         record.category);
+            if (record.phase == TRACE_PHASE_COMPLETE) {
+                std::fprintf(file, "\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,", toMicroseconds(record.start_ns, epoch_ns),
+                             record.duration_ns / 1000.0);
+            } else {
+                std::fprintf(file, "\"ph\":\"i\",\"s\":\"t\",\"ts\":%.3f,", toMicroseconds(record.start_ns, epoch_ns));
+            }
+            std::fprintf(file, "\"pid\":1,\"tid\":%u,\"args\":{\"value\":%lld}}", tid,
+                         static_cast<long long>(record.arg));
+            first_event = false;
+        }
+        
+        // Written out and no thread writes it any more: empty it under a new
+        // thread id before the next thread may take it
+        if (state == TRACE_BUFFER_RETIRED) {
+            buffer->head.store(0, std::memory_order_relaxed);
+            buffer->name.store(nullptr, std::memory_order_relaxed);
+            buffer->tid.store(g_next_tid.fetch_add(1, std::memory_order_relaxed), std::memory_order_relaxed);
+            buffer->state.store(TRACE_BUFFER_FREE, std::memory_order_release);
+        }
+    }
+    
+    std::fprintf(file, "\n],\"otherData\":{\"threads_without_buffer\":%llu}}\n",
+                 static_cast<unsigned long long>(g_threads_without_buffer.load(std::memory_order_relaxed)));
+    return std::fclose(file) == 0;
+}
@@ -0,0 +1,106 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Timeline tracing: spans and instant events recorded per thread and exported as
+// Chrome trace JSON (chrome://tracing, ui.perfetto.dev), so audio callbacks can
+// be lined up with MIDI bursts and OS sends. Compiled in only with
+// -DSPOBX8_ENABLE_TRACING=ON; otherwise the SPOBX8_TRACE_* macros expand to
+// nothing. Even when compiled in, nothing is recorded until Tracer::start().
+//
+// Each thread writes its own ring of the most recent records; a record is two
+// clock reads and a few stores, with no locks or allocation once the thread's
+// ring exists (claimed on its first record). A thread's ring outlives it until
+// the next export has written it out, and is then reused by a new thread. When
+// MAX_THREADS rings are in use a new thread records nothing; the export counts
+// those threads. Names and categories must be string literals.
+#ifndef SPOBX8_TRACING
+#define SPOBX8_TRACING 0
+#endif
+
+class Tracer {
+public:
+    // Environment variable naming a file the plugin exports to at deactivate()
+    static const char* const ENV_VAR;
+    static const size_t RECORDS_PER_THREAD = 16384;  // power of two
+    static const size_t MAX_THREADS = 64;
+    
+    // False when tracing was compiled out; start() then does nothing
+    static bool isAvailable();
+    
+    // Main thread. Recording is process-wide and shared by all instances.
+    static bool start();
+    static void stop();
+    static bool isRecording() { return recording_.load(std::memory_order_relaxed); }
+    
+    // Writes everything still held in the rings as Chrome trace JSON, with the
+    // number of threads that found no free ring under otherData. Main thread;
+    // records written during the export may or may not be included.
+    static bool exportChromeJson(const std::string& path);
+    
+    // Any thread
+    static void complete(const char* category, const char* name, uint64_t start_ns, uint64_t end_ns, int64_t arg);
+    static void instant(const char* category, const char* name, int64_t arg);
+    static void nameThread(const char* name);
+    
+    static uint64_t nowNs() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+private:
+    static std::atomic<bool> recording_;
+};
+
+// Records a span from construction to the end of the scope
+class TraceScope {
+public:
+    TraceScope(const char* category, const char* name, int64_t arg = 0)
+        : category_(category)
+        , name_(name)
+        , arg_(arg)
+        , start_ns_(Tracer::isRecording() ? Tracer::nowNs() : 0)
+    {
+    }
+    
+    ~TraceScope() {
+        if (start_ns_ != 0) {
+            Tracer::complete(category_, name_, start_ns_, Tracer::nowNs(), arg_);
+        }
+    }
+    
+    TraceScope(const TraceScope&) = delete;
+    TraceScope& operator=(const TraceScope&) = delete;
+
+private:
+    const char* category_;
+    const char* name_;
+    int64_t arg_;
+    uint64_t start_ns_;
+};
+
+#if SPOBX8_TRACING
+#define SPOBX8_TRACE_CONCAT_(a, b) a##b
+#define SPOBX8_TRACE_CONCAT(a, b) SPOBX8_TRACE_CONCAT_(a, b)
+#define SPOBX8_TRACE_SCOPE(category, name, arg) \
+    TraceScope SPOBX8_TRACE_CONCAT(trace_scope_, __LINE__)(category, name, static_cast<int64_t>(arg))
+#define SPOBX8_TRACE_INSTANT(category, name, arg) \
+    do { \
+        if (Tracer::isRecording()) { \
+            Tracer::instant(category, name, static_cast<int64_t>(arg)); \
+        } \
+    } while (0)
+#define SPOBX8_TRACE_THREAD_NAME(name) \
+    do { \
+        if (Tracer::isRecording()) { \
+            Tracer::nameThread(name); \
+        } \
+    } while (0)
+#else
+#define SPOBX8_TRACE_SCOPE(category, name, arg) do {} while (0)
+#define SPOBX8_TRACE_INSTANT(category, name, arg) do {} while (0)
+#define SPOBX8_TRACE_THREAD_NAME(name) do {} while (0)
+#endif
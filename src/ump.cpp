@@ -0,0 +1,51 @@
+#include "ump.h"
+
+UmpPacket UmpCodec::fromMidi1(uint8_t status, uint8_t data1, uint8_t data2, uint8_t group) {
+    if (status == 0xF0 || status == 0xF7 || status < 0x80) {
+        return UmpPacket{0, 0};
+    }
+    uint32_t type = status >= 0xF0 ? TYPE_SYSTEM : TYPE_MIDI1_CHANNEL_VOICE;
+    uint32_t word0 = (type << 28) | (static_cast<uint32_t>(group & 0x0F) << 24) |
+                     (static_cast<uint32_t>(status) << 16) | (static_cast<uint32_t>(data1 & 0x7F) << 8) |
+                     (data2 & 0x7F);
+    return UmpPacket{word0, 0};
+}
+
+UmpPacket UmpCodec::nrpn(uint8_t channel, uint16_t number, uint32_t value, uint8_t group) {
+    uint32_t word0 = (static_cast<uint32_t>(TYPE_MIDI2_CHANNEL_VOICE) << 28) |
+                     (static_cast<uint32_t>(group & 0x0F) << 24) |
+                     (static_cast<uint32_t>(OPCODE_ASSIGNABLE_CONTROLLER) << 20) |
+                     (static_cast<uint32_t>(channel & 0x0F) << 16) |
+                     (static_cast<uint32_t>((number >> 7) & 0x7F) << 8) | (number & 0x7F);
+    return UmpPacket{word0, value};
+}
+
+UmpPacket UmpCodec::relativeNrpn(uint8_t channel, uint16_t number, int32_t delta, uint8_t group) {
+    UmpPacket packet = nrpn(channel, number, static_cast<uint32_t>(delta), group);
+    packet.word0 = (packet.word0 & ~0x00F00000u) |
+                   (static_cast<uint32_t>(OPCODE_RELATIVE_ASSIGNABLE_CONTROLLER) << 20);
+    return packet;
+}
+
+uint32_t UmpCodec::scaleUp(uint32_t value, unsigned source_bits, unsigned target_bits) {
+    unsigned scale_bits = target_bits - source_bits;
+    uint32_t shifted = value << scale_bits;
+    uint32_t center = 1u << (source_bits - 1);
+    if (value <= center) {
+        return shifted;
+    }
+    
+    // Above the center the low bits repeat the value's own bits below its MSB
+    unsigned repeat_bits = source_bits - 1;
+    uint32_t repeat = value & ((1u << repeat_bits) - 1);
+    if (scale_bits > repeat_bits) {
+        repeat <<= scale_bits - repeat_bits;
+    } else {
+        repeat >>= repeat_bits - scale_bits;
+    }
+    while (repeat != 0) {
+        shifted |= repeat;
+        repeat >>= repeat_bits;
+    }
+    return shifted;
+}
@@ -0,0 +1,67 @@
+#pragma once
+#include <cstdint>
+
+// One Universal MIDI Packet of up to 64 bits, word 0 first. Word 0 starts with
+// the message type and group nibbles; 32-bit types leave word 1 zero.
+struct UmpPacket {
+    uint32_t word0;
+    uint32_t word1;
+};
+
+// Builds and reads the packets the plugin sends internally. Parameter writes are
+// MIDI 2.0 channel voice packets, so an NRPN is one packet carrying its number
+// and a 32-bit value rather than four controller messages; everything else is a
+// MIDI 1.0 message in its 32-bit packet form. Conversion back to MIDI 1.0 byte
+// streams happens at the transport (UmpMidi1Encoder).
+class UmpCodec {
+public:
+    enum MessageType : uint8_t {
+        TYPE_UTILITY = 0x0,
+        TYPE_SYSTEM = 0x1,
+        TYPE_MIDI1_CHANNEL_VOICE = 0x2,
+        TYPE_MIDI2_CHANNEL_VOICE = 0x4
+    };
+    
+    // MIDI 2.0 channel voice opcodes
+    static const uint8_t OPCODE_ASSIGNABLE_CONTROLLER = 0x3;           // NRPN
+    static const uint8_t OPCODE_RELATIVE_ASSIGNABLE_CONTROLLER = 0x5;  // NRPN increment/decrement
+    
+    // A MIDI 1.0 message: channel voice as type 2, system common and realtime as
+    // type 1. SysEx has no 32-bit form and becomes a utility NOOP.
+    static UmpPacket fromMidi1(uint8_t status, uint8_t data1, uint8_t data2, uint8_t group = 0);
+    
+    // NRPN write of a 14-bit number with a 32-bit value
+    static UmpPacket nrpn(uint8_t channel, uint16_t number, uint32_t value, uint8_t group = 0);
+    // Relative NRPN change; the value is a signed step count
+    static UmpPacket relativeNrpn(uint8_t channel, uint16_t number, int32_t delta, uint8_t group = 0);
+    
+    static uint8_t messageType(const UmpPacket& packet) { return static_cast<uint8_t>(packet.word0 >> 28); }
+    static uint8_t group(const UmpPacket& packet) { return (packet.word0 >> 24) & 0x0F; }
+    // The MIDI 1.0 status byte of types 1 and 2; opcode and channel of type 4
+    static uint8_t statusByte(const UmpPacket& packet) { return (packet.word0 >> 16) & 0xFF; }
+    static uint8_t opcode(const UmpPacket& packet) { return (packet.word0 >> 20) & 0x0F; }
+    static uint8_t channel(const UmpPacket& packet) { return (packet.word0 >> 16) & 0x0F; }
+    static uint8_t data1(const UmpPacket& packet) { return (packet.word0 >> 8) & 0x7F; }
+    static uint8_t data2(const UmpPacket& packet) { return packet.word0 & 0x7F; }
+    
+    static bool isNrpn(const UmpPacket& packet) {
+        return messageType(packet) == TYPE_MIDI2_CHANNEL_VOICE && opcode(packet) == OPCODE_ASSIGNABLE_CONTROLLER;
+    }
+    static bool isRelativeNrpn(const UmpPacket& packet) {
+        return messageType(packet) == TYPE_MIDI2_CHANNEL_VOICE &&
+               opcode(packet) == OPCODE_RELATIVE_ASSIGNABLE_CONTROLLER;
+    }
+    // Bank (number MSB) and index (number LSB) of either NRPN packet
+    static uint16_t nrpnNumber(const UmpPacket& packet) {
+        return static_cast<uint16_t>((((packet.word0 >> 8) & 0x7F) << 7) | (packet.word0 & 0x7F));
+    }
+    static int32_t relativeDelta(const UmpPacket& packet) { return static_cast<int32_t>(packet.word1); }
+    
+    // Value resolution changes as the MIDI 2.0 specification defines them:
+    // min-center-max scaling up, so 0, the center and full scale stay exact, and
+    // truncation down, which inverts it
+    static uint32_t scaleUp(uint32_t value, unsigned source_bits, unsigned target_bits);
+    static uint32_t scaleDown(uint32_t value, unsigned source_bits, unsigned target_bits) {
+        return value >> (source_bits - target_bits);
+    }
+};
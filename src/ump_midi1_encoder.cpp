@@ -0,0 +1,114 @@
+#include "ump_midi1_encoder.h"
+
+UmpMidi1Encoder::UmpMidi1Encoder()
+    : selected_nrpn_(NO_SELECTED_NRPN)
+{
+}
+
+size_t UmpMidi1Encoder::messageLength(const MidiMessage& message) {
+    if (message.status >= 0xF0) {
+        switch (message.status) {
+            case 0xF1: // MTC quarter frame
+            case 0xF3: // Song select
+                return 2;
+            case 0xF2: // Song position pointer
+                return 3;
+            default:   // Realtime and the remaining single-byte system messages
+                return 1;
+        }
+    }
+    uint8_t type = message.status & 0xF0;
+    return (type == 0xC0 || type == 0xD0) ? 2 : 3;
+}
+
+size_t UmpMidi1Encoder::maxWireLength(const UmpPacket& packet) {
+    switch (UmpCodec::messageType(packet)) {
+        case UmpCodec::TYPE_SYSTEM:
+        case UmpCodec::TYPE_MIDI1_CHANNEL_VOICE:
+            return messageLength(MidiMessage{UmpCodec::statusByte(packet), 0, 0, 0});
+        case UmpCodec::TYPE_MIDI2_CHANNEL_VOICE:
+            if (UmpCodec::isNrpn(packet)) {
+                return 12;
+            }
+            if (UmpCodec::isRelativeNrpn(packet)) {
+                int32_t delta = UmpCodec::relativeDelta(packet);
+                int steps = delta < 0 ? -delta : delta;
+                return 6 + 3 * static_cast<size_t>(steps < MAX_RELATIVE_STEPS ? steps : MAX_RELATIVE_STEPS);
+            }
+            return 0;
+        default:
+            return 0;
+    }
+}
+
+size_t UmpMidi1Encoder::encodeAddress(uint8_t status, uint16_t parameter, MidiMessage* messages) {
+    messages[0] = MidiMessage{status, CC_NRPN_MSB, static_cast<uint8_t>((parameter >> 7) & 0x7F), 0};
+    messages[1] = MidiMessage{status, CC_NRPN_LSB, static_cast<uint8_t>(parameter & 0x7F), 0};
+    selected_nrpn_.store(parameter, std::memory_order_relaxed);
+    return 2;
+}
+
+size_t UmpMidi1Encoder::encode(const UmpPacket& packet, MidiMessage* messages) {
+    uint8_t type = UmpCodec::messageType(packet);
+    if (type == UmpCodec::TYPE_SYSTEM || type == UmpCodec::TYPE_MIDI1_CHANNEL_VOICE) {
+        uint8_t status = UmpCodec::statusByte(packet);
+        uint8_t data1 = UmpCodec::data1(packet);
+        if ((status & 0xF0) == 0xB0 && (data1 == CC_NRPN_MSB || data1 == CC_NRPN_LSB ||
+                                         data1 == CC_RPN_MSB || data1 == CC_RPN_LSB)) {
+            // Someone else addressed the hardware
+            invalidateSelectedNRPN();
+        }
+        messages[0] = MidiMessage{status, data1, UmpCodec::data2(packet), 0};
+        return 1;
+    }
+    if (type != UmpCodec::TYPE_MIDI2_CHANNEL_VOICE) {
+        return 0;
+    }
+    
+    uint8_t status = static_cast<uint8_t>(0xB0 | UmpCodec::channel(packet));
+    uint16_t parameter = UmpCodec::nrpnNumber(packet);
+    
+    if (UmpCodec::isNrpn(packet)) {
+        // Absolute writes always carry the address so they also resynchronise the hardware
+        size_t count = encodeAddress(status, parameter, messages);
+        uint32_t value = UmpCodec::scaleDown(packet.word1, 32, 14);
+        messages[count++] = MidiMessage{status, CC_DATA_MSB, static_cast<uint8_t>((value >> 7) & 0x7F), 0};
+        messages[count++] = MidiMessage{status, CC_DATA_LSB, static_cast<uint8_t>(value & 0x7F), 0};
+        return count;
+    }
+    
+    if (UmpCodec::isRelativeNrpn(packet)) {
+        size_t count = 0;
+        if (!isNRPNSelected(parameter)) {
+            count = encodeAddress(status, parameter, messages);
+        }
+        
+        // The data byte is sent as 1 so receivers that read it as a step count and
+        // receivers that ignore it both move by one unit per message
+        int32_t delta = UmpCodec::relativeDelta(packet);
+        uint8_t cc = delta > 0 ? CC_DATA_INCREMENT : CC_DATA_DECREMENT;
+        int steps = delta > 0 ? delta : -delta;
+        if (steps > MAX_RELATIVE_STEPS) {
+            steps = MAX_RELATIVE_STEPS;
+        }
+        for (int i = 0; i < steps; ++i) {
+            messages[count++] = MidiMessage{status, cc, 1, 0};
+        }
+        return count;
+    }
+    return 0;
+}
+
+size_t UmpMidi1Encoder::encodeBytes(const UmpPacket& packet, uint8_t* bytes) {
+    MidiMessage messages[MAX_MESSAGES];
+    size_t count = encode(packet, messages);
+    size_t length = 0;
+    for (size_t i = 0; i < count; ++i) {
+        const uint8_t message_bytes[3] = {messages[i].status, messages[i].data1, messages[i].data2};
+        size_t message_length = messageLength(messages[i]);
+        for (size_t j = 0; j < message_length; ++j) {
+            bytes[length++] = message_bytes[j];
+        }
+    }
+    return length;
+}
@@ -0,0 +1,60 @@
+#pragma once
+#include "midi_handler.h"
+#include "ump.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+// Down-converts outgoing packets to MIDI 1.0 where they leave the plugin (device
+// bytes or host MIDI events). An NRPN packet becomes CC99/98/6/38 and a relative
+// one the data increment/decrement run; the encoder tracks the NRPN selected on
+// the wire so a relative change only repeats the address after another NRPN was
+// selected. Packets must be encoded in the order they go out. Audio thread,
+// except invalidateSelectedNRPN.
+class UmpMidi1Encoder {
+public:
+    UmpMidi1Encoder();
+    
+    // A relative packet of more steps is sent as this many
+    static const int MAX_RELATIVE_STEPS = 16;
+    // Most messages and bytes one packet can expand to
+    static const size_t MAX_MESSAGES = 2 + MAX_RELATIVE_STEPS;
+    static const size_t MAX_BYTES = MAX_MESSAGES * 3;
+    
+    // Writes the MIDI 1.0 form of packet into messages (room for MAX_MESSAGES) and
+    // returns the count; 0 for packets with no MIDI 1.0 form
+    size_t encode(const UmpPacket& packet, MidiMessage* messages);
+    // The same as a byte stream (room for MAX_BYTES); returns its length
+    size_t encodeBytes(const UmpPacket& packet, uint8_t* bytes);
+    
+    // Bytes the packet takes on a MIDI 1.0 wire, counting a relative packet's address
+    static size_t maxWireLength(const UmpPacket& packet);
+    
+    // Bytes a message occupies on the wire (program change and channel pressure are
+    // 2, clock and transport 1, song position 3)
+    static size_t messageLength(const MidiMessage& message);
+    
+    bool isNRPNSelected(uint16_t parameter) const {
+        return selected_nrpn_.load(std::memory_order_relaxed) == parameter;
+    }
+    // Forget the NRPN address on the wire, e.g. after a message was lost on the way
+    // out. Any thread.
+    void invalidateSelectedNRPN() { selected_nrpn_.store(NO_SELECTED_NRPN, std::memory_order_relaxed); }
+
+private:
+    // NRPN address last encoded, NO_SELECTED_NRPN when unknown. Atomic because
+    // device changes invalidate it from the main thread.
+    std::atomic<int32_t> selected_nrpn_;
+    static const int32_t NO_SELECTED_NRPN = -1;
+    
+    size_t encodeAddress(uint8_t status, uint16_t parameter, MidiMessage* messages);
+    
+    static const uint8_t CC_NRPN_MSB = 99;
+    static const uint8_t CC_NRPN_LSB = 98;
+    static const uint8_t CC_DATA_MSB = 6;
+    static const uint8_t CC_DATA_LSB = 38;
+    static const uint8_t CC_DATA_INCREMENT = 96;
+    static const uint8_t CC_DATA_DECREMENT = 97;
+    static const uint8_t CC_RPN_LSB = 100;
+    static const uint8_t CC_RPN_MSB = 101;
+};
@@ -0,0 +1,321 @@
+// Replays a SPOBX8Edit traffic capture through a fresh plugin instance.
+//
+// Usage: obx8_replay CAPTURE [--compare] [--output REPLAY] [--repeat N] [--trace TRACE.json]
+//
+// Host events are fed back through process()/params_flush() block by block, and
+// captured device input through the plugin's MIDI receive path, with the plugin
+// clock driven from the capture timestamps so throttling and timeouts behave as
+// recorded, and on_main_thread() called wherever the host called it. The plugin
+// talks to the Null device, so no hardware is touched.
+//
+// --compare captures the replay's own output and fails (exit status 1) when the
+// MIDI it sends to the device or the host differs from the original capture.
+// --repeat runs the replay N times and reports process() timing over all runs.
+// --trace writes a Chrome trace of the replay (builds with SPOBX8_ENABLE_TRACING).
+
+#include "../bench/bench_host.h"
+#include "../src/obx8_plugin.h"
+#include "../src/midi_capture.h"
+#include "../src/trace.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct ReplayStats {
+    uint64_t blocks = 0;
+    uint64_t flushes = 0;
+    uint64_t events = 0;
+    uint64_t device_bytes_in = 0;
+    uint64_t dropped = 0;
+    std::vector<uint64_t> process_ns;
+};
+
+// MIDI a run sent, in order: device bytes and host events kept separately since
+// they leave through different paths
+struct ReplayOutput {
+    std::vector<uint8_t> device_bytes;
+    std::vector<uint8_t> host_events;
+};
+
+static bool loadCapture(const std::string& path, std::vector<CaptureRecord>& records) {
+    CaptureReader reader;
+    if (!reader.open(path)) {
+        return false;
+    }
+    
+    CaptureRecord record;
+    while (reader.next(record)) {
+        records.push_back(record);
+    }
+    
+    // Records from different threads can reach the ring slightly out of order
+    std::stable_sort(records.begin(), records.end(), [](const CaptureRecord& a, const CaptureRecord& b) {
+        return a.time_ns < b.time_ns;
+    });
+    return true;
+}
+
+static void collectOutput(const std::vector<CaptureRecord>& records, ReplayOutput& output) {
+    for (const auto& record : records) {
+        if (record.type == CAPTURE_DEVICE_MIDI_OUT) {
+            output.device_bytes.insert(output.device_bytes.end(), record.payload.begin(), record.payload.end());
+        } else if (record.type == CAPTURE_HOST_MIDI_OUT) {
+            output.host_events.insert(output.host_events.end(), record.payload.begin(), record.payload.end());
+        }
+    }
+}
+
+static bool replay(const std::vector<CaptureRecord>& records, const std::string& output_path, ReplayStats& stats) {
+    CaptureSession session = {48000.0, 1, 4096};
+    for (const auto& record : records) {
+        if (record.type == CAPTURE_SESSION && CaptureReader::decode(record, session)) {
+            break;
+        }
+    }
+    
+    uint64_t clock_ns = records.empty() ? 0 : records.front().time_ns;
+    OBX8Plugin plugin(&bench_host);
+    plugin.setTimeSource([&clock_ns]() { return clock_ns; });
+    plugin.init();
+    if (!output_path.empty() && !plugin.startCapture(output_path)) {
+        std::fprintf(stderr, "Failed to open %s\n", output_path.c_str());
+        return false;
+    }
+    
+    plugin.activate(session.sample_rate, session.min_frames, session.max_frames);
+    plugin.start_processing();
+    
+    // Let deferred MIDI setup finish so it can't pick a device mid-replay
+    for (int i = 0; i < 500 && !plugin.isMidiReady(); ++i) {
+        plugin.on_main_thread();
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    plugin.selectMidiDevice(MidiDeviceManager::NULL_DEVICE_NAME);
+    
+    BenchInputEvents in_events;
+    BenchOutputEvents out_events;
+    uint32_t pending_events = 0;
+    
+    for (const auto& record : records) {
+        clock_ns = record.time_ns;
+        
+        switch (record.type) {
+            case CAPTURE_PARAM_VALUE:
+            case CAPTURE_PARAM_MOD: {
+                CaptureParamEvent event;
+                if (CaptureReader::decode(record, event)) {
+                    if (record.type == CAPTURE_PARAM_VALUE) {
+                        in_events.addParamValue(event.sample_time, event.param_id, event.value);
+                    } else {
+                        in_events.addParamMod(event.sample_time, event.param_id, event.value);
+                    }
+                    ++pending_events;
+                }
+                break;
+            }
+            
+            case CAPTURE_HOST_MIDI_IN: {
+                CaptureHostMidi event;
+                if (CaptureReader::decode(record, event)) {
+                    in_events.addMidi(event.sample_time, event.data[0], event.data[1], event.data[2]);
+                    ++pending_events;
+                }
+                break;
+            }
+            
+            case CAPTURE_BLOCK: {
+                CaptureBlock block;
+                if (!CaptureReader::decode(record, block)) {
+                    break;
+                }
+                if (block.event_count != pending_events) {
+                    std::fprintf(stderr, "Block at %llu: expected %u events, capture holds %u\n",
+                                 static_cast<unsigned long long>(record.time_ns), block.event_count, pending_events);
+                }
+                
+                clap_process_t process = {};
+                process.steady_time = block.steady_time;
+                process.frames_count = block.frames;
+                process.in_events = in_events.get();
+                process.out_events = out_events.get();
+                
+                auto start = std::chrono::steady_clock::now();
+                plugin.process(&process);
+                stats.process_ns.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    std::chrono::steady_clock::now() - start).count());
+                
+                stats.events += pending_events;
+                ++stats.blocks;
+                pending_events = 0;
+                in_events.clear();
+                out_events.clear();
+                break;
+            }
+            
+            case CAPTURE_FLUSH: {
+                plugin.params_flush(in_events.get(), out_events.get());
+                stats.events += pending_events;
+                ++stats.flushes;
+                pending_events = 0;
+                in_events.clear();
+                out_events.clear();
+                break;
+            }
+            
+            case CAPTURE_MAIN_THREAD:
+                plugin.on_main_thread();
+                break;
+            
+            case CAPTURE_RENDER_MODE: {
+                // Replay under the host's mode, not whatever the capture clock suggests
+                CaptureRenderMode render;
+                if (CaptureReader::decode(record, render) && render.mode >= 0) {
+                    plugin.render_set(static_cast<clap_plugin_render_mode>(render.mode));
+                }
+                break;
+            }
+            
+            case CAPTURE_DEVICE_MIDI_IN:
+                plugin.receiveMidiData(record.payload.data(), record.payload.size());
+                stats.device_bytes_in += record.payload.size();
+                break;
+            
+            case CAPTURE_DROPPED: {
+                uint64_t lost = 0;
+                if (CaptureReader::decode(record, lost)) {
+                    stats.dropped += lost;
+                }
+                break;
+            }
+            
+            default:
+                // Session and recorded output
+                break;
+        }
+    }
+    
+    plugin.stop_processing();
+    plugin.deactivate();
+    plugin.stopCapture();
+    plugin.destroy();
+    return true;
+}
+
+static bool compareOutput(const char* label, const std::vector<uint8_t>& expected, const std::vector<uint8_t>& actual) {
+    size_t common = std::min(expected.size(), actual.size());
+    size_t mismatch = std::mismatch(expected.begin(), expected.begin() + common, actual.begin()).first - expected.begin();
+    if (mismatch == common && expected.size() == actual.size()) {
+        std::printf("%s: %zu bytes match\n", label, expected.size());
+        return true;
+    }
+    
+    std::printf("%s: MISMATCH at byte %zu (captured %zu bytes, replayed %zu bytes)\n",
+                label, mismatch, expected.size(), actual.size());
+    return false;
+}
+
+int main(int argc, char **argv) {
+    if (argc < 2) {
+        std::fprintf(stderr, "Usage: %s CAPTURE [--compare] [--output REPLAY] [--repeat N] [--trace TRACE.json]\n",
+                     argv[0]);
+        return 2;
+    }
+    
+    std::string capture_path = argv[1];
+    std::string output_path;
+    std::string trace_path;
+    bool compare = false;
+    int repeat = 1;
+    
+    for (int i = 2; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if (arg == "--compare") {
+            compare = true;
+        } else if (arg == "--output" && has_value) {
+            output_path = argv[++i];
+        } else if (arg == "--repeat" && has_value) {
+            repeat = std::max(1, std::atoi(argv[++i]));
+        } else if (arg == "--trace" && has_value) {
+            trace_path = argv[++i];
+        } else {
+            std::fprintf(stderr, "Unknown or incomplete argument: %s\n", arg.c_str());
+            return 2;
+        }
+    }
+    
+    if (compare && output_path.empty()) {
+        output_path = capture_path + ".replay";
+    }
+    
+    std::vector<CaptureRecord> records;
+    if (!loadCapture(capture_path, records)) {
+        std::fprintf(stderr, "Failed to read capture %s\n", capture_path.c_str());
+        return 2;
+    }
+    
+    if (!trace_path.empty() && !Tracer::start()) {
+        std::fprintf(stderr, "--trace needs a build configured with -DSPOBX8_ENABLE_TRACING=ON\n");
+        return 2;
+    }
+    
+    ReplayStats stats;
+    for (int run = 0; run < repeat; ++run) {
+        ReplayStats run_stats;
+        // Only the first run is captured; the rest are for timing
+        if (!replay(records, run == 0 ? output_path : std::string(), run_stats)) {
+            return 2;
+        }
+        if (run == 0) {
+            stats = run_stats;
+        } else {
+            stats.process_ns.insert(stats.process_ns.end(), run_stats.process_ns.begin(), run_stats.process_ns.end());
+        }
+    }
+    
+    if (!trace_path.empty() && !Tracer::exportChromeJson(trace_path)) {
+        std::fprintf(stderr, "Failed to write trace %s\n", trace_path.c_str());
+        return 2;
+    }
+    
+    std::printf("%zu records, %llu blocks, %llu flushes, %llu host events, %llu device bytes in\n",
+                records.size(), static_cast<unsigned long long>(stats.blocks),
+                static_cast<unsigned long long>(stats.flushes), static_cast<unsigned long long>(stats.events),
+                static_cast<unsigned long long>(stats.device_bytes_in));
+    if (stats.dropped > 0) {
+        std::printf("warning: capture lost %llu records to a full ring; output may differ\n",
+                    static_cast<unsigned long long>(stats.dropped));
+    }
+    
+    if (!stats.process_ns.empty()) {
+        std::sort(stats.process_ns.begin(), stats.process_ns.end());
+        size_t count = stats.process_ns.size();
+        std::printf("process(): median %llu ns, p99 %llu ns, max %llu ns over %zu calls\n",
+                    static_cast<unsigned long long>(stats.process_ns[count / 2]),
+                    static_cast<unsigned long long>(stats.process_ns[std::min(count - 1, count * 99 / 100)]),
+                    static_cast<unsigned long long>(stats.process_ns.back()), count);
+    }
+    
+    if (!compare) {
+        return 0;
+    }
+    
+    std::vector<CaptureRecord> replayed;
+    if (!loadCapture(output_path, replayed)) {
+        std::fprintf(stderr, "Failed to read replay capture %s\n", output_path.c_str());
+        return 2;
+    }
+    
+    ReplayOutput expected;
+    ReplayOutput actual;
+    collectOutput(records, expected);
+    collectOutput(replayed, actual);
+    
+    bool device_match = compareOutput("device MIDI out", expected.device_bytes, actual.device_bytes);
+    bool host_match = compareOutput("host MIDI out", expected.host_events, actual.host_events);
+    return device_match && host_match ? 0 : 1;
+}